@@ -50,6 +50,14 @@ void Application::KdPostUpdate()
 {
 	// 3DSoundListnerの行列を更新
 	KdAudioManager::Instance().SetListnerMatrix(KdShaderManager::Instance().GetCameraCB().mView.Invert());
+
+	// 登録されたモデルのアニメーション・行列を描画前にまとめて更新
+	KdAnimationBatch::Instance().Execute();
+
+#if KD_COLLISION_STATS
+	// 当たり判定の計測を1フレーム分で区切る
+	KdCollisionStats::Instance().EndFrame();
+#endif
 }
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
@@ -221,6 +229,11 @@ bool Application::Init(int w, int h)
 	//===================================================================
 	KdAudioManager::Instance().Init();
 
+	//===================================================================
+	// アセット先読み初期化
+	// Record：シーン毎に使用したアセットを記録 / Prefetch：記録を元にシーン開始時に並列で先読み
+	//===================================================================
+	KdAssetPrefetcher::Instance().Init(KdAssetPrefetcher::Mode::Disable);
 
 	
 	return true;
@@ -335,6 +348,10 @@ void Application::Execute()
 // アプリケーション終了
 void Application::Release()
 {
+	KdAssetPrefetcher::Instance().Release();
+
+	KdAnimationBatch::Instance().Release();
+
 	KdInputManager::Instance().Release();
 
 	KdShaderManager::Instance().Release();
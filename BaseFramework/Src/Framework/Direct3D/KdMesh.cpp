@@ -11,14 +11,39 @@
 //=============================================================
 
 void KdMesh::SetToDevice() const
+{
+	// 頂点バッファセット
+	if (m_vertexLayout == VertexLayout::Standard)
+	{
+		UINT stride = m_vertexStride;		// 1頂点のサイズ
+		UINT offset = 0;					// オフセット
+		KdDirect3D::Instance().WorkDevContext()->IASetVertexBuffers(0, 1, m_vertBuf.GetAddress(), &stride, &offset);
+	}
+	else
+	{
+		// スロット0：座標　スロット1：座標以外の属性
+		ID3D11Buffer* buffers[2] = { m_posBuf.GetBuffer(), m_vertBuf.GetBuffer() };
+		UINT strides[2] = { sizeof(Math::Vector3), m_vertexStride };
+		UINT offsets[2] = { 0, 0 };
+		KdDirect3D::Instance().WorkDevContext()->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	}
+
+	// インデックスバッファセット
+	KdDirect3D::Instance().WorkDevContext()->IASetIndexBuffer(m_indxBuf.GetBuffer(), m_indexFormat, 0);
+
+	//プリミティブ・トポロジーをセット
+	KdDirect3D::Instance().WorkDevContext()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void KdMesh::SetToDevice(const KdBuffer& vertBuf) const
 {
 	// 頂点バッファセット
 	UINT stride = sizeof(KdMeshVertex);	// 1頂点のサイズ
 	UINT offset = 0;					// オフセット
-	KdDirect3D::Instance().WorkDevContext()->IASetVertexBuffers(0, 1, m_vertBuf.GetAddress(), &stride, &offset);
+	KdDirect3D::Instance().WorkDevContext()->IASetVertexBuffers(0, 1, vertBuf.GetAddress(), &stride, &offset);
 
 	// インデックスバッファセット
-	KdDirect3D::Instance().WorkDevContext()->IASetIndexBuffer(m_indxBuf.GetBuffer(), DXGI_FORMAT_R32_UINT, 0);
+	KdDirect3D::Instance().WorkDevContext()->IASetIndexBuffer(m_indxBuf.GetBuffer(), m_indexFormat, 0);
 
 	//プリミティブ・トポロジーをセット
 	KdDirect3D::Instance().WorkDevContext()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -28,28 +53,54 @@ void KdMesh::SetToDevice() const
 // 生成
 // 頂点配列、インデックス配列、サブセット配列（マテリアルなど）の生成
 //=============================================================
-bool KdMesh::Create(const std::vector<KdMeshVertex>& vertices, const std::vector<KdMeshFace>& faces, const std::vector<KdMeshSubset>& subsets, bool isSkinMesh)
+bool KdMesh::Create(const std::vector<KdMeshVertex>& vertices, const std::vector<KdMeshFace>& faces, const std::vector<KdMeshSubset>& subsets,
+	bool isSkinMesh, VertexLayout layout, UINT residency)
 {
 	Release();
 
+	m_residency = residency;
+
 	//------------------------------
 	// サブセット情報
 	//------------------------------
 	m_subsets = subsets;
 
+	//------------------------------
+	// 頂点の形式を決定
+	//------------------------------
+	if (layout == VertexLayout::Auto)
+	{
+		// スキンメッシュはスキニング情報を持つ必要があるので通常形式
+		if (isSkinMesh)
+		{
+			layout = VertexLayout::Standard;
+		}
+		else
+		{
+			// 16bit浮動小数でテクセル単位の精度が保てる範囲か
+			constexpr float kHalfUVLimit = 2.0f;
+
+			layout = VertexLayout::Compact;
+
+			for (const KdMeshVertex& vertex : vertices)
+			{
+				if (fabsf(vertex.UV.x) > kHalfUVLimit || fabsf(vertex.UV.y) > kHalfUVLimit)
+				{
+					layout = VertexLayout::CompactWideUV;
+					break;
+				}
+			}
+		}
+	}
+
+	m_vertexLayout = layout;
+
 	//------------------------------
 	// 頂点バッファ作成
 	//------------------------------
 	if(vertices.size() > 0)
 	{
-		// 書き込むデータ
-		D3D11_SUBRESOURCE_DATA initData;
-		initData.pSysMem = &vertices[0];				// バッファに書き込む頂点配列の先頭アドレス
-		initData.SysMemPitch = 0;
-		initData.SysMemSlicePitch = 0;
-
-		// 頂点バッファ作成
-		if (FAILED(m_vertBuf.Create(D3D11_BIND_VERTEX_BUFFER, sizeof(KdMeshVertex) * vertices.size(), D3D11_USAGE_DEFAULT, &initData)))
+		if (HasGPUGeometry() && !CreateVertexBuffer(vertices))
 		{
 			Release();
 			return false;
@@ -66,6 +117,13 @@ bool KdMesh::Create(const std::vector<KdMeshVertex>& vertices, const std::vector
 		DirectX::BoundingBox::CreateFromPoints(m_aabb, m_positions.size(), &m_positions[0], sizeof(Math::Vector3));
 		// 境界球データ作成
 		DirectX::BoundingSphere::CreateFromPoints(m_bs, m_positions.size(), &m_positions[0], sizeof(Math::Vector3));
+
+		// 境界データだけ残して座標の複製は破棄する
+		if (!HasCPUGeometry())
+		{
+			m_positions.clear();
+			m_positions.shrink_to_fit();
+		}
 	}	
 
 	//------------------------------
@@ -73,29 +131,194 @@ bool KdMesh::Create(const std::vector<KdMeshVertex>& vertices, const std::vector
 	//------------------------------
 	if(faces.size() > 0)
 	{
-		// 書き込むデータ
-		D3D11_SUBRESOURCE_DATA initData;
-		initData.pSysMem = &faces[0];				// バッファに書き込む頂点配列の先頭アドレス
-		initData.SysMemPitch = 0;
-		initData.SysMemSlicePitch = 0;
-
-		// バッファ作成
-		if (FAILED(m_indxBuf.Create(D3D11_BIND_INDEX_BUFFER, faces.size() * sizeof(KdMeshFace), D3D11_USAGE_DEFAULT, &initData)))
+		if (HasGPUGeometry() && !CreateIndexBuffer(faces, vertices.size()))
 		{
 			Release();
 			return false;
 		}
 
 		// 面情報コピー
-		m_faces = faces;
+		if (HasCPUGeometry())
+		{
+			m_faces = faces;
+		}
 	}
 
 
 	m_isSkinMesh = isSkinMesh;
 
+	//------------------------------
+	// 描画用の変形元の頂点：インスタンス毎にCPUで変形して描画する(KdSkinnedMesh)
+	//------------------------------
+	if (isSkinMesh && HasGPUGeometry())
+	{
+		m_skinSourceVertices = vertices;
+	}
+
+	//------------------------------
+	// スキニング情報：判定時に現在の姿勢へ変形するために残す
+	//------------------------------
+	if (isSkinMesh && HasCPUGeometry() && vertices.size() > 0)
+	{
+		m_skinWeights.resize(vertices.size());
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const KdMeshVertex& vertex = vertices[i];
+
+			m_skinWeights[i].SkinIndexList = vertex.SkinIndexList;
+			m_skinWeights[i].SkinWeightList = vertex.SkinWeightList;
+
+			// ボーン毎の影響範囲を広げる
+			for (int j = 0; j < 4; ++j)
+			{
+				int boneIdx = vertex.SkinIndexList[j];
+
+				if (boneIdx < 0 || vertex.SkinWeightList[j] <= 0.0f) { continue; }
+
+				if (boneIdx >= static_cast<int>(m_boneBounds.size()))
+				{
+					// 未使用のボーンは大きさが負の箱にしておく
+					m_boneBounds.resize(boneIdx + 1, DirectX::BoundingBox(Math::Vector3::Zero, Math::Vector3(-1.0f)));
+				}
+
+				DirectX::BoundingBox& bounds = m_boneBounds[boneIdx];
+
+				if (bounds.Extents.x < 0.0f)
+				{
+					bounds = DirectX::BoundingBox(vertex.Pos, Math::Vector3::Zero);
+				}
+				else
+				{
+					DirectX::BoundingBox point(vertex.Pos, Math::Vector3::Zero);
+					DirectX::BoundingBox::CreateMerged(bounds, bounds, point);
+				}
+			}
+		}
+	}
+
 	return true;
 }
 
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 頂点バッファの作成
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// Compact系は座標を別ストリームに分け、法線・接線を8bit、UVを16bit浮動小数に量子化する
+// 座標だけのストリームは深度描画などで頂点の読み込み量を減らすため
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdMesh::CreateVertexBuffer(const std::vector<KdMeshVertex>& vertices)
+{
+	// 書き込むデータ
+	D3D11_SUBRESOURCE_DATA initData;
+	initData.SysMemPitch = 0;
+	initData.SysMemSlicePitch = 0;
+
+	// 通常形式はそのまま転送
+	if (m_vertexLayout == VertexLayout::Standard)
+	{
+		m_vertexStride = sizeof(KdMeshVertex);
+
+		initData.pSysMem = &vertices[0];
+
+		return m_vertBuf.Create(D3D11_BIND_VERTEX_BUFFER, m_vertexStride * vertices.size(), D3D11_USAGE_DEFAULT, &initData);
+	}
+
+	//------------------------------
+	// 座標ストリーム
+	//------------------------------
+	std::vector<Math::Vector3> positions(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		positions[i] = vertices[i].Pos;
+	}
+
+	initData.pSysMem = &positions[0];
+
+	if (!m_posBuf.Create(D3D11_BIND_VERTEX_BUFFER, sizeof(Math::Vector3) * positions.size(), D3D11_USAGE_DEFAULT, &initData))
+	{
+		return false;
+	}
+
+	//------------------------------
+	// 属性ストリーム
+	//------------------------------
+	if (m_vertexLayout == VertexLayout::Compact)
+	{
+		std::vector<KdMeshCompactVertex> compactVertices(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const KdMeshVertex& src = vertices[i];
+			KdMeshCompactVertex& dst = compactVertices[i];
+
+			dst.UV = DirectX::PackedVector::XMHALF2(src.UV.x, src.UV.y);
+			dst.Color = src.Color;
+			dst.Normal = DirectX::PackedVector::XMBYTEN4(src.Normal.x, src.Normal.y, src.Normal.z, 0.0f);
+			dst.Tangent = DirectX::PackedVector::XMBYTEN4(src.Tangent.x, src.Tangent.y, src.Tangent.z, 0.0f);
+		}
+
+		m_vertexStride = sizeof(KdMeshCompactVertex);
+
+		initData.pSysMem = &compactVertices[0];
+
+		return m_vertBuf.Create(D3D11_BIND_VERTEX_BUFFER, m_vertexStride * compactVertices.size(), D3D11_USAGE_DEFAULT, &initData);
+	}
+
+	std::vector<KdMeshCompactWideUVVertex> compactVertices(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const KdMeshVertex& src = vertices[i];
+		KdMeshCompactWideUVVertex& dst = compactVertices[i];
+
+		dst.UV = src.UV;
+		dst.Color = src.Color;
+		dst.Normal = DirectX::PackedVector::XMBYTEN4(src.Normal.x, src.Normal.y, src.Normal.z, 0.0f);
+		dst.Tangent = DirectX::PackedVector::XMBYTEN4(src.Tangent.x, src.Tangent.y, src.Tangent.z, 0.0f);
+	}
+
+	m_vertexStride = sizeof(KdMeshCompactWideUVVertex);
+
+	initData.pSysMem = &compactVertices[0];
+
+	return m_vertBuf.Create(D3D11_BIND_VERTEX_BUFFER, m_vertexStride * compactVertices.size(), D3D11_USAGE_DEFAULT, &initData);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// インデックスバッファの作成
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 頂点数が65536未満なら16bitインデックスでメモリと帯域を半分にする
+// 当たり判定用の面情報(m_faces)は32bitのまま保持する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdMesh::CreateIndexBuffer(const std::vector<KdMeshFace>& faces, size_t vertexNum)
+{
+	// 書き込むデータ
+	D3D11_SUBRESOURCE_DATA initData;
+	initData.SysMemPitch = 0;
+	initData.SysMemSlicePitch = 0;
+
+	if (vertexNum < 65536)
+	{
+		std::vector<uint16_t> indices(faces.size() * 3);
+		for (size_t i = 0; i < faces.size(); ++i)
+		{
+			indices[i * 3 + 0] = static_cast<uint16_t>(faces[i].Idx[0]);
+			indices[i * 3 + 1] = static_cast<uint16_t>(faces[i].Idx[1]);
+			indices[i * 3 + 2] = static_cast<uint16_t>(faces[i].Idx[2]);
+		}
+
+		m_indexFormat = DXGI_FORMAT_R16_UINT;
+
+		initData.pSysMem = &indices[0];
+
+		return m_indxBuf.Create(D3D11_BIND_INDEX_BUFFER, indices.size() * sizeof(uint16_t), D3D11_USAGE_DEFAULT, &initData);
+	}
+
+	m_indexFormat = DXGI_FORMAT_R32_UINT;
+
+	initData.pSysMem = &faces[0];				// バッファに書き込む頂点配列の先頭アドレス
+
+	return m_indxBuf.Create(D3D11_BIND_INDEX_BUFFER, faces.size() * sizeof(KdMeshFace), D3D11_USAGE_DEFAULT, &initData);
+}
+
 
 void KdMesh::DrawSubset(int subsetNo) const
 {
@@ -107,3 +330,117 @@ void KdMesh::DrawSubset(int subsetNo) const
 	// 描画
 	KdDirect3D::Instance().WorkDevContext()->DrawIndexed(m_subsets[subsetNo].FaceCount * 3, m_subsets[subsetNo].FaceStart * 3, 0);
 }
+
+void KdMesh::DrawFaces(UINT faceStart, UINT faceCount) const
+{
+	if (faceCount == 0)return;
+
+	// 描画
+	KdDirect3D::Instance().WorkDevContext()->DrawIndexed(faceCount * 3, faceStart * 3, 0);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 当たり判定用のBVHの作成
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdMesh::BuildBVH()
+{
+	if (m_faces.empty()) { return; }
+
+	m_spBVH = std::make_shared<KdMeshBVH>();
+	m_spBVH->Build(m_positions, m_faces);
+}
+
+bool KdMesh::SaveBVH(std::ostream& os) const
+{
+	if (!m_spBVH) { return false; }
+
+	return m_spBVH->Save(os);
+}
+
+bool KdMesh::LoadBVH(std::istream& is)
+{
+	if (m_faces.empty()) { return false; }
+
+	std::shared_ptr<KdMeshBVH> spBVH = std::make_shared<KdMeshBVH>();
+
+	if (!spBVH->Load(is, m_positions, m_faces)) { return false; }
+
+	m_spBVH = spBVH;
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// スキンメッシュを指定の姿勢に変形した当たり判定用の形状を作成・更新する
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 頂点毎に 座標 x スキンの行列 をウェイトで合成する(シェーダーのスキニングと同じ計算)
+// 面の分け方は変わらないので、BVHは初回だけ作成し以降は箱の計算し直しだけで済ませる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdMesh::UpdateSkinnedCollision(const KdMesh& src, const std::vector<Math::Matrix>& skinMatrices)
+{
+	const std::vector<Math::Vector3>& srcPositions = src.m_positions;
+	const std::vector<KdMeshSkinWeight>& skinWeights = src.m_skinWeights;
+
+	if (srcPositions.empty() || skinWeights.size() != srcPositions.size()) { return; }
+
+	bool isFirst = (m_positions.size() != srcPositions.size());
+
+	if (isFirst)
+	{
+		Release();
+
+		m_residency = ResidencyCPU;
+		m_isSkinMesh = false;
+
+		m_subsets = src.m_subsets;
+		m_faces = src.m_faces;
+		m_positions.resize(srcPositions.size());
+	}
+
+	const int boneNum = static_cast<int>(skinMatrices.size());
+
+	for (size_t i = 0; i < srcPositions.size(); ++i)
+	{
+		const KdMeshSkinWeight& skin = skinWeights[i];
+
+		DirectX::XMVECTOR srcPos = DirectX::XMLoadFloat3(&srcPositions[i]);
+		DirectX::XMVECTOR skinnedPos = DirectX::XMVectorZero();
+
+		float totalWeight = 0.0f;
+
+		for (int j = 0; j < 4; ++j)
+		{
+			int boneIdx = skin.SkinIndexList[j];
+			float weight = skin.SkinWeightList[j];
+
+			if (weight <= 0.0f || boneIdx < 0 || boneIdx >= boneNum) { continue; }
+
+			skinnedPos = DirectX::XMVectorMultiplyAdd(DirectX::XMVector3TransformCoord(srcPos, skinMatrices[boneIdx]),
+				DirectX::XMVectorReplicate(weight), skinnedPos);
+
+			totalWeight += weight;
+		}
+
+		// どのボーンの影響も受けていない頂点は元の位置のまま
+		if (totalWeight <= 0.0f)
+		{
+			skinnedPos = srcPos;
+		}
+
+		DirectX::XMStoreFloat3(&m_positions[i], skinnedPos);
+	}
+
+	DirectX::BoundingBox::CreateFromPoints(m_aabb, m_positions.size(), &m_positions[0], sizeof(Math::Vector3));
+	DirectX::BoundingSphere::CreateFromPoints(m_bs, m_positions.size(), &m_positions[0], sizeof(Math::Vector3));
+
+	if (m_faces.empty()) { return; }
+
+	if (isFirst || !m_spBVH)
+	{
+		BuildBVH();
+	}
+	else
+	{
+		m_spBVH->Refit(m_positions, m_faces);
+	}
+}
@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+class KdMeshBVH;
+
 //==========================================================
 // メッシュ用 頂点情報
 //==========================================================
@@ -15,6 +17,31 @@ struct KdMeshVertex
 	std::array<float, 4>	SkinWeightList;		// スキニングウェイトリスト
 };
 
+//==========================================================
+// メッシュ用 圧縮頂点情報(スタティックメッシュ用)
+// 座標は別ストリーム(Math::Vector3の配列)で持ち、それ以外の属性を量子化して詰める
+// スキニング情報は持たない
+//==========================================================
+struct KdMeshCompactVertex
+{
+	DirectX::PackedVector::XMHALF2	UV;			// UV(16bit浮動小数)
+	unsigned int					Color = 0xFFFFFFFF;	// RGBA色
+	DirectX::PackedVector::XMBYTEN4	Normal;		// 法線(各成分-1～1を8bitに量子化)
+	DirectX::PackedVector::XMBYTEN4	Tangent;	// 接線(各成分-1～1を8bitに量子化)
+};
+
+//==========================================================
+// メッシュ用 圧縮頂点情報(UVの範囲が広いスタティックメッシュ用)
+// 16bit浮動小数では精度が足りない大きなUV(タイリングした地形など)はfloatのまま持つ
+//==========================================================
+struct KdMeshCompactWideUVVertex
+{
+	Math::Vector2					UV;			// UV
+	unsigned int					Color = 0xFFFFFFFF;	// RGBA色
+	DirectX::PackedVector::XMBYTEN4	Normal;		// 法線(各成分-1～1を8bitに量子化)
+	DirectX::PackedVector::XMBYTEN4	Tangent;	// 接線(各成分-1～1を8bitに量子化)
+};
+
 //==========================================================
 // メッシュ用 面情報
 //==========================================================
@@ -23,6 +50,15 @@ struct KdMeshFace
 	UINT Idx[3];				// 三角形を構成する頂点のIndex
 };
 
+//==========================================================
+// メッシュ用 スキニング情報(当たり判定用にCPU側で保持する)
+//==========================================================
+struct KdMeshSkinWeight
+{
+	std::array<short, 4>	SkinIndexList;		// スキニングIndexリスト
+	std::array<float, 4>	SkinWeightList;		// スキニングウェイトリスト
+};
+
 //==========================================================
 // メッシュ用 サブセット情報
 //==========================================================
@@ -43,6 +79,24 @@ class KdMesh
 {
 public:
 
+	// GPUに転送する頂点の形式
+	enum class VertexLayout
+	{
+		Auto,			// 作成時のみ指定可能：スキンメッシュはStandard、それ以外は頂点のUVの範囲からCompact系を選ぶ
+		Standard,		// KdMeshVertexをそのまま1ストリームで転送(72byte/頂点)
+		Compact,		// 座標ストリーム(12byte) + KdMeshCompactVertex(16byte)
+		CompactWideUV,	// 座標ストリーム(12byte) + KdMeshCompactWideUVVertex(20byte)
+	};
+
+	// 形状データをどこに保持するか(ビットフラグ)
+	enum Residency
+	{
+		ResidencyGPU = 1 << 0,	// 頂点・インデックスバッファを作成する：描画に必要
+		ResidencyCPU = 1 << 1,	// 座標・面の配列を保持する：当たり判定に必要
+
+		ResidencyAll = ResidencyGPU | ResidencyCPU,
+	};
+
 	//=================================================
 	// 取得・設定
 	//=================================================
@@ -61,11 +115,46 @@ public:
 	const DirectX::BoundingSphere&		GetBoundingSphere() const { return m_bs; }
 
 	// メッシュデータをデバイスへセットする
+	// 入力レイアウトはGetVertexLayout()に合わせたものをシェーダー側でセットすること
 	void SetToDevice() const;
+	// 頂点バッファだけ差し替えてセットする(KdSkinnedMeshで変形した頂点など)：入力レイアウトはStandard
+	void SetToDevice(const KdBuffer& vertBuf) const;
+
+	// 頂点の形式
+	VertexLayout GetVertexLayout() const { return m_vertexLayout; }
+	// インデックスの形式(DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT)
+	DXGI_FORMAT GetIndexFormat() const { return m_indexFormat; }
 
 	// スキンメッシュ？
 	bool IsSkinMesh() const { return m_isSkinMesh; }
 
+	// 描画用のバッファを持っているか
+	bool HasGPUGeometry() const { return (m_residency & ResidencyGPU) != 0; }
+	// 当たり判定用の座標・面の配列を持っているか
+	bool HasCPUGeometry() const { return (m_residency & ResidencyCPU) != 0; }
+
+	// スキニング情報の配列：スキンメッシュでCPU側に形状を保持している場合のみ(頂点と同じ数)
+	const std::vector<KdMeshSkinWeight>&	GetSkinWeights() const { return m_skinWeights; }
+	// ボーン毎の、そのボーンの影響を受ける頂点の範囲(メッシュの空間)
+	const std::vector<DirectX::BoundingBox>&	GetBoneBounds() const { return m_boneBounds; }
+	// 描画用に変形する元の頂点：スキンメッシュで描画用のバッファを持つ場合のみ
+	const std::vector<KdMeshVertex>&	GetSkinSourceVertices() const { return m_skinSourceVertices; }
+
+	// 当たり判定用のBVH：未作成ならnullptr(判定は総当たりになる)
+	const KdMeshBVH* GetBVH() const { return m_spBVH.get(); }
+
+	// BVHの作成：CPU側に形状を保持している場合のみ
+	void BuildBVH();
+	// BVHのキャッシュファイルへの書き出し・読込
+	bool SaveBVH(std::ostream& os) const;
+	bool LoadBVH(std::istream& is);
+
+	// スキンメッシュを指定の姿勢に変形した、当たり判定専用の形状を作成・更新する
+	// ・src			… 変形元のスキンメッシュ(CPU側にスキニング情報を持つもの)
+	// ・skinMatrices	… ボーン毎のスキンの行列(オフセット行列 x ボーンの行列)
+	// 初回は面の複製とBVHの作成を行い、2回目以降は座標の更新とBVHの箱の計算し直し(Refit)だけを行う
+	void UpdateSkinnedCollision(const KdMesh& src, const std::vector<Math::Matrix>& skinMatrices);
+
 	//=================================================
 	// 作成・解放
 	//=================================================
@@ -74,17 +163,25 @@ public:
 	// ・vertices		… 頂点配列
 	// ・faces			… 面インデックス情報配列
 	// ・subsets		… サブセット情報配列
+	// ・layout			… GPUに転送する頂点の形式
+	// ・residency		… 形状データの保持先(Residencyの組み合わせ)：描画しないならGPU、判定しないならCPUを外す
 	// 戻り値			… 成功：true
-	bool Create(const std::vector<KdMeshVertex>& vertices, const std::vector<KdMeshFace>& faces, const std::vector<KdMeshSubset>& subsets, bool isSkinMesh);
+	bool Create(const std::vector<KdMeshVertex>& vertices, const std::vector<KdMeshFace>& faces, const std::vector<KdMeshSubset>& subsets,
+		bool isSkinMesh, VertexLayout layout = VertexLayout::Auto, UINT residency = ResidencyAll);
 
 	// 解放
 	void Release()
 	{
+		m_posBuf.Release();
 		m_vertBuf.Release();
 		m_indxBuf.Release();
 		m_subsets.clear();
 		m_positions.clear();
 		m_faces.clear();
+		m_skinWeights.clear();
+		m_boneBounds.clear();
+		m_skinSourceVertices.clear();
+		m_spBVH = nullptr;
 	}
 
 	~KdMesh()
@@ -98,17 +195,30 @@ public:
 
 	// 指定サブセットを描画
 	void DrawSubset(int subsetNo) const;
+	// 指定範囲の面を描画
+	void DrawFaces(UINT faceStart, UINT faceCount) const;
 
 	// 
 	KdMesh() {}
 
 private:
 
+	// 頂点バッファの作成
+	bool CreateVertexBuffer(const std::vector<KdMeshVertex>& vertices);
+	// インデックスバッファの作成：頂点数が65536未満なら16bitインデックスにする
+	bool CreateIndexBuffer(const std::vector<KdMeshFace>& faces, size_t vertexNum);
+
+	// 座標のみの頂点バッファ(Compact系のみ)
+	KdBuffer					m_posBuf;
 	// 頂点バッファ
 	KdBuffer					m_vertBuf;
 	// インデックスバッファ
 	KdBuffer					m_indxBuf;
 
+	VertexLayout				m_vertexLayout = VertexLayout::Standard;
+	UINT						m_vertexStride = sizeof(KdMeshVertex);	// m_vertBufの1頂点のサイズ
+	DXGI_FORMAT					m_indexFormat = DXGI_FORMAT_R32_UINT;
+
 	// サブセット情報
 	std::vector<KdMeshSubset>	m_subsets;
 
@@ -121,8 +231,20 @@ private:
 	// 面情報のみの配列(複製)
 	std::vector<KdMeshFace>		m_faces;
 
+	// スキニング情報のみの配列(複製)
+	std::vector<KdMeshSkinWeight>		m_skinWeights;
+	// ボーン毎の影響を受ける頂点の範囲
+	std::vector<DirectX::BoundingBox>	m_boneBounds;
+	// 描画用に変形する元の頂点(複製)
+	std::vector<KdMeshVertex>			m_skinSourceVertices;
+
 	bool						m_isSkinMesh = false;
 
+	UINT						m_residency = ResidencyAll;
+
+	// 当たり判定用の面の空間分割
+	std::shared_ptr<KdMeshBVH>	m_spBVH = nullptr;
+
 private:
 	// コピー禁止用
 	KdMesh(const KdMesh& src) = delete;
@@ -28,6 +28,8 @@ bool KdModelData::Load(std::string_view filename)
 
 	CreateAnimations(spGltfModel);
 
+	CreateCollisionBVH(filename);
+
 	return true;
 }
 
@@ -46,17 +48,8 @@ void KdModelData::CreateNodes(const std::shared_ptr<KdGLTFModel>& spGltfModel)
 
 		if (rSrcNode.IsMesh)
 		{
-			// メッシュ作成
-			rDstNode.m_spMesh = std::make_shared<KdMesh>();
-
-			if (rDstNode.m_spMesh)
-			{
-				rDstNode.m_spMesh->Create(rSrcNode.Mesh.Vertices, rSrcNode.Mesh.Faces, rSrcNode.Mesh.Subsets, rSrcNode.Mesh.IsSkinMesh);
-			}
-
-			// メッシュノードリストにインデックス登録
+			// メッシュノードリストにインデックス登録：メッシュ本体は用途が確定してから作成する
 			m_meshNodeIndices.push_back(i);
-
 		}
 
 		// ノード情報セット
@@ -102,12 +95,133 @@ void KdModelData::CreateNodes(const std::shared_ptr<KdGLTFModel>& spGltfModel)
 		}
 	}
 
+	//------------------------------
+	// 行列の計算順
+	// ルートから深さ優先で辿り、子孫の数は後ろから足し合わせる
+	//------------------------------
+	m_nodeOrder.clear();
+	m_nodeOrder.reserve(m_originalNodes.size());
+
+	std::vector<int> stack(m_rootNodeIndices.rbegin(), m_rootNodeIndices.rend());
+
+	while (!stack.empty())
+	{
+		int nodeIdx = stack.back();
+		stack.pop_back();
+
+		OrderedNode& ordered = m_nodeOrder.emplace_back();
+		ordered.m_nodeIdx = nodeIdx;
+		ordered.m_parent = m_originalNodes[nodeIdx].m_parent;
+
+		// 先頭の子から処理されるように逆順に積む
+		const std::vector<int>& children = m_originalNodes[nodeIdx].m_children;
+		stack.insert(stack.end(), children.rbegin(), children.rend());
+	}
+
+	std::vector<UINT> orderPositions(m_originalNodes.size(), 0);
+
+	for (UINT pos = 0; pos < m_nodeOrder.size(); ++pos)
+	{
+		orderPositions[m_nodeOrder[pos].m_nodeIdx] = pos;
+	}
+
+	for (size_t pos = m_nodeOrder.size(); pos-- > 0; )
+	{
+		int parent = m_nodeOrder[pos].m_parent;
+
+		if (parent >= 0) { m_nodeOrder[orderPositions[parent]].m_subtreeSize += m_nodeOrder[pos].m_subtreeSize; }
+	}
+
 	// 当たり判定用ノードが1つも見つからなければ、m_drawMeshNodeと同じ割り当てを行い
 	// 見た目 = 当たり判定となる
 	if (!m_collisionMeshNodeIndices.size())
 	{
 		m_collisionMeshNodeIndices = m_drawMeshNodeIndices;
 	}
+
+	// メッシュ作成
+	// 描画に使うノードだけGPUにバッファを作り、判定に使うノードだけCPUに形状を残す
+	for (int nodeIdx : m_meshNodeIndices)
+	{
+		const KdGLTFNode& rSrcNode = spGltfModel->Nodes[nodeIdx];
+
+		UINT residency = 0;
+
+		if (std::find(m_drawMeshNodeIndices.begin(), m_drawMeshNodeIndices.end(), nodeIdx) != m_drawMeshNodeIndices.end())
+		{
+			residency |= KdMesh::ResidencyGPU;
+		}
+
+		if (std::find(m_collisionMeshNodeIndices.begin(), m_collisionMeshNodeIndices.end(), nodeIdx) != m_collisionMeshNodeIndices.end())
+		{
+			residency |= KdMesh::ResidencyCPU;
+		}
+
+		m_originalNodes[nodeIdx].m_spMesh = std::make_shared<KdMesh>();
+
+		m_originalNodes[nodeIdx].m_spMesh->Create(rSrcNode.Mesh.Vertices, rSrcNode.Mesh.Faces, rSrcNode.Mesh.Subsets,
+			rSrcNode.Mesh.IsSkinMesh, KdMesh::VertexLayout::Auto, residency);
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 当たり判定用メッシュのBVH作成
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// モデルファイルより新しいキャッシュファイル(モデルのパス + ".bvh")があれば読み込む
+// 無い・古い・壊れている場合は作成し直してキャッシュファイルに書き出す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdModelData::CreateCollisionBVH(std::string_view modelFileName)
+{
+	std::vector<std::shared_ptr<KdMesh>> targetMeshes;
+
+	for (int nodeIdx : m_collisionMeshNodeIndices)
+	{
+		const std::shared_ptr<KdMesh>& spMesh = m_originalNodes[nodeIdx].m_spMesh;
+
+		if (spMesh && !spMesh->GetFaces().empty()) { targetMeshes.push_back(spMesh); }
+	}
+
+	if (targetMeshes.empty()) { return; }
+
+	std::string cachePath = std::string(modelFileName) + ".bvh";
+
+	//------------------------------
+	// キャッシュファイルの読込
+	//------------------------------
+	std::error_code ec;
+
+	if (std::filesystem::exists(cachePath, ec) &&
+		std::filesystem::last_write_time(cachePath, ec) >= std::filesystem::last_write_time(modelFileName, ec))
+	{
+		std::ifstream ifs(cachePath, std::ios::binary);
+
+		bool isLoaded = ifs.good();
+
+		for (size_t i = 0; isLoaded && i < targetMeshes.size(); ++i)
+		{
+			isLoaded = targetMeshes[i]->LoadBVH(ifs);
+		}
+
+		if (isLoaded) { return; }
+	}
+
+	//------------------------------
+	// 作成と書き出し
+	//------------------------------
+	for (const std::shared_ptr<KdMesh>& spMesh : targetMeshes)
+	{
+		spMesh->BuildBVH();
+	}
+
+	std::ofstream ofs(cachePath, std::ios::binary);
+
+	// 書き出せなくても判定には影響しないので何もしない
+	if (!ofs) { return; }
+
+	for (const std::shared_ptr<KdMesh>& spMesh : targetMeshes)
+	{
+		spMesh->SaveBVH(ofs);
+	}
 }
 
 // マテリアル作成
@@ -164,13 +278,38 @@ void KdModelData::CreateAnimations(const std::shared_ptr<KdGLTFModel>& spGltfMod
 		for (UINT j = 0; j < rDstAnimation.m_nodes.size(); ++j)
 		{
 			rDstAnimation.m_nodes[j].m_nodeOffset = rSrcAnimation.m_nodes[j]->m_nodeOffset;
-			rDstAnimation.m_nodes[j].m_translations = rSrcAnimation.m_nodes[j]->m_translations;
-			rDstAnimation.m_nodes[j].m_rotations = rSrcAnimation.m_nodes[j]->m_rotations;
-			rDstAnimation.m_nodes[j].m_scales = rSrcAnimation.m_nodes[j]->m_scales;
+			rDstAnimation.m_nodes[j].m_translations.SetKeys(rSrcAnimation.m_nodes[j]->m_translations, &KdAnimKeyVector3::m_vec);
+			rDstAnimation.m_nodes[j].m_rotations.SetKeys(rSrcAnimation.m_nodes[j]->m_rotations, &KdAnimKeyQuaternion::m_quat);
+			rDstAnimation.m_nodes[j].m_scales.SetKeys(rSrcAnimation.m_nodes[j]->m_scales, &KdAnimKeyVector3::m_vec);
+		}
+
+		// キーの圧縮
+		const KdAnimCompressSettings& compressSettings = GetAnimationCompressSettings();
+
+		if (compressSettings.m_enable)
+		{
+			KdCompressAnimation(rDstAnimation, compressSettings);
 		}
 	}
 }
 
+// アニメーションの圧縮設定
+static KdAnimCompressSettings& AnimationCompressSettings()
+{
+	static KdAnimCompressSettings settings;
+	return settings;
+}
+
+void KdModelData::SetAnimationCompressSettings(const KdAnimCompressSettings& settings)
+{
+	AnimationCompressSettings() = settings;
+}
+
+const KdAnimCompressSettings& KdModelData::GetAnimationCompressSettings()
+{
+	return AnimationCompressSettings();
+}
+
 // アニメーションデータ取得：文字列検索
 const std::shared_ptr<KdAnimationData> KdModelData::GetAnimation(std::string_view animName) const
 {
@@ -200,6 +339,8 @@ void KdModelData::Release()
 	m_rootNodeIndices.clear();
 	m_boneNodeIndices.clear();
 	m_meshNodeIndices.clear();
+
+	m_nodeOrder.clear();
 }
 
 bool KdModelData::IsSkinMesh()
@@ -225,99 +366,298 @@ const KdModelData::Node* KdModelWork::FindDataNode(std::string_view name) const
 	return m_spData->FindNode(name.data());
 }
 
-// ノード検索：文字列
-const KdModelWork::Node* KdModelWork::FindNode(std::string_view name) const
-{
-	for (auto&& node : m_coppiedNodes)
+// モデル設定：ノードの行列は書き換えるまでモデルデータと共有する
+void KdModelWork::SetModelData(const std::shared_ptr<KdModelData>& rModel)
+{ 
+	m_spData = rModel;
+
+	// モデルデータの行列は計算済みなので再計算は不要
+	m_localTransforms.clear();
+	m_worldTransforms.clear();
+	m_dirtyNodes.clear();
+
+	m_needCalcNode = false;
+
+	// 別のモデルの変形済みの形状は使えない
+	m_skinnedCollisions.clear();
+	m_skinnedMeshes.clear();
+	m_skinnedVersion = 0;
+
+	++m_poseVersion;
+
+	// スキンメッシュは読込時の行列が ローカル行列 x 親の行列 と一致しないことがある(ボーン以外の親を持つボーンなど)
+	// 複製して全てのルートを再計算の対象にし、最初の計算で親から順に求め直す
+	if (m_spData && m_spData->IsSkinMesh())
 	{
-		if (node.m_name == name.data())
+		MakeUniqueTransforms();
+
+		for (const KdModelData::OrderedNode& ordered : m_spData->GetNodeOrder())
 		{
-			return &node;
+			if (ordered.m_parent < 0) { MarkDirty(ordered.m_nodeIdx); }
 		}
 	}
+}
 
-	return nullptr;
+void KdModelWork::SetModelData(std::string_view fileName)
+{
+	// モデルのセット
+	SetModelData(KdAssets::Instance().m_modeldatas.GetData(fileName));
 }
 
-// 可変ノード検索：文字列
-KdModelWork::Node* KdModelWork::FindWorkNode(std::string_view name)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ノードの行列の複製
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 最初に行列を書き換える時に、モデルデータの行列を複製して以降はそちらを使う
+// 複製した時点の行列はモデルデータと同じなので再計算は不要
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdModelWork::MakeUniqueTransforms()
 {
-	for (auto&& node : m_coppiedNodes)
+	if (!m_localTransforms.empty()) { return; }
+
+	const std::vector<KdModelData::Node>& dataNodes = GetDataNodes();
+
+	m_localTransforms.resize(dataNodes.size());
+	m_worldTransforms.resize(dataNodes.size());
+
+	for (size_t i = 0; i < dataNodes.size(); ++i)
 	{
-		if (node.m_name == name.data())
+		m_localTransforms[i] = dataNodes[i].m_localTransform;
+		m_worldTransforms[i] = dataNodes[i].m_worldTransform;
+	}
+
+	m_dirtyNodes.assign(dataNodes.size(), 0);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ルートノードから各ノードの行列を計算していく
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 親が子より前に並んだ順番で1回のループで計算する
+// 変更したノードが見つかったら、その部分木(直後に並ぶ子孫)の範囲を計算し、それ以外は計算しない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdModelWork::CalcNodeMatrices()
+{
+	if (!m_spData) { assert(0 && "モデルのないノード行列計算"); return; }
+
+	// 書き換えていなければモデルデータの行列のまま
+	if (m_localTransforms.empty())
+	{
+		m_needCalcNode = false;
+		return;
+	}
+
+	const std::vector<KdModelData::OrderedNode>& nodeOrder = m_spData->GetNodeOrder();
+
+	// この位置より前は再計算する部分木の中
+	size_t dirtyEnd = 0;
+
+	for (size_t pos = 0; pos < nodeOrder.size(); ++pos)
+	{
+		const KdModelData::OrderedNode& ordered = nodeOrder[pos];
+
+		if (m_dirtyNodes[ordered.m_nodeIdx])
 		{
-			m_needCalcNode = true;
+			dirtyEnd = std::max(dirtyEnd, pos + ordered.m_subtreeSize);
+
+			m_dirtyNodes[ordered.m_nodeIdx] = 0;
+		}
+
+		if (pos >= dirtyEnd) { continue; }
 
-			return &node;
+		DirectX::XMMATRIX world = DirectX::XMLoadFloat4x4(&m_localTransforms[ordered.m_nodeIdx]);
+
+		// 親との行列を合成：親が居ない場合は親は自分自身とする
+		if (ordered.m_parent >= 0)
+		{
+			world = DirectX::XMMatrixMultiply(world, DirectX::XMLoadFloat4x4(&m_worldTransforms[ordered.m_parent]));
 		}
+
+		DirectX::XMStoreFloat4x4(&m_worldTransforms[ordered.m_nodeIdx], world);
 	}
 
-	return nullptr;
+	m_needCalcNode = false;
+
+	++m_poseVersion;
 }
 
-// モデル設定：コピーノードの生成
-void KdModelWork::SetModelData(const std::shared_ptr<KdModelData>& rModel)
-{ 
-	m_spData = rModel;
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 当たり判定に使うメッシュ
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// スキンメッシュは頂点をボーンで変形させた形状を判定に使う
+// 判定の度に変形すると重いので、判定対象になった時に1回だけ変形して同じ姿勢の間は使い回す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+const KdMesh* KdModelWork::GetCollisionMesh(int nodeIdx, Math::Matrix& meshMatrix) const
+{
+	if (!m_spData || nodeIdx < 0 || nodeIdx >= static_cast<int>(GetNodeNum())) { return nullptr; }
 
-	UINT nodeSize = rModel->GetOriginalNodes().size();
+	const KdMesh* pMesh = GetDataNodes()[nodeIdx].m_spMesh.get();
 
-	m_coppiedNodes.resize(nodeSize);
+	if (!pMesh) { return nullptr; }
 
-	// ノードのコピーを生成
-	for (UINT i = 0; i < nodeSize; ++i)
+	// 通常のメッシュ・スキニング情報を持たないメッシュはノードの行列で動かす
+	if (!pMesh->IsSkinMesh() || pMesh->GetSkinWeights().empty())
 	{
-		m_coppiedNodes[i].copy(rModel->GetOriginalNodes()[i]);
+		meshMatrix = GetWorldTransform(nodeIdx);
+
+		return pMesh;
 	}
 
-	m_needCalcNode = true;
-}
+	// 変形済みの頂点はモデルの原点の空間にある
+	meshMatrix = Math::Matrix::Identity;
 
-void KdModelWork::SetModelData(std::string_view fileName)
-{
-	// モデルのセット
-	SetModelData(KdAssets::Instance().m_modeldatas.GetData(fileName));
+	std::lock_guard<std::mutex> lock(m_skinningMutex);
+
+	if (m_skinnedCollisions.size() != GetNodeNum())
+	{
+		m_skinnedCollisions.resize(GetNodeNum());
+	}
+
+	SkinnedCollision& skinned = m_skinnedCollisions[nodeIdx];
+
+	if (skinned.m_poseVersion != m_poseVersion)
+	{
+		UpdateSkinMatrices();
+
+		if (!skinned.m_spMesh) { skinned.m_spMesh = std::make_shared<KdMesh>(); }
+
+		skinned.m_spMesh->UpdateSkinnedCollision(*pMesh, m_skinMatrices);
+		skinned.m_poseVersion = m_poseVersion;
+	}
+
+	return skinned.m_spMesh.get();
 }
 
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 当たり判定に使うメッシュの境界ボックス(モデルの原点の空間)
 // ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
-// ルートノードから各ノードの行列を計算していく
-// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
-void KdModelWork::CalcNodeMatrices()
+// スキンメッシュの頂点はボーン毎に動かした位置の重み付き平均なので、
+// 影響するボーンの箱をそれぞれ動かして合わせた範囲に必ず収まる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdModelWork::CalcCollisionMeshBounds(int nodeIdx, DirectX::BoundingBox& out) const
 {
-	if (!m_spData) { assert(0 && "モデルのないノード行列計算"); return; }
+	if (!m_spData || nodeIdx < 0 || nodeIdx >= static_cast<int>(GetNodeNum())) { return false; }
+
+	const KdMesh* pMesh = GetDataNodes()[nodeIdx].m_spMesh.get();
+
+	if (!pMesh) { return false; }
 
-	// 全ボーン行列を書き込み
-	for (auto&& nodeIdx : m_spData->GetRootNodeIndices())
+	if (!pMesh->IsSkinMesh() || pMesh->GetSkinWeights().empty())
 	{
-		recCalcNodeMatrices(nodeIdx);
+		pMesh->GetBoundingBox().Transform(out, GetWorldTransform(nodeIdx));
+
+		return true;
 	}
 
-	m_needCalcNode = false;
+	std::lock_guard<std::mutex> lock(m_skinningMutex);
+
+	UpdateSkinMatrices();
+
+	const std::vector<DirectX::BoundingBox>& boneBounds = pMesh->GetBoneBounds();
+
+	bool isFirst = true;
+
+	for (size_t boneIdx = 0; boneIdx < boneBounds.size() && boneIdx < m_skinMatrices.size(); ++boneIdx)
+	{
+		// 影響する頂点の無いボーン
+		if (boneBounds[boneIdx].Extents.x < 0.0f) { continue; }
+
+		DirectX::BoundingBox boneBox;
+		boneBounds[boneIdx].Transform(boneBox, m_skinMatrices[boneIdx]);
+
+		if (isFirst)
+		{
+			out = boneBox;
+			isFirst = false;
+		}
+		else
+		{
+			DirectX::BoundingBox::CreateMerged(out, out, boneBox);
+		}
+	}
+
+	return !isFirst;
 }
 
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 描画用のスキンメッシュの変形
 // ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
-// ノード行列計算用の再起用関数
-// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
-void KdModelWork::recCalcNodeMatrices(int nodeIdx, int parentNodeIdx)
+// ボーン毎のスキンの行列(ボーンパレット)を現在のノードの行列から求め、描画するスキンメッシュを全て変形する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdModelWork::UpdateSkinning()
 {
-	auto& data = m_spData->GetOriginalNodes()[nodeIdx];
-	auto& work = m_coppiedNodes[nodeIdx];
+	if (!m_spData) { return; }
+
+	if (m_needCalcNode) { CalcNodeMatrices(); }
 
-	// 親との行列を合成
-	if (parentNodeIdx >= 0)
+	if (m_skinnedVersion == m_poseVersion) { return; }
+
+	std::lock_guard<std::mutex> lock(m_skinningMutex);
+
+	UpdateSkinMatrices();
+
+	if (m_skinnedMeshes.size() != GetNodeNum())
 	{
-		auto& parent = m_coppiedNodes[data.m_parent];
+		m_skinnedMeshes.resize(GetNodeNum());
+	}
+
+	const std::vector<KdModelData::Node>& dataNodes = GetDataNodes();
 
-		work.m_worldTransform = work.m_localTransform * parent.m_worldTransform;
+	for (int nodeIdx : m_spData->GetDrawMeshNodeIndices())
+	{
+		const KdMesh* pMesh = dataNodes[nodeIdx].m_spMesh.get();
+
+		if (!pMesh || !pMesh->IsSkinMesh() || pMesh->GetSkinSourceVertices().empty()) { continue; }
+
+		std::shared_ptr<KdSkinnedMesh>& spSkinned = m_skinnedMeshes[nodeIdx];
+
+		if (!spSkinned) { spSkinned = std::make_shared<KdSkinnedMesh>(); }
+
+		spSkinned->Skin(*pMesh, m_skinMatrices);
 	}
-	// 親が居ない場合は親は自分自身とする
-	else
+
+	m_skinnedVersion = m_poseVersion;
+}
+
+bool KdModelWork::GetSkinnedBoundingBox(DirectX::BoundingBox& out) const
+{
+	bool isFirst = true;
+
+	for (const std::shared_ptr<KdSkinnedMesh>& spSkinned : m_skinnedMeshes)
 	{
-		work.m_worldTransform = work.m_localTransform;
+		if (!spSkinned || spSkinned->IsEmpty()) { continue; }
+
+		if (isFirst)
+		{
+			out = spSkinned->GetBoundingBox();
+			isFirst = false;
+		}
+		else
+		{
+			DirectX::BoundingBox::CreateMerged(out, out, spSkinned->GetBoundingBox());
+		}
 	}
 
-	for (auto childNodeIdx : data.m_children)
+	return !isFirst;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 現在の姿勢のスキンの行列を求める
+// スキンの行列 = オフセット行列(バインドポーズの逆行列) x ボーンの現在の行列
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdModelWork::UpdateSkinMatrices() const
+{
+	if (m_skinMatricesVersion == m_poseVersion) { return; }
+
+	const std::vector<KdModelData::Node>& dataNodes = GetDataNodes();
+	const std::vector<int>& boneNodeIndices = m_spData->GetBoneNodeIndices();
+
+	m_skinMatrices.resize(boneNodeIndices.size());
+
+	for (size_t boneIdx = 0; boneIdx < boneNodeIndices.size(); ++boneIdx)
 	{
-		recCalcNodeMatrices(childNodeIdx, nodeIdx);
+		int nodeIdx = boneNodeIndices[boneIdx];
+
+		m_skinMatrices[boneIdx] = dataNodes[nodeIdx].m_boneInverseWorldMatrix * GetWorldTransform(nodeIdx);
 	}
+
+	m_skinMatricesVersion = m_poseVersion;
 }
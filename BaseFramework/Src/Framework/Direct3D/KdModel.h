@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 struct KdAnimationData;
+struct KdAnimCompressSettings;
 struct KdGLTFModel;
 
 class KdModelData
@@ -27,6 +28,15 @@ public:
 		bool	m_isSkinMesh = false;
 	};
 
+	// 行列の計算順のノード：親が必ず子より前になる(深さ優先)
+	// 子孫は自分の直後に連続して並ぶので、子孫の数だけで部分木の範囲が分かる
+	struct OrderedNode
+	{
+		int		m_nodeIdx = -1;		// ノードのインデックス
+		int		m_parent = -1;		// 親のインデックス
+		UINT	m_subtreeSize = 1;	// 自分を含む子孫の数
+	};
+
 	KdModelData();
 	~KdModelData();
 
@@ -35,6 +45,7 @@ public:
 	void CreateNodes(const std::shared_ptr<KdGLTFModel>& spGltfModel);									// ノード作成
 	void CreateMaterials(const std::shared_ptr<KdGLTFModel>& spGltfModel, const  std::string& fileDir);	// マテリアル作成
 	void CreateAnimations(const std::shared_ptr<KdGLTFModel>& spGltfModel);								// アニメーション作成
+	void CreateCollisionBVH(std::string_view modelFileName);												// 当たり判定用BVH作成
 
 	//アクセサ
 	const std::shared_ptr<KdMesh> GetMesh(UINT index) const { return index < m_originalNodes.size() ? m_originalNodes[ index ].m_spMesh : nullptr; }
@@ -52,6 +63,17 @@ public:
 		return nullptr;
 	}
 
+	// ノードのインデックス検索：見つからなければ-1
+	int FindNodeIndex(std::string_view name) const
+	{
+		for (size_t i = 0; i < m_originalNodes.size(); ++i)
+		{
+			if (m_originalNodes[i].m_name == name) { return static_cast<int>(i); }
+		}
+
+		return -1;
+	}
+
 	// マテリアル配列取得
 	const std::vector<KdMaterial>& GetMaterials() const { return m_materials; }
 
@@ -70,8 +92,16 @@ public:
 	const std::vector<int>& GetDrawMeshNodeIndices() const { return m_drawMeshNodeIndices; }
 	const std::vector<int>& GetCollisionMeshNodeIndices() const { return m_collisionMeshNodeIndices; }
 
+	// 行列の計算順のノードリスト取得
+	const std::vector<OrderedNode>& GetNodeOrder() const { return m_nodeOrder; }
+
 	bool IsSkinMesh();
 
+	// 読み込み時のアニメーションの圧縮設定：以降に読み込むモデルに適用される
+	// 読み込みは別スレッドで行われることがあるので、起動時など読み込みの無い時に設定すること
+	static void SetAnimationCompressSettings(const KdAnimCompressSettings& settings);
+	static const KdAnimCompressSettings& GetAnimationCompressSettings();
+
 private:
 	// 解放
 	void Release();
@@ -95,29 +125,23 @@ private:
 	std::vector<int>		m_collisionMeshNodeIndices;
 	// 全ノード中、描画するノードのみのIndexn配列
 	std::vector<int>		m_drawMeshNodeIndices;
+
+	// 行列の計算順の全ノード
+	std::vector<OrderedNode>	m_nodeOrder;
 };
 
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデルのインスタンス
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// インスタンス毎に持つのはノードの行列(親からの相対・原点から)の配列だけ
+// 名前などの変化しない情報はモデルデータ側を参照する
+// 一度も行列を書き換えていない間はモデルデータの行列をそのまま使い、最初に書き換える時に複製する
+// 　→ 動かない小物を大量に配置してもノードの複製は作られない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 class KdModelWork
 {
 public:
 
-	// ノード：活動中変化する可能性のあるデータ、検索用の名前
-	struct Node
-	{
-		std::string		m_name;				// ノード名
-
-		Math::Matrix	m_localTransform;	// 直属の親ボーンからの行列
-		Math::Matrix	m_worldTransform;	// 原点からの行列
-
-		void copy(const KdModelData::Node& rNode)
-		{
-			m_name = rNode.m_name;
-
-			m_localTransform = rNode.m_localTransform;
-			m_worldTransform = rNode.m_worldTransform;
-		}
-	};
-
 	// コンストラクタ
 	KdModelWork(){}
 	KdModelWork(const std::shared_ptr<KdModelData>& spModel) { SetModelData(spModel); }
@@ -133,35 +157,92 @@ public:
 
 	// ノード検索：文字列
 	const KdModelData::Node* FindDataNode(std::string_view name) const;
-	const Node* FindNode(std::string_view name) const;
-	Node* FindWorkNode(std::string_view name);
+	// ノードのインデックス検索(モデルデータから探す)：見つからなければ-1
+	int FindNodeIndex(std::string_view name) const { return !m_spData ? -1 : m_spData->FindNodeIndex(name); }
 
 	// アクセサ
 	// ----- ----- ----- ----- ----- ----- ----- ----- ----- -----
 	inline const std::shared_ptr<KdModelData> GetData() const { return m_spData; }
 	// メッシュ取得
-	inline const std::shared_ptr<KdMesh> GetMesh(UINT index) const { return index >= m_coppiedNodes.size() ? nullptr : GetDataNodes()[index].m_spMesh; }
+	inline const std::shared_ptr<KdMesh> GetMesh(UINT index) const { return index >= GetNodeNum() ? nullptr : GetDataNodes()[index].m_spMesh; }
 
 	// データノードリスト取得
 	const std::vector<KdModelData::Node>& GetDataNodes() const { assert(m_spData && "モデルデータが存在しません"); return m_spData->GetOriginalNodes(); }
-	// コピーノードリスト取得
-	const std::vector<Node>& GetNodes() const { return m_coppiedNodes; }
-	std::vector<Node>& WorkNodes() { m_needCalcNode = true; return m_coppiedNodes; }
+
+	// ノードの行列の取得・変更
+	// 変更したノードとその子孫だけが次のCalcNodeMatrices()で再計算される
+	UINT GetNodeNum() const { return !m_spData ? 0 : static_cast<UINT>(m_spData->GetOriginalNodes().size()); }
+	const Math::Matrix& GetLocalTransform(UINT nodeIdx) const
+	{
+		return m_localTransforms.empty() ? GetDataNodes()[nodeIdx].m_localTransform : m_localTransforms[nodeIdx];
+	}
+	const Math::Matrix& GetWorldTransform(UINT nodeIdx) const
+	{
+		return m_worldTransforms.empty() ? GetDataNodes()[nodeIdx].m_worldTransform : m_worldTransforms[nodeIdx];
+	}
+	Math::Matrix& WorkLocalTransform(UINT nodeIdx)
+	{
+		MakeUniqueTransforms();
+		MarkDirty(nodeIdx);
+		return m_localTransforms[nodeIdx];
+	}
+	void SetLocalTransform(UINT nodeIdx, const Math::Matrix& mat) { WorkLocalTransform(nodeIdx) = mat; }
+
+	// ノードの行列を自分で持っているか(一度でも書き換えたか)
+	bool HasUniqueTransforms() const { return !m_localTransforms.empty(); }
 
 	// アニメーションデータ取得
 	const std::shared_ptr<KdAnimationData> GetAnimation(std::string_view animName) const { return !m_spData ? nullptr : m_spData->GetAnimation(animName); }
 	const std::shared_ptr<KdAnimationData> GetAnimation(int index) const { return !m_spData ? nullptr : m_spData->GetAnimation(index); }
 
-	// モデル設定：コピーノードの生成
+	// モデル設定：ノードの行列は書き換えるまでモデルデータと共有する
 	void SetModelData(const std::shared_ptr<KdModelData>& rModel);
 	void SetModelData(std::string_view fileName);
 
 	bool NeedCalcNodeMatrices() { return m_needCalcNode; }
 
+	// 姿勢の番号：CalcNodeMatrices()で行列を計算する度に変わる
+	UINT GetPoseVersion() const { return m_poseVersion; }
+
+	// 当たり判定に使うメッシュと、そのメッシュをモデルの原点の空間へ動かす行列
+	// スキンメッシュは現在の姿勢に変形した形状を返す(行列は単位行列)
+	// 変形は判定で必要になった時に初めて行い、姿勢が変わるまで使い回す：複数のスレッドから同時に呼び出してよい
+	// ※判定中にCalcNodeMatrices()を呼び出さないこと
+	const KdMesh* GetCollisionMesh(int nodeIdx, Math::Matrix& meshMatrix) const;
+
+	// 当たり判定に使うメッシュのモデルの原点の空間での境界ボックス
+	// スキンメッシュは変形せずに、ボーン毎の影響範囲をボーンの行列で動かして合わせる(実際の形状より少し大きくなる)
+	bool CalcCollisionMeshBounds(int nodeIdx, DirectX::BoundingBox& out) const;
+
+	// 描画用のスキンメッシュを現在の姿勢に変形する
+	// 姿勢が変わっていなければ何もしない：DrawModel()からも呼ばれるので、呼び出さなくても描画はされる
+	// GPUへの転送は行わないので、描画スレッド以外から呼び出してよい
+	void UpdateSkinning();
+
+	// 描画用に変形したスキンメッシュ：スキンメッシュ以外・未変形ならnullptr
+	KdSkinnedMesh* WorkSkinnedMesh(int nodeIdx)
+	{
+		return nodeIdx < 0 || nodeIdx >= static_cast<int>(m_skinnedMeshes.size()) ? nullptr : m_skinnedMeshes[nodeIdx].get();
+	}
+
+	// 変形した全てのスキンメッシュを合わせた境界ボックス(モデルの原点の空間)：カリング用
+	// 変形したスキンメッシュが無ければfalse
+	bool GetSkinnedBoundingBox(DirectX::BoundingBox& out) const;
+
 private:
 
-	// 再帰呼び出し用計算関数
-	void recCalcNodeMatrices(int nodeIdx, int parentNodeIdx = -1);
+	// 再計算の対象にする
+	void MarkDirty(UINT nodeIdx)
+	{
+		m_dirtyNodes[nodeIdx] = 1;
+		m_needCalcNode = true;
+	}
+
+	// モデルデータの行列を共有していれば複製する
+	void MakeUniqueTransforms();
+
+	// 現在の姿勢のスキンの行列を求める：m_skinningMutexをロックした状態で呼び出すこと
+	void UpdateSkinMatrices() const;
 
 	// 有効
 	bool	m_enable = true;
@@ -169,8 +250,31 @@ private:
 	// モデルデータへの参照
 	std::shared_ptr<KdModelData>	m_spData = nullptr;
 
-	// 活動中変化する可能性のある全ノードデータのコピー配列
-	std::vector<Node>	m_coppiedNodes;
+	// ノードの行列(ノード毎)：空の間はモデルデータの行列を共有している
+	std::vector<Math::Matrix>	m_localTransforms;	// 直属の親ボーンからの行列
+	std::vector<Math::Matrix>	m_worldTransforms;	// 原点からの行列
 
 	bool m_needCalcNode = false;
+
+	// 行列を変更したノード(ノード毎)：そのノードの部分木を再計算する
+	std::vector<uint8_t>	m_dirtyNodes;
+
+	UINT m_poseVersion = 1;
+
+	// スキンメッシュの当たり判定用の形状(現在の姿勢に変形したもの)
+	struct SkinnedCollision
+	{
+		std::shared_ptr<KdMesh>	m_spMesh;
+		UINT					m_poseVersion = 0;	// 変形した時の姿勢の番号
+	};
+
+	// 判定時に作成・更新するのでmutable
+	mutable std::vector<SkinnedCollision>	m_skinnedCollisions;	// ノード毎
+	mutable std::vector<Math::Matrix>		m_skinMatrices;			// ボーン毎のスキンの行列
+	mutable UINT							m_skinMatricesVersion = 0;
+	mutable std::mutex						m_skinningMutex;
+
+	// 描画用に変形したスキンメッシュ(ノード毎)
+	std::vector<std::shared_ptr<KdSkinnedMesh>>	m_skinnedMeshes;
+	UINT										m_skinnedVersion = 0;	// 変形した時の姿勢の番号
 };
@@ -0,0 +1,129 @@
+﻿#include "KdSkinnedMesh.h"
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 頂点の変形
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 先に行列をウェイトで合成してから頂点を1回だけ変形する(行ベクトル4本の積和)
+// ボーン毎に頂点を変形して合成するより計算が少なく、座標・法線・接線で合成した行列を共有できる
+// 法線・接線は合成した行列で回してから正規化する(ボーンの拡縮が揃っている前提)
+// 変形した座標の最小・最大をpMin・pMaxに広げる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+static void SkinVertices(const KdMeshVertex* pSrc, KdMeshVertex* pDst, UINT vertexNum,
+	const std::vector<Math::Matrix>& skinMatrices, Math::Vector3* pMin, Math::Vector3* pMax)
+{
+	const int boneNum = static_cast<int>(skinMatrices.size());
+
+	DirectX::XMVECTOR vMin = DirectX::g_XMFltMax;
+	DirectX::XMVECTOR vMax = DirectX::XMVectorNegate(DirectX::g_XMFltMax);
+
+	for (UINT i = 0; i < vertexNum; ++i)
+	{
+		const KdMeshVertex& src = pSrc[i];
+
+		DirectX::XMMATRIX blended;
+		blended.r[0] = DirectX::XMVectorZero();
+		blended.r[1] = DirectX::XMVectorZero();
+		blended.r[2] = DirectX::XMVectorZero();
+		blended.r[3] = DirectX::XMVectorZero();
+
+		float totalWeight = 0.0f;
+
+		for (int j = 0; j < 4; ++j)
+		{
+			int boneIdx = src.SkinIndexList[j];
+			float weight = src.SkinWeightList[j];
+
+			if (weight <= 0.0f || boneIdx < 0 || boneIdx >= boneNum) { continue; }
+
+			DirectX::XMMATRIX bone = DirectX::XMLoadFloat4x4(&skinMatrices[boneIdx]);
+			DirectX::XMVECTOR vWeight = DirectX::XMVectorReplicate(weight);
+
+			blended.r[0] = DirectX::XMVectorMultiplyAdd(bone.r[0], vWeight, blended.r[0]);
+			blended.r[1] = DirectX::XMVectorMultiplyAdd(bone.r[1], vWeight, blended.r[1]);
+			blended.r[2] = DirectX::XMVectorMultiplyAdd(bone.r[2], vWeight, blended.r[2]);
+			blended.r[3] = DirectX::XMVectorMultiplyAdd(bone.r[3], vWeight, blended.r[3]);
+
+			totalWeight += weight;
+		}
+
+		// どのボーンの影響も受けていない頂点は元の位置のまま
+		if (totalWeight <= 0.0f) { blended = DirectX::XMMatrixIdentity(); }
+
+		KdMeshVertex& dst = pDst[i];
+
+		DirectX::XMVECTOR pos = DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&src.Pos), blended);
+		DirectX::XMVECTOR normal = DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&src.Normal), blended);
+		DirectX::XMVECTOR tangent = DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&src.Tangent), blended);
+
+		DirectX::XMStoreFloat3(&dst.Pos, pos);
+		DirectX::XMStoreFloat3(&dst.Normal, DirectX::XMVector3Normalize(normal));
+		DirectX::XMStoreFloat3(&dst.Tangent, DirectX::XMVector3Normalize(tangent));
+
+		vMin = DirectX::XMVectorMin(vMin, pos);
+		vMax = DirectX::XMVectorMax(vMax, pos);
+	}
+
+	DirectX::XMStoreFloat3(pMin, vMin);
+	DirectX::XMStoreFloat3(pMax, vMax);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 変形
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 描画のたびに呼ばれるので、毎回のメモリの確保・スレッドの起動はしない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdSkinnedMesh::Skin(const KdMesh& src, const std::vector<Math::Matrix>& skinMatrices)
+{
+	const std::vector<KdMeshVertex>& srcVertices = src.GetSkinSourceVertices();
+
+	if (srcVertices.empty()) { return; }
+
+	// 初回・メッシュが変わった時は変形しない情報ごとコピーする
+	if (m_vertices.size() != srcVertices.size())
+	{
+		m_vertBuf.Release();
+		m_vertices = srcVertices;
+	}
+
+	Math::Vector3 vMin, vMax;
+
+	SkinVertices(&srcVertices[0], &m_vertices[0], static_cast<UINT>(srcVertices.size()), skinMatrices, &vMin, &vMax);
+
+	DirectX::BoundingBox::CreateFromPoints(m_aabb, vMin, vMax);
+
+	m_needUpload = true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 変形した頂点の転送
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 毎フレーム全ての頂点を書き換えるので、動的バッファをD3D11_MAP_WRITE_DISCARDで書き込む
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdSkinnedMesh::Upload()
+{
+	if (!m_needUpload) { return true; }
+
+	const UINT bufferSize = static_cast<UINT>(sizeof(KdMeshVertex) * m_vertices.size());
+
+	if (!m_vertBuf.GetBuffer())
+	{
+		D3D11_SUBRESOURCE_DATA initData;
+		initData.pSysMem = &m_vertices[0];
+		initData.SysMemPitch = 0;
+		initData.SysMemSlicePitch = 0;
+
+		if (!m_vertBuf.Create(D3D11_BIND_VERTEX_BUFFER, bufferSize, D3D11_USAGE_DYNAMIC, &initData))
+		{
+			assert(0 && "KdSkinnedMesh::Upload：頂点バッファの作成に失敗しました");
+			return false;
+		}
+	}
+	else
+	{
+		m_vertBuf.WriteData(&m_vertices[0], bufferSize);
+	}
+
+	m_needUpload = false;
+
+	return true;
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 描画用にCPUで変形したスキンメッシュ(インスタンス毎)
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 頂点毎に影響するボーンのスキンの行列をウェイトで合成し、座標・法線・接線を変形する
+// 変形した頂点は通常のメッシュと同じ形式(KdMeshVertex)なので、シェーダーはスキニングを意識しなくてよい
+// 形状はモデルの原点の空間にあるので、描画時の行列はモデルの行列だけになる
+//
+// 変形(Skin)はCPUだけで完結するのでどのスレッドから呼び出してもよい
+// 変形は呼び出したスレッドだけで行う：多数のモデルはKdAnimationBatchでモデル単位に並列に変形する
+// GPUへの転送(Upload)はデバイスコンテキストを使うので描画スレッドから呼び出すこと
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdSkinnedMesh
+{
+public:
+
+	KdSkinnedMesh() {}
+	~KdSkinnedMesh() { Release(); }
+
+	// 変形
+	// ・src			… 変形元のスキンメッシュ(変形元の頂点を持つもの)
+	// ・skinMatrices	… ボーン毎のスキンの行列(オフセット行列 x ボーンの行列)
+	void Skin(const KdMesh& src, const std::vector<Math::Matrix>& skinMatrices);
+
+	// 変形した頂点を動的頂点バッファへ転送する：変形していなければ何もしない
+	bool Upload();
+
+	// アクセサ
+	// ----- ----- ----- ----- ----- ----- ----- ----- ----- -----
+	// 変形した頂点の動的頂点バッファ
+	const KdBuffer&				GetVertexBuffer() const { return m_vertBuf; }
+	// 変形した頂点の境界ボックス(モデルの原点の空間)：カリング用
+	const DirectX::BoundingBox&	GetBoundingBox() const { return m_aabb; }
+
+	bool IsEmpty() const { return m_vertices.empty(); }
+
+	// 解放
+	void Release()
+	{
+		m_vertBuf.Release();
+		m_vertices.clear();
+		m_needUpload = false;
+	}
+
+private:
+
+	// 変形した頂点：UV・色・スキニング情報は変形元のコピー
+	std::vector<KdMeshVertex>	m_vertices;
+	// 変形した頂点の転送先
+	KdBuffer					m_vertBuf;
+
+	DirectX::BoundingBox		m_aabb;
+
+	// 転送していない変形がある
+	bool						m_needUpload = false;
+
+	// コピー禁止用
+	KdSkinnedMesh(const KdSkinnedMesh& src) = delete;
+	void operator=(const KdSkinnedMesh& src) = delete;
+};
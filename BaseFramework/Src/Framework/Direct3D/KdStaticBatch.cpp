@@ -0,0 +1,245 @@
+﻿#include "KdStaticBatch.h"
+#include "KdGLTFLoader.h"
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデルの登録
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// マテリアルはKdAssetsのモデルデータから、頂点はGLTFファイルから取得する
+// (KdModelDataの描画用メッシュはCPU側に頂点を保持していないため)
+// 同じファイルを複数回登録してもGLTFの読込は1回だけ
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdStaticBatch::AddModel(std::string_view fileName, const Math::Matrix& mWorld)
+{
+	std::shared_ptr<KdModelData> spData = KdAssets::Instance().m_modeldatas.GetData(fileName);
+
+	if (!spData)
+	{
+		assert(0 && "KdStaticBatch::AddModel モデルデータが読み込めません");
+
+		return false;
+	}
+
+	std::shared_ptr<KdGLTFModel>& spSource = m_sources[fileName.data()];
+
+	if (!spSource)
+	{
+		spSource = KdLoadGLTFModel(fileName);
+
+		if (!spSource)
+		{
+			m_sources.erase(fileName.data());
+
+			assert(0 && "KdStaticBatch::AddModel GLTFファイルが読み込めません");
+
+			return false;
+		}
+	}
+
+	for (int nodeIdx : spData->GetDrawMeshNodeIndices())
+	{
+		const KdGLTFNode& rNode = spSource->Nodes[nodeIdx];
+
+		// スキンメッシュはボーンに合わせて動くので結合できない
+		if (!rNode.IsMesh || rNode.Mesh.IsSkinMesh) { continue; }
+
+		SourceNode sourceNode;
+		sourceNode.m_spSource = spSource;
+		sourceNode.m_spData = spData;
+		sourceNode.m_nodeIdx = nodeIdx;
+		sourceNode.m_mWorld = rNode.WorldTransform * mWorld;
+
+		m_sourceNodes.push_back(sourceNode);
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 結合
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 登録された全ノードのサブセットをマテリアル毎に振り分け、ワールド座標に変換した頂点を1つのメッシュに詰める
+// 結合メッシュのサブセット = マテリアルとなり、サブセットの中は元のノード毎の範囲(Range)が並ぶ
+// 反転行列(拡大率が負)で配置されたノードは面の表裏が逆になるので頂点の並びを入れ替える
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdStaticBatch::Build()
+{
+	m_spMesh = nullptr;
+	m_materials.clear();
+	m_ranges.clear();
+
+	if (m_sourceNodes.empty()) { return false; }
+
+	//------------------------------
+	// マテリアル毎に振り分け
+	//------------------------------
+	struct Piece
+	{
+		UINT	m_sourceNodeIdx = 0;
+		UINT	m_subsetIdx = 0;
+	};
+
+	std::vector<std::vector<Piece>> piecesPerMaterial;
+
+	for (UINT i = 0; i < m_sourceNodes.size(); ++i)
+	{
+		const SourceNode& rSrc = m_sourceNodes[i];
+		const std::vector<KdMeshSubset>& subsets = rSrc.m_spSource->Nodes[rSrc.m_nodeIdx].Mesh.Subsets;
+		const std::vector<KdMaterial>& materials = rSrc.m_spData->GetMaterials();
+
+		for (UINT subi = 0; subi < subsets.size(); ++subi)
+		{
+			if (subsets[subi].FaceCount == 0) { continue; }
+			if (subsets[subi].MaterialNo >= materials.size()) { continue; }
+
+			UINT materialNo = RegisterMaterial(materials[subsets[subi].MaterialNo]);
+
+			if (materialNo >= piecesPerMaterial.size()) { piecesPerMaterial.resize(materialNo + 1); }
+
+			piecesPerMaterial[materialNo].push_back({ i, subi });
+		}
+	}
+
+	//------------------------------
+	// 頂点・面の結合
+	//------------------------------
+	std::vector<KdMeshVertex>	vertices;
+	std::vector<KdMeshFace>		faces;
+	std::vector<KdMeshSubset>	subsets(piecesPerMaterial.size());
+
+	// 元の頂点Index → 結合後の頂点Index：サブセットで使われている頂点だけを取り出す
+	std::vector<UINT> remap;
+
+	for (UINT materialNo = 0; materialNo < piecesPerMaterial.size(); ++materialNo)
+	{
+		subsets[materialNo].MaterialNo = materialNo;
+		subsets[materialNo].FaceStart = static_cast<UINT>(faces.size());
+
+		for (const Piece& piece : piecesPerMaterial[materialNo])
+		{
+			const SourceNode& rSrc = m_sourceNodes[piece.m_sourceNodeIdx];
+			const auto& rMesh = rSrc.m_spSource->Nodes[rSrc.m_nodeIdx].Mesh;
+			const KdMeshSubset& rSubset = rMesh.Subsets[piece.m_subsetIdx];
+
+			bool isMirror = rSrc.m_mWorld.Determinant() < 0.0f;
+
+			// 法線は逆転置行列で変換する：拡縮が軸毎に異なる配置でも面に垂直なまま保つ
+			// 接線は面に沿う方向なのでワールド行列のまま変換する
+			Math::Matrix mNormal = rSrc.m_mWorld.Invert().Transpose();
+
+			remap.assign(rMesh.Vertices.size(), UINT_MAX);
+
+			Range range;
+			range.m_subsetNo = materialNo;
+			range.m_faceStart = static_cast<UINT>(faces.size());
+			range.m_faceCount = rSubset.FaceCount;
+
+			size_t firstVertex = vertices.size();
+
+			for (UINT facei = rSubset.FaceStart; facei < rSubset.FaceStart + rSubset.FaceCount; ++facei)
+			{
+				KdMeshFace face;
+
+				for (int k = 0; k < 3; ++k)
+				{
+					UINT srcIdx = rMesh.Faces[facei].Idx[k];
+
+					// 初めて使われる頂点はワールド座標に変換して追加
+					if (remap[srcIdx] == UINT_MAX)
+					{
+						remap[srcIdx] = static_cast<UINT>(vertices.size());
+
+						KdMeshVertex vertex = rMesh.Vertices[srcIdx];
+
+						vertex.Pos = Math::Vector3::Transform(vertex.Pos, rSrc.m_mWorld);
+
+						vertex.Normal = Math::Vector3::TransformNormal(vertex.Normal, mNormal);
+						vertex.Normal.Normalize();
+
+						vertex.Tangent = Math::Vector3::TransformNormal(vertex.Tangent, rSrc.m_mWorld);
+						vertex.Tangent.Normalize();
+
+						vertices.push_back(vertex);
+					}
+
+					face.Idx[k] = remap[srcIdx];
+				}
+
+				if (isMirror) { std::swap(face.Idx[1], face.Idx[2]); }
+
+				faces.push_back(face);
+			}
+
+			// この範囲の頂点は連続して追加されているのでそこから境界ボックスを作成
+			DirectX::BoundingBox::CreateFromPoints(range.m_aabb, vertices.size() - firstVertex,
+				&vertices[firstVertex].Pos, sizeof(KdMeshVertex));
+
+			m_ranges.push_back(range);
+		}
+
+		subsets[materialNo].FaceCount = static_cast<UINT>(faces.size()) - subsets[materialNo].FaceStart;
+	}
+
+	//------------------------------
+	// メッシュ作成：描画専用なのでGPUにのみ保持
+	//------------------------------
+	m_spMesh = std::make_shared<KdMesh>();
+
+	if (!m_spMesh->Create(vertices, faces, subsets, false, KdMesh::VertexLayout::Auto, KdMesh::ResidencyGPU))
+	{
+		assert(0 && "KdStaticBatch::Build 結合メッシュの作成に失敗");
+
+		m_spMesh = nullptr;
+
+		return false;
+	}
+
+	m_aabb = m_spMesh->GetBoundingBox();
+
+	// 結合に使った元データはもう不要
+	m_sources.clear();
+	m_sourceNodes.clear();
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 解放
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdStaticBatch::Release()
+{
+	m_sources.clear();
+	m_sourceNodes.clear();
+
+	m_spMesh = nullptr;
+	m_materials.clear();
+	m_ranges.clear();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 同じ描画結果になるマテリアルか
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// テクスチャはKdAssetsで共有されているので、同じファイルなら同じポインタになる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdStaticBatch::IsSameMaterial(const KdMaterial& lhs, const KdMaterial& rhs)
+{
+	return lhs.m_baseColorTex == rhs.m_baseColorTex &&
+		lhs.m_metallicRoughnessTex == rhs.m_metallicRoughnessTex &&
+		lhs.m_emissiveTex == rhs.m_emissiveTex &&
+		lhs.m_normalTex == rhs.m_normalTex &&
+		lhs.m_baseColorRate == rhs.m_baseColorRate &&
+		lhs.m_metallicRate == rhs.m_metallicRate &&
+		lhs.m_roughnessRate == rhs.m_roughnessRate &&
+		lhs.m_emissiveRate == rhs.m_emissiveRate;
+}
+
+UINT KdStaticBatch::RegisterMaterial(const KdMaterial& material)
+{
+	for (UINT i = 0; i < m_materials.size(); ++i)
+	{
+		if (IsSameMaterial(m_materials[i], material)) { return i; }
+	}
+
+	m_materials.push_back(material);
+
+	return static_cast<UINT>(m_materials.size() - 1);
+}
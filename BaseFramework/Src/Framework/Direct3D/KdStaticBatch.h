@@ -0,0 +1,82 @@
+﻿#pragma once
+
+struct KdGLTFModel;
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 動かないモデルをまとめて描画するための静的バッチ
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 登録されたモデルの描画ノードを事前にワールド座標へ変換し、同じマテリアル毎に1つのメッシュへ結合する
+// 描画はマテリアルの数だけで済み、頂点バッファのセットや行列の転送も1回になる
+// 元のノード毎の面の範囲と境界ボックスを保持しているので、視錐台カリングも可能
+// 結合後は動かせない・アニメーションできないので、地形や建物などの背景専用
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdStaticBatch
+{
+public:
+
+	// 元のノード1つ分(マテリアルが複数あるノードはマテリアル毎)の描画範囲
+	struct Range
+	{
+		UINT					m_subsetNo = 0;		// 結合メッシュのサブセット番号(= マテリアル番号)
+		UINT					m_faceStart = 0;	// 結合メッシュ内の面の開始位置
+		UINT					m_faceCount = 0;	// 面数
+
+		DirectX::BoundingBox	m_aabb;				// ワールド座標での境界ボックス
+	};
+
+	KdStaticBatch() {}
+	~KdStaticBatch() { Release(); }
+
+	// モデルの登録：描画用メッシュノードを指定の行列で配置する
+	// スキンメッシュのノードは結合できないので対象外
+	bool AddModel(std::string_view fileName, const Math::Matrix& mWorld);
+
+	// 登録されたモデルを結合して描画用メッシュを作成する
+	bool Build();
+
+	// 結合済みか
+	bool IsBuilt() const { return m_spMesh != nullptr; }
+
+	// アクセサ
+	// ----- ----- ----- ----- ----- ----- ----- ----- ----- -----
+	const std::shared_ptr<KdMesh>&		GetMesh() const { return m_spMesh; }
+	const std::vector<KdMaterial>&		GetMaterials() const { return m_materials; }
+	// サブセット番号順、同じサブセット内は面の開始位置順
+	const std::vector<Range>&			GetRanges() const { return m_ranges; }
+	// 全体の境界ボックス
+	const DirectX::BoundingBox&			GetBoundingBox() const { return m_aabb; }
+
+	// 解放
+	void Release();
+
+private:
+
+	// 結合待ちのノード
+	struct SourceNode
+	{
+		std::shared_ptr<KdGLTFModel>	m_spSource;		// 頂点の取得元
+		std::shared_ptr<KdModelData>	m_spData;		// マテリアルの取得元
+		int								m_nodeIdx = -1;
+		Math::Matrix					m_mWorld;		// ノードの行列 * 配置行列
+	};
+
+	// 同じ描画結果になるマテリアルか
+	static bool IsSameMaterial(const KdMaterial& lhs, const KdMaterial& rhs);
+
+	// マテリアルの登録：同じマテリアルがあればその番号を返す
+	UINT RegisterMaterial(const KdMaterial& material);
+
+	// 読込済みの頂点の取得元：Build()後に破棄する
+	std::unordered_map<std::string, std::shared_ptr<KdGLTFModel>>	m_sources;
+	std::vector<SourceNode>			m_sourceNodes;
+
+	// 結合後のデータ
+	std::shared_ptr<KdMesh>			m_spMesh = nullptr;
+	std::vector<KdMaterial>			m_materials;
+	std::vector<Range>				m_ranges;
+	DirectX::BoundingBox			m_aabb;
+
+	// コピー禁止用
+	KdStaticBatch(const KdStaticBatch& src) = delete;
+	void operator=(const KdStaticBatch& src) = delete;
+};
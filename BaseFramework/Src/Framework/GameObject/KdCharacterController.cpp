@@ -0,0 +1,303 @@
+﻿#include "KdCharacterController.h"
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 初期化
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCharacterController::Init(const Settings& settings, const Math::Vector3& pos)
+{
+	m_settings = settings;
+
+	m_minGroundNormalY = cosf(DirectX::XMConvertToRadians(settings.m_maxSlopeAngle));
+
+	SetPos(pos);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 移動
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 横方向と縦方向は分けて動かす
+// 横移動で歩けない斜面を登ったり、重力で歩ける斜面を滑り落ちたりしないようにするため
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCharacterController::Move(const KdCollisionWorld& world, const Math::Vector3& move, const KdGameObject* pIgnore)
+{
+	m_sweepCount = 0;
+
+	bool wasGrounded = m_isGrounded;
+
+	m_isGrounded = false;
+	m_groundNormal = Math::Vector3::Up;
+	m_isHitWall = false;
+
+	Math::Vector3 pos = m_pos;
+
+	// 移動前に重なっていれば押し出す
+	Depenetrate(world, pos, pIgnore);
+
+	SlideMove(world, pos, Math::Vector3(move.x, 0.0f, move.z), pIgnore, true, wasGrounded);
+	SlideMove(world, pos, Math::Vector3(0.0f, move.y, 0.0f), pIgnore, false, false);
+
+	// 接地していた場合は下へ吸着させる：上へ移動中(ジャンプなど)は吸着させない
+	if (wasGrounded && !m_isGrounded && move.y <= 0.0f)
+	{
+		SnapToGround(world, pos, pIgnore);
+	}
+
+	m_pos = pos;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 座標を直接設定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCharacterController::SetPos(const Math::Vector3& pos)
+{
+	m_pos = pos;
+
+	m_isGrounded = false;
+	m_groundNormal = Math::Vector3::Up;
+	m_isHitWall = false;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 指定の足元の座標でのカプセル
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+KdCapsule KdCharacterController::GetCapsule(const Math::Vector3& pos) const
+{
+	float radius = m_settings.m_radius;
+	float top = std::max(m_settings.m_height - radius, radius);
+
+	return KdCapsule(pos + Math::Vector3(0.0f, radius, 0.0f), pos + Math::Vector3(0.0f, top, 0.0f), radius);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセルを移動させた時に最初に当たる位置を調べる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCharacterController::SweepCapsule(const KdCollisionWorld& world, const Math::Vector3& pos, const Math::Vector3& dir, float range,
+	const KdGameObject* pIgnore, KdCollider::CollisionResult& hit)
+{
+	++m_sweepCount;
+
+	KdCollisionWorld::HitResult nearest;
+
+	if (!world.Sweep(KdCollider::CapsuleSweepInfo(m_settings.m_collisionType, GetCapsule(pos), dir, range), &nearest, pIgnore))
+	{
+		return false;
+	}
+
+	hit = nearest.m_result;
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 移動前から重なっている形状から押し出す
+// 移動距離0のスイープでは、重なり量 = めり込み量 になる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCharacterController::Depenetrate(const KdCollisionWorld& world, Math::Vector3& pos, const KdGameObject* pIgnore)
+{
+	for (int i = 0; i < kDepenetrateNum; ++i)
+	{
+		KdCollider::CollisionResult hit;
+
+		if (!SweepCapsule(world, pos, Math::Vector3::Down, 0.0f, pIgnore, hit)) { return; }
+
+		if (hit.m_overlapDistance <= 0.0f) { return; }
+
+		pos += hit.m_hitDir * (hit.m_overlapDistance + m_settings.m_skinWidth);
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 面に沿って滑らせながら移動
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 当たった位置の手前(隙間の分だけ離した位置)まで進め、残りの移動から面の法線の成分を取り除いて次のスイープを行う
+// 2つ目以降の面に当たった場合は、直前の面との交線に沿って滑らせる(角に挟まれた場合に振動しないようにする)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCharacterController::SlideMove(const KdCollisionWorld& world, Math::Vector3& pos, const Math::Vector3& move,
+	const KdGameObject* pIgnore, bool isHorizontal, bool canStep)
+{
+	const float skin = m_settings.m_skinWidth;
+
+	Math::Vector3 remaining = move;
+
+	Math::Vector3 prevNormal;
+	bool hasPrevNormal = false;
+
+	for (int i = 0; i < m_settings.m_maxSlideNum; ++i)
+	{
+		float dist = remaining.Length();
+
+		if (dist <= kMinMoveDistance) { return; }
+
+		Math::Vector3 dir = remaining / dist;
+
+		KdCollider::CollisionResult hit;
+
+		// 隙間の分だけ長く調べる：止める位置を面から隙間の分だけ手前にするため
+		float range = dist + skin;
+
+		if (!SweepCapsule(world, pos, dir, range, pIgnore, hit))
+		{
+			pos += remaining;
+			return;
+		}
+
+		float hitDist = range - hit.m_overlapDistance;
+
+		// 移動前から重なっている(押し出しきれなかった)：押し出してから同じ移動をやり直す
+		if (hitDist < 0.0f)
+		{
+			pos += hit.m_hitDir * (-hitDist + skin);
+			continue;
+		}
+
+		float travel = std::max(hitDist - skin, 0.0f);
+
+		pos += dir * travel;
+
+		Math::Vector3 normal = hit.m_hitDir;
+
+		bool isWalkable = IsWalkable(normal);
+
+		if (isWalkable)
+		{
+			m_isGrounded = true;
+			m_groundNormal = normal;
+		}
+		else
+		{
+			m_isHitWall = true;
+		}
+
+		Math::Vector3 leftover = dir * (dist - travel);
+
+		if (isHorizontal && !isWalkable)
+		{
+			// 段差：横移動が歩けない面に止められた場合は乗り越えてみる
+			if (canStep && TryStepUp(world, pos, leftover, pIgnore)) { return; }
+
+			// 歩けない面の法線は水平にする：壁や急な斜面に沿って上へ滑らないようにする
+			normal.y = 0.0f;
+
+			if (normal.LengthSquared() <= FLT_EPSILON) { return; }
+
+			normal.Normalize();
+		}
+
+		// 縦移動で歩ける面に当たったら止める：地面の上で斜面を滑り落ちないようにする
+		if (!isHorizontal && isWalkable) { return; }
+
+		// 残りの移動を面に沿う方向にする
+		Math::Vector3 slide = leftover - normal * leftover.Dot(normal);
+
+		if (hasPrevNormal)
+		{
+			// 2つの面の交線に沿って滑らせる：交線が無い(平行な面)場合はそのまま
+			Math::Vector3 crease = prevNormal.Cross(normal);
+
+			if (crease.LengthSquared() > FLT_EPSILON)
+			{
+				crease.Normalize();
+				slide = crease * leftover.Dot(crease);
+			}
+		}
+
+		// 元の移動方向に逆らう向きには滑らせない：角で往復し続けないようにする
+		if (slide.Dot(move) <= 0.0f) { return; }
+
+		prevNormal = normal;
+		hasPrevNormal = true;
+
+		remaining = slide;
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 段差を乗り越える
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 段差の高さまで持ち上げ(天井があればその手前まで)、残りの移動を進めてから下ろす
+// 下ろした先が歩ける面でなければ段差ではないので元の位置のままにする
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCharacterController::TryStepUp(const KdCollisionWorld& world, Math::Vector3& pos, const Math::Vector3& move, const KdGameObject* pIgnore)
+{
+	const float skin = m_settings.m_skinWidth;
+
+	float dist = move.Length();
+
+	if (m_settings.m_stepHeight <= 0.0f || dist <= kMinMoveDistance) { return false; }
+
+	Math::Vector3 stepPos = pos;
+
+	KdCollider::CollisionResult hit;
+
+	//------------------------------------------
+	// 持ち上げる
+	//------------------------------------------
+	float range = m_settings.m_stepHeight + skin;
+	float up = m_settings.m_stepHeight;
+
+	if (SweepCapsule(world, stepPos, Math::Vector3::Up, range, pIgnore, hit))
+	{
+		up = std::max(range - hit.m_overlapDistance - skin, 0.0f);
+	}
+
+	if (up <= kMinMoveDistance) { return false; }
+
+	stepPos.y += up;
+
+	//------------------------------------------
+	// 進める
+	//------------------------------------------
+	Math::Vector3 dir = move / dist;
+
+	range = dist + skin;
+	float forward = dist;
+
+	if (SweepCapsule(world, stepPos, dir, range, pIgnore, hit))
+	{
+		forward = std::max(range - hit.m_overlapDistance - skin, 0.0f);
+	}
+
+	if (forward <= kMinMoveDistance) { return false; }
+
+	stepPos += dir * forward;
+
+	//------------------------------------------
+	// 下ろす：持ち上げた分だけ下ろしても地面が無ければ段差ではない(落下は通常の移動に任せる)
+	//------------------------------------------
+	range = up + skin;
+
+	if (!SweepCapsule(world, stepPos, Math::Vector3::Down, range, pIgnore, hit)) { return false; }
+
+	if (!IsWalkable(hit.m_hitDir)) { return false; }
+
+	stepPos.y -= std::max(range - hit.m_overlapDistance - skin, 0.0f);
+
+	pos = stepPos;
+
+	m_isGrounded = true;
+	m_groundNormal = hit.m_hitDir;
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 下へ吸着させる
+// 吸着させる距離の中に歩ける面があればその上に下ろす
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCharacterController::SnapToGround(const KdCollisionWorld& world, Math::Vector3& pos, const KdGameObject* pIgnore)
+{
+	const float skin = m_settings.m_skinWidth;
+
+	float range = m_settings.m_snapDistance + skin;
+
+	KdCollider::CollisionResult hit;
+
+	if (!SweepCapsule(world, pos, Math::Vector3::Down, range, pIgnore, hit)) { return; }
+
+	if (!IsWalkable(hit.m_hitDir)) { return; }
+
+	pos.y -= std::max(range - hit.m_overlapDistance - skin, 0.0f);
+
+	m_isGrounded = true;
+	m_groundNormal = hit.m_hitDir;
+}
@@ -0,0 +1,105 @@
+﻿#pragma once
+
+class KdGameObject;
+class KdCollisionWorld;
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセルの移動判定(スイープ)でキャラクターを動かすクラス
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 移動量の分だけカプセルを動かして最初に当たる位置で止め、残りの移動を当たった面に沿って滑らせる(move-and-slide)
+// 球を並べて押し出しを繰り返す方法と違い、1フレームの移動量が大きくても壁をすり抜けない
+// 1回のMove()で行うスイープの回数には上限があるので、処理時間も一定以内に収まる
+//
+// ・段差		… 横方向の移動が壁に止められた時、段差の高さまで持ち上げて進めてから下ろす
+// ・接地		… 接地していた場合は移動後に下へ吸着させ、坂道や段差の下りで地面から浮かないようにする
+// 座標はカプセルの足元(下端)　判定対象はKdCollisionWorldに登録されたオブジェクト
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdCharacterController
+{
+public:
+
+	// 動作設定
+	struct Settings
+	{
+		float	m_radius		= 0.3f;		// カプセルの半径
+		float	m_height		= 1.6f;		// カプセルの高さ(半径を含む全体)
+		float	m_stepHeight	= 0.3f;		// 乗り越えられる段差の高さ
+		float	m_maxSlopeAngle	= 45.0f;	// 歩ける斜面の角度(度)
+		float	m_snapDistance	= 0.2f;		// 接地を保つために下へ吸着させる距離
+		float	m_skinWidth		= 0.01f;	// 面との間に空ける隙間：誤差で面にめり込まないようにする
+		int		m_maxSlideNum	= 4;		// 1回の移動で面に沿って滑らせる回数の上限
+
+		UINT	m_collisionType	= KdCollider::TypeGround | KdCollider::TypeBump;	// 判定する衝突タイプ
+	};
+
+	KdCharacterController() {}
+	~KdCharacterController() {}
+
+	// 初期化
+	void Init(const Settings& settings, const Math::Vector3& pos);
+
+	// 移動：moveは今回の移動量(重力による落下も含める)
+	// ・pIgnore … 判定しないオブジェクト(キャラクター自身など)
+	// スイープの回数は最大で 2 + m_maxSlideNum x 5 + 1 回
+	void Move(const KdCollisionWorld& world, const Math::Vector3& move, const KdGameObject* pIgnore = nullptr);
+
+	// 座標を直接設定する(ワープなど)：接地状態は解除される
+	void SetPos(const Math::Vector3& pos);
+	const Math::Vector3& GetPos() const { return m_pos; }
+
+	// 直前のMove()で歩ける面の上に立ったか
+	bool IsGrounded() const { return m_isGrounded; }
+	const Math::Vector3& GetGroundNormal() const { return m_groundNormal; }
+
+	// 直前のMove()で歩けない面(壁・天井・急な斜面)に当たったか
+	bool IsHitWall() const { return m_isHitWall; }
+
+	// 直前のMove()で行ったスイープの回数：調整用
+	UINT GetSweepCount() const { return m_sweepCount; }
+
+	// 指定の足元の座標でのカプセル
+	KdCapsule GetCapsule(const Math::Vector3& pos) const;
+
+	const Settings& GetSettings() const { return m_settings; }
+
+private:
+
+	// カプセルを移動させた時に最初に当たる位置を調べる
+	bool SweepCapsule(const KdCollisionWorld& world, const Math::Vector3& pos, const Math::Vector3& dir, float range,
+		const KdGameObject* pIgnore, KdCollider::CollisionResult& hit);
+
+	// 移動前から重なっている形状から押し出す
+	void Depenetrate(const KdCollisionWorld& world, Math::Vector3& pos, const KdGameObject* pIgnore);
+
+	// 面に沿って滑らせながら移動
+	// ・isHorizontal	… 横方向の移動：歩けない面は法線を水平にして滑らせ、段差を乗り越える
+	// ・canStep		… 段差を乗り越えてよいか(接地している場合のみ)
+	void SlideMove(const KdCollisionWorld& world, Math::Vector3& pos, const Math::Vector3& move,
+		const KdGameObject* pIgnore, bool isHorizontal, bool canStep);
+
+	// 段差を乗り越える：持ち上げる → 進める → 下ろす　歩ける面の上に下ろせなければ失敗
+	bool TryStepUp(const KdCollisionWorld& world, Math::Vector3& pos, const Math::Vector3& move, const KdGameObject* pIgnore);
+
+	// 下へ吸着させる
+	void SnapToGround(const KdCollisionWorld& world, Math::Vector3& pos, const KdGameObject* pIgnore);
+
+	bool IsWalkable(const Math::Vector3& normal) const { return normal.y >= m_minGroundNormalY; }
+
+	// これより短い移動は行わない
+	static constexpr float kMinMoveDistance = 0.0001f;
+	// 移動前の重なりを押し出す回数：押し出した先で別の形状に重なる場合に備える
+	static constexpr int kDepenetrateNum = 2;
+
+	Settings		m_settings;
+
+	float			m_minGroundNormalY = 0.7f;	// 歩ける面の法線のYの最小値
+
+	Math::Vector3	m_pos;
+
+	bool			m_isGrounded = false;
+	Math::Vector3	m_groundNormal = Math::Vector3::Up;
+
+	bool			m_isHitWall = false;
+
+	UINT			m_sweepCount = 0;
+};
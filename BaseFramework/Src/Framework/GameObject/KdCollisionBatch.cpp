@@ -0,0 +1,195 @@
+﻿#include "KdCollisionBatch.h"
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 初期化
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionBatch::Init(UINT workerNum)
+{
+	Release();
+
+	if (workerNum == 0)
+	{
+		// hardware_concurrency()は取得できないと0を返すので、引く前に確認する
+		UINT threadNum = std::thread::hardware_concurrency();
+
+		workerNum = threadNum > 1 ? threadNum - 1 : 1;
+	}
+
+	m_workerNum = workerNum;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 判定の登録
+// 計測の呼び出し元の名前は登録したスレッドのものを控えておき、判定するワーカーで付け直す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+UINT KdCollisionBatch::AddRay(const KdCollider::RayInfo& ray, const KdGameObject* pIgnore, bool needDetail)
+{
+	m_pending.m_rays.push_back({ ray, pIgnore, needDetail, KdCollisionStats::CallerScope::GetName() });
+
+	return static_cast<UINT>(m_pending.m_rays.size() - 1);
+}
+
+UINT KdCollisionBatch::AddSphere(const KdCollider::SphereInfo& sphere, const KdGameObject* pIgnore, bool needDetail)
+{
+	m_pending.m_spheres.push_back({ sphere, pIgnore, needDetail, KdCollisionStats::CallerScope::GetName() });
+
+	return static_cast<UINT>(m_pending.m_spheres.size() - 1);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 即時実行：メインスレッドも判定に加わり、全ての判定が終わるまで待つ
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionBatch::Execute(const KdCollisionWorld& world)
+{
+	Start(world, true);
+
+	Wait();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 遅延実行：ワーカーだけで判定し、メインスレッドはすぐに戻る
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionBatch::Kick(const KdCollisionWorld& world)
+{
+	Start(world, false);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 判定の完了を待つ
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionBatch::Wait()
+{
+	for (auto& worker : m_workers)
+	{
+		if (worker.valid()) { worker.wait(); }
+	}
+
+	m_workers.clear();
+}
+
+bool KdCollisionBatch::IsRunning() const
+{
+	for (auto& worker : m_workers)
+	{
+		if (worker.valid() && worker.wait_for(std::chrono::seconds(0)) != std::future_status::ready) { return true; }
+	}
+
+	return false;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 解放
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionBatch::Release()
+{
+	// 残りの判定を取り出させないようにしてから待つ
+	m_nextIdx = static_cast<UINT>(m_executing.m_rays.size() + m_executing.m_spheres.size());
+
+	Wait();
+
+	m_pending.Clear();
+	m_executing.Clear();
+	m_executing.m_rayResults.clear();
+	m_executing.m_sphereResults.clear();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 登録済みの判定を実行用に移し、ワーカーを起動する
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 登録用と実行用を入れ替えるので、配列の確保はフレームをまたいで再利用される
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionBatch::Start(const KdCollisionWorld& world, bool isMainThreadJoin)
+{
+	// 前回の判定の完了を待つ
+	Wait();
+
+	std::swap(m_pending, m_executing);
+	m_pending.Clear();
+
+	m_executing.m_rayResults.assign(m_executing.m_rays.size(), Result());
+	m_executing.m_sphereResults.assign(m_executing.m_spheres.size(), Result());
+
+	m_nextIdx = 0;
+
+	UINT queryNum = static_cast<UINT>(m_executing.m_rays.size() + m_executing.m_spheres.size());
+
+	if (queryNum == 0) { return; }
+
+	// 判定数に対して多すぎるワーカーは起動しない
+	UINT workerNum = std::min(m_workerNum, (queryNum + kChunkSize - 1) / kChunkSize);
+
+	// メインスレッドも加わる場合はその分を減らす
+	if (isMainThreadJoin) { --workerNum; }
+
+	for (UINT i = 0; i < workerNum; ++i)
+	{
+		m_workers.push_back(std::async(std::launch::async, [this, &world]() { WorkerProc(world); }));
+	}
+
+	if (isMainThreadJoin) { WorkerProc(world); }
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ワーカーの処理本体
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 判定はそれぞれ別の結果に書き込むので排他制御は不要
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionBatch::WorkerProc(const KdCollisionWorld& world)
+{
+	const UINT rayNum = static_cast<UINT>(m_executing.m_rays.size());
+	const UINT queryNum = rayNum + static_cast<UINT>(m_executing.m_spheres.size());
+
+	while (true)
+	{
+		UINT begin = m_nextIdx.fetch_add(kChunkSize);
+
+		if (begin >= queryNum) { break; }
+
+		UINT end = std::min(begin + kChunkSize, queryNum);
+
+		for (UINT idx = begin; idx < end; ++idx)
+		{
+			if (idx < rayNum)
+			{
+				ExecuteQuery(world, m_executing.m_rays[idx], m_executing.m_rayResults[idx]);
+			}
+			else
+			{
+				ExecuteQuery(world, m_executing.m_spheres[idx - rayNum], m_executing.m_sphereResults[idx - rayNum]);
+			}
+		}
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 判定1つ分：レイは最も近いヒット、球は最も深く重なったヒットを残す
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// どちらも重なり量が最大のものを残せばよいので、レイ・球で同じ処理になる
+// 結果を1つずつ受け取って比較するので、途中の結果を溜めるための確保は発生しない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Shape>
+void KdCollisionBatch::ExecuteQuery(const KdCollisionWorld& world, const Query<Shape>& query, Result& result)
+{
+	KD_COLLISION_STAT_CALLER(query.m_pCaller);
+
+	if (!query.m_needDetail)
+	{
+		result.m_hitCount = world.Intersects(query.m_shape, nullptr, query.m_pIgnore) ? 1 : 0;
+
+		return;
+	}
+
+	world.IntersectsEach(query.m_shape, query.m_pIgnore, true,
+		[&result](const std::shared_ptr<KdGameObject>& spObject, const KdCollider::CollisionResult& hit)
+		{
+			if (!result.m_hitCount || hit.m_overlapDistance > result.m_result.m_overlapDistance)
+			{
+				result.m_wpObject = spObject;
+				result.m_result = hit;
+			}
+
+			++result.m_hitCount;
+
+			return true;
+		});
+}
@@ -0,0 +1,128 @@
+﻿#pragma once
+
+class KdGameObject;
+class KdCollisionWorld;
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 大量のレイ・球の当たり判定をまとめて複数スレッドで実行するクラス
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 視界判定・弾・接地判定など、1フレームに数百回発行される判定をKdCollisionWorldに対してまとめて実行する
+// 結果は判定1つにつき1つ(レイは最も近いヒット・球は最も深い重なり)に詰めて返す
+//
+// 即時実行：AddRay()・AddSphere()で登録 → Execute()で並列に判定して完了を待つ → 受付番号で結果を取得
+// 遅延実行：フレームNの更新中に登録 → 全オブジェクトの更新後にKick()で別スレッドで判定を開始
+// 　　　　　→ 描画と並行して判定される → フレームN+1でWait()後、受付番号で結果を取得
+// 　　　　　判定中はオブジェクトの行列・形状・KdCollisionWorldを変更しないこと(描画のみの期間に実行する)
+// Kick()・Execute()までに登録した判定と、次に登録する判定は別の領域に保持するので、判定中も登録できる
+// 当たり判定の計測(KdCollisionStats)の呼び出し元は、登録した時点のKD_COLLISION_STAT_CALLERの名前で集計される
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdCollisionBatch
+{
+public:
+
+	// 判定1つ分の結果
+	struct Result
+	{
+		std::weak_ptr<KdGameObject>		m_wpObject;		// 当たったオブジェクト(レイは最も近く、球は最も深く重なったもの)
+		KdCollider::CollisionResult		m_result;		// 詳細な衝突結果：needDetailがfalseの判定では設定されない
+		UINT							m_hitCount = 0;	// 当たった形状の数：needDetailがfalseの判定では最大1
+
+		bool IsHit() const { return m_hitCount > 0; }
+	};
+
+	KdCollisionBatch() {}
+	~KdCollisionBatch() { Release(); }
+
+	// 初期化：workerNumが0ならCPUのスレッド数 - 1(メインスレッドの分)
+	void Init(UINT workerNum = 0);
+
+	// 判定の登録：戻り値は結果を取得するための受付番号
+	// ・pIgnore	… 判定しないオブジェクト(判定する本人など)
+	// ・needDetail	… falseなら当たったかどうかだけを調べる(最初のヒットで終了するので軽い)
+	UINT AddRay(const KdCollider::RayInfo& ray, const KdGameObject* pIgnore = nullptr, bool needDetail = true);
+	UINT AddSphere(const KdCollider::SphereInfo& sphere, const KdGameObject* pIgnore = nullptr, bool needDetail = true);
+
+	// 登録済みの判定数
+	UINT GetRayCount() const { return static_cast<UINT>(m_pending.m_rays.size()); }
+	UINT GetSphereCount() const { return static_cast<UINT>(m_pending.m_spheres.size()); }
+
+	// 即時実行：登録済みの判定を並列に実行し、完了を待つ
+	void Execute(const KdCollisionWorld& world);
+
+	// 遅延実行：登録済みの判定を別スレッドで開始してすぐに戻る
+	// 前回の判定が終わっていなければ完了を待ってから開始する
+	void Kick(const KdCollisionWorld& world);
+	// 判定の完了を待つ
+	void Wait();
+	// 判定中か
+	bool IsRunning() const;
+
+	// 結果の取得：直前に実行(Execute・Kick)した判定の受付番号を指定する
+	// Kick()の場合はWait()の後に取得すること
+	const Result& GetRayResult(UINT ticket) const { return m_executing.m_rayResults[ticket]; }
+	const Result& GetSphereResult(UINT ticket) const { return m_executing.m_sphereResults[ticket]; }
+
+	const std::vector<Result>& GetRayResults() const { return m_executing.m_rayResults; }
+	const std::vector<Result>& GetSphereResults() const { return m_executing.m_sphereResults; }
+
+	// 解放：判定中なら完了を待つ
+	void Release();
+
+private:
+
+	// 登録された判定：Shapeはレイ・球の判定情報
+	template<class Shape>
+	struct Query
+	{
+		Shape					m_shape;
+		const KdGameObject*		m_pIgnore = nullptr;
+		bool					m_needDetail = true;
+		const char*				m_pCaller = nullptr;	// 計測用の呼び出し元の名前
+	};
+
+	using RayQuery = Query<KdCollider::RayInfo>;
+	using SphereQuery = Query<KdCollider::SphereInfo>;
+
+	// 1回分の判定と結果
+	struct Frame
+	{
+		std::vector<RayQuery>		m_rays;
+		std::vector<SphereQuery>	m_spheres;
+
+		std::vector<Result>			m_rayResults;
+		std::vector<Result>			m_sphereResults;
+
+		void Clear()
+		{
+			m_rays.clear();
+			m_spheres.clear();
+		}
+	};
+
+	// 登録済みの判定を実行用に移し、ワーカーを起動する
+	void Start(const KdCollisionWorld& world, bool isMainThreadJoin);
+
+	// ワーカーの処理本体：判定をまとめて取り出して実行する
+	void WorkerProc(const KdCollisionWorld& world);
+
+	// 判定1つ分：レイ・球で共通
+	template<class Shape>
+	static void ExecuteQuery(const KdCollisionWorld& world, const Query<Shape>& query, Result& result);
+
+	// 1回に取り出す判定の数：取り出しの競合を減らす
+	static constexpr UINT kChunkSize = 16;
+
+	UINT	m_workerNum = 1;
+
+	Frame	m_pending;		// 次に実行する判定(登録中)
+	Frame	m_executing;	// 実行中・実行済みの判定
+
+	// 次に取り出す判定の番号：レイ → 球の順に通し番号で数える
+	std::atomic<UINT>				m_nextIdx = 0;
+
+	std::vector<std::future<void>>	m_workers;
+
+	// コピー禁止用
+	KdCollisionBatch(const KdCollisionBatch& src) = delete;
+	void operator=(const KdCollisionBatch& src) = delete;
+};
@@ -0,0 +1,437 @@
+﻿#include "KdCollisionWorld.h"
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 初期化
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionWorld::Init(const Settings& settings)
+{
+	Release();
+
+	m_settings = settings;
+
+	m_tree.SetMargin(m_settings.m_margin);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// オブジェクトの登録
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 登録済みなら境界ボックスの更新のみ行う
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionWorld::Register(const std::shared_ptr<KdGameObject>& spObject, bool isStatic)
+{
+	if (!spObject) { return; }
+
+	auto it = m_entryIndices.find(spObject.get());
+
+	if (it != m_entryIndices.end())
+	{
+		m_entries[it->second].m_isStatic = isStatic;
+
+		RefreshEntry(it->second);
+
+		return;
+	}
+
+	UINT entryIdx = static_cast<UINT>(m_entries.size());
+
+	Entry entry;
+	entry.m_wpObject = spObject;
+	entry.m_pObject = spObject.get();
+	entry.m_isStatic = isStatic;
+
+	m_entries.push_back(entry);
+	m_entryIndices.emplace(spObject.get(), entryIdx);
+
+	RefreshEntry(entryIdx);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// オブジェクトの登録解除
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionWorld::Unregister(const KdGameObject* pObject)
+{
+	auto it = m_entryIndices.find(pObject);
+
+	if (it == m_entryIndices.end()) { return; }
+
+	RemoveEntry(it->second);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 更新
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 消滅したオブジェクトは登録を解除し、動くオブジェクトの境界ボックスを更新する
+// 境界ボックスがファットAABBに収まっている間は木を組み替えないので、静止しているオブジェクトの負荷は小さい
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionWorld::Update()
+{
+	UINT entryIdx = 0;
+
+	while (entryIdx < m_entries.size())
+	{
+		Entry& entry = m_entries[entryIdx];
+
+		std::shared_ptr<KdGameObject> spObject = entry.m_wpObject.lock();
+
+		// 消滅したオブジェクトは解除：末尾と入れ替わるので同じ位置をもう一度処理する
+		if (!spObject || spObject->IsExpired())
+		{
+			RemoveEntry(entryIdx);
+
+			continue;
+		}
+
+		if (!entry.m_isStatic) { RefreshEntry(entryIdx); }
+
+		++entryIdx;
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 1つだけ境界ボックスを更新
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionWorld::UpdateObject(const KdGameObject* pObject)
+{
+	auto it = m_entryIndices.find(pObject);
+
+	if (it == m_entryIndices.end()) { return; }
+
+	RefreshEntry(it->second);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// レイヤー行列の設定
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// queryTypeの各ビットの行に対して、targetTypeのビットを立てる・下ろす
+// 例：SetLayerCollision(TypeSight, TypeBump, true) … 視界の判定で衝突用の形状も遮蔽物として扱う
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionWorld::SetLayerCollision(UINT queryType, UINT targetType, bool enable)
+{
+	for (UINT bit = 0; bit < m_layerMatrix.size(); ++bit)
+	{
+		if (!(queryType & (1u << bit))) { continue; }
+
+		if (enable)
+		{
+			m_layerMatrix[bit] |= targetType;
+		}
+		else
+		{
+			m_layerMatrix[bit] &= ~targetType;
+		}
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 初期状態に戻す：KdCollider単体での判定と同じく、同じタイプ同士のみ判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionWorld::ResetLayerMatrix()
+{
+	for (UINT bit = 0; bit < m_layerMatrix.size(); ++bit)
+	{
+		m_layerMatrix[bit] = 1u << bit;
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// queryTypeで判定した時に判定対象となるタイプ
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+UINT KdCollisionWorld::GetLayerMask(UINT queryType) const
+{
+	UINT mask = 0;
+
+	for (UINT bit = 0; bit < m_layerMatrix.size(); ++bit)
+	{
+		if (queryType & (1u << bit)) { mask |= m_layerMatrix[bit]; }
+	}
+
+	return mask;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 球との当たり判定
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollisionWorld::Intersects(const KdCollider::SphereInfo& targetShape, std::list<HitResult>* pResults, const KdGameObject* pIgnore) const
+{
+	return IntersectsEach(targetShape, pIgnore, pResults != nullptr,
+		[pResults](const std::shared_ptr<KdGameObject>& spObject, const KdCollider::CollisionResult& result)
+		{
+			pResults->push_back({ spObject, result });
+			return true;
+		});
+}
+
+bool KdCollisionWorld::Intersects(const KdCollider::SphereInfo& targetShape, std::vector<HitResult>& results, const KdGameObject* pIgnore) const
+{
+	return IntersectsEach(targetShape, pIgnore, true,
+		[&results](const std::shared_ptr<KdGameObject>& spObject, const KdCollider::CollisionResult& result)
+		{
+			results.push_back({ spObject, result });
+			return true;
+		});
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOXとの当たり判定
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollisionWorld::Intersects(const KdCollider::BoxInfo& targetBox, std::list<HitResult>* pResults, const KdGameObject* pIgnore) const
+{
+	return IntersectsEach(targetBox, pIgnore, pResults != nullptr,
+		[pResults](const std::shared_ptr<KdGameObject>& spObject, const KdCollider::CollisionResult& result)
+		{
+			pResults->push_back({ spObject, result });
+			return true;
+		});
+}
+
+bool KdCollisionWorld::Intersects(const KdCollider::BoxInfo& targetBox, std::vector<HitResult>& results, const KdGameObject* pIgnore) const
+{
+	return IntersectsEach(targetBox, pIgnore, true,
+		[&results](const std::shared_ptr<KdGameObject>& spObject, const KdCollider::CollisionResult& result)
+		{
+			results.push_back({ spObject, result });
+			return true;
+		});
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// レイとの当たり判定
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollisionWorld::Intersects(const KdCollider::RayInfo& targetShape, std::list<HitResult>* pResults, const KdGameObject* pIgnore) const
+{
+	return IntersectsEach(targetShape, pIgnore, pResults != nullptr,
+		[pResults](const std::shared_ptr<KdGameObject>& spObject, const KdCollider::CollisionResult& result)
+		{
+			pResults->push_back({ spObject, result });
+			return true;
+		});
+}
+
+bool KdCollisionWorld::Intersects(const KdCollider::RayInfo& targetShape, std::vector<HitResult>& results, const KdGameObject* pIgnore) const
+{
+	return IntersectsEach(targetShape, pIgnore, true,
+		[&results](const std::shared_ptr<KdGameObject>& spObject, const KdCollider::CollisionResult& result)
+		{
+			results.push_back({ spObject, result });
+			return true;
+		});
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセルの移動との当たり判定
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollisionWorld::Intersects(const KdCollider::CapsuleSweepInfo& targetSweep, std::list<HitResult>* pResults, const KdGameObject* pIgnore) const
+{
+	return IntersectsEach(targetSweep, pIgnore, pResults != nullptr,
+		[pResults](const std::shared_ptr<KdGameObject>& spObject, const KdCollider::CollisionResult& result)
+		{
+			pResults->push_back({ spObject, result });
+			return true;
+		});
+}
+
+bool KdCollisionWorld::Intersects(const KdCollider::CapsuleSweepInfo& targetSweep, std::vector<HitResult>& results, const KdGameObject* pIgnore) const
+{
+	return IntersectsEach(targetSweep, pIgnore, true,
+		[&results](const std::shared_ptr<KdGameObject>& spObject, const KdCollider::CollisionResult& result)
+		{
+			results.push_back({ spObject, result });
+			return true;
+		});
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセルの移動で最も手前の接触だけを取得
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 結果を1つずつ受け取って比較するので、途中の結果を溜めるための確保は発生しない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollisionWorld::Sweep(const KdCollider::CapsuleSweepInfo& targetSweep, HitResult* pNearest, const KdGameObject* pIgnore) const
+{
+	// 詳細な結果が不要なら最初に当たった時点で終了する
+	if (!pNearest)
+	{
+		return IntersectsEach(targetSweep, pIgnore, false,
+			[](const std::shared_ptr<KdGameObject>&, const KdCollider::CollisionResult&) { return true; });
+	}
+
+	bool isHit = false;
+
+	IntersectsEach(targetSweep, pIgnore, true,
+		[&](const std::shared_ptr<KdGameObject>& spObject, const KdCollider::CollisionResult& result)
+		{
+			if (!isHit || result.m_overlapDistance > pNearest->m_result.m_overlapDistance)
+			{
+				pNearest->m_spObject = spObject;
+				pNearest->m_result = result;
+			}
+
+			isHit = true;
+
+			return true;
+		});
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 箱と境界ボックスが重なり、typeの判定対象となるオブジェクトを取得
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionWorld::QueryObjects(const DirectX::BoundingBox& aabb, UINT type, std::vector<std::shared_ptr<KdGameObject>>& result) const
+{
+	UINT layerMask = GetLayerMask(type);
+
+	if (!layerMask) { return; }
+
+	QueryEntries(aabb,
+		[&](UINT entryIdx)
+		{
+			std::shared_ptr<KdGameObject> spObject;
+			const KdCollider* pCollider = nullptr;
+			UINT mask = 0;
+
+			if (GetTarget(entryIdx, type, layerMask, nullptr, spObject, pCollider, mask))
+			{
+				result.push_back(spObject);
+			}
+
+			return true;
+		});
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 解放
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionWorld::Release()
+{
+	m_tree.Release();
+
+	m_entries.clear();
+	m_entryIndices.clear();
+	m_unboundedEntries.clear();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 境界ボックスと衝突タイプを更新する
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 境界ボックスを求められない形状(独自の派生クラスなど)を持つ場合は木から外し、常に判定対象とする
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionWorld::RefreshEntry(UINT entryIdx)
+{
+	Entry& entry = m_entries[entryIdx];
+
+	std::shared_ptr<KdGameObject> spObject = entry.m_wpObject.lock();
+	const KdCollider* pCollider = spObject ? spObject->GetCollider() : nullptr;
+
+	entry.m_types = pCollider ? pCollider->GetCollisionTypes() : 0;
+
+	DirectX::BoundingBox aabb;
+	bool isBounded = true;
+
+	if (!pCollider)
+	{
+		// コライダーが無ければ当たらないので、位置だけ登録しておく
+		aabb.Center = spObject ? spObject->GetPos() : Math::Vector3::Zero;
+		aabb.Extents = Math::Vector3::Zero;
+	}
+	else
+	{
+		isBounded = pCollider->CalcBoundingBox(spObject->GetMatrix(), aabb);
+	}
+
+	auto unboundedIt = std::find(m_unboundedEntries.begin(), m_unboundedEntries.end(), entryIdx);
+	bool wasUnbounded = unboundedIt != m_unboundedEntries.end();
+
+	if (!isBounded)
+	{
+		if (entry.m_proxyId != KdDynamicAABBTree::kNullNode)
+		{
+			m_tree.DestroyProxy(entry.m_proxyId);
+			entry.m_proxyId = KdDynamicAABBTree::kNullNode;
+		}
+
+		if (!wasUnbounded) { m_unboundedEntries.push_back(entryIdx); }
+
+		return;
+	}
+
+	if (wasUnbounded) { m_unboundedEntries.erase(unboundedIt); }
+
+	if (entry.m_proxyId == KdDynamicAABBTree::kNullNode)
+	{
+		entry.m_proxyId = m_tree.CreateProxy(aabb, entryIdx);
+	}
+	else
+	{
+		m_tree.MoveProxy(entry.m_proxyId, aabb);
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 登録の解除
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 末尾の登録をentryIdxの位置に移し、木と検索表の参照先も付け替える
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionWorld::RemoveEntry(UINT entryIdx)
+{
+	Entry& entry = m_entries[entryIdx];
+
+	if (entry.m_proxyId != KdDynamicAABBTree::kNullNode)
+	{
+		m_tree.DestroyProxy(entry.m_proxyId);
+	}
+
+	m_entryIndices.erase(entry.m_pObject);
+
+	auto unboundedIt = std::find(m_unboundedEntries.begin(), m_unboundedEntries.end(), entryIdx);
+	if (unboundedIt != m_unboundedEntries.end()) { m_unboundedEntries.erase(unboundedIt); }
+
+	UINT lastIdx = static_cast<UINT>(m_entries.size() - 1);
+
+	if (entryIdx != lastIdx)
+	{
+		m_entries[entryIdx] = std::move(m_entries[lastIdx]);
+
+		Entry& moved = m_entries[entryIdx];
+
+		m_entryIndices[moved.m_pObject] = entryIdx;
+
+		if (moved.m_proxyId != KdDynamicAABBTree::kNullNode)
+		{
+			m_tree.SetUserData(moved.m_proxyId, entryIdx);
+		}
+
+		std::replace(m_unboundedEntries.begin(), m_unboundedEntries.end(), lastIdx, entryIdx);
+	}
+
+	m_entries.pop_back();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 判定対象のオブジェクトとコライダーを取得
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// KdCollider::Intersects()と同じく、判定するタイプがコライダーで無効になっていれば対象外
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollisionWorld::GetTarget(UINT entryIdx, UINT queryType, UINT layerMask, const KdGameObject* pIgnore,
+	std::shared_ptr<KdGameObject>& spObject, const KdCollider*& pCollider, UINT& mask) const
+{
+	const Entry& entry = m_entries[entryIdx];
+
+	// 衝突タイプが対象外
+	if (!(entry.m_types & layerMask)) { return false; }
+
+	if (entry.m_pObject == pIgnore) { return false; }
+
+	spObject = entry.m_wpObject.lock();
+
+	if (!spObject || spObject->IsExpired()) { return false; }
+
+	pCollider = spObject->GetCollider();
+
+	if (!pCollider) { return false; }
+
+	if (queryType & pCollider->GetDisableType()) { return false; }
+
+	mask = layerMask & ~pCollider->GetDisableType();
+
+	return mask != 0;
+}
@@ -0,0 +1,287 @@
+﻿#pragma once
+
+class KdGameObject;
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 当たり判定を持つゲームオブジェクトをまとめて管理し、判定の対象を絞り込むクラス
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 登録したオブジェクトのコライダーの境界ボックスを動的AABBツリーで管理し、
+// 球・BOX・レイと境界ボックスが重なるオブジェクトにだけ KdCollider::Intersects() を実行する
+// 判定する組み合わせはレイヤー行列(KdCollider::Typeのビット同士の対応表)で決める：初期状態は同じタイプ同士のみ
+//
+// 運用手順
+// ・Register()でオブジェクトを登録する(動かないオブジェクトはisStaticをtrueにすると更新を省ける)
+// ・全オブジェクトの移動後にUpdate()を呼び、境界ボックスを更新する
+// ・Intersects()で判定する：Update()以降に余白(Settings::m_margin)を超えて移動したオブジェクトは
+// 　次のUpdate()まで取りこぼす可能性がある　ワープなどで大きく動かした場合はUpdateObject()を呼ぶこと
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdCollisionWorld
+{
+public:
+
+	// 動作設定
+	struct Settings
+	{
+		float	m_margin = 0.5f;	// 境界ボックスの余白：この範囲内の移動では木を組み替えない
+	};
+
+	// 判定結果：当たったオブジェクトと詳細な衝突結果
+	struct HitResult
+	{
+		std::shared_ptr<KdGameObject>	m_spObject;
+		KdCollider::CollisionResult		m_result;
+	};
+
+	KdCollisionWorld() { ResetLayerMatrix(); }
+	~KdCollisionWorld() { Release(); }
+
+	// 初期化
+	void Init(const Settings& settings);
+
+	// オブジェクトの登録・解除
+	void Register(const std::shared_ptr<KdGameObject>& spObject, bool isStatic = false);
+	void Unregister(const KdGameObject* pObject);
+
+	// 更新：全オブジェクトの境界ボックスを更新し、消滅したオブジェクトの登録を解除する
+	void Update();
+	// 1つだけ境界ボックスを更新：動かないオブジェクトを動かした場合やワープさせた場合に使う
+	void UpdateObject(const KdGameObject* pObject);
+
+	// レイヤー行列の設定：queryTypeで判定した時にtargetTypeの形状を判定対象にするか
+	void SetLayerCollision(UINT queryType, UINT targetType, bool enable);
+	// 初期状態(同じタイプ同士のみ)に戻す
+	void ResetLayerMatrix();
+	// queryTypeで判定した時に判定対象となるタイプ
+	UINT GetLayerMask(UINT queryType) const;
+
+	// 当たり判定実行：pIgnoreのオブジェクトは判定しない(判定する本人など)
+	bool Intersects(const KdCollider::SphereInfo& targetShape, std::list<HitResult>* pResults, const KdGameObject* pIgnore = nullptr) const;
+	bool Intersects(const KdCollider::BoxInfo& targetBox, std::list<HitResult>* pResults, const KdGameObject* pIgnore = nullptr) const;
+	bool Intersects(const KdCollider::RayInfo& targetShape, std::list<HitResult>* pResults, const KdGameObject* pIgnore = nullptr) const;
+	bool Intersects(const KdCollider::CapsuleSweepInfo& targetSweep, std::list<HitResult>* pResults, const KdGameObject* pIgnore = nullptr) const;
+
+	// 当たり判定実行(結果を配列の末尾に追加する)：配列を使い回せば容量が足りている限りメモリの確保は発生しない
+	bool Intersects(const KdCollider::SphereInfo& targetShape, std::vector<HitResult>& results, const KdGameObject* pIgnore = nullptr) const;
+	bool Intersects(const KdCollider::BoxInfo& targetBox, std::vector<HitResult>& results, const KdGameObject* pIgnore = nullptr) const;
+	bool Intersects(const KdCollider::RayInfo& targetShape, std::vector<HitResult>& results, const KdGameObject* pIgnore = nullptr) const;
+	bool Intersects(const KdCollider::CapsuleSweepInfo& targetSweep, std::vector<HitResult>& results, const KdGameObject* pIgnore = nullptr) const;
+
+	// カプセルの移動判定で最も手前の接触(重なり量が最大のもの)だけを取得：移動を止める位置を求める場合に使う
+	// 移動前から重なっている形状があれば、最も深く重なっているものが結果になる
+	bool Sweep(const KdCollider::CapsuleSweepInfo& targetSweep, HitResult* pNearest, const KdGameObject* pIgnore = nullptr) const;
+
+	// 当たり判定実行(結果を1つずつ受け取る)
+	// ・needDetail	… falseなら詳細な結果を求めず、最初に当たった時点で終了する(onHitは呼ばれない)
+	// ・onHit		… bool(const std::shared_ptr<KdGameObject>&, const KdCollider::CollisionResult&)：falseを返すと終了
+	template<class Info, class Func>
+	bool IntersectsEach(const Info& target, const KdGameObject* pIgnore, bool needDetail, Func onHit) const;
+
+	// 箱と境界ボックスが重なり、typeの判定対象となるオブジェクトを取得
+	void QueryObjects(const DirectX::BoundingBox& aabb, UINT type, std::vector<std::shared_ptr<KdGameObject>>& result) const;
+
+	// 登録数
+	UINT GetObjectCount() const { return static_cast<UINT>(m_entries.size()); }
+	// 木の高さ：調整用
+	int GetTreeHeight() const { return m_tree.GetHeight(); }
+
+	// 解放
+	void Release();
+
+private:
+
+	// 登録したオブジェクト1つ分
+	struct Entry
+	{
+		std::weak_ptr<KdGameObject>	m_wpObject;
+		const KdGameObject*			m_pObject = nullptr;	// 検索用：参照先が消滅していても比較に使える
+
+		int		m_proxyId = KdDynamicAABBTree::kNullNode;	// 境界ボックスを求められない場合はkNullNode
+		UINT	m_types = 0;								// コライダーの全形状の衝突タイプ
+		bool	m_isStatic = false;
+	};
+
+	// 境界ボックスと衝突タイプを更新する
+	void RefreshEntry(UINT entryIdx);
+	// 登録の解除：末尾と入れ替えて削除する
+	void RemoveEntry(UINT entryIdx);
+
+	// 境界ボックスが重なる登録を全て辿る：境界ボックスを求められない登録は常に対象
+	// ・onEntry … bool(UINT entryIdx)：falseを返すと終了
+	template<class Func>
+	void QueryEntries(const DirectX::BoundingBox& aabb, Func onEntry) const;
+
+	// 判定対象の形状と境界ボックスが重なる可能性のある登録を全て辿る
+	template<class Func>
+	void ForEachCandidate(const KdCollider::SphereInfo& target, Func onEntry) const;
+	template<class Func>
+	void ForEachCandidate(const KdCollider::BoxInfo& target, Func onEntry) const;
+	template<class Func>
+	void ForEachCandidate(const KdCollider::RayInfo& target, Func onEntry) const;
+	template<class Func>
+	void ForEachCandidate(const KdCollider::CapsuleSweepInfo& target, Func onEntry) const;
+
+	// 判定対象のオブジェクトとコライダーを取得：対象外ならfalse
+	// queryTypeをレイヤー行列で広げ、コライダーで無効になっているタイプを除いたものをmaskで返す
+	bool GetTarget(UINT entryIdx, UINT queryType, UINT layerMask, const KdGameObject* pIgnore,
+		std::shared_ptr<KdGameObject>& spObject, const KdCollider*& pCollider, UINT& mask) const;
+
+	Settings	m_settings;
+
+	KdDynamicAABBTree	m_tree;
+
+	std::vector<Entry>	m_entries;
+
+	// オブジェクト → m_entriesの位置
+	std::unordered_map<const KdGameObject*, UINT>	m_entryIndices;
+
+	// 境界ボックスを求められない登録
+	std::vector<UINT>	m_unboundedEntries;
+
+	// レイヤー行列：[判定するタイプのビット番号] = 判定対象となるタイプ
+	std::array<UINT, 32>	m_layerMatrix = {};
+
+	// コピー禁止用
+	KdCollisionWorld(const KdCollisionWorld& src) = delete;
+	void operator=(const KdCollisionWorld& src) = delete;
+};
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 境界ボックスが重なる登録を全て辿る
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Func>
+void KdCollisionWorld::QueryEntries(const DirectX::BoundingBox& aabb, Func onEntry) const
+{
+	for (UINT entryIdx : m_unboundedEntries)
+	{
+		if (!onEntry(entryIdx)) { return; }
+	}
+
+	Math::Vector3 boxMin = Math::Vector3(aabb.Center) - Math::Vector3(aabb.Extents);
+	Math::Vector3 boxMax = Math::Vector3(aabb.Center) + Math::Vector3(aabb.Extents);
+
+	m_tree.Query(boxMin, boxMax,
+		[&](int proxyId)
+		{
+			return onEntry(m_tree.GetUserData(proxyId));
+		});
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 球と境界ボックスが重なる登録を辿る
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Func>
+void KdCollisionWorld::ForEachCandidate(const KdCollider::SphereInfo& target, Func onEntry) const
+{
+	DirectX::BoundingBox queryBox;
+	DirectX::BoundingBox::CreateFromSphere(queryBox, target.m_sphere);
+
+	QueryEntries(queryBox, onEntry);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOXと境界ボックスが重なる登録を辿る：OBBは8つの角を包む箱で絞り込む
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Func>
+void KdCollisionWorld::ForEachCandidate(const KdCollider::BoxInfo& target, Func onEntry) const
+{
+	DirectX::BoundingBox queryBox = target.m_Abox;
+
+	if (target.CheckBoxType(KdCollider::BoxInfo::BoxType::BoxOBB))
+	{
+		DirectX::XMFLOAT3 corners[DirectX::BoundingOrientedBox::CORNER_COUNT];
+		target.m_Obox.GetCorners(corners);
+
+		DirectX::BoundingBox::CreateFromPoints(queryBox, DirectX::BoundingOrientedBox::CORNER_COUNT, corners, sizeof(DirectX::XMFLOAT3));
+	}
+
+	QueryEntries(queryBox, onEntry);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// レイと境界ボックスが交差する登録を辿る
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Func>
+void KdCollisionWorld::ForEachCandidate(const KdCollider::RayInfo& target, Func onEntry) const
+{
+	// レイの方向ベクトルが存在しない場合は判定不能なのでそのまま返る
+	if (!target.m_dir.LengthSquared())
+	{
+		assert(0 && "KdCollisionWorld::Intersects：レイの方向ベクトルが存在していないため、正しく判定できません");
+
+		return;
+	}
+
+	for (UINT entryIdx : m_unboundedEntries)
+	{
+		if (!onEntry(entryIdx)) { return; }
+	}
+
+	m_tree.RayCast(target.m_pos, target.m_dir, target.m_range,
+		[&](int proxyId, float maxDist)
+		{
+			return onEntry(m_tree.GetUserData(proxyId)) ? maxDist : -1.0f;
+		});
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセルの移動範囲全体と境界ボックスが重なる登録を辿る
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Func>
+void KdCollisionWorld::ForEachCandidate(const KdCollider::CapsuleSweepInfo& target, Func onEntry) const
+{
+	DirectX::BoundingBox queryBox;
+	KdCalcCapsuleSweptBox(target.m_capsule, target.m_dir, target.m_range, queryBox);
+
+	QueryEntries(queryBox, onEntry);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 当たり判定実行(結果を1つずつ受け取る)
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 境界ボックスで絞り込んだオブジェクトのコライダーに判定を任せる
+// 結果は受け取り側へ直接渡すので、途中でリストなどの確保は発生しない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Info, class Func>
+bool KdCollisionWorld::IntersectsEach(const Info& target, const KdGameObject* pIgnore, bool needDetail, Func onHit) const
+{
+	UINT layerMask = GetLayerMask(target.m_type);
+
+	if (!layerMask) { return false; }
+
+	bool isHit = false;
+
+	ForEachCandidate(target,
+		[&](UINT entryIdx)
+		{
+			std::shared_ptr<KdGameObject> spObject;
+			const KdCollider* pCollider = nullptr;
+			UINT mask = 0;
+
+			if (!GetTarget(entryIdx, target.m_type, layerMask, pIgnore, spObject, pCollider, mask)) { return true; }
+
+			Info query = target;
+			query.m_type = mask;
+
+			bool isContinue = true;
+
+			if (!pCollider->IntersectsEach(query, spObject->GetMatrix(), needDetail,
+				[&](const KdCollider::CollisionResult& result)
+				{
+					isContinue = static_cast<bool>(onHit(spObject, result));
+
+					return isContinue;
+				}))
+			{
+				return true;
+			}
+
+			isHit = true;
+
+			// 詳細な衝突結果を必要としない場合は1つでも接触したら終了
+			if (!needDetail) { return false; }
+
+			return isContinue;
+		});
+
+	return isHit;
+}
@@ -52,3 +52,24 @@ bool KdGameObject::Intersects(const KdCollider::RayInfo& targetShape, std::list<
 
 	return m_pCollider->Intersects(targetShape, m_mWorld, pResults);
 }
+
+UINT KdGameObject::Intersects(const KdCollider::SphereInfo& targetShape, std::span<KdCollider::CollisionResult> results) const
+{
+	if (!m_pCollider) { return 0; }
+
+	return m_pCollider->Intersects(targetShape, m_mWorld, results);
+}
+
+UINT KdGameObject::Intersects(const KdCollider::BoxInfo& targetBox, std::span<KdCollider::CollisionResult> results) const
+{
+	if (!m_pCollider) { return 0; }
+
+	return m_pCollider->Intersects(targetBox, m_mWorld, results);
+}
+
+UINT KdGameObject::Intersects(const KdCollider::RayInfo& targetShape, std::span<KdCollider::CollisionResult> results) const
+{
+	if (!m_pCollider) { return 0; }
+
+	return m_pCollider->Intersects(targetShape, m_mWorld, results);
+}
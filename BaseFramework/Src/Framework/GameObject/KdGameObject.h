@@ -43,6 +43,7 @@ public:
 	virtual void SetScale(const Math::Vector3& scale);
 	virtual Math::Vector3 GetScale() const;
 
+	virtual void SetMatrix(const Math::Matrix& mWorld) { m_mWorld = mWorld; }
 	const Math::Matrix& GetMatrix() const { return m_mWorld; }
 
 	virtual bool IsExpired() const { return m_isExpired; }
@@ -64,6 +65,14 @@ public:
 	bool Intersects(const KdCollider::BoxInfo& targetBox, std::list<KdCollider::CollisionResult>* pResults);
 	bool Intersects(const KdCollider::RayInfo& targetShape, std::list<KdCollider::CollisionResult>* pResults);
 
+	// 結果を呼び出し側の配列へ書き込む：戻り値は書き込んだ結果の数
+	UINT Intersects(const KdCollider::SphereInfo& targetShape, std::span<KdCollider::CollisionResult> results) const;
+	UINT Intersects(const KdCollider::BoxInfo& targetBox, std::span<KdCollider::CollisionResult> results) const;
+	UINT Intersects(const KdCollider::RayInfo& targetShape, std::span<KdCollider::CollisionResult> results) const;
+
+	// 当たり判定クラスの取得：KdCollisionWorldの登録・判定で使用する
+	const KdCollider* GetCollider() const { return m_pCollider.get(); }
+
 protected:
 
 	void Release() {}
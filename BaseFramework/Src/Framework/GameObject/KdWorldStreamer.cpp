@@ -0,0 +1,356 @@
+﻿#include "KdWorldStreamer.h"
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 初期化
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdWorldStreamer::Init(const Settings& settings)
+{
+	Release();
+
+	m_settings = settings;
+
+	// 解放半径が読込半径以下だと境界で読込・解放を繰り返すため補正
+	if (m_settings.m_unloadRadius <= m_settings.m_loadRadius)
+	{
+		assert(0 && "KdWorldStreamer::Init 解放半径は読込半径より大きくしてください");
+
+		m_settings.m_unloadRadius = m_settings.m_loadRadius + m_settings.m_cellSize;
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// セルの登録：既に登録済みのセルには内容を追加する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdWorldStreamer::RegisterCell(int cellX, int cellZ, const CellDesc& desc)
+{
+	Cell& cell = m_cells[MakeCellKey(cellX, cellZ)];
+
+	cell.m_x = cellX;
+	cell.m_z = cellZ;
+
+	if (cell.m_state != CellState::Unloaded)
+	{
+		assert(0 && "KdWorldStreamer::RegisterCell 読込済みのセルは変更できません");
+
+		return;
+	}
+
+	cell.m_desc.m_modelNames.insert(cell.m_desc.m_modelNames.end(), desc.m_modelNames.begin(), desc.m_modelNames.end());
+	cell.m_desc.m_textureNames.insert(cell.m_desc.m_textureNames.end(), desc.m_textureNames.begin(), desc.m_textureNames.end());
+	cell.m_desc.m_objects.insert(cell.m_desc.m_objects.end(), desc.m_objects.begin(), desc.m_objects.end());
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// CSVからセルの一括登録
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdWorldStreamer::LoadCellTable(std::string_view fileName)
+{
+	KdCSVData table;
+
+	if (!table.Load(fileName)) { return false; }
+
+	for (size_t i = 0; i < table.GetLineSize(); ++i)
+	{
+		const std::vector<std::string>& line = table.GetLine(i);
+
+		if (line.size() < 4) { continue; }
+
+		int cellX = atoi(line[0].c_str());
+		int cellZ = atoi(line[1].c_str());
+
+		CellDesc desc;
+
+		if (line[2] == "Model")
+		{
+			desc.m_modelNames.push_back(line[3]);
+		}
+		else if (line[2] == "Texture")
+		{
+			desc.m_textureNames.push_back(line[3]);
+		}
+		else if (line[2] == "Object" && line.size() >= 8)
+		{
+			ObjectInfo obj;
+			obj.m_className = line[3];
+			obj.m_assetName = line[4];
+			obj.m_mWorld = Math::Matrix::CreateTranslation(
+				(float)atof(line[5].c_str()), (float)atof(line[6].c_str()), (float)atof(line[7].c_str()));
+
+			desc.m_objects.push_back(obj);
+		}
+		else
+		{
+			continue;
+		}
+
+		RegisterCell(cellX, cellZ, desc);
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 更新
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 1.読込半径内のセルを近い順に非同期読込開始
+// 2.読込完了したセルのオブジェクトを時間予算内で活性化
+// 3.解放半径外のセルを非活性化・解放
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdWorldStreamer::Update(const Math::Vector3& focusPos)
+{
+	// 読込開始候補と活性化候補：近いセルから優先して処理する
+	std::vector<std::pair<float, Cell*>> loadCandidates;
+	std::vector<std::pair<float, Cell*>> activateCandidates;
+
+	bool isUnloaded = false;
+
+	for (auto& cellPair : m_cells)
+	{
+		Cell& cell = cellPair.second;
+
+		float dist = CalcDistanceToCell(cell, focusPos);
+
+		switch (cell.m_state)
+		{
+		case CellState::Unloaded:
+			if (dist <= m_settings.m_loadRadius) { loadCandidates.push_back({ dist, &cell }); }
+			break;
+
+		case CellState::Loading:
+			// 読込が完了しているか確認
+			if (cell.m_loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready) { break; }
+
+			cell.m_loading.get();
+			cell.m_state = CellState::Loaded;
+			--m_loadingCount;
+
+			// 読込中に範囲外に出ていた場合はそのまま解放
+			if (dist > m_settings.m_unloadRadius)
+			{
+				UnloadCell(cell);
+				isUnloaded = true;
+				break;
+			}
+
+			activateCandidates.push_back({ dist, &cell });
+			break;
+
+		case CellState::Loaded:
+		case CellState::Active:
+			if (dist > m_settings.m_unloadRadius)
+			{
+				UnloadCell(cell);
+				isUnloaded = true;
+				break;
+			}
+
+			if (cell.m_state == CellState::Loaded) { activateCandidates.push_back({ dist, &cell }); }
+			break;
+		}
+	}
+
+	// 非同期読込の開始：同時読込数の上限まで
+	std::sort(loadCandidates.begin(), loadCandidates.end(),
+		[](const std::pair<float, Cell*>& a, const std::pair<float, Cell*>& b) { return a.first < b.first; });
+
+	for (auto& candidate : loadCandidates)
+	{
+		if (m_loadingCount >= m_settings.m_maxConcurrentLoads) { break; }
+
+		BeginLoadCell(*candidate.second);
+	}
+
+	// どこからも参照されなくなったアセットを保管庫から破棄
+	if (isUnloaded)
+	{
+		KdAssets::Instance().ClearData(false);
+	}
+
+	// オブジェクトの活性化：1フレームの処理時間の上限まで
+	std::sort(activateCandidates.begin(), activateCandidates.end(),
+		[](const std::pair<float, Cell*>& a, const std::pair<float, Cell*>& b) { return a.first < b.first; });
+
+	auto beginTime = std::chrono::steady_clock::now();
+
+	for (auto& candidate : activateCandidates)
+	{
+		Cell& cell = *candidate.second;
+
+		while (ActivateNextObject(cell))
+		{
+			std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - beginTime;
+
+			// 上限を超えたら残りは次のフレームへ
+			if (elapsed.count() >= m_settings.m_activateBudgetMs) { return; }
+		}
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 活性化済みの全オブジェクトを取得
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdWorldStreamer::CollectActiveObjects(std::vector<std::shared_ptr<KdGameObject>>& result) const
+{
+	for (auto& cellPair : m_cells)
+	{
+		const Cell& cell = cellPair.second;
+
+		for (auto& spObj : cell.m_objects)
+		{
+			if (spObj) { result.push_back(spObj); }
+		}
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// セルの状態取得
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+KdWorldStreamer::CellState KdWorldStreamer::GetCellState(int cellX, int cellZ) const
+{
+	auto findCell = m_cells.find(MakeCellKey(cellX, cellZ));
+
+	if (findCell == m_cells.end()) { return CellState::Unloaded; }
+
+	return findCell->second.m_state;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ワールド座標からセル座標を求める
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdWorldStreamer::GetCellIndex(const Math::Vector3& pos, int& cellX, int& cellZ) const
+{
+	cellX = static_cast<int>(std::floor(pos.x / m_settings.m_cellSize));
+	cellZ = static_cast<int>(std::floor(pos.z / m_settings.m_cellSize));
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 解放
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdWorldStreamer::Release()
+{
+	for (auto& cellPair : m_cells)
+	{
+		Cell& cell = cellPair.second;
+
+		// 読込中のスレッドが参照しているため完了を待つ
+		if (cell.m_loading.valid()) { cell.m_loading.wait(); }
+
+		UnloadCell(cell);
+	}
+
+	m_cells.clear();
+
+	m_loadingCount = 0;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 注視点からセルまでの最短距離(XZ平面)
+// セルの中心ではなく矩形までの距離なので、セルが大きくても端に近づいた時点で読み込まれる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+float KdWorldStreamer::CalcDistanceToCell(const Cell& cell, const Math::Vector3& focusPos) const
+{
+	float minX = cell.m_x * m_settings.m_cellSize;
+	float minZ = cell.m_z * m_settings.m_cellSize;
+
+	float dx = std::max({ minX - focusPos.x, 0.0f, focusPos.x - (minX + m_settings.m_cellSize) });
+	float dz = std::max({ minZ - focusPos.z, 0.0f, focusPos.z - (minZ + m_settings.m_cellSize) });
+
+	return std::sqrt(dx * dx + dz * dz);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 非同期読込の開始
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdWorldStreamer::BeginLoadCell(Cell& cell)
+{
+	cell.m_state = CellState::Loading;
+
+	++m_loadingCount;
+
+	cell.m_loading = std::async(std::launch::async, [&cell]() { LoadCellProc(cell); });
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 非同期読込の処理本体(別スレッド)
+// KdAssetsの保管庫はスレッドセーフなので、他のセルやメインスレッドと同時に読み込んでも問題ない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdWorldStreamer::LoadCellProc(Cell& cell)
+{
+	// 画像の読込(WIC)にCOMが必要
+	HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	for (const std::string& modelName : cell.m_desc.m_modelNames)
+	{
+		std::shared_ptr<KdModelData> spModel = KdAssets::Instance().m_modeldatas.GetData(modelName);
+
+		if (spModel) { cell.m_spModels.push_back(spModel); }
+	}
+
+	for (const std::string& textureName : cell.m_desc.m_textureNames)
+	{
+		std::shared_ptr<KdTexture> spTexture = KdAssets::Instance().m_textures.GetData(textureName);
+
+		if (spTexture) { cell.m_spTextures.push_back(spTexture); }
+	}
+
+	if (SUCCEEDED(hrCom)) { CoUninitialize(); }
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// オブジェクトを1つ活性化する
+// アセットは読込済みなのでSetAsset()内のGetData()は検索のみで済む
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdWorldStreamer::ActivateNextObject(Cell& cell)
+{
+	if (cell.m_state != CellState::Loaded) { return false; }
+
+	size_t objIdx = cell.m_objects.size();
+
+	if (objIdx >= cell.m_desc.m_objects.size())
+	{
+		cell.m_state = CellState::Active;
+
+		return false;
+	}
+
+	const ObjectInfo& info = cell.m_desc.m_objects[objIdx];
+
+	std::shared_ptr<KdGameObject> spObj = KdGameObjectFactory::Instance().CreateGameObject(info.m_className);
+
+	if (spObj)
+	{
+		spObj->SetMatrix(info.m_mWorld);
+
+		if (!info.m_assetName.empty()) { spObj->SetAsset(info.m_assetName); }
+
+		if (m_onActivate) { m_onActivate(spObj); }
+	}
+
+	// 生成に失敗しても順番がずれないよう枠は確保しておく
+	cell.m_objects.push_back(spObj);
+
+	if (cell.m_objects.size() >= cell.m_desc.m_objects.size())
+	{
+		cell.m_state = CellState::Active;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 全オブジェクトを非活性化してアセットを手放す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdWorldStreamer::UnloadCell(Cell& cell)
+{
+	for (auto& spObj : cell.m_objects)
+	{
+		if (spObj && m_onDeactivate) { m_onDeactivate(spObj); }
+	}
+
+	cell.m_objects.clear();
+
+	cell.m_spModels.clear();
+	cell.m_spTextures.clear();
+
+	cell.m_state = CellState::Unloaded;
+}
@@ -0,0 +1,137 @@
+﻿#pragma once
+
+class KdGameObject;
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ワールドを一定サイズのセル(XZ平面の格子)に分割し、注視点の周囲だけを読み込むクラス
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 各セルは使用するアセット(モデル・テクスチャ)と配置するゲームオブジェクトのリストを持つ
+// 読込半径に入ったセルはアセットを別スレッドで非同期に読み込み、読込完了後にオブジェクトを生成(活性化)する
+// 活性化は1フレームあたりの処理時間の上限内で少しずつ行い、フレーム落ちを防ぐ
+// 解放半径を読込半径より大きく取ることで、境界付近での読込・解放の繰り返しを防ぐ(ヒステリシス)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdWorldStreamer
+{
+public:
+
+	// 配置するゲームオブジェクトの情報
+	struct ObjectInfo
+	{
+		std::string		m_className;	// KdGameObjectFactoryに登録したクラス名
+		std::string		m_assetName;	// SetAsset()に渡すアセット名
+		Math::Matrix	m_mWorld;		// 配置する行列
+	};
+
+	// 1セル分の内容
+	struct CellDesc
+	{
+		std::vector<std::string>	m_modelNames;	// 読み込むモデル
+		std::vector<std::string>	m_textureNames;	// 読み込むテクスチャ
+		std::vector<ObjectInfo>		m_objects;		// 配置するオブジェクト
+	};
+
+	// セルの状態
+	enum class CellState
+	{
+		Unloaded,	// 未読込
+		Loading,	// アセットを非同期読込中
+		Loaded,		// 読込完了・オブジェクトの活性化待ち(活性化途中を含む)
+		Active,		// 全てのオブジェクトが活性化済み
+	};
+
+	// 動作設定
+	struct Settings
+	{
+		float	m_cellSize = 50.0f;				// セルの1辺の長さ
+		float	m_loadRadius = 100.0f;			// この距離以内に入ったセルを読み込む
+		float	m_unloadRadius = 150.0f;		// この距離より離れたセルを解放する：読込半径より大きくすること
+		float	m_activateBudgetMs = 2.0f;		// 1フレームあたりのオブジェクト活性化の処理時間上限(ミリ秒)
+		UINT	m_maxConcurrentLoads = 2;		// 同時に非同期読込を行うセルの最大数
+	};
+
+	KdWorldStreamer() {}
+	~KdWorldStreamer() { Release(); }
+
+	// 初期化
+	void Init(const Settings& settings);
+
+	// セルの登録：座標はセル単位の格子座標
+	void RegisterCell(int cellX, int cellZ, const CellDesc& desc);
+	// CSVからセルの一括登録
+	// 1行に「セルX,セルZ,Model,パス」「セルX,セルZ,Texture,パス」「セルX,セルZ,Object,クラス名,アセット名,X,Y,Z」
+	bool LoadCellTable(std::string_view fileName);
+
+	// 更新：注視点(カメラ・プレイヤーの座標)を元にセルの読込・活性化・解放を行う
+	void Update(const Math::Vector3& focusPos);
+
+	// 活性化済みの全オブジェクトを取得
+	void CollectActiveObjects(std::vector<std::shared_ptr<KdGameObject>>& result) const;
+
+	// オブジェクトの活性化・非活性化時の通知：シーンのオブジェクトリストへの追加・削除などに使う
+	void SetOnActivate(const std::function<void(const std::shared_ptr<KdGameObject>&)>& onActivate) { m_onActivate = onActivate; }
+	void SetOnDeactivate(const std::function<void(const std::shared_ptr<KdGameObject>&)>& onDeactivate) { m_onDeactivate = onDeactivate; }
+
+	// セルの状態取得
+	CellState GetCellState(int cellX, int cellZ) const;
+
+	// ワールド座標からセル座標を求める
+	void GetCellIndex(const Math::Vector3& pos, int& cellX, int& cellZ) const;
+
+	const Settings& GetSettings() const { return m_settings; }
+
+	// 解放：読込中のセルは完了を待つ
+	void Release();
+
+private:
+
+	// 1セル分の実行時データ
+	struct Cell
+	{
+		int			m_x = 0;
+		int			m_z = 0;
+
+		CellDesc	m_desc;
+
+		CellState	m_state = CellState::Unloaded;
+
+		// 非同期読込
+		std::future<void>	m_loading;
+
+		// 読み込んだアセット：参照を持つことでKdAssetsから解放されないようにする
+		std::vector<std::shared_ptr<KdModelData>>	m_spModels;
+		std::vector<std::shared_ptr<KdTexture>>		m_spTextures;
+
+		// 活性化したオブジェクト
+		std::vector<std::shared_ptr<KdGameObject>>	m_objects;
+	};
+
+	// 格子座標からセル検索用のキーを作成
+	static long long MakeCellKey(int cellX, int cellZ) { return (static_cast<long long>(cellX) << 32) | static_cast<unsigned int>(cellZ); }
+
+	// 注視点からセルまでの最短距離(XZ平面)
+	float CalcDistanceToCell(const Cell& cell, const Math::Vector3& focusPos) const;
+
+	// 非同期読込の開始
+	void BeginLoadCell(Cell& cell);
+	// 非同期読込の処理本体(別スレッド)
+	static void LoadCellProc(Cell& cell);
+
+	// オブジェクトを1つ活性化する：全て活性化済みならfalse
+	bool ActivateNextObject(Cell& cell);
+	// 全オブジェクトを非活性化してアセットを手放す
+	void UnloadCell(Cell& cell);
+
+	Settings	m_settings;
+
+	std::unordered_map<long long, Cell>	m_cells;
+
+	// 非同期読込中のセル数
+	UINT		m_loadingCount = 0;
+
+	std::function<void(const std::shared_ptr<KdGameObject>&)>	m_onActivate;
+	std::function<void(const std::shared_ptr<KdGameObject>&)>	m_onDeactivate;
+
+	// コピー禁止用
+	KdWorldStreamer(const KdWorldStreamer& src) = delete;
+	void operator=(const KdWorldStreamer& src) = delete;
+};
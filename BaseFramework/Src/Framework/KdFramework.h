@@ -26,10 +26,16 @@
 #include "Direct3D/KdMaterial.h"
 // メッシュ
 #include "Direct3D/KdMesh.h"
+// 描画用に変形したスキンメッシュ
+#include "Direct3D/KdSkinnedMesh.h"
 // モデル
 #include "Direct3D/KdModel.h"
 // データ保管庫：テンプレート
 #include "Utility/KdDataStorage.h"
+// アセットの先読み
+#include "Utility/KdAssetPrefetcher.h"
+// 静的バッチ
+#include "Direct3D/KdStaticBatch.h"
 
 // ポリゴン基底
 #include "Direct3D/Polygon/KdPolygon.h"
@@ -44,12 +50,34 @@
 // カメラ
 #include "Direct3D/KdCamera.h"
 
+// アニメーションの圧縮
+#include "Math/KdAnimationCompression.h"
+// アニメーションの姿勢の合成
+#include "Math/KdAnimationPose.h"
 // アニメーション
 #include "Math/KdAnimation.h"
+// 焼き付けたアニメーションの共有
+#include "Math/KdAnimationPoseCache.h"
+// アニメーションの並列更新
+#include "Math/KdAnimationBatch.h"
 // コマ送りアニメーション
 #include "Math/KdUVAnimation.h"
+// 当たり判定の計測
+#include "Math/KdCollisionStats.h"
+// 三角形の一括判定(SIMD)
+#include "Math/KdCollisionSIMD.h"
+// メッシュの三角形の空間分割
+#include "Math/KdMeshBVH.h"
+// 動くオブジェクトの境界ボックスの木
+#include "Math/KdDynamicAABBTree.h"
 // メッシュとポリゴンの接触判定
 #include "Math/KdCollision.h"
+// 高さの格子による地形
+#include "Math/KdHeightfield.h"
+// 静的な形状の当たり判定の焼き込み
+#include "Math/KdBakedMesh.h"
+// 前回の判定結果を使った判定の省略
+#include "Math/KdContactCache.h"
 // 当たり判定登録
 #include "Math/KdCollider.h"
 // 数値に緩急を付ける機能
@@ -68,6 +96,14 @@
 // ゲームオブジェクト関連
 #include "GameObject/KdGameObject.h"
 #include "GameObject/KdGameObjectFactory.h"
+// ワールドのセル分割読込
+#include "GameObject/KdWorldStreamer.h"
+// 当たり判定の対象の絞り込み
+#include "GameObject/KdCollisionWorld.h"
+// 当たり判定の一括・並列実行
+#include "GameObject/KdCollisionBatch.h"
+// カプセルの移動判定によるキャラクターの移動
+#include "GameObject/KdCharacterController.h"
 
 // Effekseer管理クラス
 #include "Effekseer/KdEffekseerManager.h"
@@ -1,192 +1,443 @@
 ﻿#include "KdAnimation.h"
 #include "../Direct3D/KdModel.h"
 
-// 二分探索で、指定時間から次の配列要素のKeyIndexを求める関数
-// list		… キー配列
-// time		… 時間
-// 戻り値	… 次の配列要素のIndex
-template<class T>
-int BinarySearchNextAnimKey(const std::vector<T>& list, float time)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 1チャンネルの補間
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 先頭のキーより前なら先頭、最後のキーより後なら最後の値
+// それ以外(中間の時間)なら、前後のキーの値をlerpで補間する
+// 元のキーリスト・圧縮したキーのどちらも同じ処理で補間する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Channel, class Lerp>
+static DirectX::XMVECTOR SampleChannel(const Channel& channel, float time, UINT* pCursor, Lerp lerp)
 {
-	int low = 0;
-	int high = (int)list.size();
-	while (low < high)
+	// キー位置検索
+	UINT keyIdx = channel.FindNextKey(time, pCursor);
+
+	if (keyIdx == 0) { return channel.GetValue(0); }
+
+	if (keyIdx >= channel.GetKeyNum()) { return channel.GetValue(channel.GetKeyNum() - 1); }
+
+	// 前のキーと次のキーの時間から、0～1間の時間を求める
+	// 同じ時間のキーが並んでいる場合は後のキーの値
+	float prevTime = channel.GetTime(keyIdx - 1);
+	float nextTime = channel.GetTime(keyIdx);
+	float f = nextTime > prevTime ? (time - prevTime) / (nextTime - prevTime) : 1.0f;
+
+	return lerp(channel.GetValue(keyIdx - 1), channel.GetValue(keyIdx), f);
+}
+
+static DirectX::XMVECTOR SampleVector(const KdAnimChannel<Math::Vector3>& channel, const KdPackedVectorChannel& packed,
+	float time, UINT* pCursor)
+{
+	auto lerp = [](const DirectX::XMVECTOR& prev, const DirectX::XMVECTOR& next, float f) { return DirectX::XMVectorLerp(prev, next, f); };
+
+	if (!channel.IsEmpty()) { return SampleChannel(channel, time, pCursor, lerp); }
+
+	return SampleChannel(packed, time, pCursor, lerp);
+}
+
+static DirectX::XMVECTOR SampleQuaternion(const KdAnimChannel<Math::Quaternion>& channel, const KdPackedQuaternionChannel& packed,
+	float time, UINT* pCursor)
+{
+	auto slerp = [](const DirectX::XMVECTOR& prev, const DirectX::XMVECTOR& next, float f) { return DirectX::XMQuaternionSlerp(prev, next, f); };
+
+	if (!channel.IsEmpty()) { return SampleChannel(channel, time, pCursor, slerp); }
+
+	return SampleChannel(packed, time, pCursor, slerp);
+}
+
+bool KdAnimationData::Node::InterpolateTranslations(Math::Vector3& result, float time, UINT* pCursor) const
+{
+	if (!HasTranslations()) { return false; }
+
+	result = SampleVector(m_translations, m_packedTranslations, time, pCursor);
+
+	return true;
+}
+
+bool KdAnimationData::Node::InterpolateRotations(Math::Quaternion& result, float time, UINT* pCursor) const
+{
+	if (!HasRotations()) { return false; }
+
+	result = SampleQuaternion(m_rotations, m_packedRotations, time, pCursor);
+
+	return true;
+}
+
+bool KdAnimationData::Node::InterpolateScales(Math::Vector3& result, float time, UINT* pCursor) const
+{
+	if (!HasScales()) { return false; }
+
+	result = SampleVector(m_scales, m_packedScales, time, pCursor);
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ノードの拡縮・回転・座標の補間
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdAnimationData::Node::Sample(float time, Cursor* pCursor,
+	DirectX::XMVECTOR& scale, DirectX::XMVECTOR& rotation, DirectX::XMVECTOR& translation) const
+{
+	if (!HasScales() && !HasRotations() && !HasTranslations()) { return false; }
+
+	// ベクターによる拡縮補間
+	scale = !HasScales() ? DirectX::g_XMOne.v :
+		SampleVector(m_scales, m_packedScales, time, pCursor ? &pCursor->m_scale : nullptr);
+
+	// クォタニオンによる回転補間
+	rotation = !HasRotations() ? DirectX::XMQuaternionIdentity() :
+		SampleQuaternion(m_rotations, m_packedRotations, time, pCursor ? &pCursor->m_rotation : nullptr);
+
+	// ベクターによる座標補間
+	translation = !HasTranslations() ? DirectX::XMVectorZero() :
+		SampleVector(m_translations, m_packedTranslations, time, pCursor ? &pCursor->m_translation : nullptr);
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ノードの行列の補間
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 拡縮 x 回転 x 座標 の3つの行列を作って掛け合わせずに直接組み立てる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimationData::Node::Interpolate(Math::Matrix& rDst, float time, Cursor* pCursor) const
+{
+	DirectX::XMVECTOR scale, rotation, translation;
+
+	if (!Sample(time, pCursor, scale, rotation, translation)) { return; }
+
+	rDst = KdAnimationPose::Compose(scale, rotation, translation);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 指定時間の姿勢を取り出す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimationData::SamplePose(float time, Node::Cursor* pCursors, KdAnimationPose& pose) const
+{
+	for (size_t i = 0; i < m_nodes.size(); ++i)
 	{
-		int mid = (low + high) / 2;
-		float midTime = list[mid].m_time;
+		// 対応するモデルノードのインデックス
+		UINT idx = m_nodes[i].m_nodeOffset;
 
-		if (midTime <= time) low = mid + 1;
-		else high = mid;
+		if (idx >= pose.GetNodeNum()) { continue; }
+
+		DirectX::XMVECTOR scale, rotation, translation;
+
+		if (!m_nodes[i].Sample(time, pCursors ? &pCursors[i] : nullptr, scale, rotation, translation)) { continue; }
+
+		pose.m_scales[idx] = scale;
+		pose.m_rotations[idx] = rotation;
+		pose.m_translations[idx] = translation;
+		pose.m_mask[idx] = 1;
 	}
-	return low;
 }
 
-bool KdAnimationData::Node::InterpolateTranslations(Math::Vector3& result, float time)
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// KdAnimator
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+KdAnimator::Layer& KdAnimator::WorkLayer(UINT layerIdx)
+{
+	if (layerIdx >= m_layers.size()) { m_layers.resize(layerIdx + 1); }
+
+	return m_layers[layerIdx];
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 指定のレイヤーで再生
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// クロスフェードする場合は、再生中のアニメーションを残して重み0から追加する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimator::Play(UINT layerIdx, const std::shared_ptr<KdAnimationData>& rData, float blendFrame, bool isLoop)
 {
-	if (m_translations.size() == 0)return false;
+	Layer& layer = WorkLayer(layerIdx);
 
-	// キー位置検索
-	UINT keyIdx = BinarySearchNextAnimKey(m_translations, time);
-
-	// 先頭のキーなら、先頭のデータを返す
-	if (keyIdx == 0) {
-		result = m_translations.front().m_vec;
-		return true;
-	}
-	// 配列外のキーなら、最後のデータを返す
-	else if (keyIdx >= m_translations.size()) {
-		result = m_translations.back().m_vec;
-		return true;
-	}
-	// それ以外(中間の時間)なら、その時間の値を補間計算で求める
-	else {
-		auto& prev = m_translations[keyIdx - 1];	// 前のキー
-		auto& next = m_translations[keyIdx];		// 次のキー
-		// 前のキーと次のキーの時間から、0～1間の時間を求める
-		float f = (time - prev.m_time) / (next.m_time - prev.m_time);
-		// 補間
-		result = DirectX::XMVectorLerp(
-			prev.m_vec,
-			next.m_vec,
-			f
-		);
+	if (!rData)
+	{
+		layer.m_tracks.clear();
+		return;
 	}
 
-	return true;
+	bool isCrossFade = blendFrame > 0.0f && !layer.m_tracks.empty();
+
+	if (!isCrossFade) { layer.m_tracks.clear(); }
+
+	if (layer.m_tracks.size() >= kMaxTrackNum) { layer.m_tracks.erase(layer.m_tracks.begin()); }
+
+	Track& track = layer.m_tracks.emplace_back();
+
+	track.m_spAnimation = rData;
+	track.m_isLoop = isLoop;
+
+	// キーの検索位置は先頭から
+	track.m_cursors.assign(rData->m_nodes.size(), KdAnimationData::Node::Cursor());
+
+	track.m_weight = isCrossFade ? 0.0f : 1.0f;
+	track.m_fadeSpeed = isCrossFade ? 1.0f / blendFrame : 0.0f;
+
+	// 止めている途中のレイヤーでも再生し直す
+	if (layer.m_isStopping)
+	{
+		layer.m_isStopping = false;
+		layer.m_weightSpeed = std::abs(layer.m_targetWeight - layer.m_weight) / std::max(blendFrame, 1.0f);
+	}
 }
 
-bool KdAnimationData::Node::InterpolateRotations(Math::Quaternion& result, float time)
+void KdAnimator::SetLayerBlendMode(UINT layerIdx, BlendMode mode)
 {
-	if (m_rotations.size() == 0)return false;
+	WorkLayer(layerIdx).m_mode = mode;
+}
 
-	// キー位置検索
-	UINT keyIdx = BinarySearchNextAnimKey(m_rotations, time);
-	// 先頭のキーなら、先頭のデータを返す
-	if (keyIdx == 0) {
-		result = m_rotations.front().m_quat;
-	}
-	// 配列外のキーなら、最後のデータを返す
-	else if (keyIdx >= m_rotations.size()) {
-		result = m_rotations.back().m_quat;
-	}
-	// それ以外(中間の時間)なら、その時間の値を補間計算で求める
-	else {
-		auto& prev = m_rotations[keyIdx - 1];	// 前のキー
-		auto& next = m_rotations[keyIdx];		// 次のキー
-		// 前のキーと次のキーの時間から、0～1間の時間を求める
-		float f = (time - prev.m_time) / (next.m_time - prev.m_time);
-		// 補間
-		result = DirectX::XMQuaternionSlerp(
-			prev.m_quat,
-			next.m_quat,
-			f
-		);
+void KdAnimator::SetLayerWeight(UINT layerIdx, float weight, float blendFrame)
+{
+	Layer& layer = WorkLayer(layerIdx);
+
+	layer.m_targetWeight = weight;
+	layer.m_isStopping = false;
+
+	if (blendFrame > 0.0f)
+	{
+		layer.m_weightSpeed = std::abs(weight - layer.m_weight) / blendFrame;
+	}
+	else
+	{
+		layer.m_weight = weight;
+		layer.m_weightSpeed = 0.0f;
 	}
+}
 
-	return true;
+void KdAnimator::SetLayerMask(UINT layerIdx, const std::vector<float>& nodeWeights)
+{
+	WorkLayer(layerIdx).m_mask = nodeWeights;
 }
 
-bool KdAnimationData::Node::InterpolateScales(Math::Vector3& result, float time)
+void KdAnimator::StopLayer(UINT layerIdx, float blendFrame)
 {
-	if (m_scales.size() == 0)return false;
+	if (layerIdx >= m_layers.size()) { return; }
 
-	// キー位置検索
-	UINT keyIdx = BinarySearchNextAnimKey(m_scales, time);
-
-	// 先頭のキーなら、先頭のデータを返す
-	if (keyIdx == 0) {
-		result = m_scales.front().m_vec;
-		return true;
-	}
-	// 配列外のキーなら、最後のデータを返す
-	else if (keyIdx >= m_scales.size()) {
-		result = m_scales.back().m_vec;
-		return true;
-	}
-	// それ以外(中間の時間)なら、その時間の値を補間計算で求める
-	else {
-		auto& prev = m_scales[keyIdx - 1];	// 前のキー
-		auto& next = m_scales[keyIdx];		// 次のキー
-		// 前のキーと次のキーの時間から、0～1間の時間を求める
-		float f = (time - prev.m_time) / (next.m_time - prev.m_time);
-		// 補間
-		result = DirectX::XMVectorLerp(
-			prev.m_vec,
-			next.m_vec,
-			f
-		);
+	Layer& layer = m_layers[layerIdx];
+
+	if (blendFrame <= 0.0f)
+	{
+		layer.m_tracks.clear();
+		return;
 	}
 
-	return true;
+	// 重みが0になった時点で止める：止めた後に再生する場合に備えて元の重みを戻す
+	layer.m_isStopping = true;
+	layer.m_weightSpeed = layer.m_weight / blendFrame;
 }
 
-void KdAnimationData::Node::Interpolate(Math::Matrix& rDst, float time)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 指定の名前のノードとその子孫を1にしたマスク
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+std::vector<float> KdAnimator::CreateMask(const KdModelData& model, std::string_view rootNodeName)
 {
-	// ベクターによる拡縮補間
-	bool isChange = false;
-	Math::Matrix scale;
-	Math::Vector3 resultVec;
-	if (InterpolateScales(resultVec, time))
+	const std::vector<KdModelData::Node>& nodes = model.GetOriginalNodes();
+
+	std::vector<float> mask(nodes.size(), 0.0f);
+
+	std::vector<int> stack;
+
+	for (size_t nodeIdx = 0; nodeIdx < nodes.size(); ++nodeIdx)
 	{
-		scale = scale.CreateScale(resultVec);
-		isChange = true;
+		if (nodes[nodeIdx].m_name == rootNodeName) { stack.push_back(static_cast<int>(nodeIdx)); }
 	}
 
-	// クォタニオンによる回転補間
-	Math::Matrix rotate;
-	Math::Quaternion resultQuat;
-	if (InterpolateRotations(resultQuat, time))
+	while (!stack.empty())
 	{
-		rotate = rotate.CreateFromQuaternion(resultQuat);
-		isChange = true;
+		int nodeIdx = stack.back();
+		stack.pop_back();
+
+		mask[nodeIdx] = 1.0f;
+
+		stack.insert(stack.end(), nodes[nodeIdx].m_children.begin(), nodes[nodeIdx].m_children.end());
 	}
 
-	// ベクターによる座標補間
-	Math::Matrix trans;
-	if (InterpolateTranslations(resultVec, time))
+	return mask;
+}
+
+bool KdAnimator::IsAnimationEnd() const
+{
+	if (m_layers.empty() || m_layers[0].m_tracks.empty()) { return true; }
+
+	const Track& track = m_layers[0].m_tracks.back();
+
+	if (track.m_time >= track.m_spAnimation->m_maxLength) { return true; }
+
+	return false;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// アニメーションの更新
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 下のレイヤーから順に姿勢を合成し、最後に1回だけ行列へ書き込む
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimator::AdvanceTime(KdModelWork& rModel, float speed)
+{
+	Layer* pSingleLayer = nullptr;
+	UINT activeLayerNum = 0;
+
+	for (Layer& layer : m_layers)
 	{
-		trans = trans.CreateTranslation(resultVec);
-		isChange = true;
+		if (!IsActive(layer)) { continue; }
+
+		pSingleLayer = &layer;
+		++activeLayerNum;
 	}
 
-	if (isChange)
+	if (!activeLayerNum) { return; }
+
+	if (activeLayerNum == 1 && pSingleLayer->m_tracks.size() == 1 &&
+		pSingleLayer->m_mode == BlendMode::Override && pSingleLayer->m_mask.empty())
 	{
-		rDst = scale * rotate * trans;
+		//------------------------------
+		// 1つのアニメーションだけなら直接書き込む
+		//------------------------------
+		Track& track = pSingleLayer->m_tracks.front();
+
+		const std::vector<KdAnimationData::Node>& animNodes = track.m_spAnimation->m_nodes;
+
+		// 全てのアニメーションノード（モデルの行列を補間する情報）の行列補間を実行する
+		for (size_t i = 0; i < animNodes.size(); ++i)
+		{
+			// 対応するモデルノードのインデックス
+			UINT idx = animNodes[i].m_nodeOffset;
+
+			// アニメーションデータによる行列補間：キーは前回の位置から探す
+			animNodes[i].Interpolate(rModel.WorkLocalTransform(idx), track.m_time, &track.m_cursors[i]);
+		}
+	}
+	else
+	{
+		//------------------------------
+		// レイヤーの合成
+		//------------------------------
+		const UINT nodeNum = rModel.GetNodeNum();
+
+		KdAnimationPosePool::ScopedPose result(nodeNum);
+		KdAnimationPosePool::ScopedPose layerPose(nodeNum);
+		KdAnimationPosePool::ScopedPose work(nodeNum);
+
+		for (Layer& layer : m_layers)
+		{
+			if (!IsActive(layer)) { continue; }
+
+			SampleLayer(layer, *layerPose, *work);
+
+			const std::vector<float>* pMask = layer.m_mask.empty() ? nullptr : &layer.m_mask;
+
+			if (layer.m_mode == BlendMode::Additive)
+			{
+				result->AddDelta(*layerPose, layer.m_weight, pMask);
+			}
+			else
+			{
+				result->Blend(*layerPose, layer.m_weight, pMask);
+			}
+		}
+
+		result->WriteLocalTransforms(rModel);
+	}
+
+	// アニメーションのフレームを進める
+	for (Layer& layer : m_layers)
+	{
+		AdvanceLayer(layer, speed);
 	}
 }
 
-void KdAnimator::AdvanceTime(std::vector<KdModelWork::Node>& rNodes, float speed)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// レイヤーの姿勢
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 古いアニメーションから順に、後のアニメーションをその重みで合成していく
+// Additiveのレイヤーはそれぞれのアニメーションの先頭の姿勢からの差分にしてから合成する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimator::SampleLayer(Layer& layer, KdAnimationPose& dst, KdAnimationPose& work) const
 {
-	if (!m_spAnimation) { return; }
+	const UINT nodeNum = dst.GetNodeNum();
 
-	// 全てのアニメーションノード（モデルの行列を補間する情報）の行列補間を実行する
-	for (auto& rAnimNode : m_spAnimation->m_nodes)
+	dst.Reset(nodeNum);
+
+	for (size_t i = 0; i < layer.m_tracks.size(); ++i)
 	{
-		// 対応するモデルノードのインデックス
-		UINT idx = rAnimNode.m_nodeOffset;
+		Track& track = layer.m_tracks[i];
 
-		auto prev = rNodes[idx].m_localTransform;
+		// 最初のアニメーションは直接書き込む
+		KdAnimationPose& target = i == 0 ? dst : work;
 
-		// アニメーションデータによる行列補間
-		rAnimNode.Interpolate(rNodes[idx].m_localTransform, m_time);
+		if (i > 0) { work.Reset(nodeNum); }
 
-		prev = rNodes[idx].m_localTransform;
+		track.m_spAnimation->SamplePose(track.m_time, track.m_cursors.data(), target);
+
+		if (layer.m_mode == BlendMode::Additive)
+		{
+			if (track.m_reference.GetNodeNum() != nodeNum)
+			{
+				track.m_reference.Reset(nodeNum);
+				track.m_spAnimation->SamplePose(0.0f, nullptr, track.m_reference);
+			}
+
+			target.MakeDelta(track.m_reference);
+		}
+
+		if (i > 0) { dst.Blend(work, track.m_weight); }
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// レイヤーの時間と重みを進める
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 最後のアニメーションの重みが1になったら、それより前のアニメーションは捨てる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimator::AdvanceLayer(Layer& layer, float speed)
+{
+	for (Track& track : layer.m_tracks)
+	{
+		AdvanceTrack(track, speed);
+
+		track.m_weight = std::min(track.m_weight + track.m_fadeSpeed * speed, 1.0f);
+	}
+
+	if (layer.m_tracks.size() > 1 && layer.m_tracks.back().m_weight >= 1.0f)
+	{
+		layer.m_tracks.erase(layer.m_tracks.begin(), layer.m_tracks.end() - 1);
 	}
 
+	// レイヤーの重み
+	float target = layer.m_isStopping ? 0.0f : layer.m_targetWeight;
+
+	if (layer.m_weight < target) { layer.m_weight = std::min(layer.m_weight + layer.m_weightSpeed * speed, target); }
+	else if (layer.m_weight > target) { layer.m_weight = std::max(layer.m_weight - layer.m_weightSpeed * speed, target); }
+
+	if (layer.m_isStopping && layer.m_weight <= 0.0f)
+	{
+		layer.m_tracks.clear();
+
+		layer.m_isStopping = false;
+		layer.m_weight = layer.m_targetWeight;
+		layer.m_weightSpeed = 0.0f;
+	}
+}
+
+void KdAnimator::AdvanceTrack(Track& track, float speed)
+{
 	// アニメーションのフレームを進める
-	m_time += speed;
+	track.m_time += speed;
 
 	// アニメーションデータの最後のフレームを超えたら
-	if (m_time >= m_spAnimation->m_maxLength)
+	if (track.m_time >= track.m_spAnimation->m_maxLength)
 	{
-		if (m_isLoop)
+		if (track.m_isLoop)
 		{
 			// アニメーションの最初に戻る（ループさせる
-			m_time = 0.0f;
+			track.m_time = 0.0f;
 		}
 		else
 		{
-			m_time = m_spAnimation->m_maxLength;
+			track.m_time = track.m_spAnimation->m_maxLength;
 		}
 	}
 }
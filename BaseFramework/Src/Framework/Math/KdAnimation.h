@@ -14,6 +14,106 @@ struct KdAnimKeyVector3
 	Math::Vector3		m_vec;			// 3Dベクトルデータ
 };
 
+// 前回のキーの番号から順に探すキーの最大数：これ以上進んだ場合は残りを二分探索する
+constexpr UINT kAnimKeyLinearSearchNum = 4;
+
+// 二分探索で、指定時間から次のキーの番号を求める
+// channel	… GetKeyNum()・GetTime()を持つキーの配列
+// low		… 探し始める番号：これより前のキーの時間はtime以下であること
+template<class Channel>
+UINT KdSearchNextAnimKey(const Channel& channel, float time, UINT low = 0)
+{
+	UINT high = channel.GetKeyNum();
+
+	while (low < high)
+	{
+		UINT mid = (low + high) / 2;
+
+		if (channel.GetTime(mid) <= time) { low = mid + 1; }
+		else { high = mid; }
+	}
+
+	return low;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 指定時間の次のキーの番号(時間がtimeより後の最初のキー)
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// pCursor	… 前回の結果：時間が前回から進んでいれば、前回の番号から順に探す
+// 再生中は1フレームで進むキーは0～1個なので、前回の番号から順に調べれば二分探索より少なく済む
+// 時間が戻った(ループした・再生位置を変えた)場合は全体を二分探索する
+// どちらで探しても結果は同じ
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Channel>
+UINT KdFindNextAnimKey(const Channel& channel, float time, UINT* pCursor)
+{
+	const UINT keyNum = channel.GetKeyNum();
+
+	UINT keyIdx = pCursor ? *pCursor : UINT_MAX;
+
+	if (keyIdx > keyNum || (keyIdx > 0 && channel.GetTime(keyIdx - 1) > time))
+	{
+		keyIdx = KdSearchNextAnimKey(channel, time);
+	}
+	else
+	{
+		UINT limit = std::min(keyIdx + kAnimKeyLinearSearchNum, keyNum);
+
+		while (keyIdx < limit && channel.GetTime(keyIdx) <= time) { ++keyIdx; }
+
+		if (keyIdx == limit && keyIdx < keyNum && channel.GetTime(keyIdx) <= time)
+		{
+			keyIdx = KdSearchNextAnimKey(channel, time, keyIdx);
+		}
+	}
+
+	if (pCursor) { *pCursor = keyIdx; }
+
+	return keyIdx;
+}
+
+//============================
+// 1チャンネル分のアニメーションキー
+//============================
+// 時間と値を別々の配列に持つ(SoA)：キーの検索では時間の配列だけを連続して読む
+template<class T>
+struct KdAnimChannel
+{
+	std::vector<float>	m_times;	// 時間(昇順)
+	std::vector<T>		m_values;	// 時間に対応する値
+
+	bool IsEmpty() const { return m_times.empty(); }
+	UINT GetKeyNum() const { return static_cast<UINT>(m_times.size()); }
+
+	float GetTime(UINT idx) const { return m_times[idx]; }
+	DirectX::XMVECTOR GetValue(UINT idx) const { return m_values[idx]; }
+
+	// キーリスト(時間と値の組の配列)から設定
+	template<class Key>
+	void SetKeys(const std::vector<Key>& keys, T Key::* pValue)
+	{
+		m_times.resize(keys.size());
+		m_values.resize(keys.size());
+
+		for (size_t i = 0; i < keys.size(); ++i)
+		{
+			m_times[i] = keys[i].m_time;
+			m_values[i] = keys[i].*pValue;
+		}
+	}
+
+	void Clear()
+	{
+		m_times.clear();
+		m_times.shrink_to_fit();
+		m_values.clear();
+		m_values.shrink_to_fit();
+	}
+
+	// 指定時間の次のキーの番号：pCursorを指定すると前回の番号から探す
+	UINT FindNextKey(float time, UINT* pCursor = nullptr) const { return KdFindNextAnimKey(*this, time, pCursor); }
+};
+
 //============================
 // アニメーションデータ
 //============================
@@ -30,49 +130,143 @@ struct KdAnimationData
 		int			m_nodeOffset = -1;	// 対象モデルノードのOffset値
 
 		// 各チャンネル
-		std::vector<KdAnimKeyVector3>		m_translations;	// 位置キーリスト
-		std::vector<KdAnimKeyQuaternion>	m_rotations;	// 回転キーリスト
-		std::vector<KdAnimKeyVector3>		m_scales;		// 拡縮キーリスト
-
-		void Interpolate(Math::Matrix& rDst, float time);
-		bool InterpolateTranslations(Math::Vector3& result, float time);
-		bool InterpolateRotations(Math::Quaternion& result, float time);
-		bool InterpolateScales(Math::Vector3& result, float time);
+		KdAnimChannel<Math::Vector3>		m_translations;	// 位置キーリスト
+		KdAnimChannel<Math::Quaternion>		m_rotations;	// 回転キーリスト
+		KdAnimChannel<Math::Vector3>		m_scales;		// 拡縮キーリスト
+
+		// 圧縮したキー(KdCompressAnimation()で作成)：元のキーリストが空の場合はこちらから補間する
+		KdPackedVectorChannel				m_packedTranslations;
+		KdPackedQuaternionChannel			m_packedRotations;
+		KdPackedVectorChannel				m_packedScales;
+
+		bool HasTranslations() const { return !m_translations.IsEmpty() || !m_packedTranslations.IsEmpty(); }
+		bool HasRotations() const { return !m_rotations.IsEmpty() || !m_packedRotations.IsEmpty(); }
+		bool HasScales() const { return !m_scales.IsEmpty() || !m_packedScales.IsEmpty(); }
+
+		// 再生側が持つ、各チャンネルの前回のキーの番号
+		struct Cursor
+		{
+			UINT	m_translation = 0;
+			UINT	m_rotation = 0;
+			UINT	m_scale = 0;
+		};
+
+		// 補間：pCursorを指定すると前回のキーの番号から検索する
+		// キーの無いチャンネルは 拡縮1・回転無し・座標0 になる：全てのチャンネルにキーが無ければfalse
+		bool Sample(float time, Cursor* pCursor, DirectX::XMVECTOR& scale, DirectX::XMVECTOR& rotation, DirectX::XMVECTOR& translation) const;
+		void Interpolate(Math::Matrix& rDst, float time, Cursor* pCursor = nullptr) const;
+		bool InterpolateTranslations(Math::Vector3& result, float time, UINT* pCursor = nullptr) const;
+		bool InterpolateRotations(Math::Quaternion& result, float time, UINT* pCursor = nullptr) const;
+		bool InterpolateScales(Math::Vector3& result, float time, UINT* pCursor = nullptr) const;
 	};
 
 	// 全ノード用アニメーションデータ
 	std::vector<Node>	m_nodes;
+
+	// 圧縮の結果：圧縮していなければ全て0
+	KdAnimCompressReport	m_compressReport;
+
+	// 指定時間の姿勢を取り出す：アニメーションの無いノードは書き込まない
+	// pCursors	… アニメーションノード毎のキーの検索位置(m_nodesと同じ数)：nullptrなら毎回全体を探す
+	void SamplePose(float time, Node::Cursor* pCursors, KdAnimationPose& pose) const;
 };
 
+//============================
+// アニメーションの再生
+//============================
+// レイヤー毎にアニメーションを再生して合成し、モデルのノードの行列へ書き込む
+// ・レイヤー0が基本の動き：それより上のレイヤーは、重みとマスクの割合で上書き(Override)するか差分を加える(Additive)
+// ・各レイヤーはblendFrameを指定すると、前のアニメーションから徐々に切り替わる(クロスフェード)
+// ・合成は姿勢バッファ(KdAnimationPose)で行い、行列へは最後に1回だけ書き込む
+// 　作業用の姿勢バッファは使い回すので、毎フレームのメモリの確保は発生しない
+// 1つのアニメーションだけを再生している間は、合成せずに直接行列へ書き込む
 class KdAnimator
 {
 public:
 
-	inline void SetAnimation(const std::shared_ptr<KdAnimationData>& rData, bool isLoop = true)
+	// レイヤーの合成方法
+	enum class BlendMode
 	{
-		m_spAnimation = rData;
-		m_isLoop = isLoop;
+		Override,	// 下のレイヤーまでの結果を重みの割合で置き換える
+		Additive,	// アニメーションの先頭の姿勢からの差分を重みの割合で加える
+	};
 
-		m_time = 0.0f;
-	}
+	// 基本のレイヤーで再生：即座に切り替える
+	void SetAnimation(const std::shared_ptr<KdAnimationData>& rData, bool isLoop = true) { Play(0, rData, 0.0f, isLoop); }
 
-	// アニメーションが終了してる？
-	bool IsAnimationEnd() const
-	{
-		if (m_spAnimation == nullptr) { return true; }
-		if (m_time >= m_spAnimation->m_maxLength) { return true; }
+	// 基本のレイヤーで再生：blendFrameかけて切り替える
+	void CrossFade(const std::shared_ptr<KdAnimationData>& rData, float blendFrame, bool isLoop = true) { Play(0, rData, blendFrame, isLoop); }
 
-		return false;
-	}
+	// 指定のレイヤーで再生：blendFrameが0なら即座に切り替える
+	// rDataがnullptrならレイヤーの再生を止める
+	void Play(UINT layerIdx, const std::shared_ptr<KdAnimationData>& rData, float blendFrame = 0.0f, bool isLoop = true);
+
+	// レイヤーの設定
+	// ・重み		… blendFrameかけて変える
+	// ・マスク		… ノード毎に重みへ掛ける値(CreateMask()で作成)：空なら全てのノード
+	void SetLayerBlendMode(UINT layerIdx, BlendMode mode);
+	void SetLayerWeight(UINT layerIdx, float weight, float blendFrame = 0.0f);
+	void SetLayerMask(UINT layerIdx, const std::vector<float>& nodeWeights);
+
+	// レイヤーの再生をblendFrameかけて止める
+	void StopLayer(UINT layerIdx, float blendFrame = 0.0f);
+
+	// 指定の名前のノードとその子孫を1、それ以外を0にしたマスク
+	static std::vector<float> CreateMask(const KdModelData& model, std::string_view rootNodeName);
+
+	// アニメーションが終了してる？(基本のレイヤーの現在のアニメーション)
+	bool IsAnimationEnd() const;
 
-	// アニメーションの更新
-	void AdvanceTime(std::vector<KdModelWork::Node>& rNodes, float speed = 1.0f);
+	// アニメーションの更新：アニメーションするノードだけが行列の再計算の対象になる
+	void AdvanceTime(KdModelWork& rModel, float speed = 1.0f);
 
 private:
 
-	std::shared_ptr<KdAnimationData>	m_spAnimation = nullptr;	// 再生するアニメーションデータ
+	// 1つのアニメーションの再生状態
+	struct Track
+	{
+		std::shared_ptr<KdAnimationData>	m_spAnimation = nullptr;	// 再生するアニメーションデータ
 
-	float m_time = 0.0f;
+		// アニメーションノード毎のキーの検索位置
+		std::vector<KdAnimationData::Node::Cursor>	m_cursors;
 
-	bool m_isLoop = false;
-};
+		float	m_time = 0.0f;
+		bool	m_isLoop = false;
+
+		float	m_weight = 1.0f;		// クロスフェード中の重み
+		float	m_fadeSpeed = 0.0f;		// 1フレームあたりの重みの増加量
+
+		KdAnimationPose	m_reference;	// Additiveの差分の基準(先頭の姿勢)：必要になった時に作成
+	};
+
+	// レイヤー
+	struct Layer
+	{
+		std::vector<Track>	m_tracks;			// 古い順：最後が現在のアニメーション
+
+		BlendMode			m_mode = BlendMode::Override;
+
+		float				m_weight = 1.0f;
+		float				m_targetWeight = 1.0f;
+		float				m_weightSpeed = 0.0f;	// 1フレームあたりの重みの変化量
+		bool				m_isStopping = false;	// 重みが0になったら再生を止める
+
+		std::vector<float>	m_mask;
+	};
+
+	// クロスフェード中に保持するアニメーションの最大数：超えたら古いものから捨てる
+	static constexpr size_t kMaxTrackNum = 4;
+
+	Layer& WorkLayer(UINT layerIdx);
+
+	bool IsActive(const Layer& layer) const { return !layer.m_tracks.empty() && layer.m_weight > 0.0f; }
+
+	// レイヤーの姿勢：クロスフェード中のアニメーションを合成する
+	void SampleLayer(Layer& layer, KdAnimationPose& dst, KdAnimationPose& work) const;
+
+	// 時間と重みを進める
+	static void AdvanceLayer(Layer& layer, float speed);
+	static void AdvanceTrack(Track& track, float speed);
+
+	std::vector<Layer>	m_layers;
+};
\ No newline at end of file
@@ -0,0 +1,122 @@
+﻿#include "KdAnimationBatch.h"
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 初期化
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimationBatch::Init(UINT workerNum)
+{
+	if (workerNum == 0)
+	{
+		// hardware_concurrency()は取得できないと0を返すので、引く前に確認する
+		UINT threadNum = std::thread::hardware_concurrency();
+
+		workerNum = threadNum > 1 ? threadNum - 1 : 1;
+	}
+
+	m_workerNum = workerNum;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 更新するモデルの登録
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimationBatch::Add(KdModelWork& rModel, KdAnimator& rAnimator, float speed)
+{
+	Entry& entry = m_entries.emplace_back();
+	entry.m_pModel = &rModel;
+	entry.m_pAnimator = &rAnimator;
+	entry.m_speed = speed;
+}
+
+void KdAnimationBatch::Add(KdModelWork& rModel, KdBakedAnimator& rAnimator, float speed)
+{
+	Entry& entry = m_entries.emplace_back();
+	entry.m_pModel = &rModel;
+	entry.m_pBakedAnimator = &rAnimator;
+	entry.m_speed = speed;
+}
+
+void KdAnimationBatch::Add(KdModelWork& rModel)
+{
+	Entry& entry = m_entries.emplace_back();
+	entry.m_pModel = &rModel;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 登録済みのモデルを並列に更新する
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// メインスレッドも更新に加わり、全ての更新が終わるまで待つ
+// 登録の配列は確保したまま空にするので、毎フレームのメモリの確保は発生しない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimationBatch::Execute()
+{
+	const UINT entryNum = static_cast<UINT>(m_entries.size());
+
+	if (entryNum == 0) { return; }
+
+	m_nextIdx = 0;
+
+	// モデル数に対して多すぎるワーカーは起動しない：メインスレッドも加わるのでその分を減らす
+	UINT workerNum = std::min(m_workerNum, (entryNum + kChunkSize - 1) / kChunkSize) - 1;
+
+	std::vector<std::future<void>> workers;
+	workers.reserve(workerNum);
+
+	for (UINT i = 0; i < workerNum; ++i)
+	{
+		workers.push_back(std::async(std::launch::async, [this]() { WorkerProc(); }));
+	}
+
+	WorkerProc();
+
+	for (auto& worker : workers) { worker.wait(); }
+
+	m_entries.clear();
+}
+
+void KdAnimationBatch::Release()
+{
+	m_entries.clear();
+	m_entries.shrink_to_fit();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ワーカーの処理本体
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// モデルはそれぞれ自分の行列・頂点にだけ書き込むので排他制御は不要
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimationBatch::WorkerProc()
+{
+	const UINT entryNum = static_cast<UINT>(m_entries.size());
+
+	while (true)
+	{
+		UINT begin = m_nextIdx.fetch_add(kChunkSize);
+
+		if (begin >= entryNum) { break; }
+
+		UINT end = std::min(begin + kChunkSize, entryNum);
+
+		for (UINT i = begin; i < end; ++i)
+		{
+			UpdateEntry(m_entries[i]);
+		}
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデル1つ分の更新
+// スキンメッシュの変形はモデル単位で並列になっているので、メッシュの中では分割しない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimationBatch::UpdateEntry(const Entry& entry)
+{
+	KdModelWork& model = *entry.m_pModel;
+
+	if (!model.GetData()) { return; }
+
+	if (entry.m_pAnimator) { entry.m_pAnimator->AdvanceTime(model, entry.m_speed); }
+	if (entry.m_pBakedAnimator) { entry.m_pBakedAnimator->AdvanceTime(model, entry.m_speed); }
+
+	if (model.NeedCalcNodeMatrices()) { model.CalcNodeMatrices(); }
+
+	if (model.GetData()->IsSkinMesh()) { model.UpdateSkinning(); }
+}
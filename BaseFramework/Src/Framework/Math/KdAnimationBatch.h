@@ -0,0 +1,77 @@
+﻿#pragma once
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// アニメーションとノードの行列の更新をまとめて複数スレッドで実行するクラス
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 各オブジェクトの更新中にモデルとアニメーションの組を登録し、全オブジェクトの更新後・描画前にExecute()する
+// モデル毎に アニメーションを進める → ノードの行列を計算する → スキンメッシュを変形する をまとめて行う
+// 描画時には行列・変形済みの頂点が揃っているので、DrawModel()は読み取るだけになる
+// (登録しなかったモデルは従来通りDrawModel()の中で計算される)
+//
+// ・登録したモデル・アニメーションはExecute()が終わるまで破棄・変更しないこと
+// ・同じモデルを1フレームに2回以上登録しないこと(別々のスレッドで同時に書き込まれる)
+// ・Execute()で登録は全て消えるので、毎フレーム登録し直す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdAnimationBatch
+{
+public:
+
+	static KdAnimationBatch& Instance()
+	{
+		static KdAnimationBatch instance;
+		return instance;
+	}
+
+	// 初期化：workerNumが0ならCPUのスレッド数 - 1(メインスレッドの分)
+	void Init(UINT workerNum = 0);
+
+	// 更新するモデルの登録
+	// ・speed	… アニメーションを進める量
+	// アニメーションを登録しない場合は行列の計算とスキンメッシュの変形だけを行う
+	void Add(KdModelWork& rModel, KdAnimator& rAnimator, float speed = 1.0f);
+	void Add(KdModelWork& rModel, KdBakedAnimator& rAnimator, float speed = 1.0f);
+	void Add(KdModelWork& rModel);
+
+	// 登録済みのモデル数
+	UINT GetCount() const { return static_cast<UINT>(m_entries.size()); }
+
+	// 登録済みのモデルを並列に更新し、完了を待つ
+	void Execute();
+
+	// 解放
+	void Release();
+
+private:
+
+	// 登録されたモデル1つ分
+	struct Entry
+	{
+		KdModelWork*		m_pModel = nullptr;
+		KdAnimator*			m_pAnimator = nullptr;
+		KdBakedAnimator*	m_pBakedAnimator = nullptr;
+		float				m_speed = 1.0f;
+	};
+
+	// ワーカーの処理本体：モデルをまとめて取り出して更新する
+	void WorkerProc();
+
+	// モデル1つ分
+	static void UpdateEntry(const Entry& entry);
+
+	// 1回に取り出すモデルの数：取り出しの競合を減らす
+	static constexpr UINT kChunkSize = 8;
+
+	UINT	m_workerNum = 1;
+
+	std::vector<Entry>	m_entries;
+
+	// 次に取り出すモデルの番号
+	std::atomic<UINT>	m_nextIdx = 0;
+
+	KdAnimationBatch() { Init(); }
+	~KdAnimationBatch() { Release(); }
+
+	// コピー禁止用
+	KdAnimationBatch(const KdAnimationBatch& src) = delete;
+	void operator=(const KdAnimationBatch& src) = delete;
+};
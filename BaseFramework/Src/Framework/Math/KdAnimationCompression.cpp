@@ -0,0 +1,356 @@
+﻿#include "KdAnimationCompression.h"
+#include "KdAnimation.h"
+
+// 16bitの量子化の最大値
+static constexpr long kQuantizeMax = 65535;
+// 回転の各成分の量子化の最大値(15bit)
+static constexpr long kQuatQuantizeMax = 32767;
+
+// smallest threeの残りの3成分が取り得る範囲：最大の成分以外は ±1/√2 に収まる
+static constexpr float kSqrt2 = 1.41421356f;
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// 圧縮したキーの復元
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+UINT KdPackedAnimTimes::FindNextKey(float time, UINT* pCursor) const
+{
+	return KdFindNextAnimKey(*this, time, pCursor);
+}
+
+DirectX::XMVECTOR KdPackedVectorChannel::GetValue(UINT idx) const
+{
+	const uint16_t* pValue = &m_values[idx * 3];
+
+	DirectX::XMVECTOR quantized = DirectX::XMVectorSet(pValue[0], pValue[1], pValue[2], 0.0f);
+
+	return DirectX::XMVectorMultiplyAdd(quantized, m_step, m_min);
+}
+
+size_t KdPackedVectorChannel::GetMemorySize() const
+{
+	if (IsEmpty()) { return 0; }
+
+	return (m_times.size() + m_values.size()) * sizeof(uint16_t) + sizeof(m_timeStep) + sizeof(m_min) + sizeof(m_step);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 回転の復元
+// 除いた成分は、残りの3成分と合わせて長さが1になる正の値
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+DirectX::XMVECTOR KdPackedQuaternionChannel::GetValue(UINT idx) const
+{
+	const uint16_t* pValue = &m_values[idx * 3];
+
+	UINT largest = (pValue[0] & 1) | ((pValue[1] & 1) << 1);
+
+	float comps[4] = {};
+	float lengthSq = 0.0f;
+
+	for (UINT compIdx = 0, srcIdx = 0; compIdx < 4; ++compIdx)
+	{
+		if (compIdx == largest) { continue; }
+
+		float rate = (pValue[srcIdx++] >> 1) / static_cast<float>(kQuatQuantizeMax);
+
+		comps[compIdx] = (rate * 2.0f - 1.0f) / kSqrt2;
+		lengthSq += comps[compIdx] * comps[compIdx];
+	}
+
+	comps[largest] = std::sqrt(std::max(1.0f - lengthSq, 0.0f));
+
+	return DirectX::XMVectorSet(comps[0], comps[1], comps[2], comps[3]);
+}
+
+size_t KdPackedQuaternionChannel::GetMemorySize() const
+{
+	if (IsEmpty()) { return 0; }
+
+	return (m_times.size() + m_values.size()) * sizeof(uint16_t) + sizeof(m_timeStep);
+}
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// 圧縮
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+// 0～kQuantizeMaxへの量子化：stepが0(範囲が無い)なら0
+static uint16_t Quantize(float value, float step)
+{
+	if (step <= 0.0f) { return 0; }
+
+	return static_cast<uint16_t>(std::clamp(std::lround(value / step), 0L, kQuantizeMax));
+}
+
+// 回転の量子化：smallest three
+static void PackQuaternion(const Math::Quaternion& src, uint16_t* pDst)
+{
+	Math::Quaternion quat;
+	src.Normalize(quat);
+
+	float comps[4] = { quat.x, quat.y, quat.z, quat.w };
+
+	UINT largest = 0;
+
+	for (UINT compIdx = 1; compIdx < 4; ++compIdx)
+	{
+		if (std::abs(comps[compIdx]) > std::abs(comps[largest])) { largest = compIdx; }
+	}
+
+	// 最大の成分が正になるように揃える(q と -q は同じ回転)
+	float sign = comps[largest] < 0.0f ? -1.0f : 1.0f;
+
+	for (UINT compIdx = 0, dstIdx = 0; compIdx < 4; ++compIdx)
+	{
+		if (compIdx == largest) { continue; }
+
+		float rate = (comps[compIdx] * sign * kSqrt2 + 1.0f) * 0.5f;
+
+		long quantized = std::clamp(std::lround(rate * kQuatQuantizeMax), 0L, kQuatQuantizeMax);
+
+		pDst[dstIdx++] = static_cast<uint16_t>(quantized << 1);
+	}
+
+	pDst[0] |= largest & 1;
+	pDst[1] |= (largest >> 1) & 1;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 残すキーを選ぶ
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 最後に残したキーから補間の終点を1つずつ先へ延ばしていき、
+// 間のキーが1つでも許容誤差を超えたら1つ手前のキーを残して、そこから続ける
+// isWithin(first, last, mid) … firstとlastのキーの補間で、midのキーを許容誤差内に再現できるか
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class IsWithin>
+static std::vector<UINT> SelectKeys(UINT keyNum, IsWithin isWithin)
+{
+	std::vector<UINT> keys;
+
+	if (!keyNum) { return keys; }
+
+	keys.push_back(0);
+
+	UINT first = 0;
+
+	for (UINT last = 2; last < keyNum; ++last)
+	{
+		for (UINT mid = first + 1; mid < last; ++mid)
+		{
+			if (isWithin(first, last, mid)) { continue; }
+
+			first = last - 1;
+			keys.push_back(first);
+
+			break;
+		}
+	}
+
+	if (keyNum > 1) { keys.push_back(keyNum - 1); }
+
+	return keys;
+}
+
+// 2つのキーの間の指定時間の値
+template<class Channel, class Lerp>
+static DirectX::XMVECTOR LerpKeys(const Channel& channel, UINT first, UINT last, float time, Lerp lerp)
+{
+	float firstTime = channel.GetTime(first);
+	float lastTime = channel.GetTime(last);
+
+	float f = lastTime > firstTime ? std::clamp((time - firstTime) / (lastTime - firstTime), 0.0f, 1.0f) : 1.0f;
+
+	return lerp(channel.GetValue(first), channel.GetValue(last), f);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 1チャンネルの圧縮
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 先に全てのキーを量子化し、量子化した値の補間で元の値との誤差を測りながら残すキーを選ぶ
+// (量子化の誤差も含めて許容誤差に収める)
+// 全てのキーが先頭のキーの値で許容誤差内なら、先頭のキーだけを残す
+// encode(value, pDst)	… 値を3つのuint16_tに量子化
+// error(a, b)			… 値の誤差
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class T, class Packed, class Encode, class Lerp, class Error>
+static void PackChannel(const KdAnimChannel<T>& src, float timeStep, float tolerance, Packed& dst, Encode encode, Lerp lerp, Error error)
+{
+	const UINT keyNum = src.GetKeyNum();
+
+	dst.m_timeStep = timeStep;
+	dst.m_times.resize(keyNum);
+	dst.m_values.resize(keyNum * 3);
+
+	for (UINT keyIdx = 0; keyIdx < keyNum; ++keyIdx)
+	{
+		dst.m_times[keyIdx] = Quantize(src.m_times[keyIdx], timeStep);
+
+		encode(src.m_values[keyIdx], &dst.m_values[keyIdx * 3]);
+	}
+
+	bool isConstant = true;
+
+	for (UINT keyIdx = 1; isConstant && keyIdx < keyNum; ++keyIdx)
+	{
+		isConstant = error(dst.GetValue(0), src.m_values[keyIdx]) <= tolerance;
+	}
+
+	std::vector<UINT> keys;
+
+	if (isConstant)
+	{
+		keys.push_back(0);
+	}
+	else
+	{
+		keys = SelectKeys(keyNum,
+			[&](UINT first, UINT last, UINT mid)
+			{
+				return error(LerpKeys(dst, first, last, src.m_times[mid], lerp), src.m_values[mid]) <= tolerance;
+			});
+	}
+
+	// 選んだキーを前に詰める：keys[i] >= i なので上書きしても問題ない
+	// 量子化で時間が前のキーと同じになったキーは、前のキーを上書きして1つにまとめる(時間の差が0の区間を作らない)
+	size_t packedNum = 0;
+
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		uint16_t time = dst.m_times[keys[i]];
+
+		if (packedNum > 0 && dst.m_times[packedNum - 1] == time) { --packedNum; }
+
+		dst.m_times[packedNum] = time;
+
+		for (UINT compIdx = 0; compIdx < 3; ++compIdx)
+		{
+			dst.m_values[packedNum * 3 + compIdx] = dst.m_values[keys[i] * 3 + compIdx];
+		}
+
+		++packedNum;
+	}
+
+	dst.m_times.resize(packedNum);
+	dst.m_times.shrink_to_fit();
+	dst.m_values.resize(packedNum * 3);
+	dst.m_values.shrink_to_fit();
+}
+
+// ベクトルの誤差：距離
+static float VectorError(const DirectX::XMVECTOR& a, const DirectX::XMVECTOR& b)
+{
+	return DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(a, b)));
+}
+
+// 回転の誤差：2つの回転の間の角度
+static float QuaternionError(const DirectX::XMVECTOR& a, const DirectX::XMVECTOR& b)
+{
+	float dot = std::abs(DirectX::XMVectorGetX(DirectX::XMQuaternionDot(DirectX::XMQuaternionNormalize(a), DirectX::XMQuaternionNormalize(b))));
+
+	return 2.0f * std::acos(std::min(dot, 1.0f));
+}
+
+static void PackVectorChannel(const KdAnimChannel<Math::Vector3>& src, float timeStep, float tolerance, KdPackedVectorChannel& dst)
+{
+	dst = KdPackedVectorChannel();
+
+	if (src.IsEmpty()) { return; }
+
+	// 値の範囲
+	Math::Vector3 minValue = src.m_values.front();
+	Math::Vector3 maxValue = src.m_values.front();
+
+	for (const Math::Vector3& value : src.m_values)
+	{
+		minValue = Math::Vector3::Min(minValue, value);
+		maxValue = Math::Vector3::Max(maxValue, value);
+	}
+
+	dst.m_min = minValue;
+	dst.m_step = (maxValue - minValue) / static_cast<float>(kQuantizeMax);
+
+	PackChannel(src, timeStep, tolerance, dst,
+		[&dst](const Math::Vector3& value, uint16_t* pDst)
+		{
+			pDst[0] = Quantize(value.x - dst.m_min.x, dst.m_step.x);
+			pDst[1] = Quantize(value.y - dst.m_min.y, dst.m_step.y);
+			pDst[2] = Quantize(value.z - dst.m_min.z, dst.m_step.z);
+		},
+		[](const DirectX::XMVECTOR& a, const DirectX::XMVECTOR& b, float f) { return DirectX::XMVectorLerp(a, b, f); },
+		VectorError);
+}
+
+static void PackQuaternionChannel(const KdAnimChannel<Math::Quaternion>& src, float timeStep, float tolerance, KdPackedQuaternionChannel& dst)
+{
+	dst = KdPackedQuaternionChannel();
+
+	if (src.IsEmpty()) { return; }
+
+	PackChannel(src, timeStep, tolerance, dst, PackQuaternion,
+		[](const DirectX::XMVECTOR& a, const DirectX::XMVECTOR& b, float f) { return DirectX::XMQuaternionSlerp(a, b, f); },
+		QuaternionError);
+}
+
+// 元のキーの時間で、ノードの補間結果と元の値の最大誤差を求める
+template<class T, class Sample, class Error>
+static float MeasureError(const KdAnimChannel<T>& raw, Sample sample, Error error)
+{
+	float maxError = 0.0f;
+
+	for (UINT keyIdx = 0; keyIdx < raw.GetKeyNum(); ++keyIdx)
+	{
+		T value;
+		sample(value, raw.m_times[keyIdx]);
+
+		maxError = std::max(maxError, error(value, raw.m_values[keyIdx]));
+	}
+
+	return maxError;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// アニメーションのキーの圧縮
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 時間はアニメーションの長さを16bitで分割した段階で持つ
+// 誤差は圧縮後に元のキーリストを外して、実際の補間処理で測る
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCompressAnimation(KdAnimationData& data, const KdAnimCompressSettings& settings)
+{
+	KdAnimCompressReport& report = data.m_compressReport;
+	report = KdAnimCompressReport();
+
+	const float timeStep = data.m_maxLength > 0.0f ? data.m_maxLength / kQuantizeMax : 0.0f;
+
+	for (KdAnimationData::Node& node : data.m_nodes)
+	{
+		KdAnimChannel<Math::Vector3> translations = std::move(node.m_translations);
+		KdAnimChannel<Math::Quaternion> rotations = std::move(node.m_rotations);
+		KdAnimChannel<Math::Vector3> scales = std::move(node.m_scales);
+
+		node.m_translations.Clear();
+		node.m_rotations.Clear();
+		node.m_scales.Clear();
+
+		PackVectorChannel(translations, timeStep, settings.m_translationTolerance, node.m_packedTranslations);
+		PackQuaternionChannel(rotations, timeStep, settings.m_rotationTolerance, node.m_packedRotations);
+		PackVectorChannel(scales, timeStep, settings.m_scaleTolerance, node.m_packedScales);
+
+		//------------------------------
+		// 集計
+		//------------------------------
+		report.m_rawKeyNum += translations.GetKeyNum() + rotations.GetKeyNum() + scales.GetKeyNum();
+		report.m_rawSize += (translations.GetKeyNum() + scales.GetKeyNum()) * (sizeof(float) + sizeof(Math::Vector3)) +
+			rotations.GetKeyNum() * (sizeof(float) + sizeof(Math::Quaternion));
+
+		report.m_packedKeyNum += node.m_packedTranslations.GetKeyNum() + node.m_packedRotations.GetKeyNum() + node.m_packedScales.GetKeyNum();
+		report.m_packedSize += node.m_packedTranslations.GetMemorySize() + node.m_packedRotations.GetMemorySize() + node.m_packedScales.GetMemorySize();
+
+		report.m_maxTranslationError = std::max(report.m_maxTranslationError, MeasureError(translations,
+			[&node](Math::Vector3& value, float time) { node.InterpolateTranslations(value, time); }, VectorError));
+
+		report.m_maxRotationError = std::max(report.m_maxRotationError, MeasureError(rotations,
+			[&node](Math::Quaternion& value, float time) { node.InterpolateRotations(value, time); }, QuaternionError));
+
+		report.m_maxScaleError = std::max(report.m_maxScaleError, MeasureError(scales,
+			[&node](Math::Vector3& value, float time) { node.InterpolateScales(value, time); }, VectorError));
+	}
+}
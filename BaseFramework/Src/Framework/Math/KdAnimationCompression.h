@@ -0,0 +1,86 @@
+﻿#pragma once
+
+struct KdAnimationData;
+
+//============================
+// 圧縮したキーの時間
+//============================
+// アニメーションの長さに対する割合を16bitで持つ
+struct KdPackedAnimTimes
+{
+	std::vector<uint16_t>	m_times;
+	float					m_timeStep = 0.0f;	// 1段階あたりの時間
+
+	bool IsEmpty() const { return m_times.empty(); }
+	UINT GetKeyNum() const { return static_cast<UINT>(m_times.size()); }
+
+	float GetTime(UINT idx) const { return m_times[idx] * m_timeStep; }
+
+	// 指定時間の次のキーの番号：pCursorを指定すると前回の番号から探す
+	UINT FindNextKey(float time, UINT* pCursor = nullptr) const;
+};
+
+//============================
+// 圧縮したベクトルのキー(座標・拡縮)
+//============================
+// 値はチャンネル内の最小値～最大値に対する割合を各軸16bitで持つ
+struct KdPackedVectorChannel : public KdPackedAnimTimes
+{
+	std::vector<uint16_t>	m_values;	// キー毎にxyzの3つ
+	Math::Vector3			m_min;		// 最小値
+	Math::Vector3			m_step;		// 1段階あたりの値
+
+	DirectX::XMVECTOR GetValue(UINT idx) const;
+
+	size_t GetMemorySize() const;
+};
+
+//============================
+// 圧縮した回転のキー
+//============================
+// 絶対値が最大の成分を除いた3成分を15bitずつで持つ(smallest three)
+// 除いた成分は長さが1になるように復元する：最大の成分が正になるように符号を揃えておく
+// 除いた成分の番号(2bit)は1つ目と2つ目の値の最下位bitに入れる
+struct KdPackedQuaternionChannel : public KdPackedAnimTimes
+{
+	std::vector<uint16_t>	m_values;	// キー毎に3つ
+
+	DirectX::XMVECTOR GetValue(UINT idx) const;
+
+	size_t GetMemorySize() const;
+};
+
+// アニメーションの圧縮設定
+struct KdAnimCompressSettings
+{
+	bool	m_enable = true;					// 読み込み時に圧縮するか
+	float	m_translationTolerance = 0.001f;	// 座標の許容誤差(距離)
+	float	m_rotationTolerance = 0.0005f;		// 回転の許容誤差(ラジアン)
+	float	m_scaleTolerance = 0.001f;			// 拡縮の許容誤差
+};
+
+// アニメーションの圧縮結果
+// 誤差は元の全てのキーの時間で、圧縮したキーから補間した値と元の値を比べたもの
+struct KdAnimCompressReport
+{
+	UINT	m_rawKeyNum = 0;				// 圧縮前のキーの数(全チャンネル)
+	UINT	m_packedKeyNum = 0;				// 圧縮後のキーの数
+	size_t	m_rawSize = 0;					// 圧縮前のキーのサイズ(byte)
+	size_t	m_packedSize = 0;				// 圧縮後のキーのサイズ(byte)
+
+	float	m_maxTranslationError = 0.0f;	// 座標の最大誤差(距離)
+	float	m_maxRotationError = 0.0f;		// 回転の最大誤差(ラジアン)
+	float	m_maxScaleError = 0.0f;			// 拡縮の最大誤差
+
+	// 圧縮率(圧縮前のサイズ / 圧縮後のサイズ)：圧縮していなければ0
+	float GetRatio() const { return m_packedSize ? static_cast<float>(m_rawSize) / m_packedSize : 0.0f; }
+};
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// アニメーションのキーの圧縮
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 前後のキーの補間で許容誤差内に再現できるキーを省き、残したキーを量子化する
+// 元のキーリストは破棄され、以降は圧縮したキーから直接補間する
+// 結果はdata.m_compressReportに入る
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCompressAnimation(KdAnimationData& data, const KdAnimCompressSettings& settings);
@@ -0,0 +1,160 @@
+﻿#include "KdAnimationPose.h"
+
+// ノード毎の合成の割合：マスクの範囲外のノードは合成しない
+static float GetNodeWeight(float weight, const std::vector<float>* pNodeWeights, UINT nodeIdx)
+{
+	if (!pNodeWeights) { return weight; }
+
+	return nodeIdx < pNodeWeights->size() ? weight * (*pNodeWeights)[nodeIdx] : 0.0f;
+}
+
+// 回転の補間：近い側を通るように符号を揃えて線形補間してから正規化する
+// 合成の割合はフレーム毎に少しずつ変わるだけなので、slerpとの差は見た目に現れない
+static DirectX::XMVECTOR NLerp(const DirectX::XMVECTOR& from, const DirectX::XMVECTOR& to, float weight)
+{
+	DirectX::XMVECTOR target = to;
+
+	if (DirectX::XMVectorGetX(DirectX::XMQuaternionDot(from, to)) < 0.0f) { target = DirectX::XMVectorNegate(to); }
+
+	return DirectX::XMQuaternionNormalize(DirectX::XMVectorLerp(from, target, weight));
+}
+
+void KdAnimationPose::Reset(UINT nodeNum)
+{
+	m_scales.resize(nodeNum);
+	m_rotations.resize(nodeNum);
+	m_translations.resize(nodeNum);
+
+	m_mask.assign(nodeNum, 0);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 他の姿勢へweightの割合で近づける
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimationPose::Blend(const KdAnimationPose& src, float weight, const std::vector<float>* pNodeWeights)
+{
+	const UINT nodeNum = std::min(GetNodeNum(), src.GetNodeNum());
+
+	for (UINT nodeIdx = 0; nodeIdx < nodeNum; ++nodeIdx)
+	{
+		if (!src.m_mask[nodeIdx]) { continue; }
+
+		float nodeWeight = GetNodeWeight(weight, pNodeWeights, nodeIdx);
+
+		if (nodeWeight <= 0.0f) { continue; }
+
+		// 自分に値が無ければ合成相手がそのまま値になる
+		if (!m_mask[nodeIdx] || nodeWeight >= 1.0f)
+		{
+			m_scales[nodeIdx] = src.m_scales[nodeIdx];
+			m_rotations[nodeIdx] = src.m_rotations[nodeIdx];
+			m_translations[nodeIdx] = src.m_translations[nodeIdx];
+			m_mask[nodeIdx] = 1;
+
+			continue;
+		}
+
+		m_scales[nodeIdx] = DirectX::XMVectorLerp(m_scales[nodeIdx], src.m_scales[nodeIdx], nodeWeight);
+		m_rotations[nodeIdx] = NLerp(m_rotations[nodeIdx], src.m_rotations[nodeIdx], nodeWeight);
+		m_translations[nodeIdx] = DirectX::XMVectorLerp(m_translations[nodeIdx], src.m_translations[nodeIdx], nodeWeight);
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 基準の姿勢からの差分にする
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 回転の差分は 差分 → 基準 の順に回すと元の回転になるもの
+// 拡縮・座標の差分は値の差
+// 基準に値が無いノードは差分も無し
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimationPose::MakeDelta(const KdAnimationPose& reference)
+{
+	for (UINT nodeIdx = 0; nodeIdx < GetNodeNum(); ++nodeIdx)
+	{
+		if (!m_mask[nodeIdx]) { continue; }
+
+		if (nodeIdx >= reference.GetNodeNum() || !reference.m_mask[nodeIdx])
+		{
+			m_mask[nodeIdx] = 0;
+			continue;
+		}
+
+		m_scales[nodeIdx] -= reference.m_scales[nodeIdx];
+		m_rotations[nodeIdx] = DirectX::XMQuaternionMultiply(m_rotations[nodeIdx], DirectX::XMQuaternionInverse(reference.m_rotations[nodeIdx]));
+		m_translations[nodeIdx] -= reference.m_translations[nodeIdx];
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 差分をweightの割合で加える
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimationPose::AddDelta(const KdAnimationPose& src, float weight, const std::vector<float>* pNodeWeights)
+{
+	const UINT nodeNum = std::min(GetNodeNum(), src.GetNodeNum());
+
+	for (UINT nodeIdx = 0; nodeIdx < nodeNum; ++nodeIdx)
+	{
+		if (!m_mask[nodeIdx] || !src.m_mask[nodeIdx]) { continue; }
+
+		float nodeWeight = GetNodeWeight(weight, pNodeWeights, nodeIdx);
+
+		if (nodeWeight <= 0.0f) { continue; }
+
+		DirectX::XMVECTOR deltaRotation = nodeWeight >= 1.0f ? src.m_rotations[nodeIdx] :
+			NLerp(DirectX::XMQuaternionIdentity(), src.m_rotations[nodeIdx], nodeWeight);
+
+		m_scales[nodeIdx] += src.m_scales[nodeIdx] * nodeWeight;
+		m_rotations[nodeIdx] = DirectX::XMQuaternionMultiply(deltaRotation, m_rotations[nodeIdx]);
+		m_translations[nodeIdx] += src.m_translations[nodeIdx] * nodeWeight;
+	}
+}
+
+void KdAnimationPose::WriteLocalTransforms(KdModelWork& rModel) const
+{
+	const UINT nodeNum = std::min(GetNodeNum(), rModel.GetNodeNum());
+
+	for (UINT nodeIdx = 0; nodeIdx < nodeNum; ++nodeIdx)
+	{
+		if (!m_mask[nodeIdx]) { continue; }
+
+		rModel.WorkLocalTransform(nodeIdx) = Compose(m_scales[nodeIdx], m_rotations[nodeIdx], m_translations[nodeIdx]);
+	}
+}
+
+DirectX::XMMATRIX KdAnimationPose::Compose(const DirectX::XMVECTOR& scale, const DirectX::XMVECTOR& rotation, const DirectX::XMVECTOR& translation)
+{
+	DirectX::XMMATRIX mat = DirectX::XMMatrixRotationQuaternion(rotation);
+
+	mat.r[0] = DirectX::XMVectorMultiply(mat.r[0], DirectX::XMVectorSplatX(scale));
+	mat.r[1] = DirectX::XMVectorMultiply(mat.r[1], DirectX::XMVectorSplatY(scale));
+	mat.r[2] = DirectX::XMVectorMultiply(mat.r[2], DirectX::XMVectorSplatZ(scale));
+	mat.r[3] = DirectX::XMVectorSelect(DirectX::g_XMIdentityR3, translation, DirectX::g_XMSelect1110);
+
+	return mat;
+}
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// 姿勢バッファの使い回し
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+KdAnimationPose* KdAnimationPosePool::Acquire(UINT nodeNum)
+{
+	if (m_usedNum >= m_poses.size()) { m_poses.push_back(std::make_unique<KdAnimationPose>()); }
+
+	KdAnimationPose* pPose = m_poses[m_usedNum++].get();
+
+	pPose->Reset(nodeNum);
+
+	return pPose;
+}
+
+void KdAnimationPosePool::Release(KdAnimationPose* pPose)
+{
+	if (!m_usedNum || m_poses[m_usedNum - 1].get() != pPose)
+	{
+		assert(0 && "KdAnimationPosePool::Release：借りた順と逆の順に返却してください");
+		return;
+	}
+
+	--m_usedNum;
+}
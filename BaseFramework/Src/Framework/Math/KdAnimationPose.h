@@ -0,0 +1,96 @@
+﻿#pragma once
+
+//============================
+// 姿勢バッファ
+//============================
+// モデルの全ノードの拡縮・回転・座標(親からの相対)を別々の配列に持つ
+// アニメーションの合成は行列ではなくこの形で行い、最後に1回だけ行列へ書き込む
+// マスクが0のノードはアニメーションの対象外で、書き込み時にモデルの行列を変更しない
+struct KdAnimationPose
+{
+	std::vector<Math::Vector3>		m_scales;
+	std::vector<Math::Quaternion>	m_rotations;
+	std::vector<Math::Vector3>		m_translations;
+	std::vector<uint8_t>			m_mask;			// 1なら値が有効なノード
+
+	// ノード数を合わせて全てのノードを無効にする：容量が足りていればメモリの確保は発生しない
+	void Reset(UINT nodeNum);
+
+	UINT GetNodeNum() const { return static_cast<UINT>(m_mask.size()); }
+
+	// 他の姿勢との合成
+	// ・Blend		… srcへweightの割合で近づける(回転はnlerp)
+	// ・AddDelta	… MakeDelta()で差分にしたsrcをweightの割合で加える
+	// pNodeWeights	… ノード毎にweightへ掛ける値(マスク)：nullptrなら全て1
+	// 自分が無効でsrcが有効なノードは、Blendならsrcの値になり、AddDeltaなら何もしない
+	void Blend(const KdAnimationPose& src, float weight, const std::vector<float>* pNodeWeights = nullptr);
+	void AddDelta(const KdAnimationPose& src, float weight, const std::vector<float>* pNodeWeights = nullptr);
+
+	// 基準の姿勢からの差分にする：AddDelta()で加えるための形
+	void MakeDelta(const KdAnimationPose& reference);
+
+	// 有効なノードの行列を書き込む：書き込んだノードだけが行列の再計算の対象になる
+	void WriteLocalTransforms(KdModelWork& rModel) const;
+
+	// 拡縮 x 回転 x 座標 の行列を組み立てる
+	// 回転行列の各行を拡縮して座標を最後の行に入れる(3つの行列の積と同じ)
+	static DirectX::XMMATRIX Compose(const DirectX::XMVECTOR& scale, const DirectX::XMVECTOR& rotation, const DirectX::XMVECTOR& translation);
+};
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 姿勢バッファの使い回し
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 合成の作業用の姿勢バッファを毎フレーム作らずに使い回す
+// スレッド毎に持つので、複数のスレッドで同時にアニメーションを更新してもロックは不要
+// 一度確保したバッファはスレッドが終わるまで保持する
+// 返却は借りた順と逆の順に行う(ScopedPoseを使えば自然にそうなる)
+//
+// 使い方
+// ・KdAnimationPosePool::ScopedPose pose(nodeNum); で借り、範囲を出ると返却される
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdAnimationPosePool
+{
+public:
+
+	static KdAnimationPosePool& Instance()
+	{
+		static thread_local KdAnimationPosePool instance;
+		return instance;
+	}
+
+	// 借りる：中身はReset(nodeNum)した状態
+	KdAnimationPose* Acquire(UINT nodeNum);
+	// 返却
+	void Release(KdAnimationPose* pPose);
+
+	// 範囲内だけ借りる
+	class ScopedPose
+	{
+	public:
+		ScopedPose(UINT nodeNum) : m_pPose(KdAnimationPosePool::Instance().Acquire(nodeNum)) {}
+		~ScopedPose() { KdAnimationPosePool::Instance().Release(m_pPose); }
+
+		KdAnimationPose& operator*() const { return *m_pPose; }
+		KdAnimationPose* operator->() const { return m_pPose; }
+
+	private:
+		KdAnimationPose*	m_pPose;
+
+		// コピー禁止用
+		ScopedPose(const ScopedPose& src) = delete;
+		void operator=(const ScopedPose& src) = delete;
+	};
+
+private:
+
+	// 確保したバッファ：先頭からm_usedNum個が貸し出し中
+	std::vector<std::unique_ptr<KdAnimationPose>>	m_poses;
+	UINT											m_usedNum = 0;
+
+	KdAnimationPosePool() {}
+	~KdAnimationPosePool() {}
+
+	// コピー禁止用
+	KdAnimationPosePool(const KdAnimationPosePool& src) = delete;
+	void operator=(const KdAnimationPosePool& src) = delete;
+};
@@ -0,0 +1,196 @@
+﻿#include "KdAnimationPoseCache.h"
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 焼き付け
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 時間順に取り出すので、キーの検索は前回の位置から進めるだけで済む
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdBakedAnimation::Bake(const KdAnimationData& data, float sampleStep)
+{
+	m_sampleStep = sampleStep;
+	m_length = data.m_maxLength;
+
+	m_nodeIndices.clear();
+
+	// キーを1つも持たないノードは焼き付けない：単位行列で上書きするとモデル本来の姿勢が崩れる
+	std::vector<const KdAnimationData::Node*> srcNodes;
+
+	for (const KdAnimationData::Node& node : data.m_nodes)
+	{
+		if (!node.HasTranslations() && !node.HasRotations() && !node.HasScales()) { continue; }
+
+		m_nodeIndices.push_back(node.m_nodeOffset);
+		srcNodes.push_back(&node);
+	}
+
+	m_frameNum = static_cast<UINT>(std::ceil(m_length / m_sampleStep)) + 1;
+
+	const UINT nodeNum = GetNodeNum();
+
+	m_transforms.resize(static_cast<size_t>(m_frameNum) * nodeNum);
+
+	std::vector<KdAnimationData::Node::Cursor> cursors(nodeNum);
+
+	for (UINT frame = 0; frame < m_frameNum; ++frame)
+	{
+		float time = std::min(frame * m_sampleStep, m_length);
+
+		for (UINT i = 0; i < nodeNum; ++i)
+		{
+			Math::Matrix mat;
+			srcNodes[i]->Interpolate(mat, time, &cursors[i]);
+
+			DirectX::XMStoreFloat4x3(&m_transforms[static_cast<size_t>(frame) * nodeNum + i], mat);
+		}
+	}
+}
+
+void KdBakedAnimation::WriteLocalTransforms(KdModelWork& rModel, float time) const
+{
+	const UINT nodeNum = GetNodeNum();
+
+	if (!nodeNum) { return; }
+
+	const DirectX::XMFLOAT4X3* pTransforms = &m_transforms[static_cast<size_t>(GetFrame(time)) * nodeNum];
+
+	for (UINT i = 0; i < nodeNum; ++i)
+	{
+		UINT nodeIdx = static_cast<UINT>(m_nodeIndices[i]);
+
+		if (nodeIdx >= rModel.GetNodeNum()) { continue; }
+
+		DirectX::XMStoreFloat4x4(&rModel.WorkLocalTransform(nodeIdx), DirectX::XMLoadFloat4x3(&pTransforms[i]));
+	}
+}
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// 焼き付けたアニメーションの共有キャッシュ
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 焼き付けたアニメーションの取得
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 見つかったものは先頭(最も新しい)へ移す
+// 焼き付けはロックしたまま行う：同じアニメーションを複数のスレッドで重複して焼き付けないため
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+std::shared_ptr<const KdBakedAnimation> KdAnimationPoseCache::Acquire(const std::shared_ptr<KdAnimationData>& spAnimation)
+{
+	if (!spAnimation) { return nullptr; }
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto found = m_lookup.find(spAnimation.get());
+
+	if (found != m_lookup.end())
+	{
+		// 同じアドレスに作り直された別のアニメーション
+		if (found->second->m_wpAnimation.lock() != spAnimation)
+		{
+			Remove(found->second);
+		}
+		else
+		{
+			m_entries.splice(m_entries.begin(), m_entries, found->second);
+
+			return m_entries.front().m_spBaked;
+		}
+	}
+
+	Entry entry;
+	entry.m_pKey = spAnimation.get();
+	entry.m_wpAnimation = spAnimation;
+	entry.m_spBaked = std::make_shared<KdBakedAnimation>();
+	entry.m_spBaked->Bake(*spAnimation, m_sampleStep);
+
+	m_memorySize += entry.m_spBaked->GetMemorySize();
+
+	m_entries.push_front(entry);
+	m_lookup[spAnimation.get()] = m_entries.begin();
+
+	std::shared_ptr<const KdBakedAnimation> spResult = entry.m_spBaked;
+
+	Evict();
+
+	return spResult;
+}
+
+void KdAnimationPoseCache::SetMemoryLimit(size_t limit)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_memoryLimit = limit;
+
+	Evict();
+}
+
+void KdAnimationPoseCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_entries.clear();
+	m_lookup.clear();
+
+	m_memorySize = 0;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 上限に収まるまで、使われていないものを古い順に破棄する
+// キャッシュ以外から参照されているものは破棄してもメモリが減らないので残す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAnimationPoseCache::Evict()
+{
+	auto it = m_entries.end();
+
+	while (m_memorySize > m_memoryLimit && it != m_entries.begin())
+	{
+		--it;
+
+		if (it->m_spBaked.use_count() > 1) { continue; }
+
+		auto removed = it++;
+
+		Remove(removed);
+	}
+}
+
+void KdAnimationPoseCache::Remove(std::list<Entry>::iterator it)
+{
+	m_memorySize -= it->m_spBaked->GetMemorySize();
+
+	m_lookup.erase(it->m_pKey);
+
+	m_entries.erase(it);
+}
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// 焼き付けたアニメーションの再生
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+void KdBakedAnimator::SetAnimation(const std::shared_ptr<KdAnimationData>& spAnimation, bool isLoop, float startTime)
+{
+	m_spBaked = KdAnimationPoseCache::Instance().Acquire(spAnimation);
+
+	m_isLoop = isLoop;
+	m_time = startTime;
+
+	// 開始時間が長さを超えていたらその周の中の位置にする
+	if (m_spBaked && m_isLoop && m_spBaked->m_length > 0.0f)
+	{
+		m_time = std::fmod(m_time, m_spBaked->m_length);
+	}
+}
+
+void KdBakedAnimator::AdvanceTime(KdModelWork& rModel, float speed)
+{
+	if (!m_spBaked) { return; }
+
+	m_spBaked->WriteLocalTransforms(rModel, m_time);
+
+	// アニメーションのフレームを進める
+	m_time += speed;
+
+	if (m_time >= m_spBaked->m_length)
+	{
+		m_time = (m_isLoop && m_spBaked->m_length > 0.0f) ? std::fmod(m_time, m_spBaked->m_length) : m_spBaked->m_length;
+	}
+}
@@ -0,0 +1,135 @@
+﻿#pragma once
+
+//============================
+// 焼き付けたアニメーション
+//============================
+// 一定の間隔で姿勢を取り出し、アニメーションするノードの行列(親からの相対)を表にしたもの
+// 再生時はキーの検索も補間もせず、最も近いフレームの行列をコピーするだけで済む
+// 行列は最後の列(0,0,0,1)を省いた4x3で持つ
+struct KdBakedAnimation
+{
+	std::vector<int>					m_nodeIndices;	// アニメーションするモデルのノード
+	std::vector<DirectX::XMFLOAT4X3>	m_transforms;	// フレーム毎にm_nodeIndicesの順で並べた行列
+	UINT								m_frameNum = 0;
+	float								m_sampleStep = 1.0f;	// フレームの間隔(アニメーションの時間)
+	float								m_length = 0.0f;		// アニメの長さ
+
+	UINT GetNodeNum() const { return static_cast<UINT>(m_nodeIndices.size()); }
+
+	// 指定時間に最も近いフレーム
+	UINT GetFrame(float time) const
+	{
+		if (!m_frameNum || time <= 0.0f) { return 0; }
+
+		return std::min(static_cast<UINT>(time / m_sampleStep + 0.5f), m_frameNum - 1);
+	}
+
+	size_t GetMemorySize() const
+	{
+		return m_nodeIndices.size() * sizeof(int) + m_transforms.size() * sizeof(DirectX::XMFLOAT4X3);
+	}
+
+	// 焼き付け：sampleStepの間隔で、最初と最後の時間を含むように取り出す
+	void Bake(const KdAnimationData& data, float sampleStep);
+
+	// 指定時間の姿勢をモデルへ書き込む：アニメーションするノードだけが行列の再計算の対象になる
+	void WriteLocalTransforms(KdModelWork& rModel, float time) const;
+};
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 焼き付けたアニメーションの共有キャッシュ
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 群衆のように多数のインスタンスが少数のループアニメーションを再生する場合に、
+// アニメーション毎に1回だけ焼き付けて全てのインスタンスで共有する
+// 合計のサイズが上限を超えたら、使われていないものを最後に取得した時が古い順に破棄する
+// 使用中(KdBakedAnimatorなどが参照している)のものは破棄しないので、その分は上限を超えることがある
+// 複数のスレッドから同時に取得してよい
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdAnimationPoseCache
+{
+public:
+
+	static KdAnimationPoseCache& Instance()
+	{
+		static KdAnimationPoseCache instance;
+		return instance;
+	}
+
+	// 焼き付けたアニメーションの取得：無ければその場で焼き付ける
+	std::shared_ptr<const KdBakedAnimation> Acquire(const std::shared_ptr<KdAnimationData>& spAnimation);
+
+	// 焼き付けるフレームの間隔：以降に焼き付けるアニメーションに適用される
+	void SetSampleStep(float step) { std::lock_guard<std::mutex> lock(m_mutex); m_sampleStep = std::max(step, 0.001f); }
+	float GetSampleStep() const { return m_sampleStep; }
+
+	// 合計のサイズの上限(byte)
+	void SetMemoryLimit(size_t limit);
+	size_t GetMemoryLimit() const { return m_memoryLimit; }
+
+	// 現在の合計のサイズ(byte)
+	size_t GetMemorySize() const { return m_memorySize; }
+
+	// 全て破棄する：使用中のものは使用している側が手放すまで残る
+	void Clear();
+
+private:
+
+	struct Entry
+	{
+		const KdAnimationData*				m_pKey = nullptr;
+		std::weak_ptr<KdAnimationData>		m_wpAnimation;	// 焼き付け元：破棄されたら作り直す
+		std::shared_ptr<KdBakedAnimation>	m_spBaked;
+	};
+
+	// 使われていないものを古い順に破棄して上限に収める：m_mutexをロックした状態で呼び出すこと
+	void Evict();
+
+	void Remove(std::list<Entry>::iterator it);
+
+	// 最後に取得した時が新しい順
+	std::list<Entry>		m_entries;
+	std::unordered_map<const KdAnimationData*, std::list<Entry>::iterator>	m_lookup;
+
+	float					m_sampleStep = 1.0f;
+	size_t					m_memorySize = 0;
+	size_t					m_memoryLimit = 64 * 1024 * 1024;
+
+	std::mutex				m_mutex;
+
+	KdAnimationPoseCache() {}
+	~KdAnimationPoseCache() {}
+
+	// コピー禁止用
+	KdAnimationPoseCache(const KdAnimationPoseCache& src) = delete;
+	void operator=(const KdAnimationPoseCache& src) = delete;
+};
+
+//============================
+// 焼き付けたアニメーションの再生(インスタンス毎)
+//============================
+// 焼き付けたアニメーションへの参照と再生位置だけを持つ
+// 開始時間をずらすと、同じアニメーションでも動きを揃えずに再生できる
+class KdBakedAnimator
+{
+public:
+
+	// アニメーションの設定：焼き付けたものはキャッシュから共有する
+	void SetAnimation(const std::shared_ptr<KdAnimationData>& spAnimation, bool isLoop = true, float startTime = 0.0f);
+
+	// 再生位置
+	void SetTime(float time) { m_time = time; }
+	float GetTime() const { return m_time; }
+
+	// アニメーションが終了してる？
+	bool IsAnimationEnd() const { return !m_spBaked || (!m_isLoop && m_time >= m_spBaked->m_length); }
+
+	// アニメーションの更新：ループする場合は長さを超えた分も次の周に持ち越す
+	void AdvanceTime(KdModelWork& rModel, float speed = 1.0f);
+
+private:
+
+	std::shared_ptr<const KdBakedAnimation>	m_spBaked;
+
+	float	m_time = 0.0f;
+	bool	m_isLoop = true;
+};
@@ -0,0 +1,659 @@
+﻿#include "KdBakedMesh.h"
+
+// 焼き込みファイルの識別子と形式の版：形式を変えたら版を上げて古いファイルを読まないようにする
+static constexpr UINT kBakedFileMagic = 'K' | ('B' << 8) | ('K' << 16) | ('D' << 24);
+static constexpr UINT kBakedFileVersion = 1;
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデルの当たり判定ノードの形状を追加
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// KdModelCollisionと同じく当たり判定ノードだけを対象にする
+// スキンメッシュは変形済みの形状を使い、サブセットは変形元のメッシュから読む(面の並びは同じ)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBakedMesh::AddModel(const KdModelWork& model, const Math::Matrix& world, UINT type)
+{
+	std::shared_ptr<KdModelData> spModelData = model.GetData();
+
+	if (!spModelData)
+	{
+		assert(0 && "KdBakedMesh::AddModel：モデルデータが存在しません");
+
+		return false;
+	}
+
+	bool isAdded = false;
+
+	for (int index : spModelData->GetCollisionMeshNodeIndices())
+	{
+		Math::Matrix meshMatrix;
+		const KdMesh* pMesh = model.GetCollisionMesh(index, meshMatrix);
+
+		if (!pMesh || pMesh->GetFaces().empty()) { continue; }
+
+		AppendMesh(*pMesh, spModelData->GetOriginalNodes()[index].m_spMesh->GetSubsets(), meshMatrix * world, type);
+
+		isAdded = true;
+	}
+
+	return isAdded;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// メッシュの形状を追加
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBakedMesh::AddMesh(const KdMesh& mesh, const Math::Matrix& world, UINT type)
+{
+	if (mesh.GetFaces().empty())
+	{
+		assert(0 && "KdBakedMesh::AddMesh：当たり判定用の形状を保持していないメッシュです");
+
+		return false;
+	}
+
+	AppendMesh(mesh, mesh.GetSubsets(), world, type);
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 形状をワールド空間へ変換して溜めておく
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdBakedMesh::AppendMesh(const KdMesh& geometry, const std::vector<KdMeshSubset>& subsets, const Math::Matrix& matrix, UINT type)
+{
+	UINT baseVertex = static_cast<UINT>(m_pendingPositions.size());
+	UINT faceStart = static_cast<UINT>(m_pendingFaces.size());
+
+	for (const Math::Vector3& pos : geometry.GetVertexPositions())
+	{
+		m_pendingPositions.push_back(Math::Vector3::Transform(pos, matrix));
+	}
+
+	for (const KdMeshFace& face : geometry.GetFaces())
+	{
+		m_pendingFaces.push_back({ face.Idx[0] + baseVertex, face.Idx[1] + baseVertex, face.Idx[2] + baseVertex });
+	}
+
+	UINT faceEnd = static_cast<UINT>(m_pendingFaces.size());
+
+	// サブセットに含まれない面のタグは0
+	m_pendingTags.resize(faceEnd, 0);
+	m_pendingTypes.resize(faceEnd, type);
+
+	for (const KdMeshSubset& subset : subsets)
+	{
+		UINT begin = std::min(faceStart + subset.FaceStart, faceEnd);
+		UINT end = std::min(begin + subset.FaceCount, faceEnd);
+
+		std::fill(m_pendingTags.begin() + begin, m_pendingTags.begin() + end, subset.MaterialNo);
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 追加した形状を衝突タイプ毎にまとめる
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// グループ毎にBVHを作り、ファイルと同じ並びの1つの領域へ書き出してから参照する
+// Load()したものと全く同じ経路で判定されるので、焼き込み直後と読込後で結果が変わらない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBakedMesh::Bake()
+{
+	if (m_pendingFaces.empty())
+	{
+		assert(0 && "KdBakedMesh::Bake：形状が追加されていません");
+
+		return false;
+	}
+
+	// 解放で消えないように取り出しておく
+	std::vector<Math::Vector3> positions = std::move(m_pendingPositions);
+	std::vector<KdMeshFace> srcFaces = std::move(m_pendingFaces);
+	std::vector<UINT> srcTags = std::move(m_pendingTags);
+	std::vector<UINT> srcTypes = std::move(m_pendingTypes);
+
+	Release();
+
+	//------------------------------
+	// 衝突タイプ毎に面を振り分ける
+	//------------------------------
+	std::map<UINT, std::vector<UINT>> typeFaces;
+
+	for (UINT faceIdx = 0; faceIdx < srcFaces.size(); ++faceIdx)
+	{
+		typeFaces[srcTypes[faceIdx]].push_back(faceIdx);
+	}
+
+	//------------------------------
+	// グループ毎にBVHを作る
+	//------------------------------
+	std::vector<Group>				groups;
+	std::vector<KdMeshFace>			faces;
+	std::vector<UINT>				tags;
+	std::vector<KdMeshBVH::Node>	nodes;
+	std::vector<UINT>				faceIndices;
+	std::vector<float>				triangles;
+
+	faces.reserve(srcFaces.size());
+	tags.reserve(srcFaces.size());
+	faceIndices.reserve(srcFaces.size());
+
+	std::vector<KdMeshFace> groupFaces;
+	KdMeshBVH bvh;
+
+	for (const auto& [type, faceList] : typeFaces)
+	{
+		groupFaces.clear();
+
+		for (UINT faceIdx : faceList) { groupFaces.push_back(srcFaces[faceIdx]); }
+
+		// 座標は全グループ共通のまま、グループの面だけで分割する
+		bvh.Build(positions, groupFaces);
+
+		std::span<const KdMeshBVH::Node> groupNodes = bvh.GetNodes();
+		std::span<const UINT> groupFaceIndices = bvh.GetFaceIndices();
+
+		UINT faceCount = static_cast<UINT>(groupFaces.size());
+
+		Group group;
+		group.m_type = type;
+		group.m_faceStart = static_cast<UINT>(faces.size());
+		group.m_faceCount = faceCount;
+		group.m_nodeStart = static_cast<UINT>(nodes.size());
+		group.m_nodeCount = static_cast<UINT>(groupNodes.size());
+		group.m_triangleStart = static_cast<UINT>(triangles.size());
+		group.m_min = groupNodes[0].m_min;
+		group.m_max = groupNodes[0].m_max;
+		groups.push_back(group);
+
+		faces.insert(faces.end(), groupFaces.begin(), groupFaces.end());
+
+		for (UINT faceIdx : faceList) { tags.push_back(srcTags[faceIdx]); }
+
+		nodes.insert(nodes.end(), groupNodes.begin(), groupNodes.end());
+		faceIndices.insert(faceIndices.end(), groupFaceIndices.begin(), groupFaceIndices.end());
+
+		const float* pTriangles = bvh.GetTriangles().GetData();
+		triangles.insert(triangles.end(), pTriangles, pTriangles + KdTriangleSoA::CalcDataNum(faceCount));
+	}
+
+	//------------------------------
+	// ファイルと同じ並びで書き出す
+	//------------------------------
+	FileHeader header;
+	header.m_magic = kBakedFileMagic;
+	header.m_version = kBakedFileVersion;
+	header.m_groupNum = static_cast<UINT>(groups.size());
+	header.m_vertexNum = static_cast<UINT>(positions.size());
+	header.m_faceNum = static_cast<UINT>(faces.size());
+	header.m_nodeNum = static_cast<UINT>(nodes.size());
+	header.m_triangleDataNum = static_cast<UINT>(triangles.size());
+
+	size_t dataSize = sizeof(FileHeader) +
+		sizeof(Group) * groups.size() +
+		sizeof(Math::Vector3) * positions.size() +
+		sizeof(KdMeshFace) * faces.size() +
+		sizeof(UINT) * tags.size() +
+		sizeof(KdMeshBVH::Node) * nodes.size() +
+		sizeof(UINT) * faceIndices.size() +
+		sizeof(float) * triangles.size();
+
+	// 全ての要素が4byteの倍数なので、UINTの配列に隙間無く収まる
+	m_bakedData.resize(dataSize / sizeof(UINT));
+
+	char* pWrite = reinterpret_cast<char*>(m_bakedData.data());
+
+	auto write = [&pWrite](const void* pSrc, size_t size)
+	{
+		memcpy(pWrite, pSrc, size);
+		pWrite += size;
+	};
+
+	write(&header, sizeof(FileHeader));
+	write(groups.data(), sizeof(Group) * groups.size());
+	write(positions.data(), sizeof(Math::Vector3) * positions.size());
+	write(faces.data(), sizeof(KdMeshFace) * faces.size());
+	write(tags.data(), sizeof(UINT) * tags.size());
+	write(nodes.data(), sizeof(KdMeshBVH::Node) * nodes.size());
+	write(faceIndices.data(), sizeof(UINT) * faceIndices.size());
+	write(triangles.data(), sizeof(float) * triangles.size());
+
+	if (!AttachData(m_bakedData.data(), dataSize))
+	{
+		assert(0 && "KdBakedMesh::Bake：焼き込んだデータを参照できませんでした");
+
+		Release();
+
+		return false;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ファイルへの書き出し
+// 焼き込んだデータをそのまま書き出す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBakedMesh::Save(std::string_view filename) const
+{
+	if (!m_pData) { return false; }
+
+	std::ofstream ofs(sjis_to_wide(filename.data()), std::ios::binary);
+
+	if (!ofs) { return false; }
+
+	ofs.write(static_cast<const char*>(m_pData), m_dataSize);
+
+	return ofs.good();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ファイルからの読込
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// ファイルをメモリに割り当て、その領域をそのまま参照する：読み込みやBVHの作り直しは行わない
+// 実際にファイルから読まれるのは判定で触れた部分だけなので、広い地形でも読込の待ち時間がほぼ無い
+// ファイルが無い・形式が異なる場合はfalse：呼び出し側で形状を追加してBake()し直すこと
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBakedMesh::Load(std::string_view filename)
+{
+	Release();
+
+	if (filename.empty()) { return false; }
+
+	// ファイル名をWideCharへ変換
+	std::wstring wFilename = sjis_to_wide(filename.data());
+
+	m_hFile = CreateFileW(wFilename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+
+	if (m_hFile == INVALID_HANDLE_VALUE) { return false; }
+
+	LARGE_INTEGER fileSize = {};
+
+	if (!GetFileSizeEx(m_hFile, &fileSize) ||
+		fileSize.QuadPart < static_cast<LONGLONG>(sizeof(FileHeader)) ||
+		static_cast<ULONGLONG>(fileSize.QuadPart) > SIZE_MAX)
+	{
+		Release();
+
+		return false;
+	}
+
+	m_hMapping = CreateFileMappingW(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (m_hMapping) { m_pMappedView = MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0); }
+
+	if (!m_pMappedView || !AttachData(m_pMappedView, static_cast<size_t>(fileSize.QuadPart)))
+	{
+		Release();
+
+		return false;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 解放
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdBakedMesh::Release()
+{
+	// BVHは焼き込んだデータを参照しているので先に解放する
+	m_bvhs.clear();
+
+	m_groups = {};
+	m_positions = {};
+	m_faces = {};
+	m_tags = {};
+
+	m_aabb = DirectX::BoundingBox();
+
+	m_pData = nullptr;
+	m_dataSize = 0;
+
+	m_bakedData.clear();
+	m_bakedData.shrink_to_fit();
+
+	Unmap();
+
+	m_pendingPositions.clear();
+	m_pendingFaces.clear();
+	m_pendingTags.clear();
+	m_pendingTypes.clear();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ファイルの割り当ての解除
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdBakedMesh::Unmap()
+{
+	if (m_pMappedView)
+	{
+		UnmapViewOfFile(m_pMappedView);
+		m_pMappedView = nullptr;
+	}
+
+	if (m_hMapping)
+	{
+		CloseHandle(m_hMapping);
+		m_hMapping = nullptr;
+	}
+
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 焼き込んだデータを解釈して参照する
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 壊れたファイルで範囲外を参照しないように、各要素の位置は64bitで計算してファイルの大きさと照らし合わせる
+// 頂点・ノード・面のIndexは全て範囲内か確かめる(読込時に1度だけ)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBakedMesh::AttachData(const void* pData, size_t size)
+{
+	if (size < sizeof(FileHeader)) { return false; }
+
+	const char* pBytes = static_cast<const char*>(pData);
+
+	FileHeader header;
+	memcpy(&header, pBytes, sizeof(FileHeader));
+
+	if (header.m_magic != kBakedFileMagic || header.m_version != kBakedFileVersion) { return false; }
+	if (header.m_groupNum == 0 || header.m_faceNum == 0) { return false; }
+
+	//------------------------------
+	// 各要素の位置
+	//------------------------------
+	const uint64_t groupOffset		= sizeof(FileHeader);
+	const uint64_t positionOffset	= groupOffset + static_cast<uint64_t>(sizeof(Group)) * header.m_groupNum;
+	const uint64_t faceOffset		= positionOffset + static_cast<uint64_t>(sizeof(Math::Vector3)) * header.m_vertexNum;
+	const uint64_t tagOffset		= faceOffset + static_cast<uint64_t>(sizeof(KdMeshFace)) * header.m_faceNum;
+	const uint64_t nodeOffset		= tagOffset + static_cast<uint64_t>(sizeof(UINT)) * header.m_faceNum;
+	const uint64_t faceIndexOffset	= nodeOffset + static_cast<uint64_t>(sizeof(KdMeshBVH::Node)) * header.m_nodeNum;
+	const uint64_t triangleOffset	= faceIndexOffset + static_cast<uint64_t>(sizeof(UINT)) * header.m_faceNum;
+	const uint64_t endOffset		= triangleOffset + static_cast<uint64_t>(sizeof(float)) * header.m_triangleDataNum;
+
+	if (endOffset != size) { return false; }
+
+	std::span<const Group> groups(reinterpret_cast<const Group*>(pBytes + groupOffset), header.m_groupNum);
+	std::span<const Math::Vector3> positions(reinterpret_cast<const Math::Vector3*>(pBytes + positionOffset), header.m_vertexNum);
+	std::span<const KdMeshFace> faces(reinterpret_cast<const KdMeshFace*>(pBytes + faceOffset), header.m_faceNum);
+	std::span<const UINT> tags(reinterpret_cast<const UINT*>(pBytes + tagOffset), header.m_faceNum);
+	std::span<const KdMeshBVH::Node> nodes(reinterpret_cast<const KdMeshBVH::Node*>(pBytes + nodeOffset), header.m_nodeNum);
+	std::span<const UINT> faceIndices(reinterpret_cast<const UINT*>(pBytes + faceIndexOffset), header.m_faceNum);
+	const float* pTriangles = reinterpret_cast<const float*>(pBytes + triangleOffset);
+
+	//------------------------------
+	// 範囲の検証
+	//------------------------------
+	for (const KdMeshFace& face : faces)
+	{
+		if (face.Idx[0] >= header.m_vertexNum || face.Idx[1] >= header.m_vertexNum || face.Idx[2] >= header.m_vertexNum) { return false; }
+	}
+
+	//------------------------------
+	// グループ毎のBVHの参照
+	//------------------------------
+	std::vector<KdMeshBVH> bvhs(groups.size());
+
+	Math::Vector3 boundsMin(FLT_MAX);
+	Math::Vector3 boundsMax(-FLT_MAX);
+
+	for (size_t i = 0; i < groups.size(); ++i)
+	{
+		const Group& group = groups[i];
+
+		if (group.m_faceCount == 0) { return false; }
+		if (static_cast<uint64_t>(group.m_faceStart) + group.m_faceCount > header.m_faceNum) { return false; }
+		if (static_cast<uint64_t>(group.m_nodeStart) + group.m_nodeCount > header.m_nodeNum) { return false; }
+		if (static_cast<uint64_t>(group.m_triangleStart) + KdTriangleSoA::CalcDataNum(group.m_faceCount) > header.m_triangleDataNum) { return false; }
+
+		// ノードと面のIndexはグループ内の相対値なので、グループの範囲だけを渡す
+		if (!bvhs[i].Attach(nodes.subspan(group.m_nodeStart, group.m_nodeCount),
+			faceIndices.subspan(group.m_faceStart, group.m_faceCount), pTriangles + group.m_triangleStart))
+		{
+			return false;
+		}
+
+		boundsMin = Math::Vector3::Min(boundsMin, group.m_min);
+		boundsMax = Math::Vector3::Max(boundsMax, group.m_max);
+	}
+
+	m_bvhs = std::move(bvhs);
+
+	m_groups = groups;
+	m_positions = positions;
+	m_faces = faces;
+	m_tags = tags;
+
+	DirectX::BoundingBox::CreateFromPoints(m_aabb, boundsMin, boundsMax);
+
+	m_pData = pData;
+	m_dataSize = size;
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// グループの形状を判定用の参照にする
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+KdMeshShapeView KdBakedMesh::MakeGroupView(UINT groupIdx) const
+{
+	const Group& group = m_groups[groupIdx];
+
+	KdMeshShapeView view;
+	view.m_positions = m_positions;
+	view.m_faces = m_faces.subspan(group.m_faceStart, group.m_faceCount);
+	view.m_pBVH = &m_bvhs[groupIdx];
+
+	DirectX::BoundingBox::CreateFromPoints(view.m_aabb, group.m_min, group.m_max);
+
+	return view;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 全グループの衝突タイプを合わせたもの
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+UINT KdBakedMesh::GetTypes() const
+{
+	UINT types = 0;
+
+	for (const Group& group : m_groups) { types |= group.m_type; }
+
+	return types;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 球との判定
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 形状は既にワールド空間にあるので単位行列で判定する：グループの数しか判定が呼ばれない
+// KdModelCollisionと同じく、グループ毎に球を押し出しながら判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBakedMesh::Intersects(UINT type, const DirectX::BoundingSphere& sphere, CollisionMeshResult* pResult) const
+{
+	DirectX::BoundingSphere pushedSphere = sphere;
+
+	bool isHit = false;
+
+	DirectX::XMVECTOR hitPos = {};
+
+	for (UINT groupIdx = 0; groupIdx < m_groups.size(); ++groupIdx)
+	{
+		if (!(m_groups[groupIdx].m_type & type)) { continue; }
+
+		CollisionMeshResult tmpResult;
+		CollisionMeshResult* pTmpResult = pResult ? &tmpResult : nullptr;
+
+		if (!MeshIntersect(MakeGroupView(groupIdx), pushedSphere, DirectX::XMMatrixIdentity(), pTmpResult)) { continue; }
+
+		// 詳細リザルトが必要無ければ即結果を返す
+		if (!pResult) { return true; }
+
+		isHit = true;
+
+		// 重なった分押し戻す
+		DirectX::XMStoreFloat3(&pushedSphere.Center, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&pushedSphere.Center),
+			DirectX::XMVectorScale(tmpResult.m_hitDir, tmpResult.m_overlapDistance)));
+
+		hitPos = tmpResult.m_hitPos;
+	}
+
+	if (pResult && isHit)
+	{
+		pResult->m_hitPos = hitPos;
+
+		// 押し出された最終的な位置 - 元の位置 = 押し出しベクトル
+		pResult->m_hitDir = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&pushedSphere.Center), DirectX::XMLoadFloat3(&sphere.Center));
+
+		pResult->m_overlapDistance = DirectX::XMVectorGetX(DirectX::XMVector3Length(pResult->m_hitDir));
+
+		pResult->m_hitDir = DirectX::XMVector3Normalize(pResult->m_hitDir);
+
+		pResult->m_hit = true;
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOXとの判定
+// 球と同様にグループ毎にBOXを押し出しながら判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBakedMesh::Intersects(UINT type, const DirectX::BoundingOrientedBox& box, CollisionMeshResult* pResult) const
+{
+	DirectX::BoundingOrientedBox pushedBox = box;
+
+	bool isHit = false;
+
+	DirectX::XMVECTOR hitPos = {};
+
+	for (UINT groupIdx = 0; groupIdx < m_groups.size(); ++groupIdx)
+	{
+		if (!(m_groups[groupIdx].m_type & type)) { continue; }
+
+		CollisionMeshResult tmpResult;
+		CollisionMeshResult* pTmpResult = pResult ? &tmpResult : nullptr;
+
+		if (!MeshIntersect(MakeGroupView(groupIdx), pushedBox, DirectX::XMMatrixIdentity(), pTmpResult)) { continue; }
+
+		// 詳細リザルトが必要無ければ即結果を返す
+		if (!pResult) { return true; }
+
+		isHit = true;
+
+		// 重なった分押し戻す
+		DirectX::XMStoreFloat3(&pushedBox.Center, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&pushedBox.Center),
+			DirectX::XMVectorScale(tmpResult.m_hitDir, tmpResult.m_overlapDistance)));
+
+		hitPos = tmpResult.m_hitPos;
+	}
+
+	if (pResult && isHit)
+	{
+		pResult->m_hitPos = hitPos;
+
+		// 押し出された最終的な位置 - 元の位置 = 押し出しベクトル
+		pResult->m_hitDir = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&pushedBox.Center), DirectX::XMLoadFloat3(&box.Center));
+
+		pResult->m_overlapDistance = DirectX::XMVectorGetX(DirectX::XMVector3Length(pResult->m_hitDir));
+
+		pResult->m_hitDir = DirectX::XMVector3Normalize(pResult->m_hitDir);
+
+		pResult->m_hit = true;
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// レイとの判定
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// ワールド空間のレイでそのままBVHを辿る：レイの変換も逆行列も不要
+// 判定距離はグループを跨いで縮めていくので、後のグループは手前の箱だけを調べる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBakedMesh::Intersects(UINT type, const Math::Vector3& rayPos, const Math::Vector3& rayDir, float rayRange,
+	CollisionMeshResult* pResult, UINT* pHitFace) const
+{
+	// 当たった面も結果も不要なら最初のヒットで終了
+	bool anyHit = (!pResult && !pHitFace);
+
+	bool isHit = false;
+
+	float nearestDist = rayRange;
+	UINT nearestFace = 0;
+
+	for (UINT groupIdx = 0; groupIdx < m_groups.size(); ++groupIdx)
+	{
+		const Group& group = m_groups[groupIdx];
+
+		if (!(group.m_type & type)) { continue; }
+
+		UINT hitFace = 0;
+
+		if (!m_bvhs[groupIdx].IntersectRay(rayPos, rayDir, nearestDist, anyHit, &hitFace)) { continue; }
+
+		if (anyHit) { return true; }
+
+		isHit = true;
+
+		// グループ内の番号 → 全体の番号
+		nearestFace = group.m_faceStart + hitFace;
+	}
+
+	if (!isHit) { return false; }
+
+	if (pHitFace) { *pHitFace = nearestFace; }
+
+	if (pResult)
+	{
+		pResult->m_hitPos = rayPos + rayDir * nearestDist;
+
+		pResult->m_hitDir = rayDir * (-1);
+
+		pResult->m_overlapDistance = rayRange - nearestDist;
+
+		pResult->m_hit = true;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセルの移動判定
+// 全てのグループの中で最も手前で当たったものを結果とする
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBakedMesh::Sweep(UINT type, const KdCapsule& capsule, const Math::Vector3& moveDir, float moveRange, CollisionMeshResult* pResult) const
+{
+	CollisionMeshResult nearestResult;
+
+	bool isHit = false;
+
+	for (UINT groupIdx = 0; groupIdx < m_groups.size(); ++groupIdx)
+	{
+		if (!(m_groups[groupIdx].m_type & type)) { continue; }
+
+		CollisionMeshResult tmpResult;
+		CollisionMeshResult* pTmpResult = pResult ? &tmpResult : nullptr;
+
+		if (!MeshSweep(MakeGroupView(groupIdx), capsule, moveDir, moveRange, DirectX::XMMatrixIdentity(), pTmpResult)) { continue; }
+
+		// 詳細リザルトが必要無ければ即結果を返す
+		if (!pResult) { return true; }
+
+		// 重なり量が大きい = 手前で当たっている
+		if (!isHit || tmpResult.m_overlapDistance > nearestResult.m_overlapDistance)
+		{
+			nearestResult = tmpResult;
+		}
+
+		isHit = true;
+	}
+
+	if (pResult && isHit)
+	{
+		*pResult = nearestResult;
+
+		pResult->m_hit = true;
+	}
+
+	return isHit;
+}
@@ -0,0 +1,157 @@
+﻿#pragma once
+
+class KdModelWork;
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 動かない地形・建物の当たり判定用の形状をワールド空間で1つにまとめたもの(焼き込み)
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 配置済みのモデルの三角形をワールド座標に変換してから1つのBVHにまとめるので、
+// 判定時にメッシュ毎の行列の逆行列を求めたり、レイや球をローカル空間へ変換したりする必要が無い
+// 衝突タイプ(KdCollider::Type)毎に面のまとまり(グループ)を分け、それぞれでBVHを作る
+// 面毎にタグ(サブセットのマテリアル番号など)を持ち、当たった面の材質で足音を変えるなどに使う
+//
+// 使い方
+// ・AddModel() / AddMesh()	… 配置済みの形状を追加する
+// ・Bake()					… 追加した形状をまとめる
+// ・Save() / Load()		… ファイルへの書き出し・読込：読込はファイルをメモリに割り当てて、そのまま参照する(コピーしない)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdBakedMesh
+{
+public:
+
+	// 衝突タイプ毎の面のまとまり(ファイルにそのまま書き出す：48byte)
+	struct Group
+	{
+		UINT			m_type = 0;				// 衝突タイプ(KdCollider::Typeの組み合わせ)
+		UINT			m_faceStart = 0;		// 面の開始位置
+		UINT			m_faceCount = 0;		// 面数
+		UINT			m_nodeStart = 0;		// BVHのノードの開始位置
+		UINT			m_nodeCount = 0;		// BVHのノード数
+		UINT			m_triangleStart = 0;	// BVHの三角形の格納領域(float)の開始位置
+		Math::Vector3	m_min;					// 境界ボックス
+		Math::Vector3	m_max;
+	};
+
+	KdBakedMesh() {}
+	~KdBakedMesh() { Release(); }
+
+	//=================================================
+	// 作成・解放
+	//=================================================
+
+	// モデルの当たり判定ノードの形状を追加：タグはサブセットのマテリアル番号
+	// スキンメッシュは追加時の姿勢で焼き込まれる
+	// ・world	… モデルを配置する行列
+	// ・type	… 衝突タイプ(KdCollider::Typeの組み合わせ)
+	bool AddModel(const KdModelWork& model, const Math::Matrix& world, UINT type);
+
+	// メッシュの形状を追加：タグはサブセットのマテリアル番号
+	bool AddMesh(const KdMesh& mesh, const Math::Matrix& world, UINT type);
+
+	// 追加した形状を衝突タイプ毎にまとめてBVHを作る：追加した形状は破棄される
+	bool Bake();
+
+	// ファイルへの書き出し・読込
+	// 読込はファイルをメモリに割り当てるだけなので、形状の大きさに関係なくほぼ一瞬で終わる
+	// 壊れたファイル・形式の異なるファイルは失敗
+	bool Save(std::string_view filename) const;
+	bool Load(std::string_view filename);
+
+	// 解放
+	void Release();
+
+	bool IsEmpty() const { return m_groups.empty(); }
+
+	//=================================================
+	// 判定：座標は全てワールド空間
+	// typeと衝突タイプが重なるグループだけを判定する
+	//=================================================
+
+	// 球との判定：結果は球を押し出す方向と量
+	bool Intersects(UINT type, const DirectX::BoundingSphere& sphere, CollisionMeshResult* pResult = nullptr) const;
+	// BOXとの判定：結果はBOXを押し出す方向と量
+	bool Intersects(UINT type, const DirectX::BoundingOrientedBox& box, CollisionMeshResult* pResult = nullptr) const;
+	// レイとの判定：最も近くで当たった面
+	// ・rayDir		… 正規化済み
+	// ・pHitFace	… 当たった面のIndex(GetFaceTag()に渡す)：不要ならnullptr
+	bool Intersects(UINT type, const Math::Vector3& rayPos, const Math::Vector3& rayDir, float rayRange,
+		CollisionMeshResult* pResult = nullptr, UINT* pHitFace = nullptr) const;
+	// カプセルの移動判定：最も手前で当たった面
+	bool Sweep(UINT type, const KdCapsule& capsule, const Math::Vector3& moveDir, float moveRange, CollisionMeshResult* pResult = nullptr) const;
+
+	//=================================================
+	// 取得
+	//=================================================
+
+	// 面のタグ：範囲外なら0
+	UINT GetFaceTag(UINT faceIdx) const { return faceIdx < m_tags.size() ? m_tags[faceIdx] : 0; }
+
+	// 全体の境界ボックス
+	const DirectX::BoundingBox& GetBoundingBox() const { return m_aabb; }
+
+	// 全グループの衝突タイプを合わせたもの
+	UINT GetTypes() const;
+
+	std::span<const Group> GetGroups() const { return m_groups; }
+	UINT GetFaceNum() const { return static_cast<UINT>(m_faces.size()); }
+
+private:
+
+	// ファイルの先頭(32byte)
+	struct FileHeader
+	{
+		UINT	m_magic = 0;
+		UINT	m_version = 0;
+		UINT	m_groupNum = 0;
+		UINT	m_vertexNum = 0;
+		UINT	m_faceNum = 0;
+		UINT	m_nodeNum = 0;
+		UINT	m_triangleDataNum = 0;	// BVHの三角形の格納領域のfloatの数
+		UINT	m_reserved = 0;
+	};
+
+	// 形状をワールド空間へ変換して溜めておく：サブセットはタグに使う
+	void AppendMesh(const KdMesh& geometry, const std::vector<KdMeshSubset>& subsets, const Math::Matrix& matrix, UINT type);
+
+	// 焼き込んだデータ(ファイルの内容と同じ並び)を解釈して参照する：Bake()・Load()の共通処理
+	// 並び：FileHeader → Group[] → 座標[] → 面[] → タグ[] → BVHのノード[] → BVHの面のIndex[] → BVHの三角形[]
+	bool AttachData(const void* pData, size_t size);
+
+	// グループの形状を判定用の参照にする
+	KdMeshShapeView MakeGroupView(UINT groupIdx) const;
+
+	// ファイルの割り当ての解除
+	void Unmap();
+
+	// Bake()前の追加した形状(ワールド空間)
+	std::vector<Math::Vector3>	m_pendingPositions;
+	std::vector<KdMeshFace>		m_pendingFaces;
+	std::vector<UINT>			m_pendingTags;
+	std::vector<UINT>			m_pendingTypes;		// 面毎の衝突タイプ
+
+	// 焼き込んだデータの参照先：Bake()したものはm_bakedData、Load()したものはファイルを割り当てたメモリ
+	std::span<const Group>			m_groups;
+	std::span<const Math::Vector3>	m_positions;
+	std::span<const KdMeshFace>		m_faces;	// 頂点のIndexは全グループ共通
+	std::span<const UINT>			m_tags;
+
+	std::vector<KdMeshBVH>			m_bvhs;		// グループ毎：ノードと三角形は焼き込んだデータを参照する
+
+	DirectX::BoundingBox			m_aabb;
+
+	// ファイルへの書き出し用
+	const void*						m_pData = nullptr;
+	size_t							m_dataSize = 0;
+
+	// Bake()したデータ(4byte単位で確保して各要素の配置を揃える)
+	std::vector<UINT>				m_bakedData;
+
+	// ファイルの割り当て
+	HANDLE							m_hFile = INVALID_HANDLE_VALUE;
+	HANDLE							m_hMapping = nullptr;
+	const void*						m_pMappedView = nullptr;
+
+	// コピー禁止用
+	KdBakedMesh(const KdBakedMesh& src) = delete;
+	void operator=(const KdBakedMesh& src) = delete;
+};
@@ -4,108 +4,186 @@
 // KdCollider
 // ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
 
+KdCollider::KdCollider() {}
+
+KdCollider::~KdCollider() {}
+
 ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // 当たり判定形状の登録関数群
+// 形状は種類毎の配列に連続して格納し、名前からはハンドルで引く
 ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-void KdCollider::RegisterCollisionShape(std::string_view name, std::unique_ptr<KdCollisionShape> spShape)
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, std::unique_ptr<KdCollisionShape> spShape)
 {
-	if (!spShape) { return; }
+	if (!spShape) { return kInvalidShape; }
+
+	ShapeHandle handle = MakeHandle(KindCustom, m_customShapes.size());
+
+	if (!RegisterName(name, handle)) { return kInvalidShape; }
 
-	m_collisionShapes.emplace(name.data(), std::move(spShape));
+	m_customShapes.push_back(std::move(spShape));
+
+	return handle;
 }
 
 ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-void KdCollider::RegisterCollisionShape(std::string_view name, const DirectX::BoundingSphere& sphere, UINT type)
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, const DirectX::BoundingSphere& sphere, UINT type)
 {
-	RegisterCollisionShape(name, std::make_unique<KdSphereCollision>(sphere, type));
+	ShapeHandle handle = MakeHandle(KindSphere, m_sphereShapes.size());
+
+	if (!RegisterName(name, handle)) { return kInvalidShape; }
+
+	m_sphereShapes.emplace_back(sphere, type);
+
+	return handle;
 }
 
 ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-void KdCollider::RegisterCollisionShape(std::string_view name, const DirectX::BoundingBox& box, UINT type)
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, const DirectX::BoundingBox& box, UINT type)
 {
-	RegisterCollisionShape(name, std::make_unique<KdBoxCollision>(box, type));
+	ShapeHandle handle = MakeHandle(KindBox, m_boxShapes.size());
+
+	if (!RegisterName(name, handle)) { return kInvalidShape; }
+
+	m_boxShapes.emplace_back(box, type);
+
+	return handle;
 }
 
 ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-void KdCollider::RegisterCollisionShape(std::string_view name, const DirectX::BoundingOrientedBox& box, UINT type)
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, const DirectX::BoundingOrientedBox& box, UINT type)
 {
-	RegisterCollisionShape(name, std::make_unique<KdBoxCollision>(box, type));
+	ShapeHandle handle = MakeHandle(KindBox, m_boxShapes.size());
+
+	if (!RegisterName(name, handle)) { return kInvalidShape; }
+
+	m_boxShapes.emplace_back(box, type);
+
+	return handle;
 }
 
 ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-void KdCollider::RegisterCollisionShape(std::string_view name, const Math::Vector3& localPos, float radius, UINT type)
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, const Math::Vector3& localPos, float radius, UINT type)
 {
-	RegisterCollisionShape(name, std::make_unique<KdSphereCollision>(localPos, radius, type));
+	ShapeHandle handle = MakeHandle(KindSphere, m_sphereShapes.size());
+
+	if (!RegisterName(name, handle)) { return kInvalidShape; }
+
+	m_sphereShapes.emplace_back(localPos, radius, type);
+
+	return handle;
 }
 
 ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-void KdCollider::RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdModelData>& model, UINT type)
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, const KdCapsule& capsule, UINT type)
 {
-	RegisterCollisionShape(name, std::make_unique<KdModelCollision>(model, type));
+	ShapeHandle handle = MakeHandle(KindCapsule, m_capsuleShapes.size());
+
+	if (!RegisterName(name, handle)) { return kInvalidShape; }
+
+	m_capsuleShapes.emplace_back(capsule, type);
+
+	return handle;
 }
 
 ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-void KdCollider::RegisterCollisionShape(std::string_view name, KdModelData* model, UINT type)
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdModelData>& model, UINT type)
 {
-	RegisterCollisionShape(name, std::make_unique<KdModelCollision>(std::shared_ptr<KdModelData>(model), type));
+	ShapeHandle handle = MakeHandle(KindModel, m_modelShapes.size());
+
+	if (!RegisterName(name, handle)) { return kInvalidShape; }
+
+	m_modelShapes.emplace_back(model, type);
+
+	return handle;
 }
 
 ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-void KdCollider::RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdModelWork>& model, UINT type)
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, KdModelData* model, UINT type)
 {
-	RegisterCollisionShape(name, std::make_unique<KdModelCollision>(model, type));
+	return RegisterCollisionShape(name, std::shared_ptr<KdModelData>(model), type);
 }
 
 ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-void KdCollider::RegisterCollisionShape(std::string_view name, KdModelWork* model, UINT type)
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdModelWork>& model, UINT type)
 {
-	RegisterCollisionShape(name, std::make_unique<KdModelCollision>(std::shared_ptr<KdModelWork>(model), type));
+	ShapeHandle handle = MakeHandle(KindModel, m_modelShapes.size());
+
+	if (!RegisterName(name, handle)) { return kInvalidShape; }
+
+	m_modelShapes.emplace_back(model, type);
+
+	return handle;
 }
 
 ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-void KdCollider::RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdPolygon> polygon, UINT type)
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, KdModelWork* model, UINT type)
 {
-	RegisterCollisionShape(name, std::make_unique<KdPolygonCollision>(polygon, type));
+	return RegisterCollisionShape(name, std::shared_ptr<KdModelWork>(model), type);
 }
 
 ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-void KdCollider::RegisterCollisionShape(std::string_view name, KdPolygon* polygon, UINT type)
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdPolygon> polygon, UINT type)
 {
-	RegisterCollisionShape(name, std::make_unique<KdPolygonCollision>(std::shared_ptr<KdPolygon>(polygon), type));
+	ShapeHandle handle = MakeHandle(KindPolygon, m_polygonShapes.size());
+
+	if (!RegisterName(name, handle)) { return kInvalidShape; }
+
+	m_polygonShapes.emplace_back(polygon, type);
+
+	return handle;
 }
 
-// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-// コライダーvs球に登録された任意の形状の当たり判定
-// 球に合わせて何のために当たり判定をするのか type を渡す必要がある
-// 第3引数に詳細結果の受け取る機能が付いている
-// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdCollider::Intersects(const SphereInfo& targetShape, const Math::Matrix& ownerMatrix, std::list<KdCollider::CollisionResult>* pResults) const
+///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, KdPolygon* polygon, UINT type)
 {
-	// 当たり判定無効のタイプの場合は返る
-	if (targetShape.m_type & m_disableType) { return false; }
+	return RegisterCollisionShape(name, std::shared_ptr<KdPolygon>(polygon), type);
+}
 
-	bool isHit = false;
+///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdHeightfield>& heightfield, UINT type)
+{
+	ShapeHandle handle = MakeHandle(KindHeightfield, m_heightfieldShapes.size());
 
-	for (auto& collisionShape : m_collisionShapes)
-	{
-		// 用途が一致していない当たり判定形状はスキップ
-		if (!(targetShape.m_type & collisionShape.second->GetType())) { continue; }
+	if (!RegisterName(name, handle)) { return kInvalidShape; }
 
-		KdCollider::CollisionResult tmpRes;
-		KdCollider::CollisionResult* pTmpRes = pResults ? &tmpRes : nullptr;
+	m_heightfieldShapes.emplace_back(heightfield, type);
 
-		if (collisionShape.second->Intersects(targetShape.m_sphere, ownerMatrix, pTmpRes))
-		{
-			isHit = true;
+	return handle;
+}
 
-			// 詳細な衝突結果を必要としない場合は1つでも接触して返す
-			if (!pResults) { break; }
+///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+KdCollider::ShapeHandle KdCollider::RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdBakedMesh>& bakedMesh, UINT type)
+{
+	ShapeHandle handle = MakeHandle(KindBakedMesh, m_bakedMeshShapes.size());
 
-			pResults->push_back(tmpRes);
-		}
-	}
+	if (!RegisterName(name, handle)) { return kInvalidShape; }
 
-	return isHit;
+	m_bakedMeshShapes.emplace_back(bakedMesh, type);
+
+	return handle;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 名前の登録：同じ名前が登録済みなら登録しない(以前のstd::unordered_map::emplaceと同じ挙動)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollider::RegisterName(std::string_view name, ShapeHandle handle)
+{
+	if (m_shapeHandles.find(name) != m_shapeHandles.end()) { return false; }
+
+	m_shapeHandles.emplace(name, handle);
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// コライダーvs球に登録された任意の形状の当たり判定
+// 球に合わせて何のために当たり判定をするのか type を渡す必要がある
+// 第3引数に詳細結果の受け取る機能が付いている
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollider::Intersects(const SphereInfo& targetShape, const Math::Matrix& ownerMatrix, std::list<KdCollider::CollisionResult>* pResults) const
+{
+	return IntersectsEach(targetShape, ownerMatrix, pResults != nullptr,
+		[pResults](const CollisionResult& result) { pResults->push_back(result); return true; });
 }
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
@@ -115,75 +193,138 @@ bool KdCollider::Intersects(const SphereInfo& targetShape, const Math::Matrix& o
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 bool KdCollider::Intersects(const BoxInfo& targetShape, const Math::Matrix& ownerMatrix, std::list<KdCollider::CollisionResult>* pResults) const
 {
-	// 当たり判定無効のタイプの場合は返る
-	if (targetShape.m_type & m_disableType) { return false; }
+	return IntersectsEach(targetShape, ownerMatrix, pResults != nullptr,
+		[pResults](const CollisionResult& result) { pResults->push_back(result); return true; });
+}
 
-	bool isHit = false;
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// コライダーvsレイに登録された任意の形状の当たり判定
+// レイに合わせて何のために当たり判定をするのか type を渡す必要がある
+// 第3引数に詳細結果の受け取る機能が付いている
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollider::Intersects(const RayInfo& targetShape, const Math::Matrix& ownerMatrix, std::list<KdCollider::CollisionResult>* pResults) const
+{
+	return IntersectsEach(targetShape, ownerMatrix, pResults != nullptr,
+		[pResults](const CollisionResult& result) { pResults->push_back(result); return true; });
+}
 
-	for (auto& collisionShape : m_collisionShapes)
-	{
-		// 用途が一致していない当たり判定形状はスキップ
-		if (!(targetShape.m_type & collisionShape.second->GetType())) { continue; }
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// コライダーvsカプセルの移動に登録された任意の形状の当たり判定
+// 移動に合わせて何のために当たり判定をするのか type を渡す必要がある
+// 第3引数に詳細結果の受け取る機能が付いている：移動を止める位置には最も手前の結果(重なり量が最大のもの)を使う
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollider::Intersects(const CapsuleSweepInfo& targetSweep, const Math::Matrix& ownerMatrix, std::list<KdCollider::CollisionResult>* pResults) const
+{
+	return IntersectsEach(targetSweep, ownerMatrix, pResults != nullptr,
+		[pResults](const CollisionResult& result) { pResults->push_back(result); return true; });
+}
 
-		KdCollider::CollisionResult tmpRes;
-		KdCollider::CollisionResult* pTmpRes = pResults ? &tmpRes : nullptr;
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 当たり判定実行(結果を呼び出し側の配列へ書き込む)
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 結果の入れ物を呼び出し側が用意するのでメモリの確保は発生しない　配列が一杯になった時点で判定を終了する
+// 当たったかどうかだけを知りたい場合は Intersects(..., nullptr) を使うこと(空の配列では常に0を返す)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+UINT KdCollider::Intersects(const SphereInfo& targetShape, const Math::Matrix& ownerMatrix, std::span<KdCollider::CollisionResult> results) const
+{
+	if (results.empty()) { return 0; }
 
-		bool isIntersects = (targetShape.CheckBoxType(BoxInfo::BoxType::BoxAABB)) ? collisionShape.second->Intersects(targetShape.m_Abox, ownerMatrix, pTmpRes) :
-			collisionShape.second->Intersects(targetShape.m_Obox, ownerMatrix, pTmpRes);
-		if (isIntersects)
-		{
-			isHit = true;
+	UINT hitNum = 0;
 
-			// 詳細な衝突結果を必要としない場合は1つでも接触して返す
-			if (!pResults) { break; }
+	IntersectsEach(targetShape, ownerMatrix, true,
+		[&](const CollisionResult& result) { results[hitNum++] = result; return hitNum < results.size(); });
 
-			pResults->push_back(tmpRes);
-		}
-	}
+	return hitNum;
+}
 
-	return isHit;
+UINT KdCollider::Intersects(const BoxInfo& targetBox, const Math::Matrix& ownerMatrix, std::span<KdCollider::CollisionResult> results) const
+{
+	if (results.empty()) { return 0; }
+
+	UINT hitNum = 0;
+
+	IntersectsEach(targetBox, ownerMatrix, true,
+		[&](const CollisionResult& result) { results[hitNum++] = result; return hitNum < results.size(); });
+
+	return hitNum;
+}
+
+UINT KdCollider::Intersects(const RayInfo& targetShape, const Math::Matrix& ownerMatrix, std::span<KdCollider::CollisionResult> results) const
+{
+	if (results.empty()) { return 0; }
+
+	UINT hitNum = 0;
+
+	IntersectsEach(targetShape, ownerMatrix, true,
+		[&](const CollisionResult& result) { results[hitNum++] = result; return hitNum < results.size(); });
+
+	return hitNum;
+}
+
+UINT KdCollider::Intersects(const CapsuleSweepInfo& targetSweep, const Math::Matrix& ownerMatrix, std::span<KdCollider::CollisionResult> results) const
+{
+	if (results.empty()) { return 0; }
+
+	UINT hitNum = 0;
+
+	IntersectsEach(targetSweep, ownerMatrix, true,
+		[&](const CollisionResult& result) { results[hitNum++] = result; return hitNum < results.size(); });
+
+	return hitNum;
 }
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-// コライダーvsレイに登録された任意の形状の当たり判定
-// レイに合わせて何のために当たり判定をするのか type を渡す必要がある
-// 第3引数に詳細結果の受け取る機能が付いている
+// レイの方向ベクトルが存在しない場合は判定不能
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdCollider::Intersects(const RayInfo& targetShape, const Math::Matrix& ownerMatrix, std::list<KdCollider::CollisionResult>* pResults) const
+bool KdCollider::IsValidTarget(const RayInfo& target)
 {
-	// 当たり判定無効のタイプの場合は返る
-	if (targetShape.m_type & m_disableType) { return false; }
-
-	// レイの方向ベクトルが存在しない場合は判定不能なのでそのまま返る
-	if (!targetShape.m_dir.LengthSquared())
+	if (!target.m_dir.LengthSquared())
 	{
 		assert(0 && "KdCollider::Intersects：レイの方向ベクトルが存在していないため、正しく判定できません");
 
 		return false;
 	}
 
-	bool isHit = false;
+	return true;
+}
 
-	for (auto& collisionShape : m_collisionShapes)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 移動方向が存在しない・半径が0以下のカプセルは判定不能
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollider::IsValidTarget(const CapsuleSweepInfo& target)
+{
+	if (target.m_capsule.m_radius <= 0.0f || target.m_range < 0.0f || (target.m_range > 0.0f && !target.m_dir.LengthSquared()))
 	{
-		// 用途が一致していない当たり判定形状はスキップ
-		if (!(targetShape.m_type & collisionShape.second->GetType())) { continue; }
+		assert(0 && "KdCollider::Intersects：カプセルの半径か移動方向が存在していないため、正しく判定できません");
 
-		KdCollider::CollisionResult tmpRes;
-		KdCollider::CollisionResult* pTmpRes = pResults ? &tmpRes : nullptr;
+		return false;
+	}
 
-		if (collisionShape.second->Intersects(targetShape, ownerMatrix, pTmpRes))
-		{
-			isHit = true;
+	return true;
+}
 
-			// 詳細な衝突結果を必要としない場合は1つでも接触して返す
-			if (!pResults) { break; }
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 形状1つとの判定：判定対象の種類に合わせて形状の判定関数を呼び分ける
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollider::IntersectShape(const KdCollisionShape& shape, const SphereInfo& target, const Math::Matrix& ownerMatrix, CollisionResult* pRes)
+{
+	return shape.Intersects(target, ownerMatrix, pRes);
+}
 
-			pResults->push_back(tmpRes);
-		}
-	}
+bool KdCollider::IntersectShape(const KdCollisionShape& shape, const BoxInfo& target, const Math::Matrix& ownerMatrix, CollisionResult* pRes)
+{
+	return target.CheckBoxType(BoxInfo::BoxType::BoxAABB) ? shape.Intersects(target.m_Abox, ownerMatrix, pRes) :
+		shape.Intersects(target.m_Obox, ownerMatrix, pRes);
+}
 
-	return isHit;
+bool KdCollider::IntersectShape(const KdCollisionShape& shape, const RayInfo& target, const Math::Matrix& ownerMatrix, CollisionResult* pRes)
+{
+	return shape.Intersects(target, ownerMatrix, pRes);
+}
+
+bool KdCollider::IntersectShape(const KdCollisionShape& shape, const CapsuleSweepInfo& target, const Math::Matrix& ownerMatrix, CollisionResult* pRes)
+{
+	return shape.Intersects(target, ownerMatrix, pRes);
 }
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
@@ -191,12 +332,7 @@ bool KdCollider::Intersects(const RayInfo& targetShape, const Math::Matrix& owne
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 void KdCollider::SetEnable(std::string_view name, bool flag)
 {
-	auto targetCol = m_collisionShapes.find(name.data());
-
-	if (targetCol != m_collisionShapes.end())
-	{
-		targetCol->second->SetEnable(flag);
-	}
+	SetShapeEnable(FindShape(name), flag);
 }
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
@@ -221,10 +357,108 @@ void KdCollider::SetEnable(int type, bool flag)
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 void KdCollider::SetEnableAll(bool flag)
 {
-	for (auto& col : m_collisionShapes)
+	for (auto& col : m_sphereShapes) { col.SetEnable(flag); }
+	for (auto& col : m_boxShapes) { col.SetEnable(flag); }
+	for (auto& col : m_capsuleShapes) { col.SetEnable(flag); }
+	for (auto& col : m_modelShapes) { col.SetEnable(flag); }
+	for (auto& col : m_polygonShapes) { col.SetEnable(flag); }
+	for (auto& col : m_heightfieldShapes) { col.SetEnable(flag); }
+	for (auto& col : m_bakedMeshShapes) { col.SetEnable(flag); }
+	for (auto& spCol : m_customShapes) { spCol->SetEnable(flag); }
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ハンドルで指定した形状の有効/無効を切り替える
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollider::SetShapeEnable(ShapeHandle handle, bool flag)
+{
+	KdCollisionShape* pShape = GetShape(handle);
+
+	if (pShape) { pShape->SetEnable(flag); }
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 名前からハンドルを検索
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+KdCollider::ShapeHandle KdCollider::FindShape(std::string_view name) const
+{
+	auto it = m_shapeHandles.find(name);
+
+	return (it != m_shapeHandles.end()) ? it->second : kInvalidShape;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ハンドルから形状を取得
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+KdCollisionShape* KdCollider::GetShape(ShapeHandle handle)
+{
+	if (handle == kInvalidShape) { return nullptr; }
+
+	size_t index = handle & 0x00FFFFFF;
+
+	switch (handle >> 24)
 	{
-		col.second->SetEnable(flag);
+	case KindSphere:	return (index < m_sphereShapes.size()) ? &m_sphereShapes[index] : nullptr;
+	case KindBox:		return (index < m_boxShapes.size()) ? &m_boxShapes[index] : nullptr;
+	case KindCapsule:	return (index < m_capsuleShapes.size()) ? &m_capsuleShapes[index] : nullptr;
+	case KindModel:		return (index < m_modelShapes.size()) ? &m_modelShapes[index] : nullptr;
+	case KindPolygon:	return (index < m_polygonShapes.size()) ? &m_polygonShapes[index] : nullptr;
+	case KindHeightfield:	return (index < m_heightfieldShapes.size()) ? &m_heightfieldShapes[index] : nullptr;
+	case KindBakedMesh:	return (index < m_bakedMeshShapes.size()) ? &m_bakedMeshShapes[index] : nullptr;
+	case KindCustom:	return (index < m_customShapes.size()) ? m_customShapes[index].get() : nullptr;
 	}
+
+	return nullptr;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 登録した全形状の衝突タイプを合わせたもの
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+UINT KdCollider::GetCollisionTypes() const
+{
+	UINT types = 0;
+
+	ForEachShape([&types](const KdCollisionShape& shape) { types |= shape.GetType(); return true; });
+
+	return types;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 登録した全形状を包むワールド座標の境界ボックス
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 有効/無効は途中で切り替わる可能性があるので、無効な形状も含める
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollider::CalcBoundingBox(const Math::Matrix& ownerMatrix, DirectX::BoundingBox& out) const
+{
+	bool isFirst = true;
+	bool isBounded = true;
+
+	ForEachShape(
+		[&](const KdCollisionShape& shape)
+		{
+			DirectX::BoundingBox shapeBox;
+
+			if (!shape.CalcBoundingBox(ownerMatrix, shapeBox))
+			{
+				isBounded = false;
+
+				return false;
+			}
+
+			if (isFirst)
+			{
+				out = shapeBox;
+				isFirst = false;
+			}
+			else
+			{
+				DirectX::BoundingBox::CreateMerged(out, out, shapeBox);
+			}
+
+			return true;
+		});
+
+	return isBounded && !isFirst;
 }
 
 
@@ -238,7 +472,7 @@ void KdCollider::SetEnableAll(bool flag)
 // 判定回数は 1 回　計算自体も軽く最も軽量な当たり判定　計算回数も固定なので処理効率は安定
 // 片方の球の判定を0にすれば単純な距離判定も作れる
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdSphereCollision::Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes)
+bool KdSphereCollision::Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
 {
 	if (!m_enable) { return false; }
 
@@ -277,30 +511,52 @@ bool KdSphereCollision::Intersects(const DirectX::BoundingSphere& target, const
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // 球vsBOX(AABB)の当たり判定
 // 判定回数は 1 回　計算自体も軽く最も軽量な当たり判定　計算回数も固定なので処理効率は安定
-// 片方の球の判定を0にすれば単純な距離判定も作れる
+// 回転の無いOBBとして判定する
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdSphereCollision::Intersects(const DirectX::BoundingBox& /*target*/, const Math::Matrix& /*world*/, KdCollider::CollisionResult* /*pRes*/)
+bool KdSphereCollision::Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
 {
-	// TODO: 当たり計算は各自必要に応じて拡張して下さい
-	return false;
+	DirectX::BoundingOrientedBox targetBox;
+	DirectX::BoundingOrientedBox::CreateFromBoundingBox(targetBox, target);
+
+	return Intersects(targetBox, world, pRes);
 }
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // 球vsBOX(OBB)の当たり判定
 // 判定回数は 1 回　計算自体も軽く最も軽量な当たり判定　計算回数も固定なので処理効率は安定
-// 片方の球の判定を0にすれば単純な距離判定も作れる
+// BOX上で球の中心に最も近い点を求め、BOXを球から遠ざける方向へ押し出す
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdSphereCollision::Intersects(const DirectX::BoundingOrientedBox& /*target*/, const Math::Matrix& /*world*/, KdCollider::CollisionResult* /*pRes*/)
+bool KdSphereCollision::Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
 {
-	// TODO: 当たり計算は各自必要に応じて拡張して下さい
-	return false;
+	if (!m_enable) { return false; }
+
+	DirectX::BoundingSphere myShape;
+
+	m_shape.Transform(myShape, world);
+
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
+
+	// 結果は球を押し出す方向なので、BOXを押し出す方向は逆になる
+	if (!KdBoxIntersect(target, myShape, pTmpResult)) { return false; }
+
+	if (pRes)
+	{
+		pRes->m_hitPos = result.m_hitPos;
+
+		pRes->m_hitDir = DirectX::XMVectorNegate(result.m_hitDir);
+
+		pRes->m_overlapDistance = result.m_overlapDistance;
+	}
+
+	return true;
 }
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // 球vsレイの当たり判定
 // 判定回数は 1 回　計算回数が固定なので処理効率は安定
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdSphereCollision::Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes)
+bool KdSphereCollision::Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
 {
 	if (!m_enable) { return false; }
 
@@ -332,282 +588,1253 @@ bool KdSphereCollision::Intersects(const KdCollider::RayInfo& target, const Math
 	return isHit;
 }
 
-// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
-// BOXCollision
-// BOXの形状
-// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
-bool KdBoxCollision::Intersects(const DirectX::BoundingSphere& /*target*/, const Math::Matrix& /*world*/, KdCollider::CollisionResult* /*pRes*/)
-{
-	// TODO: 当たり計算は各自必要に応じて拡張して下さい
-	return false;
-}
-bool KdBoxCollision::Intersects(const DirectX::BoundingBox& /*target*/, const Math::Matrix& /*world*/, KdCollider::CollisionResult* /*pRes*/)
-{
-	// TODO: 当たり計算は各自必要に応じて拡張して下さい
-	return false;
-}
-bool KdBoxCollision::Intersects(const DirectX::BoundingOrientedBox& /*target*/, const Math::Matrix& /*world*/, KdCollider::CollisionResult* /*pRes*/)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 球vsカプセルの移動判定
+// 判定回数は 保守的前進法の繰り返し回数分　距離の計算は軽いので処理効率は安定
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdSphereCollision::Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
 {
-	// TODO: 当たり計算は各自必要に応じて拡張して下さい
-	return false;
+	if (!m_enable) { return false; }
+
+	DirectX::BoundingSphere myShape;
+
+	m_shape.Transform(myShape, world);
+
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
+
+	if (!KdCapsuleSweep(myShape, target.m_capsule, target.m_dir, target.m_range, pTmpResult)) { return false; }
+
+	if (pRes)
+	{
+		pRes->m_hitPos = result.m_hitPos;
+
+		pRes->m_hitDir = result.m_hitDir;
+
+		pRes->m_overlapDistance = result.m_overlapDistance;
+	}
+
+	return true;
 }
-bool KdBoxCollision::Intersects(const KdCollider::RayInfo& /*target*/, const Math::Matrix& /*world*/, KdCollider::CollisionResult* /*pRes*/)
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 球のワールド座標の境界ボックス
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdSphereCollision::CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const
 {
-	// TODO: 当たり計算は各自必要に応じて拡張して下さい
-	return false;
+	DirectX::BoundingSphere myShape;
+
+	m_shape.Transform(myShape, world);
+
+	DirectX::BoundingBox::CreateFromSphere(out, myShape);
+
+	return true;
 }
 
 // ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
-// ModelCollision
-// 3Dメッシュの形状
+// BOXCollision
+// BOXの形状
 // ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-// モデルvs球の当たり判定
-// 判定回数は メッシュの個数 x 各メッシュのポリゴン数 計算回数がモデルのデータ依存のため処理効率は不安定
-// 単純に計算回数が多くなる可能性があるため重くなりがち
+// BOXvs球の当たり判定
+// 判定回数は 1 回　計算回数が固定なので処理効率は安定
+// BOX上で球の中心に最も近い点を求め、球をBOXの外へ押し出す
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdModelCollision::Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes)
+bool KdBoxCollision::Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
 {
-	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
-	if (!m_enable || !m_shape) { return false; }
+	if (!m_enable) { return false; }
 
-	std::shared_ptr<KdModelData> spModelData = m_shape->GetData();
+	DirectX::BoundingOrientedBox myShape;
+	CalcWorldBox(world, myShape);
 
-	// データが無ければ判定不能なので返る
-	if (!spModelData) { return false; }
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
 
-	const std::vector<KdModelData::Node>& dataNodes = spModelData->GetOriginalNodes();
-	const std::vector<KdModelWork::Node>& workNodes = m_shape->GetNodes();
+	if (!KdBoxIntersect(myShape, target, pTmpResult)) { return false; }
 
-	// 各メッシュに押される用の球・押される毎に座標を更新する必要がある
-	DirectX::BoundingSphere pushedSphere = target;
-	// 計算用にFloat3 → Vectorへ変換
+	if (pRes)
+	{
+		pRes->m_hitPos = result.m_hitPos;
+
+		pRes->m_hitDir = result.m_hitDir;
+
+		pRes->m_overlapDistance = result.m_overlapDistance;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOXvsBOX(AABB)の当たり判定
+// 回転の無いOBBとして判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBoxCollision::Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	DirectX::BoundingOrientedBox targetBox;
+	DirectX::BoundingOrientedBox::CreateFromBoundingBox(targetBox, target);
+
+	return Intersects(targetBox, world, pRes);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOXvsBOX(OBB)の当たり判定
+// 判定回数は 分離軸の15本　計算回数が固定なので処理効率は安定
+// 重なりが最も小さい軸の方向へ相手のBOXを押し出す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBoxCollision::Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	if (!m_enable) { return false; }
+
+	DirectX::BoundingOrientedBox myShape;
+	CalcWorldBox(world, myShape);
+
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
+
+	if (!KdBoxIntersect(myShape, target, pTmpResult)) { return false; }
+
+	if (pRes)
+	{
+		pRes->m_hitPos = result.m_hitPos;
+
+		pRes->m_hitDir = result.m_hitDir;
+
+		pRes->m_overlapDistance = result.m_overlapDistance;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOXvsレイの当たり判定
+// 判定回数は 1 回　計算回数が固定なので処理効率は安定
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBoxCollision::Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	if (!m_enable) { return false; }
+
+	float hitDistance = 0.0f;
+
+	bool isHit = false;
+
+	if (!m_isOriented)
+	{
+		DirectX::BoundingBox myShape;
+		m_Abox.Transform(myShape, world);
+
+		isHit = myShape.Intersects(target.m_pos, target.m_dir, hitDistance);
+	}
+	else
+	{
+		DirectX::BoundingOrientedBox myShape;
+		m_Obox.Transform(myShape, world);
+
+		isHit = myShape.Intersects(target.m_pos, target.m_dir, hitDistance);
+	}
+
+	// 判定限界距離を加味
+	isHit &= (target.m_range >= hitDistance);
+
+	// 詳細リザルトが必要無ければ即結果を返す
+	if (!pRes) { return isHit; }
+
+	// 当たった時のみ計算
+	if (isHit)
+	{
+		// レイ発射位置 + レイの当たった位置までのベクトル 
+		pRes->m_hitPos = target.m_pos + target.m_dir * hitDistance;
+
+		pRes->m_hitDir = target.m_dir * (-1);
+
+		pRes->m_overlapDistance = target.m_range - hitDistance;
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOXvsカプセルの移動判定
+// 判定回数は BOXの面の三角形12個分　計算回数が固定なので処理効率は安定
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBoxCollision::Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	if (!m_enable) { return false; }
+
+	DirectX::BoundingOrientedBox myShape;
+	CalcWorldBox(world, myShape);
+
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
+
+	if (!KdCapsuleSweep(myShape, target.m_capsule, target.m_dir, target.m_range, pTmpResult)) { return false; }
+
+	if (pRes)
+	{
+		pRes->m_hitPos = result.m_hitPos;
+
+		pRes->m_hitDir = result.m_hitDir;
+
+		pRes->m_overlapDistance = result.m_overlapDistance;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOXのワールド座標のOBB：回転を考慮しないBOXは行列で変換した後の軸に揃った箱
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdBoxCollision::CalcWorldBox(const Math::Matrix& world, DirectX::BoundingOrientedBox& out) const
+{
+	if (!m_isOriented)
+	{
+		DirectX::BoundingBox myShape;
+		m_Abox.Transform(myShape, world);
+
+		DirectX::BoundingOrientedBox::CreateFromBoundingBox(out, myShape);
+
+		return;
+	}
+
+	m_Obox.Transform(out, world);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOXのワールド座標の境界ボックス：OBBは8つの角を包む箱
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBoxCollision::CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const
+{
+	if (!m_isOriented)
+	{
+		m_Abox.Transform(out, world);
+
+		return true;
+	}
+
+	DirectX::BoundingOrientedBox myShape;
+	m_Obox.Transform(myShape, world);
+
+	DirectX::XMFLOAT3 corners[DirectX::BoundingOrientedBox::CORNER_COUNT];
+	myShape.GetCorners(corners);
+
+	DirectX::BoundingBox::CreateFromPoints(out, DirectX::BoundingOrientedBox::CORNER_COUNT, corners, sizeof(DirectX::XMFLOAT3));
+
+	return true;
+}
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// CapsuleCollision
+// カプセルの形状
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセルvs球の当たり判定
+// 判定回数は 1 回　計算回数が固定なので処理効率は安定
+// 線分上で球の中心に最も近い点を求め、球をカプセルの外へ押し出す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCapsuleCollision::Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	if (!m_enable) { return false; }
+
+	KdCapsule myShape;
+	m_shape.Transform(myShape, world);
+
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
+
+	if (!KdCapsuleIntersect(myShape, target, pTmpResult)) { return false; }
+
+	if (pRes)
+	{
+		pRes->m_hitPos = result.m_hitPos;
+
+		pRes->m_hitDir = result.m_hitDir;
+
+		pRes->m_overlapDistance = result.m_overlapDistance;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセルvsBOX(AABB)の当たり判定
+// 回転の無いOBBとして判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCapsuleCollision::Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	DirectX::BoundingOrientedBox targetBox;
+	DirectX::BoundingOrientedBox::CreateFromBoundingBox(targetBox, target);
+
+	return Intersects(targetBox, world, pRes);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセルvsBOX(OBB)の当たり判定
+// 判定回数は BOXの面の三角形12個分　計算回数が固定なので処理効率は安定
+// 移動距離0のスイープでめり込み量を求め、BOXをカプセルから遠ざける方向へ押し出す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCapsuleCollision::Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	if (!m_enable) { return false; }
+
+	KdCapsule myShape;
+	m_shape.Transform(myShape, world);
+
+	// 線分がBOXの面に触れている場合に備えて、カプセルからBOXへ向かう方向を移動方向とする
+	Math::Vector3 toBox = Math::Vector3(target.Center) - (myShape.m_pos0 + myShape.m_pos1) * 0.5f;
+	if (!toBox.LengthSquared()) { toBox = Math::Vector3::Down; }
+	toBox.Normalize();
+
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
+
+	if (!KdCapsuleSweep(target, myShape, toBox, 0.0f, pTmpResult)) { return false; }
+
+	// 結果はカプセルを押し出す方向なので、BOXを押し出す方向は逆になる
+	if (pRes)
+	{
+		pRes->m_hitPos = result.m_hitPos;
+
+		pRes->m_hitDir = DirectX::XMVectorNegate(result.m_hitDir);
+
+		pRes->m_overlapDistance = result.m_overlapDistance;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセルvsレイの当たり判定
+// 判定回数は 保守的前進法の繰り返し回数分　距離の計算は軽いので処理効率は安定
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCapsuleCollision::Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	if (!m_enable) { return false; }
+
+	KdCapsule myShape;
+	m_shape.Transform(myShape, world);
+
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
+
+	if (!KdCapsuleIntersect(myShape, target.m_pos, target.m_dir, target.m_range, pTmpResult)) { return false; }
+
+	if (pRes)
+	{
+		pRes->m_hitPos = result.m_hitPos;
+
+		pRes->m_hitDir = result.m_hitDir;
+
+		pRes->m_overlapDistance = result.m_overlapDistance;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセルvsカプセルの移動判定
+// 判定回数は 保守的前進法の繰り返し回数分　距離の計算は軽いので処理効率は安定
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCapsuleCollision::Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	if (!m_enable) { return false; }
+
+	KdCapsule myShape;
+	m_shape.Transform(myShape, world);
+
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
+
+	if (!KdCapsuleSweep(myShape, target.m_capsule, target.m_dir, target.m_range, pTmpResult)) { return false; }
+
+	if (pRes)
+	{
+		pRes->m_hitPos = result.m_hitPos;
+
+		pRes->m_hitDir = result.m_hitDir;
+
+		pRes->m_overlapDistance = result.m_overlapDistance;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセルのワールド座標の境界ボックス
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCapsuleCollision::CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const
+{
+	KdCapsule myShape;
+	m_shape.Transform(myShape, world);
+
+	KdCalcCapsuleSweptBox(myShape, DirectX::g_XMZero, 0.0f, out);
+
+	return true;
+}
+
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// ModelCollision
+// 3Dメッシュの形状
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデルvs球の当たり判定
+// 判定回数は メッシュの個数 x 各メッシュのポリゴン数 計算回数がモデルのデータ依存のため処理効率は不安定
+// 単純に計算回数が多くなる可能性があるため重くなりがち
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdModelCollision::Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	return IntersectSphere(target, world, pRes, nullptr);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデルvs球の当たり判定(前回の判定の記録を使う)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdModelCollision::Intersects(const KdCollider::SphereInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	return IntersectSphere(target.m_sphere, world, pRes, target.m_pCache);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデルvs球の当たり判定本体
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdModelCollision::IntersectSphere(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes,
+	KdContactCache* pCache) const
+{
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
+
+	std::shared_ptr<KdModelData> spModelData = m_shape->GetData();
+
+	// データが無ければ判定不能なので返る
+	if (!spModelData) { return false; }
+
+	// 各メッシュに押される用の球・押される毎に座標を更新する必要がある
+	DirectX::BoundingSphere pushedSphere = target;
+	// 計算用にFloat3 → Vectorへ変換
 	Math::Vector3 pushedSphereCenter = DirectX::XMLoadFloat3(&pushedSphere.Center);
 
-	bool isHit = false;
+	bool isHit = false;
+
+	Math::Vector3 hitPos;
+
+	// 当たり判定ノードとのみ当たり判定
+	for (int index : spModelData->GetCollisionMeshNodeIndices())
+	{
+		// 押し出された後の球の範囲
+		DirectX::BoundingBox queryBox;
+		DirectX::BoundingBox::CreateFromSphere(queryBox, pushedSphere);
+
+		Math::Matrix meshWorld;
+		const KdMesh* pMesh = GetCollisionMesh(index, world, queryBox, meshWorld);
+
+		// 判定範囲外のスキンメッシュ・メッシュの無いノード
+		if (!pMesh) { continue; }
+
+		CollisionMeshResult tmpResult;
+		CollisionMeshResult* pTmpResult = pRes ? &tmpResult : nullptr;
+
+		// メッシュと球形の当たり判定実行
+		if (!MeshIntersect(KdMeshShapeView(*pMesh), pushedSphere, meshWorld, pTmpResult, AcquireQueryCache(pCache, index, pMesh, meshWorld)))
+		{
+			continue;
+		}
+
+		// 詳細リザルトが必要無ければ即結果を返す
+		if (!pRes) { return true; }
+
+		isHit = true;
+
+		// 重なった分押し戻す
+		pushedSphereCenter = DirectX::XMVectorAdd(pushedSphereCenter, DirectX::XMVectorScale(tmpResult.m_hitDir, tmpResult.m_overlapDistance));
+
+		DirectX::XMStoreFloat3(&pushedSphere.Center, pushedSphereCenter);
+
+		// とりあえず当たった座標で更新
+		hitPos = tmpResult.m_hitPos;
+	}
+
+	if (pRes && isHit)
+	{
+		// 最後に当たった座標が使用される
+		pRes->m_hitPos = hitPos;
+
+		// 複数のメッシュに押された最終的な位置 - 移動前の位置 = 押し出しベクトル
+		pRes->m_hitDir = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&pushedSphere.Center), DirectX::XMLoadFloat3(&target.Center));
+
+		pRes->m_overlapDistance = DirectX::XMVector3Length(pRes->m_hitDir).m128_f32[0];
+
+		pRes->m_hitDir = DirectX::XMVector3Normalize(pRes->m_hitDir);
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデルvsBOX(AABB)の当たり判定
+// 判定回数は メッシュの個数 x 各メッシュのポリゴン数 計算回数がモデルのデータ依存のため処理効率は不安定
+// 回転の無いOBBとして判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdModelCollision::Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	DirectX::BoundingOrientedBox targetBox;
+	DirectX::BoundingOrientedBox::CreateFromBoundingBox(targetBox, target);
+
+	return Intersects(targetBox, world, pRes);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデルvsBOX(OBB)の当たり判定
+// 判定回数は メッシュの個数 x 各メッシュのポリゴン数 計算回数がモデルのデータ依存のため処理効率は不安定
+// BVHを持つメッシュはBOXの周囲の面だけを判定する　球と同様にメッシュ毎にBOXを押し出しながら判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdModelCollision::Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
+
+	std::shared_ptr<KdModelData> spModelData = m_shape->GetData();
+
+	// データが無ければ判定不能なので返る
+	if (!spModelData) { return false; }
+
+	// 各メッシュに押される用のBOX・押される毎に座標を更新する必要がある
+	DirectX::BoundingOrientedBox pushedBox = target;
+	// 計算用にFloat3 → Vectorへ変換
+	Math::Vector3 pushedBoxCenter = DirectX::XMLoadFloat3(&pushedBox.Center);
+
+	bool isHit = false;
+
+	Math::Vector3 hitPos;
+
+	// 当たり判定ノードとのみ当たり判定
+	for (int index : spModelData->GetCollisionMeshNodeIndices())
+	{
+		// 押し出された後のBOXの範囲
+		DirectX::XMFLOAT3 corners[DirectX::BoundingOrientedBox::CORNER_COUNT];
+		pushedBox.GetCorners(corners);
+
+		DirectX::BoundingBox queryBox;
+		DirectX::BoundingBox::CreateFromPoints(queryBox, DirectX::BoundingOrientedBox::CORNER_COUNT, corners, sizeof(DirectX::XMFLOAT3));
+
+		Math::Matrix meshWorld;
+		const KdMesh* pMesh = GetCollisionMesh(index, world, queryBox, meshWorld);
+
+		// 判定範囲外のスキンメッシュ・メッシュの無いノード
+		if (!pMesh) { continue; }
+
+		CollisionMeshResult tmpResult;
+		CollisionMeshResult* pTmpResult = pRes ? &tmpResult : nullptr;
+
+		// メッシュとBOXの当たり判定実行
+		if (!MeshIntersect(*pMesh, pushedBox, meshWorld, pTmpResult))
+		{
+			continue;
+		}
+
+		// 詳細リザルトが必要無ければ即結果を返す
+		if (!pRes) { return true; }
+
+		isHit = true;
+
+		// 重なった分押し戻す
+		pushedBoxCenter = DirectX::XMVectorAdd(pushedBoxCenter, DirectX::XMVectorScale(tmpResult.m_hitDir, tmpResult.m_overlapDistance));
+
+		DirectX::XMStoreFloat3(&pushedBox.Center, pushedBoxCenter);
+
+		// とりあえず当たった座標で更新
+		hitPos = tmpResult.m_hitPos;
+	}
+
+	if (pRes && isHit)
+	{
+		// 最後に当たった座標が使用される
+		pRes->m_hitPos = hitPos;
+
+		// 複数のメッシュに押された最終的な位置 - 移動前の位置 = 押し出しベクトル
+		pRes->m_hitDir = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&pushedBox.Center), DirectX::XMLoadFloat3(&target.Center));
+
+		pRes->m_overlapDistance = DirectX::XMVector3Length(pRes->m_hitDir).m128_f32[0];
+
+		pRes->m_hitDir = DirectX::XMVector3Normalize(pRes->m_hitDir);
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデルvsレイの当たり判定
+// 判定回数は メッシュの個数 x 各メッシュのポリゴン数 計算回数がモデルのデータ依存のため処理効率は不安定
+// 単純に計算回数が多くなる可能性があるため重くなりがち
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdModelCollision::Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
+
+	std::shared_ptr<KdModelData> spModelData = m_shape->GetData();
+
+	// データが無ければ判定不能なので返る
+	if (!spModelData) { return false; }
+
+	CollisionMeshResult nearestResult;
+
+	bool isHit = false;
+
+	// レイの範囲：スキンメッシュはこの範囲に掛かる場合だけ変形する
+	Math::Vector3 rayPoints[2] = { target.m_pos, target.m_pos + target.m_dir * target.m_range };
+
+	DirectX::BoundingBox queryBox;
+	DirectX::BoundingBox::CreateFromPoints(queryBox, 2, rayPoints, sizeof(Math::Vector3));
+
+	for (int index : spModelData->GetCollisionMeshNodeIndices())
+	{
+		Math::Matrix meshWorld;
+		const KdMesh* pMesh = GetCollisionMesh(index, world, queryBox, meshWorld);
+
+		if (!pMesh) { continue; }
+
+		CollisionMeshResult tmpResult;
+		CollisionMeshResult* pTmpResult = pRes ? &tmpResult : nullptr;
+
+		if (!MeshIntersect(KdMeshShapeView(*pMesh), target.m_pos, target.m_dir, target.m_range, meshWorld, pTmpResult,
+			AcquireQueryCache(target.m_pCache, index, pMesh, meshWorld)))
+		{
+			continue;
+		}
+
+		// 詳細リザルトが必要無ければ即結果を返す
+		if (!pRes) { return true; }
+
+		isHit = true;
+
+		if (tmpResult.m_overlapDistance > nearestResult.m_overlapDistance)
+		{
+			nearestResult = tmpResult;
+		}
+	}
+
+	if (pRes && isHit)
+	{
+		// 最も近くで当たったヒット情報をコピーする
+		pRes->m_hitPos = nearestResult.m_hitPos;
+
+		pRes->m_hitDir = nearestResult.m_hitDir;
+
+		pRes->m_overlapDistance = nearestResult.m_overlapDistance;
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデルvsカプセルの移動判定
+// 判定回数は メッシュの個数 x 移動範囲に掛かるポリゴン数　BVHがあれば移動範囲の周囲の面だけを調べる
+// 全てのメッシュの中で最も手前で当たったものを結果とする
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdModelCollision::Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
+
+	std::shared_ptr<KdModelData> spModelData = m_shape->GetData();
+
+	// データが無ければ判定不能なので返る
+	if (!spModelData) { return false; }
+
+	CollisionMeshResult nearestResult;
+
+	bool isHit = false;
+
+	// 移動範囲全体：スキンメッシュはこの範囲に掛かる場合だけ変形する
+	DirectX::BoundingBox queryBox;
+	KdCalcCapsuleSweptBox(target.m_capsule, target.m_dir, target.m_range, queryBox);
+
+	for (int index : spModelData->GetCollisionMeshNodeIndices())
+	{
+		Math::Matrix meshWorld;
+		const KdMesh* pMesh = GetCollisionMesh(index, world, queryBox, meshWorld);
+
+		if (!pMesh) { continue; }
+
+		CollisionMeshResult tmpResult;
+		CollisionMeshResult* pTmpResult = pRes ? &tmpResult : nullptr;
+
+		if (!MeshSweep(*pMesh, target.m_capsule, target.m_dir, target.m_range, meshWorld, pTmpResult))
+		{
+			continue;
+		}
+
+		// 詳細リザルトが必要無ければ即結果を返す
+		if (!pRes) { return true; }
+
+		// 重なり量が大きい = 手前で当たっている
+		if (!isHit || tmpResult.m_overlapDistance > nearestResult.m_overlapDistance)
+		{
+			nearestResult = tmpResult;
+		}
+
+		isHit = true;
+	}
+
+	if (pRes && isHit)
+	{
+		// 最も手前で当たったヒット情報をコピーする
+		pRes->m_hitPos = nearestResult.m_hitPos;
+
+		pRes->m_hitDir = nearestResult.m_hitDir;
+
+		pRes->m_overlapDistance = nearestResult.m_overlapDistance;
+	}
+
+	return isHit;
+}
+
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 判定に使うメッシュとワールド行列
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// スキンメッシュは変形する前にボーンの影響範囲で判定対象の範囲(queryBox)に掛かるか調べ、
+// 掛かる場合だけ現在の姿勢に変形した形状を使う(同じ姿勢の間は変形済みの形状を使い回す)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+const KdMesh* KdModelCollision::GetCollisionMesh(int nodeIdx, const Math::Matrix& world, const DirectX::BoundingBox& queryBox,
+	Math::Matrix& meshWorld) const
+{
+	const KdMesh* pDataMesh = m_shape->GetDataNodes()[nodeIdx].m_spMesh.get();
+
+	if (!pDataMesh) { return nullptr; }
+
+	if (pDataMesh->IsSkinMesh())
+	{
+		DirectX::BoundingBox bounds;
+		if (!m_shape->CalcCollisionMeshBounds(nodeIdx, bounds)) { return nullptr; }
+
+		bounds.Transform(bounds, world);
+
+		if (!bounds.Intersects(queryBox)) { return nullptr; }
+	}
+
+	Math::Matrix meshMatrix;
+	const KdMesh* pMesh = m_shape->GetCollisionMesh(nodeIdx, meshMatrix);
+
+	meshWorld = meshMatrix * world;
+
+	return pMesh;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// メッシュ毎の前回の判定の記録
+// 変形したスキンメッシュは行列が同じでも形が変わるので、姿勢の番号も記録と照らし合わせる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+KdMeshQueryCache* KdModelCollision::AcquireQueryCache(KdContactCache* pCache, int nodeIdx, const KdMesh* pMesh, const Math::Matrix& meshWorld) const
+{
+	if (!pCache) { return nullptr; }
+
+	const KdMesh* pDataMesh = m_shape->GetDataNodes()[nodeIdx].m_spMesh.get();
+
+	UINT version = (pDataMesh && pDataMesh->IsSkinMesh()) ? m_shape->GetPoseVersion() : 0;
+
+	return &pCache->Acquire(m_shape.get(), nodeIdx, pMesh, meshWorld, version);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデルのワールド座標の境界ボックス
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 当たり判定ノードのメッシュの境界ボックスを、ノードの現在の行列で変換して合わせる
+// 当たり判定ノードが無い場合は原点の大きさ0の箱
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdModelCollision::CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const
+{
+	if (!m_shape) { return false; }
+
+	std::shared_ptr<KdModelData> spModelData = m_shape->GetData();
+
+	if (!spModelData) { return false; }
+
+	out.Center = world.Translation();
+	out.Extents = Math::Vector3::Zero;
+
+	bool isFirst = true;
+
+	for (int index : spModelData->GetCollisionMeshNodeIndices())
+	{
+		// スキンメッシュは変形せずにボーンの影響範囲から求める
+		DirectX::BoundingBox nodeBox;
+		if (!m_shape->CalcCollisionMeshBounds(index, nodeBox)) { continue; }
+
+		nodeBox.Transform(nodeBox, world);
+
+		if (isFirst)
+		{
+			out = nodeBox;
+			isFirst = false;
+		}
+		else
+		{
+			DirectX::BoundingBox::CreateMerged(out, out, nodeBox);
+		}
+	}
+
+	return true;
+}
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// PolygonCollision
+// 多角形ポリゴン(頂点の集合体)の形状
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 多角形ポリゴン(頂点の集合体)vs球の当たり判定
+// 判定回数は ポリゴンの個数 計算回数がポリゴンデータ依存のため処理効率は不安定
+// 単純に計算回数が多くなる可能性があるため重くなりがち
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdPolygonCollision::Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
+
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
+
+	// メッシュと球形の当たり判定実行
+	if (!PolygonsIntersect(*m_shape, target, world, pTmpResult))
+	{
+		// 当たっていなければ無条件に返る
+		return false;
+	}
+
+	if (pRes)
+	{
+		pRes->m_hitPos = result.m_hitPos;
+
+		pRes->m_hitDir = result.m_hitDir;
+
+		pRes->m_overlapDistance = result.m_overlapDistance;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 多角形ポリゴン(頂点の集合体)vsBOX(AABB)の当たり判定
+// 判定回数は ポリゴンの個数 計算回数がポリゴンデータ依存のため処理効率は不安定
+// 回転の無いOBBとして判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdPolygonCollision::Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	DirectX::BoundingOrientedBox targetBox;
+	DirectX::BoundingOrientedBox::CreateFromBoundingBox(targetBox, target);
+
+	return Intersects(targetBox, world, pRes);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 多角形ポリゴン(頂点の集合体)vsBOX(OBB)の当たり判定
+// 判定回数は ポリゴンの個数 計算回数がポリゴンデータ依存のため処理効率は不安定
+// BOXを包む球で面を絞り込んでから分離軸判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdPolygonCollision::Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
+
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
+
+	// ポリゴンとBOXの当たり判定実行
+	if (!PolygonsIntersect(*m_shape, target, world, pTmpResult))
+	{
+		// 当たっていなければ無条件に返る
+		return false;
+	}
+
+	if (pRes)
+	{
+		pRes->m_hitPos = result.m_hitPos;
 
-	Math::Vector3 hitPos;
+		pRes->m_hitDir = result.m_hitDir;
 
-	// 当たり判定ノードとのみ当たり判定
-	for (int index : spModelData->GetCollisionMeshNodeIndices())
+		pRes->m_overlapDistance = result.m_overlapDistance;
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 多角形ポリゴン(頂点の集合体)vsレイの当たり判定
+// 判定回数は ポリゴンの個数 計算回数がポリゴンデータ依存のため処理効率は不安定
+// 単純に計算回数が多くなる可能性があるため重くなりがち
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdPolygonCollision::Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
+
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
+
+	if (!PolygonsIntersect(*m_shape, target.m_pos, target.m_dir, target.m_range, world, pTmpResult))
+	{
+		// 当たっていなければ無条件に返る
+		return false;
+	}
+
+	if (pRes)
 	{
-		const KdModelData::Node& dataNode = dataNodes[index];
-		const KdModelWork::Node& workNode = workNodes[index];
+		pRes->m_hitPos = result.m_hitPos;
 
-		// あり得ないはずだが一応チェック
-		if (!dataNode.m_spMesh) { continue; }
+		pRes->m_hitDir = result.m_hitDir;
 
-		CollisionMeshResult tmpResult;
-		CollisionMeshResult* pTmpResult = pRes ? &tmpResult : nullptr;
+		pRes->m_overlapDistance = result.m_overlapDistance;
+	}
 
-		// メッシュと球形の当たり判定実行
-		if (!MeshIntersect(*dataNode.m_spMesh, pushedSphere, workNode.m_worldTransform * world, pTmpResult))
-		{
-			continue;
-		}
+	return true;
+}
 
-		// 詳細リザルトが必要無ければ即結果を返す
-		if (!pRes) { return true; }
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 多角形ポリゴン(頂点の集合体)vsカプセルの移動判定
+// 判定回数は 移動範囲に掛かるポリゴンの個数 計算回数がポリゴンデータ依存のため処理効率は不安定
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdPolygonCollision::Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
 
-		isHit = true;
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
 
-		// 重なった分押し戻す
-		pushedSphereCenter = DirectX::XMVectorAdd(pushedSphereCenter, DirectX::XMVectorScale(tmpResult.m_hitDir, tmpResult.m_overlapDistance));
+	if (!PolygonsSweep(*m_shape, target.m_capsule, target.m_dir, target.m_range, world, pTmpResult)) { return false; }
 
-		DirectX::XMStoreFloat3(&pushedSphere.Center, pushedSphereCenter);
+	if (pRes)
+	{
+		pRes->m_hitPos = result.m_hitPos;
 
-		// とりあえず当たった座標で更新
-		hitPos = tmpResult.m_hitPos;
+		pRes->m_hitDir = result.m_hitDir;
+
+		pRes->m_overlapDistance = result.m_overlapDistance;
 	}
 
-	if (pRes && isHit)
-	{
-		// 最後に当たった座標が使用される
-		pRes->m_hitPos = hitPos;
+	return true;
+}
 
-		// 複数のメッシュに押された最終的な位置 - 移動前の位置 = 押し出しベクトル
-		pRes->m_hitDir = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&pushedSphere.Center), DirectX::XMLoadFloat3(&target.Center));
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 多角形ポリゴン(頂点の集合体)のワールド座標の境界ボックス
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdPolygonCollision::CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const
+{
+	if (!m_shape) { return false; }
 
-		pRes->m_overlapDistance = DirectX::XMVector3Length(pRes->m_hitDir).m128_f32[0];
+	const std::vector<KdPolygon::Vertex>& vertices = m_shape->GetVertices();
 
-		pRes->m_hitDir = DirectX::XMVector3Normalize(pRes->m_hitDir);
+	if (vertices.empty())
+	{
+		out.Center = world.Translation();
+		out.Extents = Math::Vector3::Zero;
+
+		return true;
 	}
 
-	return isHit;
+	DirectX::BoundingBox localBox;
+	DirectX::BoundingBox::CreateFromPoints(localBox, vertices.size(), &vertices[0].pos, sizeof(KdPolygon::Vertex));
+
+	localBox.Transform(out, world);
+
+	return true;
 }
 
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// HeightfieldCollision
+// ハイトフィールド(地形)の形状
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-// モデルvsBOX(AABB)の当たり判定
-// 判定回数は メッシュの個数 x 各メッシュのポリゴン数 計算回数がモデルのデータ依存のため処理効率は不安定
-// 単純に計算回数が多くなる可能性があるため重くなりがち
+// ハイトフィールドvs球の当たり判定
+// 判定回数は 球と重なるマスの数 x 2 地形の大きさに依存しないため処理効率は安定
+// 球をハイトフィールドのローカル空間へ変換して判定する
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdModelCollision::Intersects(const DirectX::BoundingBox& /*target*/, const Math::Matrix& /*world*/, KdCollider::CollisionResult* /*pRes*/)
+bool KdHeightfieldCollision::Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
 {
-	// TODO: 当たり計算は各自必要に応じて拡張して下さい
-	return false;
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
+
+	// ローカル空間の球の中心と、各軸の拡大率
+	Math::Vector3 localCenter = Math::Vector3::Transform(target.Center, world.Invert());
+	Math::Vector3 scale(world.Right().Length(), world.Up().Length(), world.Backward().Length());
+
+	Math::Vector3 localHitPos;
+
+	if (!m_shape->IntersectSphere(localCenter, scale, target.Radius, localHitPos)) { return false; }
+
+	// 詳細リザルトが必要無ければ即結果を返す
+	if (!pRes) { return true; }
+
+	pRes->m_hitPos = Math::Vector3::Transform(localHitPos, world);
+
+	// 押し出された位置 - 元の位置 = 押し出しベクトル
+	pRes->m_hitDir = Math::Vector3::Transform(localCenter, world) - Math::Vector3(target.Center);
+
+	pRes->m_overlapDistance = pRes->m_hitDir.Length();
+
+	pRes->m_hitDir.Normalize();
+
+	return true;
 }
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-// モデルvsBOX(OBB)の当たり判定
-// 判定回数は メッシュの個数 x 各メッシュのポリゴン数 計算回数がモデルのデータ依存のため処理効率は不安定
-// 単純に計算回数が多くなる可能性があるため重くなりがち
+// ハイトフィールドvsBOX(AABB)の当たり判定
+// 回転の無いOBBとして判定する
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdModelCollision::Intersects(const DirectX::BoundingOrientedBox& /*target*/, const Math::Matrix& /*world*/, KdCollider::CollisionResult* /*pRes*/)
+bool KdHeightfieldCollision::Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
 {
-	// TODO: 当たり計算は各自必要に応じて拡張して下さい
-	return false;
+	DirectX::BoundingOrientedBox targetBox;
+	DirectX::BoundingOrientedBox::CreateFromBoundingBox(targetBox, target);
+
+	return Intersects(targetBox, world, pRes);
 }
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-// モデルvsレイの当たり判定
-// 判定回数は メッシュの個数 x 各メッシュのポリゴン数 計算回数がモデルのデータ依存のため処理効率は不安定
-// 単純に計算回数が多くなる可能性があるため重くなりがち
+// ハイトフィールドvsBOX(OBB)の当たり判定
+// 判定回数は BOXの下にあるマスの数 x 2　地形の大きさに依存しないため処理効率は安定
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdModelCollision::Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes)
+bool KdHeightfieldCollision::Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
 {
 	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
 	if (!m_enable || !m_shape) { return false; }
 
-	std::shared_ptr<KdModelData> spModelData = m_shape->GetData();
+	CollisionMeshResult result;
+	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
 
-	// データが無ければ判定不能なので返る
-	if (!spModelData) { return false; }
+	if (!HeightfieldIntersect(*m_shape, target, world, pTmpResult)) { return false; }
 
-	CollisionMeshResult nearestResult;
+	// 詳細リザルトが必要無ければ即結果を返す
+	if (!pRes) { return true; }
 
-	bool isHit = false;
+	pRes->m_hitPos = result.m_hitPos;
 
-	const std::vector<KdModelData::Node>& dataNodes = spModelData->GetOriginalNodes();
-	const std::vector<KdModelWork::Node>& workNodes = m_shape->GetNodes();
+	pRes->m_hitDir = result.m_hitDir;
 
-	for (int index : spModelData->GetCollisionMeshNodeIndices())
-	{
-		const KdModelData::Node& dataNode = dataNodes[index];
-		const KdModelWork::Node& workNode = workNodes[index];
+	pRes->m_overlapDistance = result.m_overlapDistance;
 
-		if (!dataNode.m_spMesh) { continue; }
+	return true;
+}
 
-		CollisionMeshResult tmpResult;
-		CollisionMeshResult* pTmpResult = pRes ? &tmpResult : nullptr;
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ハイトフィールドvsレイの当たり判定
+// 判定回数は レイが通るマスの数 x 2 真下に向けたレイなら1マスだけなので接地判定はほぼ一定の軽さ
+// レイの始点と終点をハイトフィールドのローカル空間へ変換して判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdHeightfieldCollision::Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
 
-		if (!MeshIntersect(*dataNode.m_spMesh, target.m_pos, target.m_dir, target.m_range,
-			workNode.m_worldTransform * world, pTmpResult))
-		{
-			continue;
-		}
+	Math::Matrix invWorld = world.Invert();
 
-		// 詳細リザルトが必要無ければ即結果を返す
-		if (!pRes) { return true; }
+	Math::Vector3 localStart = Math::Vector3::Transform(target.m_pos, invWorld);
+	Math::Vector3 localEnd = Math::Vector3::Transform(target.m_pos + target.m_dir * target.m_range, invWorld);
 
-		isHit = true;
+	float hitRate = 0.0f;
 
-		if (tmpResult.m_overlapDistance > nearestResult.m_overlapDistance)
+	if (!m_shape->IntersectSegment(localStart, localEnd, hitRate)) { return false; }
+
+	// 詳細リザルトが必要無ければ即結果を返す
+	if (!pRes) { return true; }
+
+	// 線分上の割合 = レイの判定限界距離に対する割合
+	float hitDistance = target.m_range * hitRate;
+
+	pRes->m_hitPos = target.m_pos + target.m_dir * hitDistance;
+
+	pRes->m_hitDir = target.m_dir * (-1);
+
+	pRes->m_overlapDistance = target.m_range - hitDistance;
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ハイトフィールドvsカプセルの移動判定
+// 判定回数は 移動範囲に掛かるマスの数 x 2　地形の大きさに依存しないため処理効率は安定
+// 移動範囲を包む箱をローカル空間へ変換してマスを絞り込み、三角形はワールド空間へ戻してから判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdHeightfieldCollision::Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
+{
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
+
+	DirectX::BoundingBox sweptBox;
+	KdCalcCapsuleSweptBox(target.m_capsule, target.m_dir, target.m_range, sweptBox);
+
+	DirectX::BoundingBox localBox;
+	sweptBox.Transform(localBox, world.Invert());
+
+	bool isHit = false;
+
+	float nearestDist = target.m_range;
+	DirectX::XMVECTOR hitPos = {};
+	DirectX::XMVECTOR hitNormal = {};
+
+	m_shape->ForEachTriangle(localBox,
+		[&](const Math::Vector3& v0, const Math::Vector3& v1, const Math::Vector3& v2)
 		{
-			nearestResult = tmpResult;
-		}
-	}
+			isHit |= KdCapsuleSweepTriangle(target.m_capsule, target.m_dir,
+				DirectX::XMVector3TransformCoord(v0, world),
+				DirectX::XMVector3TransformCoord(v1, world),
+				DirectX::XMVector3TransformCoord(v2, world),
+				nearestDist, hitPos, hitNormal);
+
+			// CollisionResult無しなら結果は関係ないので当たった時点で終了
+			return pRes || !isHit;
+		});
 
 	if (pRes && isHit)
 	{
-		// 最も近くで当たったヒット情報をコピーする
-		pRes->m_hitPos = nearestResult.m_hitPos;
+		pRes->m_hitPos = hitPos;
 
-		pRes->m_hitDir = nearestResult.m_hitDir;
+		pRes->m_hitDir = hitNormal;
 
-		pRes->m_overlapDistance = nearestResult.m_overlapDistance;
+		pRes->m_overlapDistance = target.m_range - nearestDist;
 	}
 
 	return isHit;
 }
 
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ハイトフィールドのワールド座標の境界ボックス
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdHeightfieldCollision::CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const
+{
+	if (!m_shape) { return false; }
+
+	m_shape->GetBoundingBox().Transform(out, world);
+
+	return true;
+}
 
 // ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
-// PolygonCollision
-// 多角形ポリゴン(頂点の集合体)の形状
+// BakedMeshCollision
+// 焼き込んだ静的な形状
 // ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-// 多角形ポリゴン(頂点の集合体)vs球の当たり判定
-// 判定回数は ポリゴンの個数 計算回数がポリゴンデータ依存のため処理効率は不安定
-// 単純に計算回数が多くなる可能性があるため重くなりがち
+// 焼き込んだ形状vs球の当たり判定
+// 判定回数は 衝突タイプのグループ数 x 球の周囲のポリゴン数　配置したモデルの数に依存しない
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdPolygonCollision::Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes)
+bool KdBakedMeshCollision::Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& /*world*/, KdCollider::CollisionResult* pRes) const
 {
 	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
 	if (!m_enable || !m_shape) { return false; }
 
 	CollisionMeshResult result;
-	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
 
-	// メッシュと球形の当たり判定実行
-	if (!PolygonsIntersect(*m_shape, target, world, pTmpResult))
-	{
-		// 当たっていなければ無条件に返る
-		return false;
-	}
+	if (!m_shape->Intersects(GetType(), target, pRes ? &result : nullptr)) { return false; }
 
-	if (pRes)
-	{
-		pRes->m_hitPos = result.m_hitPos;
+	// 詳細リザルトが必要無ければ即結果を返す
+	if (!pRes) { return true; }
 
-		pRes->m_hitDir = result.m_hitDir;
+	pRes->m_hitPos = result.m_hitPos;
 
-		pRes->m_overlapDistance = result.m_overlapDistance;
-	}
+	pRes->m_hitDir = result.m_hitDir;
+
+	pRes->m_overlapDistance = result.m_overlapDistance;
 
 	return true;
 }
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-// 多角形ポリゴン(頂点の集合体)vsBOX(AABB)の当たり判定
-// 判定回数は ポリゴンの個数 計算回数がポリゴンデータ依存のため処理効率は不安定
-// 単純に計算回数が多くなる可能性があるため重くなりがち
+// 焼き込んだ形状vsBOX(AABB)の当たり判定
+// 回転の無いOBBとして判定する
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdPolygonCollision::Intersects(const DirectX::BoundingBox& /*target*/, const Math::Matrix& /*world*/, KdCollider::CollisionResult* /*pRes*/)
+bool KdBakedMeshCollision::Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const
 {
-	// TODO: 当たり計算は各自必要に応じて拡張して下さい
-	return false;
+	DirectX::BoundingOrientedBox targetBox;
+	DirectX::BoundingOrientedBox::CreateFromBoundingBox(targetBox, target);
+
+	return Intersects(targetBox, world, pRes);
 }
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-// 多角形ポリゴン(頂点の集合体)vsBOX(OBB)の当たり判定
-// 判定回数は ポリゴンの個数 計算回数がポリゴンデータ依存のため処理効率は不安定
-// 単純に計算回数が多くなる可能性があるため重くなりがち
+// 焼き込んだ形状vsBOX(OBB)の当たり判定
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdPolygonCollision::Intersects(const DirectX::BoundingOrientedBox& /*target*/, const Math::Matrix& /*world*/, KdCollider::CollisionResult* /*pRes*/)
+bool KdBakedMeshCollision::Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& /*world*/, KdCollider::CollisionResult* pRes) const
 {
-	// TODO: 当たり計算は各自必要に応じて拡張して下さい
-	return false;
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
+
+	CollisionMeshResult result;
+
+	if (!m_shape->Intersects(GetType(), target, pRes ? &result : nullptr)) { return false; }
+
+	// 詳細リザルトが必要無ければ即結果を返す
+	if (!pRes) { return true; }
+
+	pRes->m_hitPos = result.m_hitPos;
+
+	pRes->m_hitDir = result.m_hitDir;
+
+	pRes->m_overlapDistance = result.m_overlapDistance;
+
+	return true;
 }
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-// 多角形ポリゴン(頂点の集合体)vsレイの当たり判定
-// 判定回数は ポリゴンの個数 計算回数がポリゴンデータ依存のため処理効率は不安定
-// 単純に計算回数が多くなる可能性があるため重くなりがち
+// 焼き込んだ形状vsレイの当たり判定
+// ワールド空間のレイのままBVHを辿るので、レイの変換も逆行列も不要
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
-bool KdPolygonCollision::Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes)
+bool KdBakedMeshCollision::Intersects(const KdCollider::RayInfo& target, const Math::Matrix& /*world*/, KdCollider::CollisionResult* pRes) const
 {
 	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
 	if (!m_enable || !m_shape) { return false; }
 
 	CollisionMeshResult result;
-	CollisionMeshResult* pTmpResult = pRes ? &result : nullptr;
 
-	if (!PolygonsIntersect(*m_shape, target.m_pos, target.m_dir, target.m_range, world, pTmpResult))
-	{
-		// 当たっていなければ無条件に返る
-		return false;
-	}
+	if (!m_shape->Intersects(GetType(), target.m_pos, target.m_dir, target.m_range, pRes ? &result : nullptr)) { return false; }
 
-	if (pRes)
-	{
-		pRes->m_hitPos = result.m_hitPos;
+	// 詳細リザルトが必要無ければ即結果を返す
+	if (!pRes) { return true; }
 
-		pRes->m_hitDir = result.m_hitDir;
+	pRes->m_hitPos = result.m_hitPos;
 
-		pRes->m_overlapDistance = result.m_overlapDistance;
-	}
+	pRes->m_hitDir = result.m_hitDir;
+
+	pRes->m_overlapDistance = result.m_overlapDistance;
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 焼き込んだ形状vsカプセルの移動判定
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBakedMeshCollision::Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& /*world*/, KdCollider::CollisionResult* pRes) const
+{
+	// 当たり判定が無効 or 形状が解放済みなら判定せず返る
+	if (!m_enable || !m_shape) { return false; }
+
+	CollisionMeshResult result;
+
+	if (!m_shape->Sweep(GetType(), target.m_capsule, target.m_dir, target.m_range, pRes ? &result : nullptr)) { return false; }
+
+	// 詳細リザルトが必要無ければ即結果を返す
+	if (!pRes) { return true; }
+
+	pRes->m_hitPos = result.m_hitPos;
+
+	pRes->m_hitDir = result.m_hitDir;
+
+	pRes->m_overlapDistance = result.m_overlapDistance;
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 焼き込んだ形状のワールド座標の境界ボックス：既にワールド空間なので行列は使わない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBakedMeshCollision::CalcBoundingBox(const Math::Matrix& /*world*/, DirectX::BoundingBox& out) const
+{
+	if (!m_shape || m_shape->IsEmpty()) { return false; }
+
+	out = m_shape->GetBoundingBox();
 
 	return true;
 }
@@ -1,6 +1,16 @@
 ﻿#pragma once
 
 class KdCollisionShape;
+class KdSphereCollision;
+class KdBoxCollision;
+class KdCapsuleCollision;
+class KdModelCollision;
+class KdPolygonCollision;
+class KdHeightfieldCollision;
+class KdHeightfield;
+class KdBakedMeshCollision;
+class KdBakedMesh;
+class KdContactCache;
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // 当たり判定を内部で実行し判定結果を返してくれるクラス
@@ -45,6 +55,9 @@ public:
 		DirectX::BoundingSphere m_sphere;
 
 		UINT m_type = 0;
+
+		// 前回の判定の記録(省略可)：同じ判定を毎フレーム繰り返す場合に、判定する側が持つ記録を指定すると判定を省ける
+		KdContactCache* m_pCache = nullptr;
 	};
 
 	// BOX形の当たり判定情報：当たる側専用
@@ -128,6 +141,41 @@ public:
 		float m_range = 0;			// 判定限界距離
 
 		UINT m_type = 0;
+
+		// 前回の判定の記録(省略可)：同じ判定を毎フレーム繰り返す場合に、判定する側が持つ記録を指定すると判定を省ける
+		KdContactCache* m_pCache = nullptr;
+	};
+
+	// カプセル形の移動判定(スイープ)情報：当たる側専用
+	// カプセルをm_dir方向へm_rangeだけ動かした時に、最初に当たる位置を調べる
+	// 結果はレイと同じ形式：m_hitPos = 当たった座標　m_hitDir = 当たった面の法線(押し返す方向)　m_overlapDistance = m_range - 当たるまでの移動距離
+	// 移動前から重なっている場合は m_overlapDistance が m_range を超える(超えた分がめり込み量)
+	// m_rangeが0なら移動せずに重なっているかどうかだけを調べる
+	struct CapsuleSweepInfo
+	{
+		CapsuleSweepInfo() {}
+
+		// 移動の情報を全て指定：自動的に方向ベクトルは正規化
+		CapsuleSweepInfo(UINT type, const KdCapsule& capsule, const Math::Vector3& dir, float range)
+			: m_type(type), m_capsule(capsule), m_dir(dir), m_range(range)
+		{
+			m_dir.Normalize();
+		}
+
+		// 移動量から移動の情報を作成：自動的に方向ベクトルは正規化
+		CapsuleSweepInfo(UINT type, const KdCapsule& capsule, const Math::Vector3& move)
+			: m_type(type), m_capsule(capsule)
+		{
+			m_dir = move;
+			m_range = m_dir.Length();
+			m_dir.Normalize();
+		}
+
+		KdCapsule		m_capsule;	// 移動前のカプセル(ワールド座標)
+		Math::Vector3	m_dir;		// 移動方向
+		float			m_range = 0;// 移動距離
+
+		UINT m_type = 0;
 	};
 
 
@@ -139,35 +187,129 @@ public:
 		float m_overlapDistance = 0.0f; // 重なり量
 	};
 
-	KdCollider() {}
-	
-	~KdCollider() {}
-
-	// 当たり判定形状形状登録
-	void RegisterCollisionShape(std::string_view name, std::unique_ptr<KdCollisionShape> spShape);
-	void RegisterCollisionShape(std::string_view name, const DirectX::BoundingSphere& sphere, UINT type);
-	void RegisterCollisionShape(std::string_view name, const DirectX::BoundingBox& box, UINT type);
-	void RegisterCollisionShape(std::string_view name, const DirectX::BoundingOrientedBox& box, UINT type);
-	void RegisterCollisionShape(std::string_view name, const Math::Vector3& localPos, float radius, UINT type);
-	void RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdModelData>& model, UINT type);
-	void RegisterCollisionShape(std::string_view name, KdModelData* model, UINT type);
-	void RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdModelWork>& model, UINT type);
-	void RegisterCollisionShape(std::string_view name, KdModelWork* model, UINT type);
-	void RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdPolygon> polygon, UINT type);
-	void RegisterCollisionShape(std::string_view name, KdPolygon* polygon, UINT type);
+	// 登録した形状を指すハンドル：名前で検索せずに有効/無効の切り替えなどができる
+	using ShapeHandle = UINT;
+	static constexpr ShapeHandle kInvalidShape = UINT_MAX;
+
+	KdCollider();
+	~KdCollider();
+
+	// 当たり判定形状形状登録：同じ名前の形状が登録済みの場合は登録せずkInvalidShapeを返す
+	ShapeHandle RegisterCollisionShape(std::string_view name, std::unique_ptr<KdCollisionShape> spShape);
+	ShapeHandle RegisterCollisionShape(std::string_view name, const DirectX::BoundingSphere& sphere, UINT type);
+	ShapeHandle RegisterCollisionShape(std::string_view name, const DirectX::BoundingBox& box, UINT type);
+	ShapeHandle RegisterCollisionShape(std::string_view name, const DirectX::BoundingOrientedBox& box, UINT type);
+	ShapeHandle RegisterCollisionShape(std::string_view name, const Math::Vector3& localPos, float radius, UINT type);
+	ShapeHandle RegisterCollisionShape(std::string_view name, const KdCapsule& capsule, UINT type);
+	ShapeHandle RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdModelData>& model, UINT type);
+	ShapeHandle RegisterCollisionShape(std::string_view name, KdModelData* model, UINT type);
+	ShapeHandle RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdModelWork>& model, UINT type);
+	ShapeHandle RegisterCollisionShape(std::string_view name, KdModelWork* model, UINT type);
+	ShapeHandle RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdPolygon> polygon, UINT type);
+	ShapeHandle RegisterCollisionShape(std::string_view name, KdPolygon* polygon, UINT type);
+	ShapeHandle RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdHeightfield>& heightfield, UINT type);
+	ShapeHandle RegisterCollisionShape(std::string_view name, const std::shared_ptr<KdBakedMesh>& bakedMesh, UINT type);
 
 	// 当たり判定実行
 	bool Intersects(const SphereInfo& targetShape, const Math::Matrix& ownerMatrix, std::list<KdCollider::CollisionResult>* pResults) const;
 	bool Intersects(const BoxInfo& targetBox, const Math::Matrix& ownerMatrix, std::list<KdCollider::CollisionResult>* pResults) const;
 	bool Intersects(const RayInfo& targetShape, const Math::Matrix& ownerMatrix, std::list<KdCollider::CollisionResult>* pResults) const;
+	bool Intersects(const CapsuleSweepInfo& targetSweep, const Math::Matrix& ownerMatrix, std::list<KdCollider::CollisionResult>* pResults) const;
+
+	// 当たり判定実行(結果を呼び出し側の配列へ書き込む)：戻り値は書き込んだ結果の数
+	// 配列が一杯になった時点で判定を終了する　メモリの確保が発生しないので毎フレーム大量に判定する場合に使う
+	UINT Intersects(const SphereInfo& targetShape, const Math::Matrix& ownerMatrix, std::span<KdCollider::CollisionResult> results) const;
+	UINT Intersects(const BoxInfo& targetBox, const Math::Matrix& ownerMatrix, std::span<KdCollider::CollisionResult> results) const;
+	UINT Intersects(const RayInfo& targetShape, const Math::Matrix& ownerMatrix, std::span<KdCollider::CollisionResult> results) const;
+	UINT Intersects(const CapsuleSweepInfo& targetSweep, const Math::Matrix& ownerMatrix, std::span<KdCollider::CollisionResult> results) const;
+
+	// 当たり判定実行(結果を1つずつ受け取る)
+	// ・needDetail	… falseなら詳細な結果を求めず、最初に当たった時点で終了する(onHitは呼ばれない)
+	// ・onHit		… bool(const CollisionResult&)：falseを返すと終了
+	template<class Info, class Func>
+	bool IntersectsEach(const Info& target, const Math::Matrix& ownerMatrix, bool needDetail, Func onHit) const;
 
 	// 登録した当たり判定の有効/無効の設定
 	void SetEnable(std::string_view name, bool flag);
 	void SetEnable(int type, bool flag);
 	void SetEnableAll(bool flag);
+	void SetShapeEnable(ShapeHandle handle, bool flag);
+
+	// 名前からハンドルを検索：見つからなければkInvalidShape
+	ShapeHandle FindShape(std::string_view name) const;
+	// ハンドルから形状を取得：形状を追加登録すると無効になるので保持しないこと
+	KdCollisionShape* GetShape(ShapeHandle handle);
+
+	// 無効にしている衝突タイプ
+	UINT GetDisableType() const { return m_disableType; }
+
+	// 登録した全形状の衝突タイプを合わせたもの
+	UINT GetCollisionTypes() const;
+
+	// 登録した全形状を包むワールド座標の境界ボックス：範囲を求められない形状がある場合はfalse
+	bool CalcBoundingBox(const Math::Matrix& ownerMatrix, DirectX::BoundingBox& out) const;
 
 private:
-	std::unordered_map<std::string, std::unique_ptr<KdCollisionShape>> m_collisionShapes;
+
+	// 形状の種類：種類毎に別の配列へ連続して格納する
+	enum ShapeKind
+	{
+		KindSphere,
+		KindBox,
+		KindCapsule,
+		KindModel,
+		KindPolygon,
+		KindHeightfield,
+		KindBakedMesh,
+		KindCustom,		// 独自の派生クラス
+	};
+
+	// ハンドル = 上位8bitが種類・下位24bitが配列の番号
+	static ShapeHandle MakeHandle(ShapeKind kind, size_t index) { return (static_cast<UINT>(kind) << 24) | static_cast<UINT>(index); }
+
+	// 名前の登録：登録済みならfalse
+	bool RegisterName(std::string_view name, ShapeHandle handle);
+
+	// 全ての形状を辿る：onShapeがfalseを返すと終了
+	template<class Func>
+	void ForEachShape(Func onShape) const;
+
+	// 判定対象の種類毎の判定
+	static bool IsValidTarget(const SphereInfo&) { return true; }
+	static bool IsValidTarget(const BoxInfo&) { return true; }
+	static bool IsValidTarget(const RayInfo& target);
+	static bool IsValidTarget(const CapsuleSweepInfo& target);
+
+	static bool IntersectShape(const KdCollisionShape& shape, const SphereInfo& target, const Math::Matrix& ownerMatrix, CollisionResult* pRes);
+	static bool IntersectShape(const KdCollisionShape& shape, const BoxInfo& target, const Math::Matrix& ownerMatrix, CollisionResult* pRes);
+	static bool IntersectShape(const KdCollisionShape& shape, const RayInfo& target, const Math::Matrix& ownerMatrix, CollisionResult* pRes);
+	static bool IntersectShape(const KdCollisionShape& shape, const CapsuleSweepInfo& target, const Math::Matrix& ownerMatrix, CollisionResult* pRes);
+
+	// 計測用の判定の種類
+	static KdCollisionStats::QueryKind GetStatKind(const SphereInfo&) { return KdCollisionStats::QuerySphere; }
+	static KdCollisionStats::QueryKind GetStatKind(const BoxInfo&) { return KdCollisionStats::QueryBox; }
+	static KdCollisionStats::QueryKind GetStatKind(const RayInfo&) { return KdCollisionStats::QueryRay; }
+	static KdCollisionStats::QueryKind GetStatKind(const CapsuleSweepInfo&) { return KdCollisionStats::QuerySweep; }
+
+	// 文字列の検索でstd::stringを作らずに済むようにする
+	struct NameHash
+	{
+		using is_transparent = void;
+
+		size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+	};
+
+	std::vector<KdSphereCollision>					m_sphereShapes;
+	std::vector<KdBoxCollision>						m_boxShapes;
+	std::vector<KdCapsuleCollision>					m_capsuleShapes;
+	std::vector<KdModelCollision>					m_modelShapes;
+	std::vector<KdPolygonCollision>					m_polygonShapes;
+	std::vector<KdHeightfieldCollision>				m_heightfieldShapes;
+	std::vector<KdBakedMeshCollision>				m_bakedMeshShapes;
+	std::vector<std::unique_ptr<KdCollisionShape>>	m_customShapes;
+
+	// 名前 → ハンドル
+	std::unordered_map<std::string, ShapeHandle, NameHash, std::equal_to<>>	m_shapeHandles;
 
 	int m_disableType = 0;
 };
@@ -188,10 +330,17 @@ public:
 
 	UINT GetType() const { return m_type; }
 
-	virtual bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) = 0;
-	virtual bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) = 0;
-	virtual bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) = 0;
-	virtual bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) = 0;
+	virtual bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const = 0;
+	// 前回の判定の記録を使う球の判定：記録に対応していない形状は通常の判定を行う
+	virtual bool Intersects(const KdCollider::SphereInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const { return Intersects(target.m_sphere, world, pRes); }
+	virtual bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const = 0;
+	virtual bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const = 0;
+	virtual bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const = 0;
+	// カプセルの移動判定：対応していない形状は常にfalseを返す
+	virtual bool Intersects(const KdCollider::CapsuleSweepInfo& /*target*/, const Math::Matrix& /*world*/, KdCollider::CollisionResult* /*pRes*/) const { return false; }
+
+	// ワールド座標の境界ボックス：範囲を求められない形状はfalseを返す
+	virtual bool CalcBoundingBox(const Math::Matrix& /*world*/, DirectX::BoundingBox& /*out*/) const { return false; }
 
 	void SetEnable(bool flag) { m_enable = flag; }
 
@@ -217,10 +366,13 @@ public:
 
 	virtual ~KdSphereCollision() {}
 
-	bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
-	bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
-	bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
-	bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
+	bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+
+	bool CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const override;
 
 private:
 	DirectX::BoundingSphere m_shape;
@@ -234,12 +386,12 @@ class KdBoxCollision : public KdCollisionShape
 {
 public:
 	KdBoxCollision(const DirectX::BoundingBox& box, UINT type) :
-		KdCollisionShape(type), m_Abox(box) {}
+		KdCollisionShape(type), m_Abox(box), m_isOriented(false) {}
 	KdBoxCollision(const DirectX::BoundingOrientedBox& box, UINT type) :
-		KdCollisionShape(type), m_Obox(box) {}
+		KdCollisionShape(type), m_Obox(box), m_isOriented(true) {}
 
 	KdBoxCollision(UINT type, const Math::Matrix& matrix, const Math::Vector3& offset, const Math::Vector3& size, const bool isOriented) :
-		KdCollisionShape(type) {
+		KdCollisionShape(type), m_isOriented(isOriented) {
 		if (!isOriented)
 		{
 			m_Abox.Center	= matrix.Translation() + offset;
@@ -256,14 +408,46 @@ public:
 
 	virtual ~KdBoxCollision() {}
 
-	bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
-	bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
-	bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
-	bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
+	bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+
+	bool CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const override;
 
 private:
+	// ワールド座標のOBB：回転を考慮しないBOXも判定用にOBBへ変換する
+	void CalcWorldBox(const Math::Matrix& world, DirectX::BoundingOrientedBox& out) const;
+
 	DirectX::BoundingBox			m_Abox;
 	DirectX::BoundingOrientedBox	m_Obox;
+
+	bool							m_isOriented = false;	// 回転を考慮するBOXか
+};
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// コライダー：カプセル形状
+// カプセル形状vs特定形状（球・BOX・レイ・カプセルの移動）の当たり判定実行クラス
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdCapsuleCollision : public KdCollisionShape
+{
+public:
+	KdCapsuleCollision(const KdCapsule& capsule, UINT type) :
+		KdCollisionShape(type), m_shape(capsule) {}
+
+	virtual ~KdCapsuleCollision() {}
+
+	bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+
+	bool CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const override;
+
+private:
+	KdCapsule m_shape;
 };
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
@@ -280,12 +464,26 @@ public:
 
 	virtual ~KdModelCollision() { m_shape.reset(); }
 
-	bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
-	bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
-	bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
-	bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
+	bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::SphereInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+
+	bool CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const override;
 
 private:
+	// 球の判定本体：pCacheがあればメッシュ毎の前回の記録を使う
+	bool IntersectSphere(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes, KdContactCache* pCache) const;
+
+	// メッシュ毎の前回の記録：スキンメッシュは姿勢が変わると使えない
+	KdMeshQueryCache* AcquireQueryCache(KdContactCache* pCache, int nodeIdx, const KdMesh* pMesh, const Math::Matrix& meshWorld) const;
+
+	// 判定に使うメッシュとワールド行列：スキンメッシュはqueryBox(ワールド座標)に掛かる場合だけ現在の姿勢に変形したもの
+	// 判定しなくてよい場合はnullptr
+	const KdMesh* GetCollisionMesh(int nodeIdx, const Math::Matrix& world, const DirectX::BoundingBox& queryBox, Math::Matrix& meshWorld) const;
+
 	std::shared_ptr<KdModelWork> m_shape;
 };
 
@@ -302,11 +500,123 @@ public:
 
 	virtual ~KdPolygonCollision() { m_shape.reset(); }
 
-	bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
-	bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
-	bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
-	bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) override;
+	bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+
+	bool CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const override;
 
 private:
 	std::shared_ptr<KdPolygon> m_shape;
 };
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// コライダー：ハイトフィールド(地形)形状
+// ハイトフィールド形状vs特定形状（球・BOX・レイ・カプセルの移動）の当たり判定実行クラス
+// 判定する位置のマスだけを調べるので、地形が広くても判定の重さはほぼ変わらない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdHeightfieldCollision : public KdCollisionShape
+{
+public:
+	KdHeightfieldCollision(const std::shared_ptr<KdHeightfield>& heightfield, UINT type) :
+		KdCollisionShape(type), m_shape(heightfield) {}
+
+	virtual ~KdHeightfieldCollision() { m_shape.reset(); }
+
+	bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+
+	bool CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const override;
+
+private:
+	std::shared_ptr<KdHeightfield> m_shape;
+};
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// コライダー：焼き込んだ静的な形状
+// 焼き込んだ形状vs特定形状（球・BOX・レイ・カプセルの移動）の当たり判定実行クラス
+// 形状は焼き込んだ時点でワールド空間にあるので、持ち主の行列は使わない
+// 登録時の衝突タイプと重なるグループだけを判定する：タイプ毎に判定を分けたい場合は別々に登録する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdBakedMeshCollision : public KdCollisionShape
+{
+public:
+	KdBakedMeshCollision(const std::shared_ptr<KdBakedMesh>& bakedMesh, UINT type) :
+		KdCollisionShape(type), m_shape(bakedMesh) {}
+
+	virtual ~KdBakedMeshCollision() { m_shape.reset(); }
+
+	bool Intersects(const DirectX::BoundingSphere& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const DirectX::BoundingOrientedBox& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::RayInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+	bool Intersects(const KdCollider::CapsuleSweepInfo& target, const Math::Matrix& world, KdCollider::CollisionResult* pRes) const override;
+
+	bool CalcBoundingBox(const Math::Matrix& world, DirectX::BoundingBox& out) const override;
+
+private:
+	std::shared_ptr<KdBakedMesh> m_shape;
+};
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 全ての形状を辿る：種類毎の配列を順番に辿る
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Func>
+void KdCollider::ForEachShape(Func onShape) const
+{
+	for (const KdSphereCollision& shape : m_sphereShapes) { if (!onShape(shape)) { return; } }
+	for (const KdBoxCollision& shape : m_boxShapes) { if (!onShape(shape)) { return; } }
+	for (const KdCapsuleCollision& shape : m_capsuleShapes) { if (!onShape(shape)) { return; } }
+	for (const KdModelCollision& shape : m_modelShapes) { if (!onShape(shape)) { return; } }
+	for (const KdPolygonCollision& shape : m_polygonShapes) { if (!onShape(shape)) { return; } }
+	for (const KdHeightfieldCollision& shape : m_heightfieldShapes) { if (!onShape(shape)) { return; } }
+	for (const KdBakedMeshCollision& shape : m_bakedMeshShapes) { if (!onShape(shape)) { return; } }
+	for (const std::unique_ptr<KdCollisionShape>& spShape : m_customShapes) { if (!onShape(*spShape)) { return; } }
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 当たり判定実行(結果を1つずつ受け取る)
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 結果はスタック上に作って渡すので、呼び出し側が保存先を用意すればメモリの確保は発生しない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Info, class Func>
+bool KdCollider::IntersectsEach(const Info& target, const Math::Matrix& ownerMatrix, bool needDetail, Func onHit) const
+{
+	// 当たり判定無効のタイプの場合は返る
+	if (target.m_type & m_disableType) { return false; }
+
+	if (!IsValidTarget(target)) { return false; }
+
+	KD_COLLISION_STAT_QUERY(GetStatKind(target), target.m_type);
+
+	bool isHit = false;
+
+	ForEachShape(
+		[&](const KdCollisionShape& shape)
+		{
+			// 用途が一致していない当たり判定形状はスキップ
+			if (!(target.m_type & shape.GetType())) { return true; }
+
+			KD_COLLISION_STAT_ADD(m_shapeTests, 1);
+
+			KdCollider::CollisionResult result;
+
+			if (!IntersectShape(shape, target, ownerMatrix, needDetail ? &result : nullptr)) { return true; }
+
+			KD_COLLISION_STAT_ADD(m_hitCount, 1);
+
+			isHit = true;
+
+			// 詳細な衝突結果を必要としない場合は1つでも接触したら終了
+			if (!needDetail) { return false; }
+
+			return static_cast<bool>(onHit(result));
+		});
+
+	return isHit;
+}
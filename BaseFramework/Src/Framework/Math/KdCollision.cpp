@@ -74,33 +74,35 @@ bool PolygonsIntersect(const KdPolygon& poly, const DirectX::XMVECTOR& rayPos, c
 
 	// ヒット判定
 	bool isHit = false;
-	float closestDist = FLT_MAX;
+	float closestDist = rayRangeInv;
 
-	// 頂点リスト取得
-	std::vector<Math::Vector3> positions;
-	poly.GetPositions(positions);
-	size_t faceNum = positions.size() - 2;
+	// 頂点リストはコピーせずに直接参照する
+	const std::vector<KdPolygon::Vertex>& vertices = poly.GetVertices();
+	if (vertices.size() < 3) { return false; }
 
-	// 全ての面(三角形)
-	for (UINT faceIdx = 0; faceIdx < faceNum; ++faceIdx)
+	// SIMDでまとめて判定するために成分毎に並べる
+	// 作業領域はスレッド毎に使い回す：複数スレッドから同時に判定しても確保が発生しない
+	static thread_local KdTriangleSoA triangles;
+	triangles.BuildFromStrip(&vertices[0].pos, static_cast<UINT>(vertices.size()), sizeof(KdPolygon::Vertex));
+	UINT faceNum = triangles.GetCount();
+
+	Math::Vector3 localRayPos, localRayDir;
+	DirectX::XMStoreFloat3(&localRayPos, rayPosInv);
+	DirectX::XMStoreFloat3(&localRayDir, rayDirInv);
+
+	// 全ての面(三角形)：kLaneNum個ずつ判定し、レイの判定範囲内で最も近いヒットを残す
+	for (UINT faceIdx = 0; faceIdx < faceNum; faceIdx += KdTriangleSoA::kLaneNum)
 	{
-		// レイと三角形の判定
-		float hitDist = FLT_MAX;
-		if (!DirectX::TriangleTests::Intersects(rayPosInv, rayDirInv,
-			positions[faceIdx], positions[faceIdx + 1], positions[faceIdx + 2],
-			hitDist))
-		{
-			continue;
-		}
+		UINT count = std::min(KdTriangleSoA::kLaneNum, faceNum - faceIdx);
 
-		// レイの判定範囲外なら無視
-		if (hitDist > rayRangeInv) { continue; }
+		float hitDist = FLT_MAX;
+		if (KdRayTrianglesNearest(triangles, faceIdx, count, localRayPos, localRayDir, closestDist, hitDist) < 0) { continue; }
 
 		// CollisionResult無しなら結果は関係ないので当たった時点で返る
-		if (!pResult) { return isHit; }
+		if (!pResult) { return true; }
 
 		// 最短距離の更新判定処理
-		closestDist = std::min(hitDist, closestDist);
+		closestDist = hitDist;
 
 		isHit = true;
 	}
@@ -115,10 +117,22 @@ bool PolygonsIntersect(const KdPolygon& poly, const DirectX::XMVECTOR& rayPos, c
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // レイ対メッシュの当たり判定本体
+// pCacheを渡すと前回当たった面を先に判定し、BVHはそれより手前の箱だけを辿る
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 bool MeshIntersect(const KdMesh& mesh, const DirectX::XMVECTOR& rayPos, const DirectX::XMVECTOR& rayDir,
 	float rayRange, const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult)
 {
+	return MeshIntersect(KdMeshShapeView(mesh), rayPos, rayDir, rayRange, matrix, pResult);
+}
+
+bool MeshIntersect(const KdMeshShapeView& mesh, const DirectX::XMVECTOR& rayPos, const DirectX::XMVECTOR& rayDir,
+	float rayRange, const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult, KdMeshQueryCache* pCache)
+{
+	// 当たり判定用の形状を保持していないメッシュは判定できない
+	if (mesh.m_faces.empty()) { return false; }
+
+	KD_COLLISION_STAT_ADD(m_meshTests, 1);
+
 	//--------------------------------------------------------
 	// ブロードフェイズ
 	// 　比較的軽量なAABB vs レイな判定で、
@@ -128,12 +142,14 @@ bool MeshIntersect(const KdMesh& mesh, const DirectX::XMVECTOR& rayPos, const Di
 		// AABB vs レイ
 		float AABBdist = FLT_MAX;
 		DirectX::BoundingBox aabb;
-		mesh.GetBoundingBox().Transform(aabb, matrix);
+		mesh.m_aabb.Transform(aabb, matrix);
 
-		if (aabb.Intersects(rayPos, rayDir, AABBdist) == false) { return false; }
-
-		// 最大距離外なら範囲外なので中止
-		if (AABBdist > rayRange) { return false; }
+		if (aabb.Intersects(rayPos, rayDir, AABBdist) == false || AABBdist > rayRange)
+		{
+			// 最大距離外なら範囲外なので中止
+			KD_COLLISION_STAT_ADD(m_aabbRejects, 1);
+			return false;
+		}
 	}
 
 	//--------------------------------------------------------
@@ -156,35 +172,79 @@ bool MeshIntersect(const KdMesh& mesh, const DirectX::XMVECTOR& rayPos, const Di
 	float closestDist = FLT_MAX;
 
 	// DEBUGビルドでも速度を維持するため、別変数に拾っておく
-	const KdMeshFace* pFaces = &mesh.GetFaces()[0];
-	auto& vertices = mesh.GetVertexPositions();
-	UINT faceNum = mesh.GetFaces().size();
+	const KdMeshFace* pFaces = mesh.m_faces.data();
+	const auto& vertices = mesh.m_positions;
+	UINT faceNum = mesh.m_faces.size();
 
-	// 全ての面(三角形)
-	for (UINT faceIdx = 0; faceIdx < faceNum; ++faceIdx)
+	// BVHがあればレイが通過する箱の中の面だけを近い順に判定する
+	if (const KdMeshBVH* pBVH = mesh.m_pBVH)
 	{
-		// 三角形を構成する３つの頂点のIndex
-		const UINT* idx = pFaces[faceIdx].Idx;
+		Math::Vector3 localRayPos, localRayDir;
+		DirectX::XMStoreFloat3(&localRayPos, rayPosInv);
+		DirectX::XMStoreFloat3(&localRayDir, rayDirInv);
 
-		// レイと三角形の判定
-		float hitDist = FLT_MAX;
-		if (!DirectX::TriangleTests::Intersects(rayPosInv, rayDirInv,
-			vertices[idx[0]], vertices[idx[1]], vertices[idx[2]],
-			hitDist))
+		float maxDist = rayRangeInv;
+
+		// 前回当たった面を先に判定して判定距離を縮めておく：それより手前に面がある箱だけを辿ればよい
+		bool isCacheHit = false;
+
+		if (pCache && pCache->m_rayFace < faceNum)
 		{
-			continue;
+			const UINT* idx = pFaces[pCache->m_rayFace].Idx;
+
+			KD_COLLISION_STAT_ADD(m_triangleTests, 1);
+
+			float hitDist = FLT_MAX;
+			isCacheHit = DirectX::TriangleTests::Intersects(rayPosInv, rayDirInv,
+				vertices[idx[0]], vertices[idx[1]], vertices[idx[2]], hitDist) && hitDist <= maxDist;
+
+			if (isCacheHit) { maxDist = hitDist; }
+
+			++(isCacheHit ? pCache->m_hitCount : pCache->m_missCount);
+
+			// CollisionResult無しなら結果は関係ないので当たった時点で返る
+			if (isCacheHit && !pResult) { return true; }
 		}
 
-		// レイの判定範囲外なら無視
-		if (hitDist > rayRangeInv) { continue; }
-	
-		// CollisionResult無しなら結果は関係ないので当たった時点で返る
-		if (!pResult) { return isHit; }
+		UINT hitFace = pCache ? pCache->m_rayFace : UINT_MAX;
 
-		// 最短距離の更新判定処理
-		closestDist = std::min(hitDist, closestDist);
+		// CollisionResult無しなら結果は関係ないので当たった時点で終了
+		isHit = pBVH->IntersectRay(localRayPos, localRayDir, maxDist, pResult == nullptr, pCache ? &hitFace : nullptr) || isCacheHit;
 
-		isHit = true;
+		if (pCache && isHit) { pCache->m_rayFace = hitFace; }
+
+		closestDist = maxDist;
+	}
+	else
+	{
+		// 全ての面(三角形)
+		for (UINT faceIdx = 0; faceIdx < faceNum; ++faceIdx)
+		{
+			KD_COLLISION_STAT_ADD(m_triangleTests, 1);
+
+			// 三角形を構成する３つの頂点のIndex
+			const UINT* idx = pFaces[faceIdx].Idx;
+
+			// レイと三角形の判定
+			float hitDist = FLT_MAX;
+			if (!DirectX::TriangleTests::Intersects(rayPosInv, rayDirInv,
+				vertices[idx[0]], vertices[idx[1]], vertices[idx[2]],
+				hitDist))
+			{
+				continue;
+			}
+
+			// レイの判定範囲外なら無視
+			if (hitDist > rayRangeInv) { continue; }
+
+			// CollisionResult無しなら結果は関係ないので当たった時点で返る
+			if (!pResult) { return true; }
+
+			// 最短距離の更新判定処理
+			closestDist = std::min(hitDist, closestDist);
+
+			isHit = true;
+		}
 	}
 
 	if (pResult && isHit)
@@ -259,6 +319,9 @@ static bool HitCheckAndPosUpdate(DirectX::XMVECTOR& finalPos, DirectX::XMVECTOR&
 	return true;
 }
 
+// 球の判定の記録で候補の面を集める範囲の倍率：広いほど記録を使い回せるが、判定する面が増える
+static constexpr float kQueryCacheMargin = 1.5f;
+
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // スフィアとの当たり判定結果をリザルトにセットする
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
@@ -287,10 +350,15 @@ bool PolygonsIntersect(const KdPolygon& poly, const DirectX::BoundingSphere& sph
 	// １つでもヒットしたらtrue
 	bool isHit = false;
 
-	// 頂点リスト取得
-	std::vector<Math::Vector3> positions;
-	poly.GetPositions(positions);
-	size_t faceNum = positions.size() - 2;
+	// 頂点リストはコピーせずに直接参照する
+	const std::vector<KdPolygon::Vertex>& vertices = poly.GetVertices();
+	if (vertices.size() < 3) { return false; }
+
+	// SIMDでまとめて判定するために成分毎に並べる
+	// 作業領域はスレッド毎に使い回す：複数スレッドから同時に判定しても確保が発生しない
+	static thread_local KdTriangleSoA triangles;
+	triangles.BuildFromStrip(&vertices[0].pos, static_cast<UINT>(vertices.size()), sizeof(KdPolygon::Vertex));
+	UINT faceNum = triangles.GetCount();
 
 	DirectX::XMVECTOR finalHitPos = {};	// 当たった座標の中でも最後の座標
 	DirectX::XMVECTOR finalPos = {};	// 各面に押されて最終的に到達する座標：判定する球の中心
@@ -298,17 +366,41 @@ bool PolygonsIntersect(const KdPolygon& poly, const DirectX::BoundingSphere& sph
 	float radiusSqr = 0.0f;
 	InvertSphereInfo(finalPos, objScale, radiusSqr, matrix, sphere);
 
+	// 絞り込み用の半径：計算順の違いによる誤差で当たる面を取りこぼさないように僅かに広げる
+	float filterRadiusSqr = radiusSqr * 1.001f + FLT_MIN;
+
 	// 全ての面と判定
 	// ※判定はポリゴンのローカル空間で行われる
-	for (UINT faceIndx = 0; faceIndx < faceNum; faceIndx++)
+	// 現在の球の位置でkLaneNum個まとめて絞り込み、当たる可能性のある最初の面から通常の判定で押し出す
+	// 押し出すと球の位置が変わるので、その次の面から絞り込み直す
+	UINT faceIndx = 0;
+	while (faceIndx < faceNum)
 	{
+		UINT count = std::min(KdTriangleSoA::kLaneNum, faceNum - faceIndx);
+
+		Math::Vector3 center, scale;
+		DirectX::XMStoreFloat3(&center, finalPos);
+		DirectX::XMStoreFloat3(&scale, objScale);
+
+		UINT mask = KdSphereTrianglesOverlapMask(triangles, faceIndx, count, center, scale, filterRadiusSqr);
+
+		if (!mask)
+		{
+			faceIndx += count;
+			continue;
+		}
+
+		unsigned long lane = 0;
+		_BitScanForward(&lane, mask);
+		faceIndx += lane;
+
 		DirectX::XMVECTOR nearPoint;
 
 		// 点 と 三角形 の最近接点を求める
 		KdPointToTriangle(finalPos,
-			positions[faceIndx],
-			positions[faceIndx + 1],
-			positions[faceIndx + 2],
+			vertices[faceIndx].pos,
+			vertices[faceIndx + 1].pos,
+			vertices[faceIndx + 2].pos,
 			nearPoint);
 
 		// 当たっているかどうかの判定と最終座標の更新
@@ -316,6 +408,8 @@ bool PolygonsIntersect(const KdPolygon& poly, const DirectX::BoundingSphere& sph
 
 		// CollisionResult無しなら結果は関係ないので当たった時点で返る
 		if (!pResult && isHit) { return isHit; }
+
+		++faceIndx;
 	}
 
 	// リザルトに結果を格納
@@ -330,10 +424,22 @@ bool PolygonsIntersect(const KdPolygon& poly, const DirectX::BoundingSphere& sph
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // スフィア対メッシュの当たり判定本体
+// pCacheを渡すと候補の面を広めに集めて記録し、球がその範囲に収まっている間はBVHを辿らない
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 bool MeshIntersect(const KdMesh& mesh, const DirectX::BoundingSphere& sphere,
 	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult)
 {
+	return MeshIntersect(KdMeshShapeView(mesh), sphere, matrix, pResult);
+}
+
+bool MeshIntersect(const KdMeshShapeView& mesh, const DirectX::BoundingSphere& sphere,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult, KdMeshQueryCache* pCache)
+{
+	// 当たり判定用の形状を保持していないメッシュは判定できない
+	if (mesh.m_faces.empty()) { return false; }
+
+	KD_COLLISION_STAT_ADD(m_meshTests, 1);
+
 	//------------------------------------------
 	// ブロードフェイズ
 	// 　高速化のため、まずは境界ボックス(AABB)で判定
@@ -342,9 +448,13 @@ bool MeshIntersect(const KdMesh& mesh, const DirectX::BoundingSphere& sphere,
 	{
 		// メッシュのAABBを元に、行列で変換したAABBを作成
 		DirectX::BoundingBox aabb;
-		mesh.GetBoundingBox().Transform(aabb, matrix);
+		mesh.m_aabb.Transform(aabb, matrix);
 
-		if (aabb.Intersects(sphere) == false) { return false; }
+		if (aabb.Intersects(sphere) == false)
+		{
+			KD_COLLISION_STAT_ADD(m_aabbRejects, 1);
+			return false;
+		}
 	}
 
 	//------------------------------------------
@@ -356,9 +466,9 @@ bool MeshIntersect(const KdMesh& mesh, const DirectX::BoundingSphere& sphere,
 	bool isHit = false;
 
 	// DEBUGビルドでも速度を維持するため、別変数に拾っておく
-	const auto* pFaces = &mesh.GetFaces()[0];
-	UINT faceNum = mesh.GetFaces().size();
-	auto& vertices = mesh.GetVertexPositions();
+	const auto* pFaces = mesh.m_faces.data();
+	UINT faceNum = mesh.m_faces.size();
+	const auto& vertices = mesh.m_positions;
 
 	DirectX::XMVECTOR finalHitPos = {};	// 当たった座標の中でも最後の座標
 	DirectX::XMVECTOR finalPos = {};	// 各面に押されて最終的に到達する座標：判定する球の中心
@@ -366,10 +476,11 @@ bool MeshIntersect(const KdMesh& mesh, const DirectX::BoundingSphere& sphere,
 	float radiusSqr = 0.0f;
 	InvertSphereInfo(finalPos, objScale, radiusSqr, matrix, sphere);
 
-	// 全ての面と判定
-	// ※判定はメッシュのローカル空間で行われる
-	for (UINT faceIdx = 0; faceIdx < faceNum; faceIdx++)
+	// 1つの面との判定：当たっていれば球を押し出す
+	auto hitFace = [&](UINT faceIdx)
 	{
+		KD_COLLISION_STAT_ADD(m_triangleTests, 1);
+
 		DirectX::XMVECTOR nearPoint;
 
 		// 三角形を構成する３つの頂点のIndex
@@ -379,7 +490,89 @@ bool MeshIntersect(const KdMesh& mesh, const DirectX::BoundingSphere& sphere,
 		KdPointToTriangle(finalPos, vertices[idx[0]], vertices[idx[1]], vertices[idx[2]], nearPoint);
 
 		// 当たっているかどうかの判定と最終座標の更新
-		isHit |= HitCheckAndPosUpdate(finalPos, finalHitPos, nearPoint, objScale, radiusSqr, sphere.Radius);
+		return HitCheckAndPosUpdate(finalPos, finalHitPos, nearPoint, objScale, radiusSqr, sphere.Radius);
+	};
+
+	// BVHがあれば球の周囲の面だけを判定する
+	// 押し出しで球が移動しても届く範囲(中心から半径の2倍)の面を集め、総当たりと同じ面の順番で押し出す
+	// 押し出し量が半径を超えた場合は範囲外の面に届いている可能性があるので総当たりでやり直す
+	bool needBruteForce = true;
+
+	if (const KdMeshBVH* pBVH = mesh.m_pBVH)
+	{
+		DirectX::XMVECTOR beginPos = finalPos;
+
+		// ローカル空間での範囲：最も小さい拡大率で割れば全ての軸で届く範囲を含む
+		// 面との距離の誤差で取りこぼさないように僅かに広げる
+		float minScale = std::min({ objScale.m128_f32[0], objScale.m128_f32[1], objScale.m128_f32[2] });
+		float queryRadius = sphere.Radius * 2.0f / minScale * 1.001f;
+
+		Math::Vector3 localCenter;
+		DirectX::XMStoreFloat3(&localCenter, beginPos);
+
+		// 作業領域はスレッド毎に使い回す
+		static thread_local std::vector<UINT> candidates;
+		const std::vector<UINT>* pCandidates = &candidates;
+
+		if (pCache && pCache->m_radius >= 0.0f &&
+			Math::Vector3::Distance(localCenter, pCache->m_center) + queryRadius <= pCache->m_radius)
+		{
+			// 前回集めた範囲に今回の範囲が収まっていれば、その面だけで必要な面を全て含む
+			pCandidates = &pCache->m_faces;
+
+			++pCache->m_hitCount;
+		}
+		else
+		{
+			// 記録する場合は少し広めに集めて、次回以降少し動いても使えるようにする
+			float collectRadius = pCache ? queryRadius * kQueryCacheMargin : queryRadius;
+
+			candidates.clear();
+			pBVH->CollectNearFaces(localCenter, collectRadius, candidates);
+			std::sort(candidates.begin(), candidates.end());
+
+			if (pCache)
+			{
+				pCache->m_center = localCenter;
+				pCache->m_radius = collectRadius;
+				pCache->m_faces.assign(candidates.begin(), candidates.end());
+
+				++pCache->m_missCount;
+			}
+		}
+
+		needBruteForce = false;
+
+		for (UINT faceIdx : *pCandidates)
+		{
+			if (!hitFace(faceIdx)) { continue; }
+
+			isHit = true;
+
+			// CollisionResult無しなら結果は関係ないので当たった時点で返る
+			if (!pResult) { return isHit; }
+
+			// 押し出し量が半径を超えたら集めた範囲の外に届いている可能性がある
+			if (DirectX::XMVector3LengthSq((finalPos - beginPos) * objScale).m128_f32[0] > radiusSqr)
+			{
+				needBruteForce = true;
+				break;
+			}
+		}
+
+		if (needBruteForce)
+		{
+			isHit = false;
+			finalHitPos = {};
+			finalPos = beginPos;
+		}
+	}
+
+	// 全ての面と判定
+	// ※判定はメッシュのローカル空間で行われる
+	for (UINT faceIdx = 0; needBruteForce && faceIdx < faceNum; faceIdx++)
+	{
+		isHit |= hitFace(faceIdx);
 
 		// CollisionResult無しなら結果は関係ないので当たった時点で返る
 		if (!pResult && isHit) { return isHit; }
@@ -474,3 +667,1215 @@ void KdPointToTriangle(const XMVECTOR& p, const XMVECTOR& a, const XMVECTOR& b,
 	float w = vc * denom;
 	outPt = a + ab * v + ac * w;	// = u*a + v*b + w*c, u = va*demon = 1.0f - v - w
 }
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// BOXの当たり判定
+// 分離軸判定(SAT)：全ての候補軸に投影した範囲が重なっていれば当たり
+// 重なりが最も小さい軸の方向へ、その重なり量だけ押し出す
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+// 辺同士の外積の軸を採用する時の重み：面の軸と重なり量がほぼ同じ場合に面の軸を優先して押し出しを安定させる
+static constexpr float kEdgeAxisBias = 1.05f;
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOXのローカル空間(BOXの中心が原点・各軸が座標軸)での三角形との分離軸判定
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// ・extents		… BOXの各軸の半分の大きさ
+// ・p0, p1, p2		… BOXのローカル空間での三角形の頂点
+// ・pushDir/pushDist … 当たっていればBOXを押し出す方向(ローカル空間)と量
+// 候補軸はBOXの3軸・三角形の法線・BOXの軸と三角形の辺の外積9本の計13本
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+static bool BoxTriangleSAT(const XMVECTOR& extents, const XMVECTOR& p0, const XMVECTOR& p1, const XMVECTOR& p2,
+	XMVECTOR& pushDir, float& pushDist)
+{
+	// BOXの3軸は4成分まとめて比較し、明らかに離れている三角形を先に除外する
+	XMVECTOR triMin = XMVectorMin(p0, XMVectorMin(p1, p2));
+	XMVECTOR triMax = XMVectorMax(p0, XMVectorMax(p1, p2));
+
+	if (!XMVector3LessOrEqual(triMin, extents) || !XMVector3GreaterOrEqual(triMax, -extents)) { return false; }
+
+	float bestDist = FLT_MAX;
+	XMVECTOR bestAxis = g_XMIdentityR1;
+
+	// 1つの軸での判定：離れていればfalse
+	auto testAxis = [&](const XMVECTOR& axis, float bias)
+	{
+		float lengthSq = XMVector3LengthSq(axis).m128_f32[0];
+
+		// 平行な辺同士などで軸が作れない場合は判定しない
+		if (lengthSq < 1e-12f) { return true; }
+
+		XMVECTOR L = axis * (1.0f / sqrtf(lengthSq));
+
+		// BOXを軸に投影した半径
+		float r = XMVector3Dot(extents, XMVectorAbs(L)).m128_f32[0];
+
+		float t0 = XMVector3Dot(p0, L).m128_f32[0];
+		float t1 = XMVector3Dot(p1, L).m128_f32[0];
+		float t2 = XMVector3Dot(p2, L).m128_f32[0];
+
+		float tMin = std::min({ t0, t1, t2 });
+		float tMax = std::max({ t0, t1, t2 });
+
+		if (tMin > r || tMax < -r) { return false; }
+
+		// +方向・-方向それぞれに押し出した場合の量の小さい方
+		float pushPlus = tMax + r;
+		float pushMinus = r - tMin;
+
+		float dist = std::min(pushPlus, pushMinus);
+
+		if (dist * bias < bestDist)
+		{
+			bestDist = dist;
+			bestAxis = (pushPlus < pushMinus) ? L : -L;
+		}
+
+		return true;
+	};
+
+	// BOXの3軸
+	if (!testAxis(g_XMIdentityR0, 1.0f)) { return false; }
+	if (!testAxis(g_XMIdentityR1, 1.0f)) { return false; }
+	if (!testAxis(g_XMIdentityR2, 1.0f)) { return false; }
+
+	XMVECTOR edges[3] = { p1 - p0, p2 - p1, p0 - p2 };
+
+	// 三角形の法線
+	if (!testAxis(XMVector3Cross(edges[0], edges[1]), 1.0f)) { return false; }
+
+	// BOXの軸と三角形の辺の外積
+	const XMVECTOR boxAxes[3] = { g_XMIdentityR0, g_XMIdentityR1, g_XMIdentityR2 };
+
+	for (const XMVECTOR& boxAxis : boxAxes)
+	{
+		for (const XMVECTOR& edge : edges)
+		{
+			if (!testAxis(XMVector3Cross(boxAxis, edge), kEdgeAxisBias)) { return false; }
+		}
+	}
+
+	pushDir = bestAxis;
+	pushDist = bestDist;
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOXの情報をBOXのローカル空間へ変換する
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 面の頂点をBOXの回転の逆で変換すれば、BOXは原点を中心とした回転の無い箱として扱える
+// BOXの中心もBOXの回転の逆で変換した座標で持ち、押し出しはこの空間で行う
+// ・toBox … 形状のローカル座標 → BOXの回転の逆を掛けた座標 への変換行列
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+static void InvertBoxInfo(DirectX::XMMATRIX& toBox, DirectX::XMVECTOR& boxCenter, DirectX::XMVECTOR& extents, DirectX::XMVECTOR& rotation,
+	const DirectX::XMMATRIX& matrix, const DirectX::BoundingOrientedBox& box)
+{
+	rotation = XMLoadFloat4(&box.Orientation);
+
+	// 回転行列の逆行列 = 転置行列
+	DirectX::XMMATRIX boxRotInv = XMMatrixTranspose(XMMatrixRotationQuaternion(rotation));
+
+	toBox = matrix * boxRotInv;
+
+	boxCenter = XMVector3TransformNormal(XMLoadFloat3(&box.Center), boxRotInv);
+
+	extents = XMLoadFloat3(&box.Extents);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOXと三角形が接触しているかどうかを判定
+// 次の三角形の判定の前に当たらない位置までBOXを移動させる
+// ・v0, v1, v2 … InvertBoxInfo()のtoBoxで変換した三角形の頂点
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+static bool BoxHitCheckAndPosUpdate(DirectX::XMVECTOR& boxCenter, DirectX::XMVECTOR& finalHitPos, const DirectX::XMVECTOR& extents,
+	const DirectX::XMVECTOR& v0, const DirectX::XMVECTOR& v1, const DirectX::XMVECTOR& v2)
+{
+	DirectX::XMVECTOR pushDir;
+	float pushDist = 0.0f;
+
+	if (!BoxTriangleSAT(extents, v0 - boxCenter, v1 - boxCenter, v2 - boxCenter, pushDir, pushDist)) { return false; }
+
+	// BOXの中心座標を更新
+	boxCenter += pushDir * pushDist;
+
+	// 当たった座標は押し出した後のBOXの中心に最も近い三角形上の点
+	KdPointToTriangle(boxCenter, v0, v1, v2, finalHitPos);
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOX対ポリゴン(KdMesh以外の任意の多角形ポリゴン)の当たり判定本体
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// BOXを包む球でkLaneNum個の面をまとめて絞り込み、当たる可能性のある面だけを分離軸判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool PolygonsIntersect(const KdPolygon& poly, const DirectX::BoundingOrientedBox& box, const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult)
+{
+	// 頂点リストはコピーせずに直接参照する
+	const std::vector<KdPolygon::Vertex>& vertices = poly.GetVertices();
+	if (vertices.size() < 3) { return false; }
+
+	// SIMDでまとめて絞り込むために成分毎に並べる
+	static thread_local KdTriangleSoA triangles;
+	triangles.BuildFromStrip(&vertices[0].pos, static_cast<UINT>(vertices.size()), sizeof(KdPolygon::Vertex));
+	UINT faceNum = triangles.GetCount();
+
+	// １つでもヒットしたらtrue
+	bool isHit = false;
+
+	DirectX::XMMATRIX toBox;
+	DirectX::XMVECTOR boxCenter, extents, rotation;
+	InvertBoxInfo(toBox, boxCenter, extents, rotation, matrix, box);
+
+	DirectX::XMVECTOR finalHitPos = {};
+
+	// 絞り込み用の球：BOXを包む球をポリゴンのローカル空間へ変換する
+	// 拡大率は最も小さい軸のものを全ての軸に使う：実際より近く見積もるので当たる面を取りこぼさない
+	DirectX::XMMATRIX invMat = XMMatrixInverse(0, matrix);
+	DirectX::XMVECTOR localCenter = XMVector3TransformCoord(XMLoadFloat3(&box.Center), invMat);
+
+	float boundRadius = XMVector3Length(extents).m128_f32[0];
+	float minScale = std::min({ XMVector3Length(matrix.r[0]).m128_f32[0], XMVector3Length(matrix.r[1]).m128_f32[0], XMVector3Length(matrix.r[2]).m128_f32[0] });
+	Math::Vector3 filterScale(minScale, minScale, minScale);
+	float filterRadiusSqr = boundRadius * boundRadius * 1.001f + FLT_MIN;
+
+	UINT faceIndx = 0;
+	while (faceIndx < faceNum)
+	{
+		UINT count = std::min(KdTriangleSoA::kLaneNum, faceNum - faceIndx);
+
+		Math::Vector3 center;
+		DirectX::XMStoreFloat3(&center, localCenter);
+
+		UINT mask = KdSphereTrianglesOverlapMask(triangles, faceIndx, count, center, filterScale, filterRadiusSqr);
+
+		if (!mask)
+		{
+			faceIndx += count;
+			continue;
+		}
+
+		unsigned long lane = 0;
+		_BitScanForward(&lane, mask);
+		faceIndx += lane;
+
+		if (BoxHitCheckAndPosUpdate(boxCenter, finalHitPos, extents,
+			XMVector3TransformCoord(vertices[faceIndx].pos, toBox),
+			XMVector3TransformCoord(vertices[faceIndx + 1].pos, toBox),
+			XMVector3TransformCoord(vertices[faceIndx + 2].pos, toBox)))
+		{
+			isHit = true;
+
+			// CollisionResult無しなら結果は関係ないので当たった時点で返る
+			if (!pResult) { return isHit; }
+
+			// BOXが動いたので絞り込み用の球も動かす
+			localCenter = XMVector3TransformCoord(XMVector3Rotate(boxCenter, rotation), invMat);
+		}
+
+		++faceIndx;
+	}
+
+	// リザルトに結果を格納：BOXのローカル空間の座標は回転させればワールド座標に戻る
+	if (pResult && isHit)
+	{
+		SetSphereResult(*pResult, isHit, XMVector3Rotate(finalHitPos, rotation),
+			XMVector3Rotate(boxCenter, rotation), XMLoadFloat3(&box.Center));
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOX対メッシュの当たり判定本体
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool MeshIntersect(const KdMesh& mesh, const DirectX::BoundingOrientedBox& box,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult)
+{
+	return MeshIntersect(KdMeshShapeView(mesh), box, matrix, pResult);
+}
+
+bool MeshIntersect(const KdMeshShapeView& mesh, const DirectX::BoundingOrientedBox& box,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult)
+{
+	// 当たり判定用の形状を保持していないメッシュは判定できない
+	if (mesh.m_faces.empty()) { return false; }
+
+	KD_COLLISION_STAT_ADD(m_meshTests, 1);
+
+	//------------------------------------------
+	// ブロードフェイズ
+	// 　メッシュの境界ボックス(AABB)とBOXで判定
+	//------------------------------------------
+	{
+		DirectX::BoundingBox aabb;
+		mesh.m_aabb.Transform(aabb, matrix);
+
+		if (aabb.Intersects(box) == false)
+		{
+			KD_COLLISION_STAT_ADD(m_aabbRejects, 1);
+			return false;
+		}
+	}
+
+	//------------------------------------------
+	// ナローフェイズ
+	// 　BOXとメッシュの各面との分離軸判定
+	//------------------------------------------
+
+	// １つでもヒットしたらtrue
+	bool isHit = false;
+
+	// DEBUGビルドでも速度を維持するため、別変数に拾っておく
+	const auto* pFaces = mesh.m_faces.data();
+	UINT faceNum = mesh.m_faces.size();
+	const auto& vertices = mesh.m_positions;
+
+	DirectX::XMMATRIX toBox;
+	DirectX::XMVECTOR boxCenter, extents, rotation;
+	InvertBoxInfo(toBox, boxCenter, extents, rotation, matrix, box);
+
+	DirectX::XMVECTOR finalHitPos = {};
+
+	// 1つの面との判定：当たっていればBOXを押し出す
+	auto hitFace = [&](UINT faceIdx)
+	{
+		KD_COLLISION_STAT_ADD(m_triangleTests, 1);
+
+		const UINT* idx = pFaces[faceIdx].Idx;
+
+		return BoxHitCheckAndPosUpdate(boxCenter, finalHitPos, extents,
+			XMVector3TransformCoord(vertices[idx[0]], toBox),
+			XMVector3TransformCoord(vertices[idx[1]], toBox),
+			XMVector3TransformCoord(vertices[idx[2]], toBox));
+	};
+
+	// BVHがあればBOXの周囲の面だけを判定する
+	// 押し出しでBOXが移動しても届く範囲(BOXを包む球の半径だけ広げた箱)の面を集め、総当たりと同じ面の順番で押し出す
+	// 押し出し量がその半径を超えた場合は範囲外の面に届いている可能性があるので総当たりでやり直す
+	bool needBruteForce = true;
+
+	if (const KdMeshBVH* pBVH = mesh.m_pBVH)
+	{
+		DirectX::XMVECTOR beginCenter = boxCenter;
+
+		float margin = XMVector3Length(extents).m128_f32[0];
+
+		// ワールド空間で広げてからメッシュのローカル空間へ変換する
+		DirectX::XMFLOAT3 corners[DirectX::BoundingOrientedBox::CORNER_COUNT];
+		box.GetCorners(corners);
+
+		DirectX::BoundingBox queryBox;
+		DirectX::BoundingBox::CreateFromPoints(queryBox, DirectX::BoundingOrientedBox::CORNER_COUNT, corners, sizeof(DirectX::XMFLOAT3));
+		queryBox.Extents.x += margin;
+		queryBox.Extents.y += margin;
+		queryBox.Extents.z += margin;
+
+		queryBox.Transform(queryBox, XMMatrixInverse(0, matrix));
+
+		// 作業領域はスレッド毎に使い回す
+		static thread_local std::vector<UINT> candidates;
+		candidates.clear();
+		pBVH->CollectOverlapFaces(queryBox, candidates);
+		std::sort(candidates.begin(), candidates.end());
+
+		needBruteForce = false;
+
+		for (UINT faceIdx : candidates)
+		{
+			if (!hitFace(faceIdx)) { continue; }
+
+			isHit = true;
+
+			// CollisionResult無しなら結果は関係ないので当たった時点で返る
+			if (!pResult) { return isHit; }
+
+			// 押し出し量が広げた分を超えたら集めた範囲の外に届いている可能性がある
+			if (DirectX::XMVector3LengthSq(boxCenter - beginCenter).m128_f32[0] > margin * margin)
+			{
+				needBruteForce = true;
+				break;
+			}
+		}
+
+		if (needBruteForce)
+		{
+			isHit = false;
+			finalHitPos = {};
+			boxCenter = beginCenter;
+		}
+	}
+
+	// 全ての面と判定
+	for (UINT faceIdx = 0; needBruteForce && faceIdx < faceNum; faceIdx++)
+	{
+		isHit |= hitFace(faceIdx);
+
+		// CollisionResult無しなら結果は関係ないので当たった時点で返る
+		if (!pResult && isHit) { return isHit; }
+	}
+
+	// リザルトに結果を格納：BOXのローカル空間の座標は回転させればワールド座標に戻る
+	if (pResult && isHit)
+	{
+		SetSphereResult(*pResult, isHit, XMVector3Rotate(finalHitPos, rotation),
+			XMVector3Rotate(boxCenter, rotation), XMLoadFloat3(&box.Center));
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOX対ハイトフィールドの当たり判定本体
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// BOXの下にあるマスの2つの三角形だけを分離軸判定する：判定回数は地形の大きさに依存しない
+// 押し出しでBOXが移動しても届く範囲(BOXを包む球の半径だけ広げた箱)のマスを対象にする
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool HeightfieldIntersect(const KdHeightfield& heightfield, const DirectX::BoundingOrientedBox& box,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult)
+{
+	if (heightfield.IsEmpty()) { return false; }
+
+	KD_COLLISION_STAT_ADD(m_meshTests, 1);
+
+	DirectX::XMMATRIX toBox;
+	DirectX::XMVECTOR boxCenter, extents, rotation;
+	InvertBoxInfo(toBox, boxCenter, extents, rotation, matrix, box);
+
+	// 対象のマスを探す箱：ハイトフィールドのローカル空間へ変換する
+	float queryExtent = XMVector3Length(extents).m128_f32[0] * 2.0f;
+
+	DirectX::BoundingBox queryBox(box.Center, DirectX::XMFLOAT3(queryExtent, queryExtent, queryExtent));
+	DirectX::BoundingBox localBox;
+	queryBox.Transform(localBox, XMMatrixInverse(0, matrix));
+
+	// １つでもヒットしたらtrue
+	bool isHit = false;
+
+	DirectX::XMVECTOR finalHitPos = {};
+
+	heightfield.ForEachTriangle(localBox,
+		[&](const Math::Vector3& v0, const Math::Vector3& v1, const Math::Vector3& v2)
+		{
+			KD_COLLISION_STAT_ADD(m_triangleTests, 1);
+
+			isHit |= BoxHitCheckAndPosUpdate(boxCenter, finalHitPos, extents,
+				XMVector3TransformCoord(v0, toBox),
+				XMVector3TransformCoord(v1, toBox),
+				XMVector3TransformCoord(v2, toBox));
+
+			// CollisionResult無しなら結果は関係ないので当たった時点で終了
+			return pResult || !isHit;
+		});
+
+	// リザルトに結果を格納：BOXのローカル空間の座標は回転させればワールド座標に戻る
+	if (pResult && isHit)
+	{
+		SetSphereResult(*pResult, isHit, XMVector3Rotate(finalHitPos, rotation),
+			XMVector3Rotate(boxCenter, rotation), XMLoadFloat3(&box.Center));
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOX対BOXの当たり判定
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 候補軸はそれぞれの3軸と、その組み合わせの外積9本の計15本
+// 結果はtargetを押し出す方向と量
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBoxIntersect(const DirectX::BoundingOrientedBox& box, const DirectX::BoundingOrientedBox& target, CollisionMeshResult* pResult)
+{
+	DirectX::XMMATRIX axesA = XMMatrixRotationQuaternion(XMLoadFloat4(&box.Orientation));
+	DirectX::XMMATRIX axesB = XMMatrixRotationQuaternion(XMLoadFloat4(&target.Orientation));
+
+	// 軸を各BOXの空間へ変換する用：回転行列の逆行列 = 転置行列
+	DirectX::XMMATRIX invA = XMMatrixTranspose(axesA);
+	DirectX::XMMATRIX invB = XMMatrixTranspose(axesB);
+
+	DirectX::XMVECTOR extentsA = XMLoadFloat3(&box.Extents);
+	DirectX::XMVECTOR extentsB = XMLoadFloat3(&target.Extents);
+
+	// 中心同士の差
+	DirectX::XMVECTOR between = XMLoadFloat3(&target.Center) - XMLoadFloat3(&box.Center);
+
+	float bestDist = FLT_MAX;
+	float bestRadiusB = 0.0f;
+	DirectX::XMVECTOR bestAxis = g_XMIdentityR1;
+
+	// 1つの軸での判定：離れていればfalse
+	auto testAxis = [&](const DirectX::XMVECTOR& axis, float bias)
+	{
+		float lengthSq = XMVector3LengthSq(axis).m128_f32[0];
+
+		// 平行な軸同士などで軸が作れない場合は判定しない
+		if (lengthSq < 1e-12f) { return true; }
+
+		DirectX::XMVECTOR L = axis * (1.0f / sqrtf(lengthSq));
+
+		// 各BOXを軸に投影した半径：軸を各BOXの空間へ変換すれば3軸分まとめて求められる
+		float radiusA = XMVector3Dot(extentsA, XMVectorAbs(XMVector3TransformNormal(L, invA))).m128_f32[0];
+		float radiusB = XMVector3Dot(extentsB, XMVectorAbs(XMVector3TransformNormal(L, invB))).m128_f32[0];
+
+		float dist = XMVector3Dot(between, L).m128_f32[0];
+
+		float overlap = radiusA + radiusB - fabsf(dist);
+
+		if (overlap < 0.0f) { return false; }
+
+		if (overlap * bias < bestDist)
+		{
+			bestDist = overlap;
+			bestRadiusB = radiusB;
+			bestAxis = (dist < 0.0f) ? -L : L;
+		}
+
+		return true;
+	};
+
+	for (int i = 0; i < 3; ++i)
+	{
+		if (!testAxis(axesA.r[i], 1.0f)) { return false; }
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		if (!testAxis(axesB.r[i], 1.0f)) { return false; }
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			if (!testAxis(XMVector3Cross(axesA.r[i], axesB.r[j]), kEdgeAxisBias)) { return false; }
+		}
+	}
+
+	if (pResult)
+	{
+		pResult->m_hit = true;
+
+		pResult->m_hitDir = bestAxis;
+
+		pResult->m_overlapDistance = bestDist;
+
+		// 当たった座標は押し出す軸上の重なっている範囲の中央
+		pResult->m_hitPos = XMLoadFloat3(&target.Center) - bestAxis * (bestRadiusB - bestDist * 0.5f);
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// BOX対球の当たり判定
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// BOXのローカル空間で球の中心に最も近いBOX上の点を求める
+// 結果はtargetを押し出す方向と量：球の中心がBOXの中にある場合は最も近い面の方向へ押し出す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdBoxIntersect(const DirectX::BoundingOrientedBox& box, const DirectX::BoundingSphere& target, CollisionMeshResult* pResult)
+{
+	DirectX::XMVECTOR rotation = XMLoadFloat4(&box.Orientation);
+	DirectX::XMVECTOR boxCenter = XMLoadFloat3(&box.Center);
+	DirectX::XMVECTOR extents = XMLoadFloat3(&box.Extents);
+
+	// 球の中心をBOXのローカル空間へ
+	DirectX::XMVECTOR localCenter = XMVector3InverseRotate(XMLoadFloat3(&target.Center) - boxCenter, rotation);
+
+	// BOX上の最近接点
+	DirectX::XMVECTOR nearPoint = XMVectorClamp(localCenter, -extents, extents);
+
+	DirectX::XMVECTOR toCenter = localCenter - nearPoint;
+
+	float distSq = XMVector3LengthSq(toCenter).m128_f32[0];
+
+	if (distSq > target.Radius * target.Radius) { return false; }
+
+	// 詳細リザルトが必要無ければ即結果を返す
+	if (!pResult) { return true; }
+
+	DirectX::XMVECTOR localDir;
+	float overlap = 0.0f;
+
+	if (distSq > 0.0f)
+	{
+		float dist = sqrtf(distSq);
+
+		localDir = toCenter / dist;
+		overlap = target.Radius - dist;
+	}
+	else
+	{
+		// 中心がBOXの中：面までの距離が最も短い軸の方向へ押し出す
+		DirectX::XMFLOAT3 center, size;
+		XMStoreFloat3(&center, localCenter);
+		XMStoreFloat3(&size, extents);
+
+		float faceDist[3] = { size.x - fabsf(center.x), size.y - fabsf(center.y), size.z - fabsf(center.z) };
+		float sign[3] = { center.x < 0.0f ? -1.0f : 1.0f, center.y < 0.0f ? -1.0f : 1.0f, center.z < 0.0f ? -1.0f : 1.0f };
+
+		int axis = 0;
+		if (faceDist[1] < faceDist[axis]) { axis = 1; }
+		if (faceDist[2] < faceDist[axis]) { axis = 2; }
+
+		const DirectX::XMVECTOR unitAxes[3] = { g_XMIdentityR0, g_XMIdentityR1, g_XMIdentityR2 };
+
+		localDir = unitAxes[axis] * sign[axis];
+		overlap = target.Radius + faceDist[axis];
+
+		// 当たった座標は押し出す方向の面上の点
+		nearPoint += localDir * faceDist[axis];
+	}
+
+	pResult->m_hit = true;
+
+	pResult->m_hitDir = XMVector3Rotate(localDir, rotation);
+
+	pResult->m_overlapDistance = overlap;
+
+	pResult->m_hitPos = boxCenter + XMVector3Rotate(nearPoint, rotation);
+
+	return true;
+}
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// カプセルの当たり判定
+// 移動判定(スイープ)は保守的前進法：今の位置で形状との最短距離を求め、その距離を詰めるのに必要なだけ進める を繰り返す
+// 凸形状同士なら進めすぎる事が無いので、1フレームの移動量が大きくても面をすり抜けない
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+// 前進を繰り返す回数の上限：超えた場合はその位置で接触とする(手前で止まるので安全側)
+static constexpr int kSweepMaxIteration = 32;
+// この距離まで近づいたら接触とする
+static constexpr float kSweepContactTolerance = 0.0001f;
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 行列で変換
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCapsule::Transform(KdCapsule& out, const DirectX::XMMATRIX& matrix) const
+{
+	float scaleSq = std::max({ XMVector3LengthSq(matrix.r[0]).m128_f32[0],
+		XMVector3LengthSq(matrix.r[1]).m128_f32[0], XMVector3LengthSq(matrix.r[2]).m128_f32[0] });
+
+	out.m_pos0 = XMVector3TransformCoord(m_pos0, matrix);
+	out.m_pos1 = XMVector3TransformCoord(m_pos1, matrix);
+	out.m_radius = m_radius * sqrtf(scaleSq);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 点に最も近い線分上の点
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+static XMVECTOR ClosestPointOnSegment(const XMVECTOR& p, const XMVECTOR& a, const XMVECTOR& b)
+{
+	XMVECTOR ab = b - a;
+
+	float lengthSq = XMVector3LengthSq(ab).m128_f32[0];
+
+	if (lengthSq <= FLT_EPSILON) { return a; }
+
+	float t = std::clamp(XMVector3Dot(p - a, ab).m128_f32[0] / lengthSq, 0.0f, 1.0f);
+
+	return a + ab * t;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 線分(p1～q1)と線分(p2～q2)の最近接点
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+static void ClosestSegmentSegment(const XMVECTOR& p1, const XMVECTOR& q1, const XMVECTOR& p2, const XMVECTOR& q2,
+	XMVECTOR& c1, XMVECTOR& c2)
+{
+	// ※参考:[書籍]「ゲームプログラミングのためのリアルタイム衝突判定」
+
+	XMVECTOR d1 = q1 - p1;
+	XMVECTOR d2 = q2 - p2;
+	XMVECTOR r = p1 - p2;
+
+	float a = XMVector3Dot(d1, d1).m128_f32[0];
+	float e = XMVector3Dot(d2, d2).m128_f32[0];
+	float f = XMVector3Dot(d2, r).m128_f32[0];
+
+	float s = 0.0f;
+	float t = 0.0f;
+
+	// 両方とも点に縮退している
+	if (a <= FLT_EPSILON && e <= FLT_EPSILON)
+	{
+		c1 = p1;
+		c2 = p2;
+		return;
+	}
+
+	if (a <= FLT_EPSILON)
+	{
+		// 1つ目の線分が点に縮退している
+		t = std::clamp(f / e, 0.0f, 1.0f);
+	}
+	else
+	{
+		float c = XMVector3Dot(d1, r).m128_f32[0];
+
+		if (e <= FLT_EPSILON)
+		{
+			// 2つ目の線分が点に縮退している
+			s = std::clamp(-c / a, 0.0f, 1.0f);
+		}
+		else
+		{
+			float b = XMVector3Dot(d1, d2).m128_f32[0];
+			float denom = a * e - b * b;
+
+			// 平行でなければ無限直線同士の最近接点から求め、平行なら任意の点(始点)を選ぶ
+			s = (denom != 0.0f) ? std::clamp((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+			t = (b * s + f) / e;
+
+			// 2つ目の線分の外に出たら端に合わせて1つ目を求め直す
+			if (t < 0.0f)
+			{
+				t = 0.0f;
+				s = std::clamp(-c / a, 0.0f, 1.0f);
+			}
+			else if (t > 1.0f)
+			{
+				t = 1.0f;
+				s = std::clamp((b - c) / a, 0.0f, 1.0f);
+			}
+		}
+	}
+
+	c1 = p1 + d1 * s;
+	c2 = p2 + d2 * t;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 線分(a～b)と三角形の最近接点
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 線分が三角形を貫いていなければ、最近接点は 線分の端と三角形 か 線分と三角形の辺 のどれかの組み合わせになる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+static void ClosestSegmentTriangle(const XMVECTOR& a, const XMVECTOR& b,
+	const XMVECTOR& v0, const XMVECTOR& v1, const XMVECTOR& v2, XMVECTOR& onSeg, XMVECTOR& onTri)
+{
+	XMVECTOR ab = b - a;
+
+	float length = XMVector3Length(ab).m128_f32[0];
+
+	// 線分が三角形を貫いていれば距離0
+	if (length > FLT_EPSILON)
+	{
+		float hitDist = 0.0f;
+
+		if (DirectX::TriangleTests::Intersects(a, ab / length, v0, v1, v2, hitDist) && hitDist <= length)
+		{
+			onSeg = onTri = a + ab * (hitDist / length);
+			return;
+		}
+	}
+
+	float nearestSq = FLT_MAX;
+
+	auto update = [&](const XMVECTOR& segPt, const XMVECTOR& triPt)
+	{
+		float distSq = XMVector3LengthSq(segPt - triPt).m128_f32[0];
+
+		if (distSq < nearestSq)
+		{
+			nearestSq = distSq;
+			onSeg = segPt;
+			onTri = triPt;
+		}
+	};
+
+	XMVECTOR triPt, segPt;
+
+	KdPointToTriangle(a, v0, v1, v2, triPt);
+	update(a, triPt);
+
+	KdPointToTriangle(b, v0, v1, v2, triPt);
+	update(b, triPt);
+
+	ClosestSegmentSegment(a, b, v0, v1, segPt, triPt);
+	update(segPt, triPt);
+
+	ClosestSegmentSegment(a, b, v1, v2, segPt, triPt);
+	update(segPt, triPt);
+
+	ClosestSegmentSegment(a, b, v2, v0, segPt, triPt);
+	update(segPt, triPt);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 保守的前進法で線分を移動させ、形状との距離がradiusになる位置を求める
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 最近接点を結ぶ方向へ近づく速さで距離を割った分だけ進めれば、その間は凸形状同士が重なる事は無い
+// ・closest	… void(線分の始点, 線分の終点, 線分上の最近接点, 形状上の最近接点)
+// ・radius	… 線分からの距離がこの値以下で接触とする(相手も太さを持つ場合はその分も足す)
+// ・hitDist	… 接触するまでの移動距離：移動前から重なっている場合はめり込み量を負の値で返す
+// ・hitNormal	… 形状からカプセルへ向かう方向：線分が形状に触れている場合は移動方向の逆とする
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Func>
+static bool SweepConservative(const XMVECTOR& segA, const XMVECTOR& segB, float radius, const XMVECTOR& dir, float range,
+	Func closest, float& hitDist, XMVECTOR& hitPos, XMVECTOR& hitNormal)
+{
+	float moved = 0.0f;
+
+	for (int i = 0; i < kSweepMaxIteration; ++i)
+	{
+		XMVECTOR offset = dir * moved;
+
+		XMVECTOR onSeg, onShape;
+		closest(segA + offset, segB + offset, onSeg, onShape);
+
+		XMVECTOR separation = onSeg - onShape;
+
+		float dist = XMVector3Length(separation).m128_f32[0];
+
+		hitNormal = (dist > FLT_EPSILON) ? separation / dist : -dir;
+		hitPos = onShape;
+
+		float gap = dist - radius;
+
+		// 移動前から重なっている
+		if (i == 0 && gap < -kSweepContactTolerance)
+		{
+			hitDist = gap;
+			return true;
+		}
+
+		// 形状へ近づく速さ：近づいていなければ距離がこれ以上縮まる事は無い
+		float approach = -XMVector3Dot(dir, hitNormal).m128_f32[0];
+
+		if (approach <= FLT_EPSILON) { return false; }
+
+		if (gap <= kSweepContactTolerance)
+		{
+			hitDist = moved;
+			return true;
+		}
+
+		moved += gap / approach;
+
+		if (moved > range) { return false; }
+	}
+
+	// 上限に達した場合は最後の位置で接触とする
+	hitDist = moved;
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// スイープの結果をリザルトにセットする
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+static void SetSweepResult(CollisionMeshResult& result, float hitDist, const XMVECTOR& hitPos, const XMVECTOR& hitNormal, float moveRange)
+{
+	result.m_hit = true;
+
+	result.m_hitPos = hitPos;
+
+	result.m_hitDir = hitNormal;
+
+	result.m_overlapDistance = moveRange - hitDist;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 移動範囲全体を包む境界ボックス
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCalcCapsuleSweptBox(const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange, DirectX::BoundingBox& out)
+{
+	XMVECTOR pos0 = capsule.m_pos0;
+	XMVECTOR pos1 = capsule.m_pos1;
+	XMVECTOR move = moveDir * moveRange;
+	XMVECTOR radius = XMVectorReplicate(capsule.m_radius);
+
+	XMVECTOR vMin = XMVectorMin(XMVectorMin(pos0, pos1), XMVectorMin(pos0 + move, pos1 + move)) - radius;
+	XMVECTOR vMax = XMVectorMax(XMVectorMax(pos0, pos1), XMVectorMax(pos0 + move, pos1 + move)) + radius;
+
+	DirectX::BoundingBox::CreateFromPoints(out, vMin, vMax);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセル対三角形のスイープ
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCapsuleSweepTriangle(const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir,
+	const DirectX::XMVECTOR& v0, const DirectX::XMVECTOR& v1, const DirectX::XMVECTOR& v2,
+	float& nearestDist, DirectX::XMVECTOR& hitPos, DirectX::XMVECTOR& hitNormal)
+{
+	// 面積の無い三角形は最近接点を求められない
+	if (XMVector3LengthSq(XMVector3Cross(v1 - v0, v2 - v0)).m128_f32[0] <= FLT_MIN) { return false; }
+
+	float hitDist = 0.0f;
+	XMVECTOR pos, normal;
+
+	// 既に重なっている面が見つかっていれば、移動せずに重なり量だけを比べる
+	if (!SweepConservative(capsule.m_pos0, capsule.m_pos1, capsule.m_radius, moveDir, std::max(nearestDist, 0.0f),
+		[&](const XMVECTOR& segA, const XMVECTOR& segB, XMVECTOR& onSeg, XMVECTOR& onShape)
+		{
+			ClosestSegmentTriangle(segA, segB, v0, v1, v2, onSeg, onShape);
+		},
+		hitDist, pos, normal))
+	{
+		return false;
+	}
+
+	if (hitDist > nearestDist) { return false; }
+
+	nearestDist = hitDist;
+	hitPos = pos;
+	hitNormal = normal;
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセル対ポリゴン(KdMesh以外の任意の多角形ポリゴン)のスイープ本体
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool PolygonsSweep(const KdPolygon& poly, const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult)
+{
+	// 頂点リストはコピーせずに直接参照する
+	const std::vector<KdPolygon::Vertex>& vertices = poly.GetVertices();
+	if (vertices.size() < 3) { return false; }
+
+	DirectX::BoundingBox sweptBox;
+	KdCalcCapsuleSweptBox(capsule, moveDir, moveRange, sweptBox);
+
+	bool isHit = false;
+
+	float nearestDist = moveRange;
+	DirectX::XMVECTOR hitPos = {};
+	DirectX::XMVECTOR hitNormal = {};
+
+	// 面はワールド空間へ変換してから判定する：拡縮が入っていてもカプセルの形が崩れない
+	UINT faceNum = static_cast<UINT>(vertices.size()) - 2;
+	for (UINT faceIdx = 0; faceIdx < faceNum; ++faceIdx)
+	{
+		DirectX::XMVECTOR v0 = XMVector3TransformCoord(vertices[faceIdx].pos, matrix);
+		DirectX::XMVECTOR v1 = XMVector3TransformCoord(vertices[faceIdx + 1].pos, matrix);
+		DirectX::XMVECTOR v2 = XMVector3TransformCoord(vertices[faceIdx + 2].pos, matrix);
+
+		// 移動範囲に掛からない面は詳細に判定しない
+		if (!sweptBox.Intersects(v0, v1, v2)) { continue; }
+
+		isHit |= KdCapsuleSweepTriangle(capsule, moveDir, v0, v1, v2, nearestDist, hitPos, hitNormal);
+
+		// CollisionResult無しなら結果は関係ないので当たった時点で返る
+		if (!pResult && isHit) { return isHit; }
+	}
+
+	if (pResult && isHit)
+	{
+		SetSweepResult(*pResult, nearestDist, hitPos, hitNormal, moveRange);
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセル対メッシュのスイープ本体
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// BVHがあれば移動範囲全体を包む箱と重なる面だけを判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool MeshSweep(const KdMesh& mesh, const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult)
+{
+	return MeshSweep(KdMeshShapeView(mesh), capsule, moveDir, moveRange, matrix, pResult);
+}
+
+bool MeshSweep(const KdMeshShapeView& mesh, const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult)
+{
+	// 当たり判定用の形状を保持していないメッシュは判定できない
+	if (mesh.m_faces.empty()) { return false; }
+
+	KD_COLLISION_STAT_ADD(m_meshTests, 1);
+
+	//------------------------------------------
+	// ブロードフェイズ
+	// 　移動範囲全体を包む箱とメッシュの境界ボックス(AABB)で判定
+	//------------------------------------------
+	DirectX::BoundingBox sweptBox;
+	KdCalcCapsuleSweptBox(capsule, moveDir, moveRange, sweptBox);
+
+	{
+		DirectX::BoundingBox aabb;
+		mesh.m_aabb.Transform(aabb, matrix);
+
+		if (aabb.Intersects(sweptBox) == false)
+		{
+			KD_COLLISION_STAT_ADD(m_aabbRejects, 1);
+			return false;
+		}
+	}
+
+	//------------------------------------------
+	// ナローフェイズ
+	// 　移動範囲に掛かる面とのスイープ
+	//------------------------------------------
+	bool isHit = false;
+
+	// DEBUGビルドでも速度を維持するため、別変数に拾っておく
+	const auto* pFaces = mesh.m_faces.data();
+	UINT faceNum = static_cast<UINT>(mesh.m_faces.size());
+	const auto& vertices = mesh.m_positions;
+
+	float nearestDist = moveRange;
+	DirectX::XMVECTOR hitPos = {};
+	DirectX::XMVECTOR hitNormal = {};
+
+	// 1つの面との判定：面はワールド空間へ変換してから判定する
+	auto sweepFace = [&](UINT faceIdx)
+	{
+		KD_COLLISION_STAT_ADD(m_triangleTests, 1);
+
+		const UINT* idx = pFaces[faceIdx].Idx;
+
+		DirectX::XMVECTOR v0 = XMVector3TransformCoord(vertices[idx[0]], matrix);
+		DirectX::XMVECTOR v1 = XMVector3TransformCoord(vertices[idx[1]], matrix);
+		DirectX::XMVECTOR v2 = XMVector3TransformCoord(vertices[idx[2]], matrix);
+
+		if (!sweptBox.Intersects(v0, v1, v2)) { return false; }
+
+		return KdCapsuleSweepTriangle(capsule, moveDir, v0, v1, v2, nearestDist, hitPos, hitNormal);
+	};
+
+	if (const KdMeshBVH* pBVH = mesh.m_pBVH)
+	{
+		// 移動範囲を包む箱をメッシュのローカル空間へ変換して面を集める
+		DirectX::BoundingBox localBox;
+		sweptBox.Transform(localBox, XMMatrixInverse(0, matrix));
+
+		// 作業領域はスレッド毎に使い回す
+		static thread_local std::vector<UINT> candidates;
+		candidates.clear();
+		pBVH->CollectOverlapFaces(localBox, candidates);
+
+		for (UINT faceIdx : candidates)
+		{
+			isHit |= sweepFace(faceIdx);
+
+			// CollisionResult無しなら結果は関係ないので当たった時点で返る
+			if (!pResult && isHit) { return isHit; }
+		}
+	}
+	else
+	{
+		for (UINT faceIdx = 0; faceIdx < faceNum; ++faceIdx)
+		{
+			isHit |= sweepFace(faceIdx);
+
+			// CollisionResult無しなら結果は関係ないので当たった時点で返る
+			if (!pResult && isHit) { return isHit; }
+		}
+	}
+
+	if (pResult && isHit)
+	{
+		SetSweepResult(*pResult, nearestDist, hitPos, hitNormal, moveRange);
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセル対球のスイープ
+// 線分と球の中心の距離が 半径の合計 になる位置を求める
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCapsuleSweep(const DirectX::BoundingSphere& sphere, const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange,
+	CollisionMeshResult* pResult)
+{
+	DirectX::XMVECTOR center = XMLoadFloat3(&sphere.Center);
+
+	float hitDist = 0.0f;
+	DirectX::XMVECTOR hitPos, hitNormal;
+
+	if (!SweepConservative(capsule.m_pos0, capsule.m_pos1, capsule.m_radius + sphere.Radius, moveDir, moveRange,
+		[&](const XMVECTOR& segA, const XMVECTOR& segB, XMVECTOR& onSeg, XMVECTOR& onShape)
+		{
+			onSeg = ClosestPointOnSegment(center, segA, segB);
+			onShape = center;
+		},
+		hitDist, hitPos, hitNormal))
+	{
+		return false;
+	}
+
+	// 当たった座標は球の表面
+	if (pResult)
+	{
+		SetSweepResult(*pResult, hitDist, center + hitNormal * sphere.Radius, hitNormal, moveRange);
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセル対BOXのスイープ
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// BOXの6面を12個の三角形として判定する
+// 線分の端がBOXの奥まで入り込んでいると面との距離ではめり込みを検出できないので、端の球をBOXから押し出す量も調べる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCapsuleSweep(const DirectX::BoundingOrientedBox& box, const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange,
+	CollisionMeshResult* pResult)
+{
+	DirectX::BoundingBox sweptBox;
+	KdCalcCapsuleSweptBox(capsule, moveDir, moveRange, sweptBox);
+
+	if (!box.Intersects(sweptBox)) { return false; }
+
+	bool isHit = false;
+
+	float nearestDist = moveRange;
+	DirectX::XMVECTOR hitPos = {};
+	DirectX::XMVECTOR hitNormal = {};
+
+	// 移動前の線分の端がBOXの中にある
+	const DirectX::XMVECTOR ends[2] = { capsule.m_pos0, capsule.m_pos1 };
+
+	for (const DirectX::XMVECTOR& end : ends)
+	{
+		if (box.Contains(end) == DirectX::DISJOINT) { continue; }
+
+		DirectX::BoundingSphere endSphere;
+		XMStoreFloat3(&endSphere.Center, end);
+		endSphere.Radius = capsule.m_radius;
+
+		CollisionMeshResult result;
+
+		if (!KdBoxIntersect(box, endSphere, &result) || -result.m_overlapDistance > nearestDist) { continue; }
+
+		isHit = true;
+
+		nearestDist = -result.m_overlapDistance;
+		hitPos = result.m_hitPos;
+		hitNormal = result.m_hitDir;
+	}
+
+	// GetCorners()の角の並び：手前(+Z)の4つ → 奥(-Z)の4つ
+	static constexpr UINT kFaceIndices[12][3] =
+	{
+		{ 0, 1, 2 }, { 0, 2, 3 },	// +Z
+		{ 4, 6, 5 }, { 4, 7, 6 },	// -Z
+		{ 0, 5, 1 }, { 0, 4, 5 },	// -Y
+		{ 3, 2, 6 }, { 3, 6, 7 },	// +Y
+		{ 0, 3, 7 }, { 0, 7, 4 },	// -X
+		{ 1, 5, 6 }, { 1, 6, 2 },	// +X
+	};
+
+	DirectX::XMFLOAT3 corners[DirectX::BoundingOrientedBox::CORNER_COUNT];
+	box.GetCorners(corners);
+
+	for (const UINT (&face)[3] : kFaceIndices)
+	{
+		isHit |= KdCapsuleSweepTriangle(capsule, moveDir,
+			XMLoadFloat3(&corners[face[0]]), XMLoadFloat3(&corners[face[1]]), XMLoadFloat3(&corners[face[2]]),
+			nearestDist, hitPos, hitNormal);
+
+		// CollisionResult無しなら結果は関係ないので当たった時点で返る
+		if (!pResult && isHit) { return isHit; }
+	}
+
+	if (pResult && isHit)
+	{
+		SetSweepResult(*pResult, nearestDist, hitPos, hitNormal, moveRange);
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセル対カプセルのスイープ
+// 線分同士の距離が 半径の合計 になる位置を求める
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCapsuleSweep(const KdCapsule& target, const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange,
+	CollisionMeshResult* pResult)
+{
+	DirectX::XMVECTOR targetPos0 = target.m_pos0;
+	DirectX::XMVECTOR targetPos1 = target.m_pos1;
+
+	float hitDist = 0.0f;
+	DirectX::XMVECTOR hitPos, hitNormal;
+
+	if (!SweepConservative(capsule.m_pos0, capsule.m_pos1, capsule.m_radius + target.m_radius, moveDir, moveRange,
+		[&](const XMVECTOR& segA, const XMVECTOR& segB, XMVECTOR& onSeg, XMVECTOR& onShape)
+		{
+			ClosestSegmentSegment(segA, segB, targetPos0, targetPos1, onSeg, onShape);
+		},
+		hitDist, hitPos, hitNormal))
+	{
+		return false;
+	}
+
+	// 当たった座標は相手のカプセルの表面
+	if (pResult)
+	{
+		SetSweepResult(*pResult, hitDist, hitPos + hitNormal * target.m_radius, hitNormal, moveRange);
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセル対球の当たり判定
+// 結果はtargetを押し出す方向と量
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCapsuleIntersect(const KdCapsule& capsule, const DirectX::BoundingSphere& target, CollisionMeshResult* pResult)
+{
+	DirectX::XMVECTOR center = XMLoadFloat3(&target.Center);
+
+	DirectX::XMVECTOR nearPoint = ClosestPointOnSegment(center, capsule.m_pos0, capsule.m_pos1);
+
+	DirectX::XMVECTOR toCenter = center - nearPoint;
+
+	float dist = XMVector3Length(toCenter).m128_f32[0];
+	float needDistance = capsule.m_radius + target.Radius;
+
+	if (dist > needDistance) { return false; }
+
+	// 詳細リザルトが必要無ければ即結果を返す
+	if (!pResult) { return true; }
+
+	// 中心が線分上にある場合は押し出す方向を決められないので上へ押し出す
+	DirectX::XMVECTOR dir = (dist > FLT_EPSILON) ? toCenter / dist : g_XMIdentityR1;
+
+	pResult->m_hit = true;
+
+	pResult->m_hitDir = dir;
+
+	pResult->m_overlapDistance = needDistance - dist;
+
+	pResult->m_hitPos = nearPoint + dir * capsule.m_radius;
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// カプセル対レイの当たり判定
+// 太さ0のカプセルをレイの方向へ動かすスイープとして求める
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCapsuleIntersect(const KdCapsule& capsule, const DirectX::XMVECTOR& rayPos, const DirectX::XMVECTOR& rayDir, float rayRange,
+	CollisionMeshResult* pResult)
+{
+	DirectX::XMVECTOR capsulePos0 = capsule.m_pos0;
+	DirectX::XMVECTOR capsulePos1 = capsule.m_pos1;
+
+	float hitDist = 0.0f;
+	DirectX::XMVECTOR hitPos, hitNormal;
+
+	if (!SweepConservative(rayPos, rayPos, capsule.m_radius, rayDir, rayRange,
+		[&](const XMVECTOR& segA, const XMVECTOR&, XMVECTOR& onSeg, XMVECTOR& onShape)
+		{
+			onSeg = segA;
+			onShape = ClosestPointOnSegment(segA, capsulePos0, capsulePos1);
+		},
+		hitDist, hitPos, hitNormal))
+	{
+		return false;
+	}
+
+	// レイの発射位置がカプセルの中にある場合は発射位置で当たったものとする
+	if (pResult)
+	{
+		SetRayResult(*pResult, true, std::max(hitDist, 0.0f), rayPos, rayDir, rayRange);
+	}
+
+	return true;
+}
@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+class KdHeightfield;
+
 //=================================================
 // メッシュの当たり判定結果
 //=================================================
@@ -11,18 +13,131 @@ struct CollisionMeshResult
 	bool m_hit = false;				// 当たったかどうか
 };
 
+//=================================================
+// メッシュの当たり判定に使う形状の参照
+// KdMeshの他、ファイルを割り当てたメモリなど任意の場所にある三角形の集まりを同じ判定で扱うために使う
+//=================================================
+struct KdMeshShapeView
+{
+	KdMeshShapeView() {}
+
+	explicit KdMeshShapeView(const KdMesh& mesh)
+		: m_positions(mesh.GetVertexPositions()), m_faces(mesh.GetFaces()), m_pBVH(mesh.GetBVH()), m_aabb(mesh.GetBoundingBox()) {}
+
+	std::span<const Math::Vector3>	m_positions;		// 頂点の座標
+	std::span<const KdMeshFace>		m_faces;			// 面
+	const KdMeshBVH*				m_pBVH = nullptr;	// 面の空間分割：nullptrなら総当たり
+	DirectX::BoundingBox			m_aabb;				// 全体の境界ボックス
+};
+
+//=================================================
+// メッシュの判定の前回の記録(時間的な連続性を利用した判定の省略)
+// 同じメッシュ・同じ行列に対して、少しずつ動く球やレイの判定を毎フレーム繰り返す場合に使う
+// メッシュや行列が変わったらReset()すること(KdContactCacheが自動で行う)
+//=================================================
+struct KdMeshQueryCache
+{
+	void Reset()
+	{
+		m_radius = -1.0f;
+		m_faces.clear();
+		m_rayFace = UINT_MAX;
+	}
+
+	// 球の判定：候補の面を集めた範囲(メッシュのローカル空間)と、範囲内の面
+	// 次の判定の範囲がこの範囲に収まっていれば、BVHを辿らずにこの面だけを判定する
+	Math::Vector3		m_center;
+	float				m_radius = -1.0f;		// 0未満なら記録無し
+	std::vector<UINT>	m_faces;
+
+	// レイの判定：前回最も近くで当たった面　先に判定して判定距離を縮めておく
+	UINT				m_rayFace = UINT_MAX;
+
+	// 記録を使えた・使えなかった回数
+	UINT				m_hitCount = 0;
+	UINT				m_missCount = 0;
+};
+
 // レイの当たり判定
 bool PolygonsIntersect(const KdPolygon& poly, const DirectX::XMVECTOR& rayPos, const DirectX::XMVECTOR& rayDir, float rayRange,
 	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr);
 //bool PolygonsIntersect(const KdPolygon& poly);
 bool MeshIntersect(const KdMesh& mesh, const DirectX::XMVECTOR& rayPos, const DirectX::XMVECTOR& rayDir, float rayRange,
 	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr);
+bool MeshIntersect(const KdMeshShapeView& mesh, const DirectX::XMVECTOR& rayPos, const DirectX::XMVECTOR& rayDir, float rayRange,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr, KdMeshQueryCache* pCache = nullptr);
 
 // スフィアの当たり判定
 bool PolygonsIntersect(const KdPolygon& poly, const DirectX::BoundingSphere& sphere,
 	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr);
 bool MeshIntersect(const KdMesh& mesh, const DirectX::BoundingSphere& sphere,
 	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr);
+bool MeshIntersect(const KdMeshShapeView& mesh, const DirectX::BoundingSphere& sphere,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr, KdMeshQueryCache* pCache = nullptr);
+
+// BOXの当たり判定
+bool PolygonsIntersect(const KdPolygon& poly, const DirectX::BoundingOrientedBox& box,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr);
+bool MeshIntersect(const KdMesh& mesh, const DirectX::BoundingOrientedBox& box,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr);
+bool MeshIntersect(const KdMeshShapeView& mesh, const DirectX::BoundingOrientedBox& box,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr);
+bool HeightfieldIntersect(const KdHeightfield& heightfield, const DirectX::BoundingOrientedBox& box,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr);
+
+// BOX vs BOX・球：結果はtargetを押し出す方向と量
+bool KdBoxIntersect(const DirectX::BoundingOrientedBox& box, const DirectX::BoundingOrientedBox& target, CollisionMeshResult* pResult = nullptr);
+bool KdBoxIntersect(const DirectX::BoundingOrientedBox& box, const DirectX::BoundingSphere& target, CollisionMeshResult* pResult = nullptr);
+
+//=================================================
+// カプセル：線分(m_pos0～m_pos1)からの距離が半径以内の範囲
+//=================================================
+struct KdCapsule
+{
+	KdCapsule() {}
+
+	KdCapsule(const Math::Vector3& pos0, const Math::Vector3& pos1, float radius)
+		: m_pos0(pos0), m_pos1(pos1), m_radius(radius) {}
+
+	// 行列で変換：半径は最も大きい拡大率で拡大する(BoundingSphere::Transformと同じ)
+	void Transform(KdCapsule& out, const DirectX::XMMATRIX& matrix) const;
+
+	Math::Vector3	m_pos0;
+	Math::Vector3	m_pos1;
+	float			m_radius = 0.0f;
+};
+
+// カプセルの移動判定(スイープ)：capsuleをmoveDir(正規化済み)方向へmoveRangeだけ動かした時に最初に当たる位置を求める
+// 座標は全てワールド空間　結果はレイと同じ形式
+// ・m_hitPos			… 接触した形状上の座標
+// ・m_hitDir			… 接触面の法線(形状からカプセルへ向かう方向)
+// ・m_overlapDistance	… moveRange - 接触するまでの移動距離：移動前から重なっている場合はmoveRange + めり込み量
+bool PolygonsSweep(const KdPolygon& poly, const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr);
+bool MeshSweep(const KdMesh& mesh, const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr);
+bool MeshSweep(const KdMeshShapeView& mesh, const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange,
+	const DirectX::XMMATRIX& matrix, CollisionMeshResult* pResult = nullptr);
+bool KdCapsuleSweep(const DirectX::BoundingSphere& sphere, const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange,
+	CollisionMeshResult* pResult = nullptr);
+bool KdCapsuleSweep(const DirectX::BoundingOrientedBox& box, const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange,
+	CollisionMeshResult* pResult = nullptr);
+bool KdCapsuleSweep(const KdCapsule& target, const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange,
+	CollisionMeshResult* pResult = nullptr);
+
+// 三角形とのスイープ：nearestDistより手前で接触した場合だけnearestDistと接触情報を更新する
+// 大量の三角形から最も手前の接触を探す場合に使う(移動前から重なっている場合はnearestDistが負の値になる)
+bool KdCapsuleSweepTriangle(const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir,
+	const DirectX::XMVECTOR& v0, const DirectX::XMVECTOR& v1, const DirectX::XMVECTOR& v2,
+	float& nearestDist, DirectX::XMVECTOR& hitPos, DirectX::XMVECTOR& hitNormal);
+
+// カプセル vs 球・レイ：球の結果はtargetを押し出す方向と量、レイの結果はレイの判定と同じ形式
+bool KdCapsuleIntersect(const KdCapsule& capsule, const DirectX::BoundingSphere& target, CollisionMeshResult* pResult = nullptr);
+bool KdCapsuleIntersect(const KdCapsule& capsule, const DirectX::XMVECTOR& rayPos, const DirectX::XMVECTOR& rayDir, float rayRange,
+	CollisionMeshResult* pResult = nullptr);
+
+// 移動範囲全体を包む境界ボックス
+void KdCalcCapsuleSweptBox(const KdCapsule& capsule, const DirectX::XMVECTOR& moveDir, float moveRange, DirectX::BoundingBox& out);
 
 // 点 vs 三角形面との最近接点を求める
 void KdPointToTriangle(const DirectX::XMVECTOR& point, const DirectX::XMVECTOR& v1,
@@ -0,0 +1,511 @@
+﻿#include "KdCollisionSIMD.h"
+
+#include <immintrin.h>
+#include <intrin.h>
+
+// レイが面と平行かどうかの判定値(DirectX::TriangleTestsと同じ値)
+static constexpr float kRayEpsilon = 1e-20f;
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// 三角形の配置
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+void KdTriangleSoA::Build(const std::vector<Math::Vector3>& positions, const std::vector<KdMeshFace>& faces, const std::vector<UINT>* pOrder)
+{
+	UINT count = static_cast<UINT>(pOrder ? pOrder->size() : faces.size());
+
+	Allocate(count);
+
+	for (UINT i = 0; i < count; ++i)
+	{
+		const UINT* idx = faces[pOrder ? (*pOrder)[i] : i].Idx;
+
+		SetTriangle(i, positions[idx[0]], positions[idx[1]], positions[idx[2]]);
+	}
+}
+
+void KdTriangleSoA::BuildFromStrip(const std::vector<Math::Vector3>& positions)
+{
+	BuildFromStrip(positions.data(), static_cast<UINT>(positions.size()), sizeof(Math::Vector3));
+}
+
+void KdTriangleSoA::BuildFromStrip(const Math::Vector3* pPositions, UINT count, size_t strideBytes)
+{
+	UINT faceNum = count >= 3 ? count - 2 : 0;
+
+	Allocate(faceNum);
+
+	const char* pBytes = reinterpret_cast<const char*>(pPositions);
+	auto position = [&](UINT i) -> const Math::Vector3& { return *reinterpret_cast<const Math::Vector3*>(pBytes + strideBytes * i); };
+
+	for (UINT i = 0; i < faceNum; ++i)
+	{
+		SetTriangle(i, position(i), position(i + 1), position(i + 2));
+	}
+}
+
+void KdTriangleSoA::Attach(const float* pData, UINT count)
+{
+	m_data.clear();
+	m_data.shrink_to_fit();
+
+	m_pAttached = pData;
+	m_count = count;
+	m_stride = CalcStride(count);
+}
+
+void KdTriangleSoA::Allocate(UINT count)
+{
+	m_pAttached = nullptr;
+	m_count = count;
+	m_stride = CalcStride(count);
+
+	m_data.assign(m_stride * ComponentNum, 0.0f);
+}
+
+void KdTriangleSoA::SetTriangle(UINT idx, const Math::Vector3& v0, const Math::Vector3& v1, const Math::Vector3& v2)
+{
+	Math::Vector3 e1 = v1 - v0;
+	Math::Vector3 e2 = v2 - v0;
+
+	m_data[V0X * m_stride + idx] = v0.x;
+	m_data[V0Y * m_stride + idx] = v0.y;
+	m_data[V0Z * m_stride + idx] = v0.z;
+	m_data[E1X * m_stride + idx] = e1.x;
+	m_data[E1Y * m_stride + idx] = e1.y;
+	m_data[E1Z * m_stride + idx] = e1.z;
+	m_data[E2X * m_stride + idx] = e2.x;
+	m_data[E2Y * m_stride + idx] = e2.y;
+	m_data[E2Z * m_stride + idx] = e2.z;
+}
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// 命令セット毎の演算
+// 判定処理本体を1つのテンプレートで書くため、SSE4.1(4個)とAVX2(8個)の命令を同じ名前で包む
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+struct KdSIMDLanesSSE4
+{
+	using V = __m128;
+	static constexpr UINT kNum = 4;
+
+	static V Load(const float* p) { return _mm_loadu_ps(p); }
+	static V Set(float f) { return _mm_set1_ps(f); }
+	static V Add(V a, V b) { return _mm_add_ps(a, b); }
+	static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+	static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+	static V Div(V a, V b) { return _mm_div_ps(a, b); }
+	static V And(V a, V b) { return _mm_and_ps(a, b); }
+	static V Or(V a, V b) { return _mm_or_ps(a, b); }
+	static V LessEq(V a, V b) { return _mm_cmple_ps(a, b); }
+	static V GreaterEq(V a, V b) { return _mm_cmpge_ps(a, b); }
+	// maskが立っている要素はb、それ以外はa
+	static V Select(V a, V b, V mask) { return _mm_blendv_ps(a, b, mask); }
+	static UINT MoveMask(V a) { return static_cast<UINT>(_mm_movemask_ps(a)); }
+	static void Store(float* p, V a) { _mm_storeu_ps(p, a); }
+};
+
+struct KdSIMDLanesAVX2
+{
+	using V = __m256;
+	static constexpr UINT kNum = 8;
+
+	static V Load(const float* p) { return _mm256_loadu_ps(p); }
+	static V Set(float f) { return _mm256_set1_ps(f); }
+	static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+	static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+	static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+	static V Div(V a, V b) { return _mm256_div_ps(a, b); }
+	static V And(V a, V b) { return _mm256_and_ps(a, b); }
+	static V Or(V a, V b) { return _mm256_or_ps(a, b); }
+	static V LessEq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	static V GreaterEq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	static V Select(V a, V b, V mask) { return _mm256_blendv_ps(a, b, mask); }
+	static UINT MoveMask(V a) { return static_cast<UINT>(_mm256_movemask_ps(a)); }
+	static void Store(float* p, V a) { _mm256_storeu_ps(p, a); }
+};
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// レイ vs 三角形(SIMD)
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// DirectX::TriangleTests::Intersectsと同じ式をLanes::kNum個同時に計算する
+// 表面・裏面どちらから当たってもヒットとする
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Lanes>
+static int RayTrianglesNearestSIMD(const KdTriangleSoA& tris, UINT first, UINT count,
+	const Math::Vector3& rayPos, const Math::Vector3& rayDir, float maxDist, float& hitDist)
+{
+	using V = typename Lanes::V;
+
+	const V zero = Lanes::Set(0.0f);
+	const V eps = Lanes::Set(kRayEpsilon);
+	const V negEps = Lanes::Set(-kRayEpsilon);
+
+	const V ox = Lanes::Set(rayPos.x), oy = Lanes::Set(rayPos.y), oz = Lanes::Set(rayPos.z);
+	const V dx = Lanes::Set(rayDir.x), dy = Lanes::Set(rayDir.y), dz = Lanes::Set(rayDir.z);
+
+	int nearestIdx = -1;
+
+	for (UINT base = 0; base < count; base += Lanes::kNum)
+	{
+		UINT offset = first + base;
+
+		V v0x = Lanes::Load(tris.GetComponent(KdTriangleSoA::V0X) + offset);
+		V v0y = Lanes::Load(tris.GetComponent(KdTriangleSoA::V0Y) + offset);
+		V v0z = Lanes::Load(tris.GetComponent(KdTriangleSoA::V0Z) + offset);
+		V e1x = Lanes::Load(tris.GetComponent(KdTriangleSoA::E1X) + offset);
+		V e1y = Lanes::Load(tris.GetComponent(KdTriangleSoA::E1Y) + offset);
+		V e1z = Lanes::Load(tris.GetComponent(KdTriangleSoA::E1Z) + offset);
+		V e2x = Lanes::Load(tris.GetComponent(KdTriangleSoA::E2X) + offset);
+		V e2y = Lanes::Load(tris.GetComponent(KdTriangleSoA::E2Y) + offset);
+		V e2z = Lanes::Load(tris.GetComponent(KdTriangleSoA::E2Z) + offset);
+
+		// p = dir × e2
+		V px = Lanes::Sub(Lanes::Mul(dy, e2z), Lanes::Mul(dz, e2y));
+		V py = Lanes::Sub(Lanes::Mul(dz, e2x), Lanes::Mul(dx, e2z));
+		V pz = Lanes::Sub(Lanes::Mul(dx, e2y), Lanes::Mul(dy, e2x));
+
+		// 行列式
+		V det = Lanes::Add(Lanes::Add(Lanes::Mul(e1x, px), Lanes::Mul(e1y, py)), Lanes::Mul(e1z, pz));
+
+		// s = origin - v0
+		V sx = Lanes::Sub(ox, v0x);
+		V sy = Lanes::Sub(oy, v0y);
+		V sz = Lanes::Sub(oz, v0z);
+
+		V u = Lanes::Add(Lanes::Add(Lanes::Mul(sx, px), Lanes::Mul(sy, py)), Lanes::Mul(sz, pz));
+
+		// q = s × e1
+		V qx = Lanes::Sub(Lanes::Mul(sy, e1z), Lanes::Mul(sz, e1y));
+		V qy = Lanes::Sub(Lanes::Mul(sz, e1x), Lanes::Mul(sx, e1z));
+		V qz = Lanes::Sub(Lanes::Mul(sx, e1y), Lanes::Mul(sy, e1x));
+
+		V v = Lanes::Add(Lanes::Add(Lanes::Mul(dx, qx), Lanes::Mul(dy, qy)), Lanes::Mul(dz, qz));
+		V t = Lanes::Add(Lanes::Add(Lanes::Mul(e2x, qx), Lanes::Mul(e2y, qy)), Lanes::Mul(e2z, qz));
+
+		V uv = Lanes::Add(u, v);
+
+		// 表面から当たる場合：0 <= u <= det, 0 <= v, u + v <= det
+		V front = Lanes::And(Lanes::And(Lanes::GreaterEq(det, eps), Lanes::GreaterEq(u, zero)),
+			Lanes::And(Lanes::And(Lanes::LessEq(u, det), Lanes::GreaterEq(v, zero)), Lanes::LessEq(uv, det)));
+
+		// 裏面から当たる場合：det <= u <= 0, v <= 0, det <= u + v
+		V back = Lanes::And(Lanes::And(Lanes::LessEq(det, negEps), Lanes::LessEq(u, zero)),
+			Lanes::And(Lanes::And(Lanes::GreaterEq(u, det), Lanes::LessEq(v, zero)), Lanes::GreaterEq(uv, det)));
+
+		t = Lanes::Div(t, det);
+
+		V valid = Lanes::And(Lanes::Or(front, back),
+			Lanes::And(Lanes::GreaterEq(t, zero), Lanes::LessEq(t, Lanes::Set(maxDist))));
+
+		UINT hitMask = Lanes::MoveMask(valid);
+
+		// 範囲外の要素を除外
+		UINT laneNum = std::min(Lanes::kNum, count - base);
+		hitMask &= (1u << laneNum) - 1;
+
+		if (!hitMask) { continue; }
+
+		float dists[Lanes::kNum];
+		Lanes::Store(dists, t);
+
+		for (UINT lane = 0; lane < laneNum; ++lane)
+		{
+			if (!(hitMask & (1u << lane))) { continue; }
+
+			if (dists[lane] > maxDist) { continue; }
+
+			// 同じ距離なら先の三角形を優先
+			if (nearestIdx >= 0 && dists[lane] == maxDist) { continue; }
+
+			maxDist = dists[lane];
+			nearestIdx = static_cast<int>(base + lane);
+		}
+	}
+
+	if (nearestIdx >= 0) { hitDist = maxDist; }
+
+	return nearestIdx;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 点 vs 三角形1つ(通常の計算)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+static bool SphereTriangleOverlapScalar(const KdTriangleSoA& tris, UINT idx,
+	const Math::Vector3& center, const Math::Vector3& scale, float radiusSq)
+{
+	Math::Vector3 v0(tris.GetComponent(KdTriangleSoA::V0X)[idx], tris.GetComponent(KdTriangleSoA::V0Y)[idx], tris.GetComponent(KdTriangleSoA::V0Z)[idx]);
+	Math::Vector3 e1(tris.GetComponent(KdTriangleSoA::E1X)[idx], tris.GetComponent(KdTriangleSoA::E1Y)[idx], tris.GetComponent(KdTriangleSoA::E1Z)[idx]);
+	Math::Vector3 e2(tris.GetComponent(KdTriangleSoA::E2X)[idx], tris.GetComponent(KdTriangleSoA::E2Y)[idx], tris.GetComponent(KdTriangleSoA::E2Z)[idx]);
+
+	DirectX::XMVECTOR nearPoint;
+	KdPointToTriangle(center, v0, v0 + e1, v0 + e2, nearPoint);
+
+	Math::Vector3 toCenter = (center - Math::Vector3(nearPoint)) * scale;
+
+	return toCenter.LengthSquared() <= radiusSq;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 点 vs 三角形(SIMD)
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// KdPointToTriangleの領域判定を分岐なしで行う：全ての領域の結果を求め、優先度の低い順に上書きする
+// 最近接点は 頂点0 + 辺1 * v + 辺2 * w の形で求める
+// 面積が0の三角形は全ての領域の割り算が0除算(NaN)になるので、その要素だけ通常の計算で判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Lanes>
+static UINT SphereTrianglesOverlapMaskSIMD(const KdTriangleSoA& tris, UINT first, UINT count,
+	const Math::Vector3& center, const Math::Vector3& scale, float radiusSq)
+{
+	using V = typename Lanes::V;
+
+	const V zero = Lanes::Set(0.0f);
+	const V one = Lanes::Set(1.0f);
+
+	const V cx = Lanes::Set(center.x), cy = Lanes::Set(center.y), cz = Lanes::Set(center.z);
+	const V scx = Lanes::Set(scale.x), scy = Lanes::Set(scale.y), scz = Lanes::Set(scale.z);
+	const V radSq = Lanes::Set(radiusSq);
+
+	UINT result = 0;
+
+	for (UINT base = 0; base < count; base += Lanes::kNum)
+	{
+		UINT offset = first + base;
+
+		V ax = Lanes::Load(tris.GetComponent(KdTriangleSoA::V0X) + offset);
+		V ay = Lanes::Load(tris.GetComponent(KdTriangleSoA::V0Y) + offset);
+		V az = Lanes::Load(tris.GetComponent(KdTriangleSoA::V0Z) + offset);
+		V abx = Lanes::Load(tris.GetComponent(KdTriangleSoA::E1X) + offset);
+		V aby = Lanes::Load(tris.GetComponent(KdTriangleSoA::E1Y) + offset);
+		V abz = Lanes::Load(tris.GetComponent(KdTriangleSoA::E1Z) + offset);
+		V acx = Lanes::Load(tris.GetComponent(KdTriangleSoA::E2X) + offset);
+		V acy = Lanes::Load(tris.GetComponent(KdTriangleSoA::E2Y) + offset);
+		V acz = Lanes::Load(tris.GetComponent(KdTriangleSoA::E2Z) + offset);
+
+		// ap = p - a
+		V apx = Lanes::Sub(cx, ax);
+		V apy = Lanes::Sub(cy, ay);
+		V apz = Lanes::Sub(cz, az);
+
+		V d1 = Lanes::Add(Lanes::Add(Lanes::Mul(abx, apx), Lanes::Mul(aby, apy)), Lanes::Mul(abz, apz));
+		V d2 = Lanes::Add(Lanes::Add(Lanes::Mul(acx, apx), Lanes::Mul(acy, apy)), Lanes::Mul(acz, apz));
+
+		// bp = ap - ab
+		V bpx = Lanes::Sub(apx, abx);
+		V bpy = Lanes::Sub(apy, aby);
+		V bpz = Lanes::Sub(apz, abz);
+
+		V d3 = Lanes::Add(Lanes::Add(Lanes::Mul(abx, bpx), Lanes::Mul(aby, bpy)), Lanes::Mul(abz, bpz));
+		V d4 = Lanes::Add(Lanes::Add(Lanes::Mul(acx, bpx), Lanes::Mul(acy, bpy)), Lanes::Mul(acz, bpz));
+
+		// cp = ap - ac
+		V cpx = Lanes::Sub(apx, acx);
+		V cpy = Lanes::Sub(apy, acy);
+		V cpz = Lanes::Sub(apz, acz);
+
+		V d5 = Lanes::Add(Lanes::Add(Lanes::Mul(abx, cpx), Lanes::Mul(aby, cpy)), Lanes::Mul(abz, cpz));
+		V d6 = Lanes::Add(Lanes::Add(Lanes::Mul(acx, cpx), Lanes::Mul(acy, cpy)), Lanes::Mul(acz, cpz));
+
+		V vc = Lanes::Sub(Lanes::Mul(d1, d4), Lanes::Mul(d3, d2));
+		V vb = Lanes::Sub(Lanes::Mul(d5, d2), Lanes::Mul(d1, d6));
+		V va = Lanes::Sub(Lanes::Mul(d3, d6), Lanes::Mul(d5, d4));
+
+		// va + vb + vc = |辺1 × 辺2|^2：0なら面積が0の三角形
+		V area = Lanes::Add(Lanes::Add(va, vb), vc);
+		UINT degenerateMask = Lanes::MoveMask(Lanes::LessEq(area, zero));
+
+		// 面領域
+		V denom = Lanes::Div(one, area);
+		V v = Lanes::Mul(vb, denom);
+		V w = Lanes::Mul(vc, denom);
+
+		// 辺bc領域
+		V d43 = Lanes::Sub(d4, d3);
+		V d56 = Lanes::Sub(d5, d6);
+		V cond = Lanes::And(Lanes::LessEq(va, zero), Lanes::And(Lanes::GreaterEq(d43, zero), Lanes::GreaterEq(d56, zero)));
+		V t = Lanes::Div(d43, Lanes::Add(d43, d56));
+		v = Lanes::Select(v, Lanes::Sub(one, t), cond);
+		w = Lanes::Select(w, t, cond);
+
+		// 辺ac領域
+		cond = Lanes::And(Lanes::LessEq(vb, zero), Lanes::And(Lanes::GreaterEq(d2, zero), Lanes::LessEq(d6, zero)));
+		v = Lanes::Select(v, zero, cond);
+		w = Lanes::Select(w, Lanes::Div(d2, Lanes::Sub(d2, d6)), cond);
+
+		// 頂点c領域
+		cond = Lanes::And(Lanes::GreaterEq(d6, zero), Lanes::LessEq(d5, d6));
+		v = Lanes::Select(v, zero, cond);
+		w = Lanes::Select(w, one, cond);
+
+		// 辺ab領域
+		cond = Lanes::And(Lanes::LessEq(vc, zero), Lanes::And(Lanes::GreaterEq(d1, zero), Lanes::LessEq(d3, zero)));
+		v = Lanes::Select(v, Lanes::Div(d1, Lanes::Sub(d1, d3)), cond);
+		w = Lanes::Select(w, zero, cond);
+
+		// 頂点b領域
+		cond = Lanes::And(Lanes::GreaterEq(d3, zero), Lanes::LessEq(d4, d3));
+		v = Lanes::Select(v, one, cond);
+		w = Lanes::Select(w, zero, cond);
+
+		// 頂点a領域
+		cond = Lanes::And(Lanes::LessEq(d1, zero), Lanes::LessEq(d2, zero));
+		v = Lanes::Select(v, zero, cond);
+		w = Lanes::Select(w, zero, cond);
+
+		// 最近接点 → 中心 のベクトル(拡縮を考慮)
+		V nx = Lanes::Mul(Lanes::Sub(apx, Lanes::Add(Lanes::Mul(abx, v), Lanes::Mul(acx, w))), scx);
+		V ny = Lanes::Mul(Lanes::Sub(apy, Lanes::Add(Lanes::Mul(aby, v), Lanes::Mul(acy, w))), scy);
+		V nz = Lanes::Mul(Lanes::Sub(apz, Lanes::Add(Lanes::Mul(abz, v), Lanes::Mul(acz, w))), scz);
+
+		V distSq = Lanes::Add(Lanes::Add(Lanes::Mul(nx, nx), Lanes::Mul(ny, ny)), Lanes::Mul(nz, nz));
+
+		UINT hitMask = Lanes::MoveMask(Lanes::LessEq(distSq, radSq));
+
+		// 範囲外の要素を除外
+		UINT laneNum = std::min(Lanes::kNum, count - base);
+		UINT laneMask = (1u << laneNum) - 1;
+
+		degenerateMask &= laneMask;
+		hitMask &= laneMask & ~degenerateMask;
+
+		// 面積が0の三角形
+		while (degenerateMask)
+		{
+			unsigned long lane = 0;
+			_BitScanForward(&lane, degenerateMask);
+			degenerateMask &= degenerateMask - 1;
+
+			if (SphereTriangleOverlapScalar(tris, offset + lane, center, scale, radiusSq)) { hitMask |= 1u << lane; }
+		}
+
+		result |= hitMask << base;
+	}
+
+	return result;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 通常の計算による判定(SSE4.1非対応のCPU用)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+static int RayTrianglesNearestScalar(const KdTriangleSoA& tris, UINT first, UINT count,
+	const Math::Vector3& rayPos, const Math::Vector3& rayDir, float maxDist, float& hitDist)
+{
+	int nearestIdx = -1;
+
+	for (UINT i = 0; i < count; ++i)
+	{
+		UINT idx = first + i;
+
+		Math::Vector3 v0(tris.GetComponent(KdTriangleSoA::V0X)[idx], tris.GetComponent(KdTriangleSoA::V0Y)[idx], tris.GetComponent(KdTriangleSoA::V0Z)[idx]);
+		Math::Vector3 e1(tris.GetComponent(KdTriangleSoA::E1X)[idx], tris.GetComponent(KdTriangleSoA::E1Y)[idx], tris.GetComponent(KdTriangleSoA::E1Z)[idx]);
+		Math::Vector3 e2(tris.GetComponent(KdTriangleSoA::E2X)[idx], tris.GetComponent(KdTriangleSoA::E2Y)[idx], tris.GetComponent(KdTriangleSoA::E2Z)[idx]);
+
+		float dist = FLT_MAX;
+
+		if (!DirectX::TriangleTests::Intersects(rayPos, rayDir, v0, v0 + e1, v0 + e2, dist)) { continue; }
+
+		if (dist > maxDist) { continue; }
+		if (nearestIdx >= 0 && dist == maxDist) { continue; }
+
+		maxDist = dist;
+		nearestIdx = static_cast<int>(i);
+	}
+
+	if (nearestIdx >= 0) { hitDist = maxDist; }
+
+	return nearestIdx;
+}
+
+static UINT SphereTrianglesOverlapMaskScalar(const KdTriangleSoA& tris, UINT first, UINT count,
+	const Math::Vector3& center, const Math::Vector3& scale, float radiusSq)
+{
+	UINT result = 0;
+
+	for (UINT i = 0; i < count; ++i)
+	{
+		if (SphereTriangleOverlapScalar(tris, first + i, center, scale, radiusSq)) { result |= 1u << i; }
+	}
+
+	return result;
+}
+
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+// 実行環境に合わせた切り替え
+// ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### ##### #####
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// CPUの対応命令を調べて使用する関数を決める
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// AVXはOSがYMMレジスタの保存に対応しているかも確認する必要がある
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+struct KdCollisionSIMDDispatch
+{
+	using RayFunc = int(*)(const KdTriangleSoA&, UINT, UINT, const Math::Vector3&, const Math::Vector3&, float, float&);
+	using SphereFunc = UINT(*)(const KdTriangleSoA&, UINT, UINT, const Math::Vector3&, const Math::Vector3&, float);
+
+	RayFunc		m_ray = RayTrianglesNearestScalar;
+	SphereFunc	m_sphere = SphereTrianglesOverlapMaskScalar;
+	const char*	m_name = "Scalar";
+
+	KdCollisionSIMDDispatch()
+	{
+		int regs[4] = {};
+		__cpuid(regs, 0);
+		int maxId = regs[0];
+
+		__cpuid(regs, 1);
+		bool hasSSE41 = (regs[2] & (1 << 19)) != 0;
+		bool hasOSXSAVE = (regs[2] & (1 << 27)) != 0;
+		bool hasAVX = (regs[2] & (1 << 28)) != 0;
+
+		bool hasAVX2 = false;
+		if (maxId >= 7 && hasAVX && hasOSXSAVE)
+		{
+			// XMM・YMMレジスタの状態をOSが保存するか
+			bool isOSSupported = (_xgetbv(0) & 0x6) == 0x6;
+
+			__cpuidex(regs, 7, 0);
+			hasAVX2 = isOSSupported && (regs[1] & (1 << 5)) != 0;
+		}
+
+		if (hasAVX2)
+		{
+			m_ray = RayTrianglesNearestSIMD<KdSIMDLanesAVX2>;
+			m_sphere = SphereTrianglesOverlapMaskSIMD<KdSIMDLanesAVX2>;
+			m_name = "AVX2";
+		}
+		else if (hasSSE41)
+		{
+			m_ray = RayTrianglesNearestSIMD<KdSIMDLanesSSE4>;
+			m_sphere = SphereTrianglesOverlapMaskSIMD<KdSIMDLanesSSE4>;
+			m_name = "SSE4.1";
+		}
+	}
+
+	static const KdCollisionSIMDDispatch& Instance()
+	{
+		static KdCollisionSIMDDispatch instance;
+		return instance;
+	}
+};
+
+int KdRayTrianglesNearest(const KdTriangleSoA& tris, UINT first, UINT count,
+	const Math::Vector3& rayPos, const Math::Vector3& rayDir, float maxDist, float& hitDist)
+{
+	assert(count <= KdTriangleSoA::kLaneNum && "KdRayTrianglesNearest 一度に判定できる三角形の数を超えています");
+
+	return KdCollisionSIMDDispatch::Instance().m_ray(tris, first, count, rayPos, rayDir, maxDist, hitDist);
+}
+
+UINT KdSphereTrianglesOverlapMask(const KdTriangleSoA& tris, UINT first, UINT count,
+	const Math::Vector3& center, const Math::Vector3& scale, float radiusSq)
+{
+	assert(count <= KdTriangleSoA::kLaneNum && "KdSphereTrianglesOverlapMask 一度に判定できる三角形の数を超えています");
+
+	return KdCollisionSIMDDispatch::Instance().m_sphere(tris, first, count, center, scale, radiusSq);
+}
+
+const char* KdGetCollisionSIMDName()
+{
+	return KdCollisionSIMDDispatch::Instance().m_name;
+}
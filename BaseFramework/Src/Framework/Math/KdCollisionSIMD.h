@@ -0,0 +1,84 @@
+﻿#pragma once
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 複数の三角形をまとめて判定するための配置(SoA)
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 三角形毎に頂点を並べる(AoS)のではなく、成分毎に全三角形分を並べることで
+// SIMD命令で4個・8個の三角形を一度に読み込んで判定できるようにする
+// 成分：頂点0の座標(x,y,z) 辺1 = 頂点1 - 頂点0 (x,y,z) 辺2 = 頂点2 - 頂点0 (x,y,z)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdTriangleSoA
+{
+public:
+
+	// 1回の判定でまとめて処理できる最大数
+	static constexpr UINT kLaneNum = 8;
+
+	// 成分の番号
+	enum Component
+	{
+		V0X, V0Y, V0Z,
+		E1X, E1Y, E1Z,
+		E2X, E2Y, E2Z,
+		ComponentNum
+	};
+
+	// メッシュの面から作成：order順に並べる(nullptrなら面の順番)
+	void Build(const std::vector<Math::Vector3>& positions, const std::vector<KdMeshFace>& faces, const std::vector<UINT>* pOrder = nullptr);
+	// 三角形ストリップ(KdPolygonの頂点)から作成
+	void BuildFromStrip(const std::vector<Math::Vector3>& positions);
+	// 頂点構造体の中の座標を直接読み込む：strideBytesは頂点1つ分のバイト数
+	void BuildFromStrip(const Math::Vector3* pPositions, UINT count, size_t strideBytes);
+
+	// 外部の領域(ファイルを割り当てたメモリなど)をそのまま参照する：領域は呼び出し側で保持すること
+	// pDataはGetData()と同じ並びでCalcDataNum(count)個のfloat
+	void Attach(const float* pData, UINT count);
+
+	void Clear() { m_data.clear(); m_pAttached = nullptr; m_count = 0; m_stride = 0; }
+
+	UINT GetCount() const { return m_count; }
+
+	// 成分の配列の先頭：末尾はkLaneNum個分の余白があるので範囲外を気にせず読み込める
+	const float* GetComponent(Component comp) const { return GetData() + comp * m_stride; }
+
+	// 格納領域全体：ファイルへの書き出し用
+	const float* GetData() const { return m_pAttached ? m_pAttached : m_data.data(); }
+
+	// count個の三角形の格納に必要なfloatの数
+	static size_t CalcDataNum(UINT count) { return static_cast<size_t>(CalcStride(count)) * ComponentNum; }
+
+private:
+
+	// 1成分分の要素数：8の倍数に切り上げ + 末尾から8個読み込んでもはみ出さない余白
+	static UINT CalcStride(UINT count) { return ((count + kLaneNum - 1) / kLaneNum) * kLaneNum + kLaneNum; }
+
+	// 格納領域の確保
+	void Allocate(UINT count);
+	// 1つ分の三角形を書き込む
+	void SetTriangle(UINT idx, const Math::Vector3& v0, const Math::Vector3& v1, const Math::Vector3& v2);
+
+	std::vector<float>	m_data;
+	const float*		m_pAttached = nullptr;	// Attach()した外部の領域
+	UINT				m_count = 0;
+	UINT				m_stride = 0;	// 1成分分の要素数(余白込み)
+};
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// SIMDによる判定処理
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 実行環境のCPUに合わせてAVX2(8個ずつ)・SSE4.1(4個ずつ)・通常の計算を自動で切り替える
+// first からcount個(最大kLaneNum個)の三角形を1回で判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+
+// レイ vs 三角形：maxDist以内で最も近いヒットの番号(firstからの相対)と距離を返す　ヒットしなければ-1
+// 判定式はDirectX::TriangleTests::Intersectsと同じ
+int KdRayTrianglesNearest(const KdTriangleSoA& tris, UINT first, UINT count,
+	const Math::Vector3& rayPos, const Math::Vector3& rayDir, float maxDist, float& hitDist);
+
+// 点 vs 三角形：最近接点までの距離の2乗(各軸にscaleを掛けた空間)がradiusSq以下の三角形をビットで返す
+// 判定式はKdPointToTriangleと同じ
+UINT KdSphereTrianglesOverlapMask(const KdTriangleSoA& tris, UINT first, UINT count,
+	const Math::Vector3& center, const Math::Vector3& scale, float radiusSq);
+
+// 使用中の命令セット名
+const char* KdGetCollisionSIMDName();
@@ -0,0 +1,266 @@
+﻿#include "KdCollisionStats.h"
+
+thread_local const char* KdCollisionStats::CallerScope::s_pName = nullptr;
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 計測する値の加算・差分
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionStats::Counters::Add(const Counters& src)
+{
+	m_queryCount += src.m_queryCount;
+	m_shapeTests += src.m_shapeTests;
+	m_hitCount += src.m_hitCount;
+	m_meshTests += src.m_meshTests;
+	m_aabbRejects += src.m_aabbRejects;
+	m_bvhNodeVisits += src.m_bvhNodeVisits;
+	m_triangleTests += src.m_triangleTests;
+}
+
+KdCollisionStats::Counters KdCollisionStats::Counters::Diff(const Counters& begin) const
+{
+	Counters result;
+
+	result.m_queryCount = m_queryCount - begin.m_queryCount;
+	result.m_shapeTests = m_shapeTests - begin.m_shapeTests;
+	result.m_hitCount = m_hitCount - begin.m_hitCount;
+	result.m_meshTests = m_meshTests - begin.m_meshTests;
+	result.m_aabbRejects = m_aabbRejects - begin.m_aabbRejects;
+	result.m_bvhNodeVisits = m_bvhNodeVisits - begin.m_bvhNodeVisits;
+	result.m_triangleTests = m_triangleTests - begin.m_triangleTests;
+
+	return result;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 判定1回分の計測の終了
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+KdCollisionStats::QueryScope::~QueryScope()
+{
+	Counters counters = Current().Diff(m_begin);
+	counters.m_queryCount = 1;
+
+	KdCollisionStats::Instance().Commit(m_kind, m_type, CallerScope::GetName(), counters);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 現在のスレッドの集計途中の値
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+KdCollisionStats::ThreadData& KdCollisionStats::GetThreadData()
+{
+	static thread_local std::shared_ptr<ThreadData> spThreadData;
+
+	if (!spThreadData)
+	{
+		spThreadData = std::make_shared<ThreadData>();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_threads.push_back(spThreadData);
+	}
+
+	return *spThreadData;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 判定1回分を現在のスレッドの集計へ加える
+// 複数の衝突タイプを持つ判定は、それぞれのタイプに加える(タイプ毎の合計は全体の合計と一致しない)
+// ロックはEndFrame()との排他のためだけなので、他のスレッドの判定を待つことはない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionStats::Commit(QueryKind kind, UINT type, const char* caller, const Counters& counters)
+{
+	ThreadData& data = GetThreadData();
+
+	std::lock_guard<std::mutex> lock(data.m_mutex);
+
+	data.m_total.Add(counters);
+
+	for (UINT bit = 0; bit < kTypeBitNum; ++bit)
+	{
+		if (type & (1 << bit)) { data.m_byKindType[kind][bit].Add(counters); }
+	}
+
+	CallerStats& stats = data.m_callers[caller];
+
+	stats.m_total.Add(counters);
+	stats.m_maxTriangleTests = std::max(stats.m_maxTriangleTests, counters.m_triangleTests);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 1フレーム分の集計を確定する
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 各スレッドの集計をまとめ、呼び出し元は名前が同じものを1つにする
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdCollisionStats::EndFrame()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	FrameData frame;
+
+	for (const std::shared_ptr<ThreadData>& spThread : m_threads)
+	{
+		std::lock_guard<std::mutex> threadLock(spThread->m_mutex);
+
+		frame.m_total.Add(spThread->m_total);
+		spThread->m_total = Counters();
+
+		for (int kind = 0; kind < QueryKindNum; ++kind)
+		{
+			for (UINT bit = 0; bit < kTypeBitNum; ++bit)
+			{
+				frame.m_byKindType[kind][bit].Add(spThread->m_byKindType[kind][bit]);
+				spThread->m_byKindType[kind][bit] = Counters();
+			}
+		}
+
+		for (auto& [pName, stats] : spThread->m_callers)
+		{
+			if (!stats.m_total.m_queryCount) { continue; }
+
+			CallerStats& dst = frame.m_callers[pName];
+
+			if (dst.m_name.empty()) { dst.m_name = pName; }
+
+			dst.m_total.Add(stats.m_total);
+			dst.m_maxTriangleTests = std::max(dst.m_maxTriangleTests, stats.m_maxTriangleTests);
+
+			stats = CallerStats();
+		}
+	}
+
+	m_lastFrame = std::move(frame);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 判定した三角形の数が多い呼び出し元
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+std::vector<KdCollisionStats::CallerStats> KdCollisionStats::GetWorstCallers(size_t num) const
+{
+	std::vector<CallerStats> callers;
+	callers.reserve(m_lastFrame.m_callers.size());
+
+	for (const auto& [name, stats] : m_lastFrame.m_callers) { callers.push_back(stats); }
+
+	std::sort(callers.begin(), callers.end(),
+		[](const CallerStats& a, const CallerStats& b) { return a.m_total.m_triangleTests > b.m_total.m_triangleTests; });
+
+	if (callers.size() > num) { callers.resize(num); }
+
+	return callers;
+}
+
+const char* KdCollisionStats::GetQueryKindName(QueryKind kind)
+{
+	switch (kind)
+	{
+	case QuerySphere:	return "Sphere";
+	case QueryBox:		return "Box";
+	case QueryRay:		return "Ray";
+	case QuerySweep:	return "Sweep";
+	default:			return "Unknown";
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// CSVへの書き出し
+// 1列目が"Query"の行は判定の種類 x 衝突タイプ毎、"Caller"の行は呼び出し元毎(三角形の数が多い順)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollisionStats::SaveCSV(std::string_view filename) const
+{
+	std::ofstream ofs(filename.data());
+
+	if (!ofs) { return false; }
+
+	auto writeCounters = [&ofs](const Counters& counters)
+	{
+		ofs << counters.m_queryCount << "," << counters.m_shapeTests << "," << counters.m_hitCount << ","
+			<< counters.m_meshTests << "," << counters.m_aabbRejects << "," << counters.m_bvhNodeVisits << ","
+			<< counters.m_triangleTests;
+	};
+
+	ofs << "Category,Name,TypeBit,Queries,ShapeTests,Hits,MeshTests,AABBRejects,BVHNodeVisits,TriangleTests,MaxTriangleTestsPerQuery\n";
+
+	for (int kind = 0; kind < QueryKindNum; ++kind)
+	{
+		for (UINT bit = 0; bit < kTypeBitNum; ++bit)
+		{
+			const Counters& counters = m_lastFrame.m_byKindType[kind][bit];
+
+			if (!counters.m_queryCount) { continue; }
+
+			ofs << "Query," << GetQueryKindName(static_cast<QueryKind>(kind)) << "," << bit << ",";
+			writeCounters(counters);
+			ofs << ",\n";
+		}
+	}
+
+	for (const CallerStats& caller : GetWorstCallers(m_lastFrame.m_callers.size()))
+	{
+		ofs << "Caller," << caller.m_name << ",,";
+		writeCounters(caller.m_total);
+		ofs << "," << caller.m_maxTriangleTests << "\n";
+	}
+
+	return ofs.good();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// JSONへの書き出し
+// 呼び出し元の名前はコード中の文字列なので、エスケープが必要な文字は含まない前提
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdCollisionStats::SaveJSON(std::string_view filename) const
+{
+	std::ofstream ofs(filename.data());
+
+	if (!ofs) { return false; }
+
+	auto writeCounters = [&ofs](const Counters& counters)
+	{
+		ofs << "\"queries\": " << counters.m_queryCount
+			<< ", \"shapeTests\": " << counters.m_shapeTests
+			<< ", \"hits\": " << counters.m_hitCount
+			<< ", \"meshTests\": " << counters.m_meshTests
+			<< ", \"aabbRejects\": " << counters.m_aabbRejects
+			<< ", \"bvhNodeVisits\": " << counters.m_bvhNodeVisits
+			<< ", \"triangleTests\": " << counters.m_triangleTests;
+	};
+
+	ofs << "{\n\t\"total\": { ";
+	writeCounters(m_lastFrame.m_total);
+	ofs << " },\n\t\"queries\": [";
+
+	bool isFirst = true;
+
+	for (int kind = 0; kind < QueryKindNum; ++kind)
+	{
+		for (UINT bit = 0; bit < kTypeBitNum; ++bit)
+		{
+			const Counters& counters = m_lastFrame.m_byKindType[kind][bit];
+
+			if (!counters.m_queryCount) { continue; }
+
+			ofs << (isFirst ? "\n" : ",\n") << "\t\t{ \"kind\": \"" << GetQueryKindName(static_cast<QueryKind>(kind))
+				<< "\", \"typeBit\": " << bit << ", ";
+			writeCounters(counters);
+			ofs << " }";
+
+			isFirst = false;
+		}
+	}
+
+	ofs << "\n\t],\n\t\"callers\": [";
+
+	isFirst = true;
+
+	for (const CallerStats& caller : GetWorstCallers(m_lastFrame.m_callers.size()))
+	{
+		ofs << (isFirst ? "\n" : ",\n") << "\t\t{ \"name\": \"" << caller.m_name << "\", ";
+		writeCounters(caller.m_total);
+		ofs << ", \"maxTriangleTestsPerQuery\": " << caller.m_maxTriangleTests << " }";
+
+		isFirst = false;
+	}
+
+	ofs << "\n\t]\n}\n";
+
+	return ofs.good();
+}
@@ -0,0 +1,181 @@
+﻿#pragma once
+
+// 当たり判定の計測の有効/無効：0なら計測の処理はコンパイルされない
+// 既定ではDebugビルドのみ有効　Releaseで計測したい場合はプロジェクトの設定で KD_COLLISION_STATS=1 を定義する
+#ifndef KD_COLLISION_STATS
+#ifdef _DEBUG
+#define KD_COLLISION_STATS 1
+#else
+#define KD_COLLISION_STATS 0
+#endif
+#endif
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 当たり判定の計測
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// KdColliderの判定1回毎に、調べた形状・メッシュ・BVHのノード・三角形の数などを数える
+// 判定の種類(球・BOX・レイ・カプセルの移動)と衝突タイプ毎、呼び出し元毎に1フレーム分を集計する
+// 数える処理・判定1回分の集計はどちらも各スレッド専用の値への加算だけなので、並列の判定でも待ちは発生しない
+// 各スレッドの集計はEndFrame()でまとめる
+//
+// 使い方
+// ・KD_COLLISION_STAT_CALLER("Player::UpdateGround") で、その範囲の判定の呼び出し元の名前を付ける
+// ・EndFrame()を毎フレーム1回呼ぶ(Application::KdPostUpdateで呼んでいる)
+// ・GetFrameTotal()などで直前のフレームの集計を取得、SaveCSV()・SaveJSON()でファイルへ書き出す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdCollisionStats
+{
+public:
+
+	// 判定の種類
+	enum QueryKind
+	{
+		QuerySphere,
+		QueryBox,
+		QueryRay,
+		QuerySweep,
+		QueryKindNum
+	};
+
+	// 衝突タイプ(KdCollider::Type)のビットの数
+	static constexpr UINT kTypeBitNum = 8;
+
+	// 計測する値
+	struct Counters
+	{
+		UINT	m_queryCount = 0;		// KdColliderの判定の回数
+		UINT	m_shapeTests = 0;		// 衝突タイプが一致して判定した形状の数
+		UINT	m_hitCount = 0;			// 当たった形状の数
+		UINT	m_meshTests = 0;		// 判定したメッシュ(ポリゴン)の数
+		UINT	m_aabbRejects = 0;		// 境界ボックスだけで外れと分かったメッシュの数
+		UINT	m_bvhNodeVisits = 0;	// 辿ったBVHのノードの数
+		UINT	m_triangleTests = 0;	// 判定した三角形の数
+
+		void Add(const Counters& src);
+		Counters Diff(const Counters& begin) const;
+	};
+
+	// 呼び出し元毎の集計
+	struct CallerStats
+	{
+		std::string	m_name;
+		Counters	m_total;
+		UINT		m_maxTriangleTests = 0;		// 判定1回で最も多く判定した三角形の数
+	};
+
+	static KdCollisionStats& Instance()
+	{
+		static KdCollisionStats instance;
+		return instance;
+	}
+
+	// 1フレーム分の集計を確定して、次のフレームの集計を始める
+	void EndFrame();
+
+	// 直前のフレームの集計
+	const Counters& GetFrameTotal() const { return m_lastFrame.m_total; }
+	const Counters& GetFrameCounters(QueryKind kind, UINT typeBit) const { return m_lastFrame.m_byKindType[kind][typeBit]; }
+
+	// 直前のフレームで判定した三角形の数が多い呼び出し元から順にnum個
+	std::vector<CallerStats> GetWorstCallers(size_t num) const;
+
+	// 直前のフレームの集計の書き出し
+	// ・CSV	… 判定の種類 x 衝突タイプ毎の行と、呼び出し元毎の行
+	// ・JSON	… 合計・判定の種類 x 衝突タイプ毎・呼び出し元毎(三角形の数が多い順)
+	bool SaveCSV(std::string_view filename) const;
+	bool SaveJSON(std::string_view filename) const;
+
+	// 判定処理から加算する、現在のスレッドの値
+	static Counters& Current()
+	{
+		static thread_local Counters counters;
+		return counters;
+	}
+
+	// 呼び出し元の名前を付ける範囲：範囲内でKdColliderの判定を行うとこの名前で集計される
+	class CallerScope
+	{
+	public:
+		CallerScope(const char* name) : m_pPrevName(s_pName) { s_pName = name; }
+		~CallerScope() { s_pName = m_pPrevName; }
+
+		static const char* GetName() { return s_pName ? s_pName : "(unknown)"; }
+
+	private:
+		const char*	m_pPrevName;
+
+		static thread_local const char* s_pName;
+	};
+
+	// KdColliderの判定1回分の計測範囲：開始時の値との差を集計へ加える
+	class QueryScope
+	{
+	public:
+		QueryScope(QueryKind kind, UINT type) : m_kind(kind), m_type(type), m_begin(Current()) {}
+		~QueryScope();
+
+	private:
+		QueryKind	m_kind;
+		UINT		m_type;
+		Counters	m_begin;
+	};
+
+private:
+
+	// 1フレーム分の集計
+	struct FrameData
+	{
+		Counters	m_total;
+		Counters	m_byKindType[QueryKindNum][kTypeBitNum];
+
+		std::unordered_map<std::string, CallerStats>	m_callers;
+	};
+
+	// スレッド毎の集計途中の値
+	// 呼び出し元は名前の文字列のアドレスで引く：同じ名前の別の文字列はEndFrame()でまとめる
+	// 呼び出し元の要素はフレームを跨いで残し、値だけを0に戻す(毎フレームの確保を避ける)
+	struct ThreadData
+	{
+		Counters	m_total;
+		Counters	m_byKindType[QueryKindNum][kTypeBitNum];
+
+		std::unordered_map<const char*, CallerStats>	m_callers;
+
+		// EndFrame()での回収と、このスレッドの加算の排他制御：他のスレッドとは競合しない
+		std::mutex	m_mutex;
+	};
+
+	// 現在のスレッドの集計途中の値：初回に登録する
+	ThreadData& GetThreadData();
+
+	// 判定1回分を現在のスレッドの集計へ加える
+	void Commit(QueryKind kind, UINT type, const char* caller, const Counters& counters);
+
+	static const char* GetQueryKindName(QueryKind kind);
+
+	// スレッドの登録とEndFrame()の排他制御
+	std::mutex	m_mutex;
+
+	// 判定を行った全てのスレッドの集計：スレッドが終了しても回収するまで残す
+	std::vector<std::shared_ptr<ThreadData>>	m_threads;
+
+	FrameData	m_lastFrame;
+
+	KdCollisionStats() {}
+	~KdCollisionStats() {}
+
+	// コピー禁止用
+	KdCollisionStats(const KdCollisionStats& src) = delete;
+	void operator=(const KdCollisionStats& src) = delete;
+};
+
+// 計測用のマクロ：KD_COLLISION_STATSが0なら何もしない
+#if KD_COLLISION_STATS
+#define KD_COLLISION_STAT_ADD(counter, num)		(KdCollisionStats::Current().counter += static_cast<UINT>(num))
+#define KD_COLLISION_STAT_QUERY(kind, type)		KdCollisionStats::QueryScope kdCollisionStatQuery(kind, type)
+#define KD_COLLISION_STAT_CALLER(name)			KdCollisionStats::CallerScope kdCollisionStatCaller(name)
+#else
+#define KD_COLLISION_STAT_ADD(counter, num)		((void)0)
+#define KD_COLLISION_STAT_QUERY(kind, type)		((void)0)
+#define KD_COLLISION_STAT_CALLER(name)			((void)0)
+#endif
@@ -0,0 +1,116 @@
+﻿#include "KdContactCache.h"
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// メッシュの記録を取得
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 記録の数は判定する側の周囲のメッシュの数程度なので、線形に探す
+// 行列の比較は完全一致：動いていないメッシュだけ記録を使い回す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+KdMeshQueryCache& KdContactCache::Acquire(const void* pOwner, int nodeIdx, const KdMesh* pMesh, const Math::Matrix& meshWorld, UINT version)
+{
+	++m_useCount;
+
+	Entry* pTarget = nullptr;
+
+	for (Entry& entry : m_entries)
+	{
+		if (entry.m_pOwner == pOwner && entry.m_nodeIdx == nodeIdx)
+		{
+			pTarget = &entry;
+			break;
+		}
+	}
+
+	if (!pTarget)
+	{
+		if (m_entries.size() < kMaxEntryNum)
+		{
+			pTarget = &m_entries.emplace_back();
+		}
+		else
+		{
+			// 最も長く使っていない記録を使い回す
+			pTarget = &*std::min_element(m_entries.begin(), m_entries.end(),
+				[](const Entry& a, const Entry& b) { return a.m_lastUsed < b.m_lastUsed; });
+		}
+
+		AddStats(pTarget->m_query);
+
+		pTarget->m_pOwner = pOwner;
+		pTarget->m_nodeIdx = nodeIdx;
+		pTarget->m_pMesh = nullptr;
+		pTarget->m_query.m_hitCount = 0;
+		pTarget->m_query.m_missCount = 0;
+	}
+
+	// 形状・行列・版のどれかが変わっていれば記録は使えない
+	if (pTarget->m_pMesh != pMesh || pTarget->m_version != version ||
+		memcmp(&pTarget->m_meshWorld, &meshWorld, sizeof(Math::Matrix)) != 0)
+	{
+		pTarget->m_pMesh = pMesh;
+		pTarget->m_version = version;
+		pTarget->m_meshWorld = meshWorld;
+		pTarget->m_query.Reset();
+	}
+
+	pTarget->m_lastUsed = m_useCount;
+
+	return pTarget->m_query;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 全ての記録を捨てる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdContactCache::Clear()
+{
+	for (const Entry& entry : m_entries) { AddStats(entry.m_query); }
+
+	m_entries.clear();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 統計
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+UINT KdContactCache::GetHitCount() const
+{
+	UINT count = m_discardedHitCount;
+
+	for (const Entry& entry : m_entries) { count += entry.m_query.m_hitCount; }
+
+	return count;
+}
+
+UINT KdContactCache::GetMissCount() const
+{
+	UINT count = m_discardedMissCount;
+
+	for (const Entry& entry : m_entries) { count += entry.m_query.m_missCount; }
+
+	return count;
+}
+
+float KdContactCache::GetHitRate() const
+{
+	UINT hitCount = GetHitCount();
+	UINT totalCount = hitCount + GetMissCount();
+
+	return totalCount ? static_cast<float>(hitCount) / totalCount : 0.0f;
+}
+
+void KdContactCache::ResetStats()
+{
+	m_discardedHitCount = 0;
+	m_discardedMissCount = 0;
+
+	for (Entry& entry : m_entries)
+	{
+		entry.m_query.m_hitCount = 0;
+		entry.m_query.m_missCount = 0;
+	}
+}
+
+void KdContactCache::AddStats(const KdMeshQueryCache& query)
+{
+	m_discardedHitCount += query.m_hitCount;
+	m_discardedMissCount += query.m_missCount;
+}
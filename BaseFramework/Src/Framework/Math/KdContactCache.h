@@ -0,0 +1,60 @@
+﻿#pragma once
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 判定する側が持つ、前回の判定で使った面の記録
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 接地判定のレイやキャラクターの球は、毎フレームほぼ同じ位置で同じ面に当たる
+// 判定したメッシュ毎に前回の候補の面・当たった面を記録しておき、次の判定ではそれを先に使う
+// 記録はメッシュとそのワールド行列(スキンメッシュは姿勢)が前回と同じ場合だけ使い、変わっていれば捨てる
+// 記録を使えない場合は通常の判定になるので、結果は記録の有無で変わらない
+//
+// 使い方
+// ・判定する側のオブジェクトがメンバーとして持ち、SphereInfo・RayInfoのm_pCacheに指定する
+// ・同じ記録を複数のスレッドから同時に使わないこと(判定する側毎に持つ)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdContactCache
+{
+public:
+
+	// 判定したメッシュ1つ分の記録
+	struct Entry
+	{
+		const void*			m_pOwner = nullptr;		// 判定した形状(モデルなど)
+		int					m_nodeIdx = -1;			// 形状の中のメッシュの番号
+		const KdMesh*		m_pMesh = nullptr;
+		Math::Matrix		m_meshWorld;			// 記録した時のメッシュのワールド行列
+		UINT				m_version = 0;			// 記録した時の形状の版(スキンメッシュの姿勢の番号など)
+		UINT				m_lastUsed = 0;			// 最後に使った時の番号：古いものから捨てる
+
+		KdMeshQueryCache	m_query;
+	};
+
+	// メッシュの記録を取得：無ければ作り、行列や版が前回と異なれば中身を捨ててから返す
+	// 返した記録は次にAcquire()を呼ぶまで有効
+	KdMeshQueryCache& Acquire(const void* pOwner, int nodeIdx, const KdMesh* pMesh, const Math::Matrix& meshWorld, UINT version);
+
+	// 全ての記録を捨てる：ワープなどで前回と全く違う場所で判定する場合
+	void Clear();
+
+	// 統計：記録を使えた・使えなかった判定の回数
+	UINT GetHitCount() const;
+	UINT GetMissCount() const;
+	// 記録を使えた割合(0～1)：判定していなければ0
+	float GetHitRate() const;
+	void ResetStats();
+
+private:
+
+	// 保持する記録の最大数：これを超えたら最も長く使っていないものを使い回す
+	static constexpr size_t kMaxEntryNum = 16;
+
+	// 捨てた記録の統計を足し込む
+	void AddStats(const KdMeshQueryCache& query);
+
+	std::vector<Entry>	m_entries;
+	UINT				m_useCount = 0;
+
+	// 捨てた記録の統計
+	UINT				m_discardedHitCount = 0;
+	UINT				m_discardedMissCount = 0;
+};
@@ -0,0 +1,424 @@
+﻿#include "KdDynamicAABBTree.h"
+
+// 箱の表面積
+static float CalcSurfaceArea(const Math::Vector3& vMin, const Math::Vector3& vMax)
+{
+	Math::Vector3 e = vMax - vMin;
+
+	return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// プロキシの作成
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+int KdDynamicAABBTree::CreateProxy(const DirectX::BoundingBox& aabb, UINT userData)
+{
+	int proxyId = AllocateNode();
+
+	Node& node = m_nodes[proxyId];
+	node.m_min = Math::Vector3(aabb.Center) - Math::Vector3(aabb.Extents) - Math::Vector3(m_margin);
+	node.m_max = Math::Vector3(aabb.Center) + Math::Vector3(aabb.Extents) + Math::Vector3(m_margin);
+	node.m_userData = userData;
+	node.m_height = 0;
+
+	InsertLeaf(proxyId);
+
+	++m_proxyCount;
+
+	return proxyId;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// プロキシの削除
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdDynamicAABBTree::DestroyProxy(int proxyId)
+{
+	if (proxyId < 0 || proxyId >= static_cast<int>(m_nodes.size()) || !m_nodes[proxyId].IsLeaf() || m_nodes[proxyId].m_height < 0)
+	{
+		assert(0 && "KdDynamicAABBTree::DestroyProxy 無効なプロキシIDです");
+
+		return;
+	}
+
+	RemoveLeaf(proxyId);
+	FreeNode(proxyId);
+
+	--m_proxyCount;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// プロキシの移動
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 新しい箱がファットAABBに収まっていれば何もしない
+// 収まっていても、ファットAABBが新しい箱に比べて大き過ぎる場合(縮んだ・テレポートで大きく外した後など)は作り直す
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdDynamicAABBTree::MoveProxy(int proxyId, const DirectX::BoundingBox& aabb)
+{
+	Math::Vector3 boxMin = Math::Vector3(aabb.Center) - Math::Vector3(aabb.Extents);
+	Math::Vector3 boxMax = Math::Vector3(aabb.Center) + Math::Vector3(aabb.Extents);
+
+	Node& node = m_nodes[proxyId];
+
+	bool isContained =
+		node.m_min.x <= boxMin.x && node.m_min.y <= boxMin.y && node.m_min.z <= boxMin.z &&
+		boxMax.x <= node.m_max.x && boxMax.y <= node.m_max.y && boxMax.z <= node.m_max.z;
+
+	if (isContained)
+	{
+		// 余白の4倍以上大きくなっていなければそのまま
+		Math::Vector3 hugeMin = boxMin - Math::Vector3(m_margin * 4.0f);
+		Math::Vector3 hugeMax = boxMax + Math::Vector3(m_margin * 4.0f);
+
+		bool isHuge =
+			node.m_min.x < hugeMin.x || node.m_min.y < hugeMin.y || node.m_min.z < hugeMin.z ||
+			hugeMax.x < node.m_max.x || hugeMax.y < node.m_max.y || hugeMax.z < node.m_max.z;
+
+		if (!isHuge) { return false; }
+	}
+
+	RemoveLeaf(proxyId);
+
+	m_nodes[proxyId].m_min = boxMin - Math::Vector3(m_margin);
+	m_nodes[proxyId].m_max = boxMax + Math::Vector3(m_margin);
+
+	InsertLeaf(proxyId);
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ファットAABBの取得
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdDynamicAABBTree::GetFatAABB(int proxyId, DirectX::BoundingBox& out) const
+{
+	const Node& node = m_nodes[proxyId];
+
+	out.Center = (node.m_min + node.m_max) * 0.5f;
+	out.Extents = (node.m_max - node.m_min) * 0.5f;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 解放
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdDynamicAABBTree::Release()
+{
+	m_nodes.clear();
+
+	m_root = kNullNode;
+	m_freeList = kNullNode;
+	m_proxyCount = 0;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ノードの確保：未使用のノードがあれば再利用する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+int KdDynamicAABBTree::AllocateNode()
+{
+	int nodeIdx = m_freeList;
+
+	if (nodeIdx == kNullNode)
+	{
+		nodeIdx = static_cast<int>(m_nodes.size());
+		m_nodes.emplace_back();
+	}
+	else
+	{
+		m_freeList = m_nodes[nodeIdx].m_next;
+	}
+
+	Node& node = m_nodes[nodeIdx];
+	node.m_parent = kNullNode;
+	node.m_next = kNullNode;
+	node.m_child1 = kNullNode;
+	node.m_child2 = kNullNode;
+	node.m_height = 0;
+	node.m_userData = 0;
+
+	return nodeIdx;
+}
+
+void KdDynamicAABBTree::FreeNode(int nodeIdx)
+{
+	Node& node = m_nodes[nodeIdx];
+	node.m_next = m_freeList;
+	node.m_child1 = kNullNode;
+	node.m_child2 = kNullNode;
+	node.m_height = -1;
+
+	m_freeList = nodeIdx;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 葉の挿入
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// ルートから、葉を含めた時の表面積の増加が少ない方の子へ降りていき、
+// 降りるよりその場で兄弟にした方が安い位置で新しい枝を作って繋ぐ
+// コスト = 新しい枝の表面積 + 祖先の箱が広がる分の表面積(継承コスト)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdDynamicAABBTree::InsertLeaf(int leaf)
+{
+	if (m_root == kNullNode)
+	{
+		m_root = leaf;
+		m_nodes[leaf].m_parent = kNullNode;
+
+		return;
+	}
+
+	const Math::Vector3 leafMin = m_nodes[leaf].m_min;
+	const Math::Vector3 leafMax = m_nodes[leaf].m_max;
+
+	//------------------------------
+	// 兄弟にするノードを探す
+	//------------------------------
+	int index = m_root;
+
+	while (!m_nodes[index].IsLeaf())
+	{
+		const Node& node = m_nodes[index];
+
+		float area = CalcSurfaceArea(node.m_min, node.m_max);
+
+		float combinedArea = CalcSurfaceArea(Math::Vector3::Min(node.m_min, leafMin), Math::Vector3::Max(node.m_max, leafMax));
+
+		// ここで兄弟にする場合のコスト
+		float cost = 2.0f * combinedArea;
+
+		// これより下に降りる場合に、このノードの箱が広がる分のコスト
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		// 子へ降りる場合のコスト
+		auto calcDescendCost = [&](int childIdx)
+		{
+			const Node& child = m_nodes[childIdx];
+
+			float childCombinedArea = CalcSurfaceArea(Math::Vector3::Min(child.m_min, leafMin), Math::Vector3::Max(child.m_max, leafMax));
+
+			if (child.IsLeaf()) { return childCombinedArea + inheritanceCost; }
+
+			return (childCombinedArea - CalcSurfaceArea(child.m_min, child.m_max)) + inheritanceCost;
+		};
+
+		float cost1 = calcDescendCost(node.m_child1);
+		float cost2 = calcDescendCost(node.m_child2);
+
+		if (cost < cost1 && cost < cost2) { break; }
+
+		index = cost1 < cost2 ? node.m_child1 : node.m_child2;
+	}
+
+	int sibling = index;
+
+	//------------------------------
+	// 兄弟と葉をまとめる枝を作成
+	//------------------------------
+	int oldParent = m_nodes[sibling].m_parent;
+	int newParent = AllocateNode();
+
+	m_nodes[newParent].m_parent = oldParent;
+	m_nodes[newParent].m_height = m_nodes[sibling].m_height + 1;
+	m_nodes[newParent].m_child1 = sibling;
+	m_nodes[newParent].m_child2 = leaf;
+	SetUnion(newParent, sibling, leaf);
+
+	if (oldParent != kNullNode)
+	{
+		if (m_nodes[oldParent].m_child1 == sibling)
+		{
+			m_nodes[oldParent].m_child1 = newParent;
+		}
+		else
+		{
+			m_nodes[oldParent].m_child2 = newParent;
+		}
+	}
+	else
+	{
+		m_root = newParent;
+	}
+
+	m_nodes[sibling].m_parent = newParent;
+	m_nodes[leaf].m_parent = newParent;
+
+	RefitAncestors(m_nodes[leaf].m_parent);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 葉の取り外し：親の枝を取り除き、兄弟を祖父に直接繋ぐ
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdDynamicAABBTree::RemoveLeaf(int leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = kNullNode;
+
+		return;
+	}
+
+	int parent = m_nodes[leaf].m_parent;
+	int grandParent = m_nodes[parent].m_parent;
+	int sibling = m_nodes[parent].m_child1 == leaf ? m_nodes[parent].m_child2 : m_nodes[parent].m_child1;
+
+	if (grandParent != kNullNode)
+	{
+		if (m_nodes[grandParent].m_child1 == parent)
+		{
+			m_nodes[grandParent].m_child1 = sibling;
+		}
+		else
+		{
+			m_nodes[grandParent].m_child2 = sibling;
+		}
+
+		m_nodes[sibling].m_parent = grandParent;
+		FreeNode(parent);
+
+		RefitAncestors(grandParent);
+	}
+	else
+	{
+		m_root = sibling;
+		m_nodes[sibling].m_parent = kNullNode;
+		FreeNode(parent);
+	}
+
+	m_nodes[leaf].m_parent = kNullNode;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 親を辿りながら箱と高さを更新し、釣り合いを取る
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdDynamicAABBTree::RefitAncestors(int nodeIdx)
+{
+	while (nodeIdx != kNullNode)
+	{
+		nodeIdx = Balance(nodeIdx);
+
+		Node& node = m_nodes[nodeIdx];
+
+		node.m_height = 1 + std::max(m_nodes[node.m_child1].m_height, m_nodes[node.m_child2].m_height);
+		SetUnion(nodeIdx, node.m_child1, node.m_child2);
+
+		nodeIdx = node.m_parent;
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 回転による釣り合い
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// ノードAの子B・Cの高さの差が2以上の場合、高い方の子をAの位置に持ち上げる
+// 持ち上げた子の2つの子のうち、高い方をそのまま残し、低い方をAの子にする
+//
+//         A                C
+//       /   \            /   \
+//      B     C    →     A     F(高い方)
+//           / \        / \
+//          F   G      B   G
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+int KdDynamicAABBTree::Balance(int iA)
+{
+	Node& A = m_nodes[iA];
+
+	if (A.IsLeaf() || A.m_height < 2) { return iA; }
+
+	int iB = A.m_child1;
+	int iC = A.m_child2;
+
+	Node& B = m_nodes[iB];
+	Node& C = m_nodes[iC];
+
+	int balance = C.m_height - B.m_height;
+
+	// 持ち上げたノードをAの親に繋ぎ直す
+	auto replaceParentLink = [&](int iUp)
+	{
+		int parent = m_nodes[iUp].m_parent;
+
+		if (parent == kNullNode)
+		{
+			m_root = iUp;
+		}
+		else if (m_nodes[parent].m_child1 == iA)
+		{
+			m_nodes[parent].m_child1 = iUp;
+		}
+		else
+		{
+			m_nodes[parent].m_child2 = iUp;
+		}
+	};
+
+	//------------------------------
+	// Cを持ち上げる
+	//------------------------------
+	if (balance > 1)
+	{
+		int iF = C.m_child1;
+		int iG = C.m_child2;
+
+		C.m_child1 = iA;
+		C.m_parent = A.m_parent;
+		A.m_parent = iC;
+
+		replaceParentLink(iC);
+
+		// 高い方をCに残し、低い方をAに移す
+		int iKeep = iF;
+		int iMove = iG;
+		if (m_nodes[iF].m_height <= m_nodes[iG].m_height) { std::swap(iKeep, iMove); }
+
+		C.m_child2 = iKeep;
+		A.m_child2 = iMove;
+		m_nodes[iMove].m_parent = iA;
+
+		SetUnion(iA, iB, iMove);
+		SetUnion(iC, iA, iKeep);
+
+		A.m_height = 1 + std::max(B.m_height, m_nodes[iMove].m_height);
+		C.m_height = 1 + std::max(A.m_height, m_nodes[iKeep].m_height);
+
+		return iC;
+	}
+
+	//------------------------------
+	// Bを持ち上げる
+	//------------------------------
+	if (balance < -1)
+	{
+		int iD = B.m_child1;
+		int iE = B.m_child2;
+
+		B.m_child1 = iA;
+		B.m_parent = A.m_parent;
+		A.m_parent = iB;
+
+		replaceParentLink(iB);
+
+		int iKeep = iD;
+		int iMove = iE;
+		if (m_nodes[iD].m_height <= m_nodes[iE].m_height) { std::swap(iKeep, iMove); }
+
+		B.m_child2 = iKeep;
+		A.m_child1 = iMove;
+		m_nodes[iMove].m_parent = iA;
+
+		SetUnion(iA, iC, iMove);
+		SetUnion(iB, iA, iKeep);
+
+		A.m_height = 1 + std::max(C.m_height, m_nodes[iMove].m_height);
+		B.m_height = 1 + std::max(A.m_height, m_nodes[iKeep].m_height);
+
+		return iB;
+	}
+
+	return iA;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 2つのノードを包む箱を設定
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdDynamicAABBTree::SetUnion(int nodeIdx, int childA, int childB)
+{
+	m_nodes[nodeIdx].m_min = Math::Vector3::Min(m_nodes[childA].m_min, m_nodes[childB].m_min);
+	m_nodes[nodeIdx].m_max = Math::Vector3::Max(m_nodes[childA].m_max, m_nodes[childB].m_max);
+}
@@ -0,0 +1,193 @@
+﻿#pragma once
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 動くオブジェクトの境界ボックスを管理する木構造(動的AABBツリー)
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 葉1つ(プロキシ)が1つのオブジェクトの境界ボックスを持ち、枝は子の境界ボックスを包む
+// 葉には余白を足した大きめの箱(ファットAABB)を登録し、その中で動いている間は木を組み替えない
+// 追加時は表面積の増加が最も少ない位置に挿入し、左右の高さの差が2以上になったら回転して釣り合いを取る
+// 削除・追加を繰り返しても作り直しが不要なので、毎フレーム動くオブジェクトの広域判定(ブロードフェイズ)に使う
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdDynamicAABBTree
+{
+public:
+
+	// 無効なノード番号
+	static constexpr int kNullNode = -1;
+
+	// 木の1ノード
+	struct Node
+	{
+		Math::Vector3	m_min;
+		Math::Vector3	m_max;
+
+		UINT	m_userData = 0;			// 葉：登録時に指定した任意の値
+
+		int		m_parent = kNullNode;
+		int		m_next = kNullNode;		// 未使用ノードのリスト
+		int		m_child1 = kNullNode;
+		int		m_child2 = kNullNode;
+
+		int		m_height = -1;			// 葉：0　未使用：-1
+
+		bool IsLeaf() const { return m_child1 == kNullNode; }
+	};
+
+	KdDynamicAABBTree() {}
+	~KdDynamicAABBTree() { Release(); }
+
+	// 余白の大きさ：登録した箱の各面をこの距離だけ広げる
+	void SetMargin(float margin) { m_margin = margin; }
+	float GetMargin() const { return m_margin; }
+
+	// プロキシの作成：戻り値のIDで移動・削除を行う
+	int CreateProxy(const DirectX::BoundingBox& aabb, UINT userData);
+	// プロキシの削除
+	void DestroyProxy(int proxyId);
+	// プロキシの移動：ファットAABBからはみ出した時だけ木を組み替える　戻り値：組み替えたか
+	bool MoveProxy(int proxyId, const DirectX::BoundingBox& aabb);
+
+	UINT GetUserData(int proxyId) const { return m_nodes[proxyId].m_userData; }
+	void SetUserData(int proxyId, UINT userData) { m_nodes[proxyId].m_userData = userData; }
+
+	// ファットAABBの取得
+	void GetFatAABB(int proxyId, DirectX::BoundingBox& out) const;
+
+	// 箱と重なるプロキシを辿る
+	// ・onProxy … bool(int proxyId)：falseを返すと終了
+	template<class Func>
+	void Query(const Math::Vector3& boxMin, const Math::Vector3& boxMax, Func onProxy) const;
+
+	// レイと重なるプロキシを辿る
+	// ・rayPos/rayDir	… レイ(rayDirは正規化済み)
+	// ・onProxy		… float(int proxyId, float maxDist)：以降の判定限界距離を返す　0未満を返すと終了
+	template<class Func>
+	void RayCast(const Math::Vector3& rayPos, const Math::Vector3& rayDir, float maxDist, Func onProxy) const;
+
+	// 木の高さ(葉だけなら0)
+	int GetHeight() const { return m_root == kNullNode ? 0 : m_nodes[m_root].m_height; }
+	// 使用中のプロキシ数
+	UINT GetProxyCount() const { return m_proxyCount; }
+
+	void Release();
+
+private:
+
+	// ノードの確保・解放
+	int AllocateNode();
+	void FreeNode(int nodeIdx);
+
+	// 葉の挿入・取り外し
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+
+	// 親を辿りながら箱と高さを更新し、釣り合いを取る
+	void RefitAncestors(int nodeIdx);
+
+	// 左右の子の高さの差が2以上なら回転する　戻り値：回転後にこの位置に来たノード
+	int Balance(int nodeIdx);
+
+	// 2つのノードを包む箱を設定
+	void SetUnion(int nodeIdx, int childA, int childB);
+
+	// 辿る時のスタックの大きさ：釣り合いを取っているので数百万個のプロキシでも足りる
+	static constexpr int kStackSize = 128;
+
+	std::vector<Node>	m_nodes;
+
+	int		m_root = kNullNode;
+	int		m_freeList = kNullNode;
+	UINT	m_proxyCount = 0;
+
+	float	m_margin = 0.1f;
+};
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 箱と重なるプロキシを辿る
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Func>
+void KdDynamicAABBTree::Query(const Math::Vector3& boxMin, const Math::Vector3& boxMax, Func onProxy) const
+{
+	if (m_root == kNullNode) { return; }
+
+	int stack[kStackSize];
+	int stackTop = 0;
+	stack[stackTop++] = m_root;
+
+	while (stackTop > 0)
+	{
+		const Node& node = m_nodes[stack[--stackTop]];
+
+		if (node.m_min.x > boxMax.x || node.m_max.x < boxMin.x ||
+			node.m_min.y > boxMax.y || node.m_max.y < boxMin.y ||
+			node.m_min.z > boxMax.z || node.m_max.z < boxMin.z)
+		{
+			continue;
+		}
+
+		if (node.IsLeaf())
+		{
+			if (!onProxy(static_cast<int>(&node - m_nodes.data()))) { return; }
+
+			continue;
+		}
+
+		assert(stackTop + 2 <= kStackSize && "KdDynamicAABBTree::Query 木が深すぎます");
+
+		stack[stackTop++] = node.m_child1;
+		stack[stackTop++] = node.m_child2;
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// レイと重なるプロキシを辿る
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 箱との判定はスラブ法：コールバックが判定限界距離を縮めると、それより遠い箱は飛ばす
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Func>
+void KdDynamicAABBTree::RayCast(const Math::Vector3& rayPos, const Math::Vector3& rayDir, float maxDist, Func onProxy) const
+{
+	if (m_root == kNullNode) { return; }
+
+	Math::Vector3 invDir(1.0f / rayDir.x, 1.0f / rayDir.y, 1.0f / rayDir.z);
+
+	int stack[kStackSize];
+	int stackTop = 0;
+	stack[stackTop++] = m_root;
+
+	while (stackTop > 0)
+	{
+		const Node& node = m_nodes[stack[--stackTop]];
+
+		float tx1 = (node.m_min.x - rayPos.x) * invDir.x;
+		float tx2 = (node.m_max.x - rayPos.x) * invDir.x;
+		float tMin = std::min(tx1, tx2);
+		float tMax = std::max(tx1, tx2);
+
+		float ty1 = (node.m_min.y - rayPos.y) * invDir.y;
+		float ty2 = (node.m_max.y - rayPos.y) * invDir.y;
+		tMin = std::max(tMin, std::min(ty1, ty2));
+		tMax = std::min(tMax, std::max(ty1, ty2));
+
+		float tz1 = (node.m_min.z - rayPos.z) * invDir.z;
+		float tz2 = (node.m_max.z - rayPos.z) * invDir.z;
+		tMin = std::max(tMin, std::min(tz1, tz2));
+		tMax = std::min(tMax, std::max(tz1, tz2));
+
+		if (tMax < tMin || tMax < 0.0f || tMin > maxDist) { continue; }
+
+		if (node.IsLeaf())
+		{
+			maxDist = onProxy(static_cast<int>(&node - m_nodes.data()), maxDist);
+
+			if (maxDist < 0.0f) { return; }
+
+			continue;
+		}
+
+		assert(stackTop + 2 <= kStackSize && "KdDynamicAABBTree::RayCast 木が深すぎます");
+
+		stack[stackTop++] = node.m_child1;
+		stack[stackTop++] = node.m_child2;
+	}
+}
@@ -0,0 +1,527 @@
+﻿#include "KdHeightfield.h"
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 高さの配列から作成
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdHeightfield::Create(const std::vector<float>& heights, UINT vertNumX, UINT vertNumZ, const Math::Vector3& origin, float cellSize)
+{
+	Release();
+
+	// 少なくとも1マス分の頂点が必要
+	if (vertNumX < 2 || vertNumZ < 2 || heights.size() != static_cast<size_t>(vertNumX) * vertNumZ)
+	{
+		assert(0 && "KdHeightfield::Create：頂点数と高さの数が一致していません");
+
+		return false;
+	}
+
+	if (cellSize <= 0.0f)
+	{
+		assert(0 && "KdHeightfield::Create：マスの大きさが0以下です");
+
+		return false;
+	}
+
+	m_heights = heights;
+
+	m_vertNumX = vertNumX;
+	m_vertNumZ = vertNumZ;
+
+	m_origin = origin;
+	m_cellSize = cellSize;
+	m_invCellSize = 1.0f / cellSize;
+
+	UpdateBounds();
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 画像から作成
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 1チャンネルの浮動小数に変換して読み取る：カラー画像は赤の成分が使われる
+// 画像の上端を+Z側にするため、行は下から順に並べる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdHeightfield::CreateFromImage(std::string_view filename, const Math::Vector3& origin, float cellSize, float heightScale)
+{
+	Release();
+
+	if (filename.empty()) { return false; }
+
+	// ファイル名をWideCharへ変換
+	std::wstring wFilename = sjis_to_wide(filename.data());
+
+	DirectX::TexMetadata meta;
+	DirectX::ScratchImage image;
+
+	if (FAILED(DirectX::LoadFromWICFile(wFilename.c_str(), DirectX::WIC_FLAGS_NONE, &meta, image)))
+	{
+		assert(0 && "KdHeightfield::CreateFromImage：画像の読み込みに失敗しました");
+
+		return false;
+	}
+
+	// 高さとして読み取れる形式へ変換
+	DirectX::ScratchImage converted;
+	const DirectX::Image* pImage = image.GetImage(0, 0, 0);
+
+	if (meta.format != DXGI_FORMAT_R32_FLOAT)
+	{
+		if (FAILED(DirectX::Convert(*pImage, DXGI_FORMAT_R32_FLOAT, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted)))
+		{
+			assert(0 && "KdHeightfield::CreateFromImage：画像の形式を変換できませんでした");
+
+			return false;
+		}
+
+		pImage = converted.GetImage(0, 0, 0);
+	}
+
+	UINT vertNumX = static_cast<UINT>(pImage->width);
+	UINT vertNumZ = static_cast<UINT>(pImage->height);
+
+	std::vector<float> heights(static_cast<size_t>(vertNumX) * vertNumZ);
+
+	for (UINT z = 0; z < vertNumZ; ++z)
+	{
+		const float* pRow = reinterpret_cast<const float*>(pImage->pixels + (vertNumZ - 1 - z) * pImage->rowPitch);
+
+		for (UINT x = 0; x < vertNumX; ++x)
+		{
+			heights[z * vertNumX + x] = pRow[x] * heightScale;
+		}
+	}
+
+	return Create(heights, vertNumX, vertNumZ, origin, cellSize);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// モデルから作成
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 各頂点の真上からレイを下に向けて撃ち、最も高い当たった位置を高さとする
+// どのメッシュにも当たらない頂点は範囲の最も低い高さになる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdHeightfield::CreateFromModel(const KdModelData& model, float cellSize)
+{
+	Release();
+
+	if (cellSize <= 0.0f)
+	{
+		assert(0 && "KdHeightfield::CreateFromModel：マスの大きさが0以下です");
+
+		return false;
+	}
+
+	const std::vector<KdModelData::Node>& nodes = model.GetOriginalNodes();
+
+	// 当たり判定メッシュが無ければ描画メッシュを使う
+	const std::vector<int>& nodeIndices = model.GetCollisionMeshNodeIndices().size() ?
+		model.GetCollisionMeshNodeIndices() : model.GetMeshNodeIndices();
+
+	// メッシュ全体を覆う範囲
+	DirectX::BoundingBox modelBox;
+	bool isFirst = true;
+
+	for (int index : nodeIndices)
+	{
+		if (!nodes[index].m_spMesh) { continue; }
+
+		DirectX::BoundingBox nodeBox;
+		nodes[index].m_spMesh->GetBoundingBox().Transform(nodeBox, nodes[index].m_worldTransform);
+
+		if (isFirst)
+		{
+			modelBox = nodeBox;
+			isFirst = false;
+		}
+		else
+		{
+			DirectX::BoundingBox::CreateMerged(modelBox, modelBox, nodeBox);
+		}
+	}
+
+	if (isFirst) { return false; }
+
+	Math::Vector3 boxMin = Math::Vector3(modelBox.Center) - Math::Vector3(modelBox.Extents);
+	Math::Vector3 boxMax = Math::Vector3(modelBox.Center) + Math::Vector3(modelBox.Extents);
+
+	UINT vertNumX = static_cast<UINT>(std::ceil((boxMax.x - boxMin.x) / cellSize)) + 1;
+	UINT vertNumZ = static_cast<UINT>(std::ceil((boxMax.z - boxMin.z) / cellSize)) + 1;
+
+	vertNumX = std::max(vertNumX, 2u);
+	vertNumZ = std::max(vertNumZ, 2u);
+
+	// レイは範囲の少し上から範囲の少し下まで
+	float rayTop = boxMax.y + 1.0f;
+	float rayRange = (boxMax.y - boxMin.y) + 2.0f;
+
+	DirectX::XMVECTOR rayDir = DirectX::XMVectorSet(0.0f, -1.0f, 0.0f, 0.0f);
+
+	std::vector<float> heights(static_cast<size_t>(vertNumX) * vertNumZ, 0.0f);
+
+	for (UINT z = 0; z < vertNumZ; ++z)
+	{
+		for (UINT x = 0; x < vertNumX; ++x)
+		{
+			DirectX::XMVECTOR rayPos = DirectX::XMVectorSet(boxMin.x + x * cellSize, rayTop, boxMin.z + z * cellSize, 1.0f);
+
+			float height = boxMin.y;
+
+			for (int index : nodeIndices)
+			{
+				if (!nodes[index].m_spMesh) { continue; }
+
+				CollisionMeshResult result;
+
+				if (!MeshIntersect(*nodes[index].m_spMesh, rayPos, rayDir, rayRange, nodes[index].m_worldTransform, &result)) { continue; }
+
+				height = std::max(height, DirectX::XMVectorGetY(result.m_hitPos));
+			}
+
+			heights[z * vertNumX + x] = height - boxMin.y;
+		}
+	}
+
+	return Create(heights, vertNumX, vertNumZ, boxMin, cellSize);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 解放
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdHeightfield::Release()
+{
+	m_heights.clear();
+
+	m_vertNumX = 0;
+	m_vertNumZ = 0;
+
+	m_aabb = DirectX::BoundingBox();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 指定の座標の地面の高さ
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 座標からマスを求め、マスの中のどちらの三角形かで補間する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdHeightfield::GetHeight(float x, float z, float& height) const
+{
+	if (IsEmpty()) { return false; }
+
+	float fx = (x - m_origin.x) * m_invCellSize;
+	float fz = (z - m_origin.z) * m_invCellSize;
+
+	if (fx < 0.0f || fz < 0.0f || fx > static_cast<float>(m_vertNumX - 1) || fz > static_cast<float>(m_vertNumZ - 1)) { return false; }
+
+	// 端ちょうどの座標は最後のマスに含める
+	UINT cellX = std::min(static_cast<UINT>(fx), m_vertNumX - 2);
+	UINT cellZ = std::min(static_cast<UINT>(fz), m_vertNumZ - 2);
+
+	float u = fx - cellX;
+	float v = fz - cellZ;
+
+	float h00 = m_heights[cellZ * m_vertNumX + cellX];
+	float h10 = m_heights[cellZ * m_vertNumX + cellX + 1];
+	float h01 = m_heights[(cellZ + 1) * m_vertNumX + cellX];
+	float h11 = m_heights[(cellZ + 1) * m_vertNumX + cellX + 1];
+
+	// 対角線 (x+1, z)-(x, z+1) のどちら側か
+	if (u + v <= 1.0f)
+	{
+		height = h00 + (h10 - h00) * u + (h01 - h00) * v;
+	}
+	else
+	{
+		height = h11 + (h01 - h11) * (1.0f - u) + (h10 - h11) * (1.0f - v);
+	}
+
+	height += m_origin.y;
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 線分との判定
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 境界ボックスで線分を切り詰めてから、XZ平面上で線分が通るマスを近い順に辿る
+// マスの三角形はそのマスの範囲にしか無いので、最初に当たったマスの最も近いヒットが全体で最も近い
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdHeightfield::IntersectSegment(const Math::Vector3& start, const Math::Vector3& end, float& hitRate) const
+{
+	if (IsEmpty()) { return false; }
+
+	Math::Vector3 dir = end - start;
+
+	//--------------------------------------------------------
+	// 境界ボックスで線分を切り詰める
+	//--------------------------------------------------------
+	float tMin = 0.0f;
+	float tMax = 1.0f;
+
+	{
+		Math::Vector3 boxMin = Math::Vector3(m_aabb.Center) - Math::Vector3(m_aabb.Extents);
+		Math::Vector3 boxMax = Math::Vector3(m_aabb.Center) + Math::Vector3(m_aabb.Extents);
+
+		const float pos[3] = { start.x, start.y, start.z };
+		const float vec[3] = { dir.x, dir.y, dir.z };
+		const float minV[3] = { boxMin.x, boxMin.y, boxMin.z };
+		const float maxV[3] = { boxMax.x, boxMax.y, boxMax.z };
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (fabsf(vec[axis]) < 1e-12f)
+			{
+				if (pos[axis] < minV[axis] || pos[axis] > maxV[axis]) { return false; }
+
+				continue;
+			}
+
+			float inv = 1.0f / vec[axis];
+			float t0 = (minV[axis] - pos[axis]) * inv;
+			float t1 = (maxV[axis] - pos[axis]) * inv;
+
+			if (t0 > t1) { std::swap(t0, t1); }
+
+			tMin = std::max(tMin, t0);
+			tMax = std::min(tMax, t1);
+
+			if (tMin > tMax) { return false; }
+		}
+	}
+
+	//--------------------------------------------------------
+	// 開始位置のマスと、次のマスの境界までの割合
+	//--------------------------------------------------------
+	const int cellNumX = static_cast<int>(m_vertNumX - 1);
+	const int cellNumZ = static_cast<int>(m_vertNumZ - 1);
+
+	Math::Vector3 enterPos = start + dir * tMin;
+
+	int cellX = std::clamp(static_cast<int>(std::floor((enterPos.x - m_origin.x) * m_invCellSize)), 0, cellNumX - 1);
+	int cellZ = std::clamp(static_cast<int>(std::floor((enterPos.z - m_origin.z) * m_invCellSize)), 0, cellNumZ - 1);
+
+	int stepX = (dir.x > 0.0f) ? 1 : ((dir.x < 0.0f) ? -1 : 0);
+	int stepZ = (dir.z > 0.0f) ? 1 : ((dir.z < 0.0f) ? -1 : 0);
+
+	// 1マス進むのに必要な割合
+	float deltaX = stepX ? m_cellSize / fabsf(dir.x) : FLT_MAX;
+	float deltaZ = stepZ ? m_cellSize / fabsf(dir.z) : FLT_MAX;
+
+	// 次のマスの境界に着く割合
+	float nextX = FLT_MAX;
+	float nextZ = FLT_MAX;
+
+	if (stepX) { nextX = (m_origin.x + (cellX + (stepX > 0 ? 1 : 0)) * m_cellSize - start.x) / dir.x; }
+	if (stepZ) { nextZ = (m_origin.z + (cellZ + (stepZ > 0 ? 1 : 0)) * m_cellSize - start.z) / dir.z; }
+
+	//--------------------------------------------------------
+	// マスを順番に辿る
+	//--------------------------------------------------------
+	float cellEnter = tMin;
+
+	while (true)
+	{
+		float cellExit = std::min({ nextX, nextZ, tMax });
+
+		// マスの高さの範囲と、マスの中を通る線分の高さの範囲が重ならなければ三角形を調べない
+		float minY = 0.0f, maxY = 0.0f;
+		GetCellHeightRange(static_cast<UINT>(cellX), static_cast<UINT>(cellZ), minY, maxY);
+
+		float y0 = start.y + dir.y * cellEnter;
+		float y1 = start.y + dir.y * cellExit;
+
+		if (std::max(y0, y1) >= minY && std::min(y0, y1) <= maxY)
+		{
+			Math::Vector3 tris[6];
+			GetCellTriangles(static_cast<UINT>(cellX), static_cast<UINT>(cellZ), tris);
+
+			float nearest = FLT_MAX;
+
+			for (int tri = 0; tri < 2; ++tri)
+			{
+				// 線分 vs 三角形(Moller-Trumbore)：両面とも判定する
+				const Math::Vector3& v0 = tris[tri * 3 + 0];
+				Math::Vector3 e1 = tris[tri * 3 + 1] - v0;
+				Math::Vector3 e2 = tris[tri * 3 + 2] - v0;
+
+				Math::Vector3 p = dir.Cross(e2);
+				float det = e1.Dot(p);
+
+				if (fabsf(det) < 1e-12f) { continue; }
+
+				float invDet = 1.0f / det;
+
+				Math::Vector3 s = start - v0;
+				float u = s.Dot(p) * invDet;
+				if (u < 0.0f || u > 1.0f) { continue; }
+
+				Math::Vector3 q = s.Cross(e1);
+				float v = dir.Dot(q) * invDet;
+				if (v < 0.0f || u + v > 1.0f) { continue; }
+
+				float t = e2.Dot(q) * invDet;
+				if (t < 0.0f || t > 1.0f) { continue; }
+
+				nearest = std::min(nearest, t);
+			}
+
+			if (nearest != FLT_MAX)
+			{
+				hitRate = nearest;
+
+				return true;
+			}
+		}
+
+		// 線分の終わりに着いた
+		if (cellExit >= tMax) { break; }
+
+		// 次のマスへ
+		if (nextX < nextZ)
+		{
+			cellX += stepX;
+			cellEnter = nextX;
+			nextX += deltaX;
+		}
+		else
+		{
+			cellZ += stepZ;
+			cellEnter = nextZ;
+			nextZ += deltaZ;
+		}
+
+		if (cellX < 0 || cellX >= cellNumX || cellZ < 0 || cellZ >= cellNumZ) { break; }
+	}
+
+	return false;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 球との判定
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 押し出しで球が移動しても届く範囲(中心から半径の2倍)のマスの三角形を順番に判定して押し出す
+// 拡縮の扱いはメッシュとの判定(MeshIntersect)と同じ
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdHeightfield::IntersectSphere(Math::Vector3& center, const Math::Vector3& scale, float radius, Math::Vector3& hitPos) const
+{
+	if (IsEmpty()) { return false; }
+
+	// ローカル空間での範囲
+	Math::Vector3 reach(radius * 2.0f / scale.x, radius * 2.0f / scale.y, radius * 2.0f / scale.z);
+
+	const int cellNumX = static_cast<int>(m_vertNumX - 1);
+	const int cellNumZ = static_cast<int>(m_vertNumZ - 1);
+
+	int beginX = std::max(static_cast<int>(std::floor((center.x - reach.x - m_origin.x) * m_invCellSize)), 0);
+	int beginZ = std::max(static_cast<int>(std::floor((center.z - reach.z - m_origin.z) * m_invCellSize)), 0);
+	int endX = std::min(static_cast<int>(std::floor((center.x + reach.x - m_origin.x) * m_invCellSize)), cellNumX - 1);
+	int endZ = std::min(static_cast<int>(std::floor((center.z + reach.z - m_origin.z) * m_invCellSize)), cellNumZ - 1);
+
+	if (beginX > endX || beginZ > endZ) { return false; }
+
+	float radiusSqr = radius * radius;
+
+	DirectX::XMVECTOR finalPos = center;
+	DirectX::XMVECTOR objScale = DirectX::XMVectorSet(scale.x, scale.y, scale.z, 0.0f);
+	DirectX::XMVECTOR finalHitPos = {};
+
+	bool isHit = false;
+
+	for (int cellZ = beginZ; cellZ <= endZ; ++cellZ)
+	{
+		for (int cellX = beginX; cellX <= endX; ++cellX)
+		{
+			// 球が届かない高さのマスは調べない
+			float minY = 0.0f, maxY = 0.0f;
+			GetCellHeightRange(static_cast<UINT>(cellX), static_cast<UINT>(cellZ), minY, maxY);
+
+			float centerY = DirectX::XMVectorGetY(finalPos);
+			if (centerY - reach.y > maxY || centerY + reach.y < minY) { continue; }
+
+			Math::Vector3 tris[6];
+			GetCellTriangles(static_cast<UINT>(cellX), static_cast<UINT>(cellZ), tris);
+
+			for (int tri = 0; tri < 2; ++tri)
+			{
+				DirectX::XMVECTOR v0 = tris[tri * 3 + 0];
+				DirectX::XMVECTOR v1 = tris[tri * 3 + 1];
+				DirectX::XMVECTOR v2 = tris[tri * 3 + 2];
+
+				DirectX::XMVECTOR nearPoint;
+				KdPointToTriangle(finalPos, v0, v1, v2, nearPoint);
+
+				// XYZ軸のスケールが均等な座標系で距離を測る
+				DirectX::XMVECTOR vToCenter = (finalPos - nearPoint) * objScale;
+
+				float distSq = DirectX::XMVector3LengthSq(vToCenter).m128_f32[0];
+
+				if (distSq > radiusSqr) { continue; }
+
+				// 中心が地面にちょうど乗っている場合は面の法線の方向へ押し出す
+				DirectX::XMVECTOR vPushDir = (distSq > 0.0f) ?
+					DirectX::XMVector3Normalize(vToCenter) :
+					DirectX::XMVector3Normalize(DirectX::XMVector3Cross(v1 - v0, v2 - v0) * objScale);
+
+				DirectX::XMVECTOR vPush = vPushDir * (radius - sqrtf(distSq));
+
+				// 拡縮を考慮した座標系へ戻す
+				vPush /= objScale;
+
+				finalPos += vPush;
+
+				finalHitPos = nearPoint;
+
+				isHit = true;
+			}
+		}
+	}
+
+	if (isHit)
+	{
+		center = finalPos;
+		hitPos = finalHitPos;
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// マスの2つの三角形の頂点
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdHeightfield::GetCellTriangles(UINT cellX, UINT cellZ, Math::Vector3 (&tris)[6]) const
+{
+	Math::Vector3 p00 = GetVertex(cellX, cellZ);
+	Math::Vector3 p10 = GetVertex(cellX + 1, cellZ);
+	Math::Vector3 p01 = GetVertex(cellX, cellZ + 1);
+	Math::Vector3 p11 = GetVertex(cellX + 1, cellZ + 1);
+
+	// v0→v1 と v0→v2 の外積が上向きになる順番
+	tris[0] = p00; tris[1] = p01; tris[2] = p10;
+	tris[3] = p10; tris[4] = p01; tris[5] = p11;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// マスの最低・最高の高さ
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdHeightfield::GetCellHeightRange(UINT cellX, UINT cellZ, float& minY, float& maxY) const
+{
+	float h00 = m_heights[cellZ * m_vertNumX + cellX];
+	float h10 = m_heights[cellZ * m_vertNumX + cellX + 1];
+	float h01 = m_heights[(cellZ + 1) * m_vertNumX + cellX];
+	float h11 = m_heights[(cellZ + 1) * m_vertNumX + cellX + 1];
+
+	minY = std::min({ h00, h10, h01, h11 }) + m_origin.y;
+	maxY = std::max({ h00, h10, h01, h11 }) + m_origin.y;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 境界ボックスの更新
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdHeightfield::UpdateBounds()
+{
+	auto range = std::minmax_element(m_heights.begin(), m_heights.end());
+
+	Math::Vector3 boxMin(m_origin.x, m_origin.y + *range.first, m_origin.z);
+	Math::Vector3 boxMax(m_origin.x + (m_vertNumX - 1) * m_cellSize, m_origin.y + *range.second, m_origin.z + (m_vertNumZ - 1) * m_cellSize);
+
+	DirectX::BoundingBox::CreateFromPoints(m_aabb, boxMin, boxMax);
+}
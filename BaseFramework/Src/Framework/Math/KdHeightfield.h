@@ -0,0 +1,137 @@
+﻿#pragma once
+
+class KdModelData;
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 等間隔の格子の各頂点に高さを持つ地形(ハイトフィールド)
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 地形を汎用のメッシュとして判定する代わりに、座標から直接マス(セル)を求めて判定するために使用する
+// 1つのマスは (x, z)-(x+1, z+1) の対角線で2つの三角形に分ける
+// 座標はハイトフィールドのローカル空間：判定側でレイや球をローカル空間に変換してから判定する
+//
+// 作成方法
+// ・Create()			… 高さの配列から
+// ・CreateFromImage()	… 画像の明るさから(1ピクセル = 1頂点・画像の上端が+Z側)
+// ・CreateFromModel()	… モデルを真上からレイで調べて
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdHeightfield
+{
+public:
+
+	KdHeightfield() {}
+	~KdHeightfield() { Release(); }
+
+	// 作成
+	// ・heights			… vertNumX × vertNumZ 個の頂点の高さ：X方向が先に並ぶ
+	// ・origin			… 頂点(0, 0)の座標：高さはこのYからの相対値
+	// ・cellSize		… マスの1辺の長さ
+	bool Create(const std::vector<float>& heights, UINT vertNumX, UINT vertNumZ, const Math::Vector3& origin, float cellSize);
+
+	// 画像から作成：明るさ(0～1) × heightScale を高さとする
+	bool CreateFromImage(std::string_view filename, const Math::Vector3& origin, float cellSize, float heightScale);
+
+	// モデルから作成：当たり判定メッシュ(無ければ描画メッシュ)を真上からレイで調べた高さを使う
+	// モデルの原点の空間で、メッシュ全体を覆う範囲をcellSize間隔で調べる
+	bool CreateFromModel(const KdModelData& model, float cellSize);
+
+	// 解放
+	void Release();
+
+	bool IsEmpty() const { return m_heights.empty(); }
+
+	// 指定の座標(X・Z)の地面の高さ：範囲外ならfalse
+	// マスを座標から直接求めるので、地形の大きさに関係なく一定の速さ
+	bool GetHeight(float x, float z, float& height) const;
+
+	// 線分との判定：start → end の間で最初に当たる位置を割合(0～1)で返す
+	// 線分が通るマスだけを順番に調べる(2DのDDA)
+	bool IntersectSegment(const Math::Vector3& start, const Math::Vector3& end, float& hitRate) const;
+
+	// 球との判定：当たっていれば球の中心を地形の外へ押し出す
+	// ・center		… ローカル空間の球の中心：押し出した後の座標になる
+	// ・scale		… ローカル空間の各軸の拡大率(判定側の行列から求める)
+	// ・radius		… 判定側の空間の半径
+	// ・hitPos		… 最後に当たった地形上の点(ローカル空間)
+	// 球と重なるマスだけを調べる
+	bool IntersectSphere(Math::Vector3& center, const Math::Vector3& scale, float radius, Math::Vector3& hitPos) const;
+
+	// 指定の箱(ローカル空間)と重なるマスの三角形を全て辿る：BOXの判定・カプセルの移動判定などで使う
+	// ・onTriangle … bool(const Math::Vector3& v0, const Math::Vector3& v1, const Math::Vector3& v2)：falseを返すと終了
+	template<class Func>
+	void ForEachTriangle(const DirectX::BoundingBox& aabb, Func onTriangle) const;
+
+	// ローカル空間の境界ボックス
+	const DirectX::BoundingBox& GetBoundingBox() const { return m_aabb; }
+
+	UINT GetVertNumX() const { return m_vertNumX; }
+	UINT GetVertNumZ() const { return m_vertNumZ; }
+	float GetCellSize() const { return m_cellSize; }
+	const Math::Vector3& GetOrigin() const { return m_origin; }
+
+private:
+
+	// 頂点の座標
+	Math::Vector3 GetVertex(UINT x, UINT z) const
+	{
+		return Math::Vector3(m_origin.x + x * m_cellSize, m_origin.y + m_heights[z * m_vertNumX + x], m_origin.z + z * m_cellSize);
+	}
+
+	// マスの2つの三角形の頂点：[0]～[2]と[3]～[5]
+	void GetCellTriangles(UINT cellX, UINT cellZ, Math::Vector3 (&tris)[6]) const;
+
+	// マスの最低・最高の高さ(ローカル座標)
+	void GetCellHeightRange(UINT cellX, UINT cellZ, float& minY, float& maxY) const;
+
+	// 境界ボックスの更新
+	void UpdateBounds();
+
+	std::vector<float>		m_heights;
+
+	UINT			m_vertNumX = 0;
+	UINT			m_vertNumZ = 0;
+
+	Math::Vector3	m_origin;
+	float			m_cellSize = 1.0f;
+	float			m_invCellSize = 1.0f;
+
+	DirectX::BoundingBox	m_aabb;
+
+	// コピー禁止用
+	KdHeightfield(const KdHeightfield& src) = delete;
+	void operator=(const KdHeightfield& src) = delete;
+};
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 指定の箱と重なるマスの三角形を全て辿る
+// 箱とXZが重なるマスのうち、高さの範囲も重なるマスだけを辿る
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+template<class Func>
+void KdHeightfield::ForEachTriangle(const DirectX::BoundingBox& aabb, Func onTriangle) const
+{
+	if (IsEmpty()) { return; }
+
+	const int cellNumX = static_cast<int>(m_vertNumX - 1);
+	const int cellNumZ = static_cast<int>(m_vertNumZ - 1);
+
+	int beginX = std::max(static_cast<int>(std::floor((aabb.Center.x - aabb.Extents.x - m_origin.x) * m_invCellSize)), 0);
+	int beginZ = std::max(static_cast<int>(std::floor((aabb.Center.z - aabb.Extents.z - m_origin.z) * m_invCellSize)), 0);
+	int endX = std::min(static_cast<int>(std::floor((aabb.Center.x + aabb.Extents.x - m_origin.x) * m_invCellSize)), cellNumX - 1);
+	int endZ = std::min(static_cast<int>(std::floor((aabb.Center.z + aabb.Extents.z - m_origin.z) * m_invCellSize)), cellNumZ - 1);
+
+	for (int cellZ = beginZ; cellZ <= endZ; ++cellZ)
+	{
+		for (int cellX = beginX; cellX <= endX; ++cellX)
+		{
+			float minY = 0.0f, maxY = 0.0f;
+			GetCellHeightRange(static_cast<UINT>(cellX), static_cast<UINT>(cellZ), minY, maxY);
+
+			if (aabb.Center.y - aabb.Extents.y > maxY || aabb.Center.y + aabb.Extents.y < minY) { continue; }
+
+			Math::Vector3 tris[6];
+			GetCellTriangles(static_cast<UINT>(cellX), static_cast<UINT>(cellZ), tris);
+
+			if (!onTriangle(tris[0], tris[1], tris[2])) { return; }
+			if (!onTriangle(tris[3], tris[4], tris[5])) { return; }
+		}
+	}
+}
@@ -0,0 +1,652 @@
+﻿#include "KdMeshBVH.h"
+
+// キャッシュファイルの識別子とバージョン
+static constexpr UINT kBVHFileMagic = 'K' | ('B' << 8) | ('V' << 16) | ('H' << 24);
+static constexpr UINT kBVHFileVersion = 2;
+
+// 箱の表面積
+static float CalcSurfaceArea(const Math::Vector3& vMin, const Math::Vector3& vMax)
+{
+	Math::Vector3 e = vMax - vMin;
+
+	return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 作成
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 全ての面を1つの箱に入れたルートから、SAHで2つずつに分割していく
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdMeshBVH::Build(const std::vector<Math::Vector3>& positions, const std::vector<KdMeshFace>& faces)
+{
+	m_attachedNodes = {};
+	m_attachedFaceIndices = {};
+
+	m_nodes.clear();
+	m_faceIndices.clear();
+	m_triangles.Clear();
+
+	if (faces.empty()) { return; }
+
+	UINT faceNum = static_cast<UINT>(faces.size());
+
+	// 面毎の境界と重心を求めておく
+	std::vector<FaceInfo> faceInfos(faceNum);
+	m_faceIndices.resize(faceNum);
+
+	for (UINT i = 0; i < faceNum; ++i)
+	{
+		const Math::Vector3& v0 = positions[faces[i].Idx[0]];
+		const Math::Vector3& v1 = positions[faces[i].Idx[1]];
+		const Math::Vector3& v2 = positions[faces[i].Idx[2]];
+
+		faceInfos[i].m_min = Math::Vector3::Min(Math::Vector3::Min(v0, v1), v2);
+		faceInfos[i].m_max = Math::Vector3::Max(Math::Vector3::Max(v0, v1), v2);
+		faceInfos[i].m_centroid = (v0 + v1 + v2) / 3.0f;
+
+		m_faceIndices[i] = i;
+	}
+
+	// ノード数は最大で 面数 * 2 - 1：途中で再確保されないように確保しておく
+	m_nodes.reserve(faceNum * 2);
+
+	Node root;
+	root.m_leftOrFirst = 0;
+	root.m_count = faceNum;
+	m_nodes.push_back(root);
+
+	UpdateNodeBounds(0, faceInfos);
+	Subdivide(0, 0, faceInfos);
+
+	m_nodes.shrink_to_fit();
+
+	// 葉の順番に三角形を並べる
+	m_triangles.Build(positions, faces, &m_faceIndices);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 箱の計算し直し(Refit)
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 葉の箱は中の面から、枝の箱は2つの子の箱から求め直す
+// 子のノードは必ず親より後ろに並んでいるので、後ろから順に計算すれば子が先に求まる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdMeshBVH::Refit(const std::vector<Math::Vector3>& positions, const std::vector<KdMeshFace>& faces)
+{
+	// 外部の領域は書き換えられない
+	if (!m_attachedNodes.empty()) { return; }
+
+	if (m_nodes.empty() || m_faceIndices.size() != faces.size()) { return; }
+
+	for (size_t i = m_nodes.size(); i-- > 0; )
+	{
+		Node& node = m_nodes[i];
+
+		if (node.IsLeaf())
+		{
+			node.m_min = Math::Vector3(FLT_MAX);
+			node.m_max = Math::Vector3(-FLT_MAX);
+
+			for (UINT j = 0; j < node.m_count; ++j)
+			{
+				const KdMeshFace& face = faces[m_faceIndices[node.m_leftOrFirst + j]];
+
+				for (UINT k = 0; k < 3; ++k)
+				{
+					node.m_min = Math::Vector3::Min(node.m_min, positions[face.Idx[k]]);
+					node.m_max = Math::Vector3::Max(node.m_max, positions[face.Idx[k]]);
+				}
+			}
+
+			// 作成時と同じだけ余白を付ける
+			Math::Vector3 margin = (node.m_max - node.m_min) * 1.0e-4f + Math::Vector3(1.0e-5f);
+
+			node.m_min -= margin;
+			node.m_max += margin;
+		}
+		else
+		{
+			const Node& left = m_nodes[node.m_leftOrFirst];
+			const Node& right = m_nodes[node.m_leftOrFirst + 1];
+
+			node.m_min = Math::Vector3::Min(left.m_min, right.m_min);
+			node.m_max = Math::Vector3::Max(left.m_max, right.m_max);
+		}
+	}
+
+	// 葉の三角形も動いた座標で並べ直す(確保済みの領域を使い回す)
+	m_triangles.Build(positions, faces, &m_faceIndices);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// キャッシュファイルへの書き出し
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdMeshBVH::Save(std::ostream& os) const
+{
+	std::span<const Node> nodes = GetNodes();
+	std::span<const UINT> faceIndices = GetFaceIndices();
+
+	UINT header[4] = { kBVHFileMagic, kBVHFileVersion,
+		static_cast<UINT>(faceIndices.size()), static_cast<UINT>(nodes.size()) };
+
+	os.write(reinterpret_cast<const char*>(header), sizeof(header));
+	os.write(reinterpret_cast<const char*>(nodes.data()), sizeof(Node) * nodes.size());
+	os.write(reinterpret_cast<const char*>(faceIndices.data()), sizeof(UINT) * faceIndices.size());
+
+	return os.good();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// キャッシュファイルからの読込
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 元のメッシュと面数が異なる・範囲外のIndexを持つなどの場合は失敗：呼び出し側で作り直すこと
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdMeshBVH::Load(std::istream& is, const std::vector<Math::Vector3>& positions, const std::vector<KdMeshFace>& faces)
+{
+	m_attachedNodes = {};
+	m_attachedFaceIndices = {};
+
+	m_nodes.clear();
+	m_faceIndices.clear();
+	m_triangles.Clear();
+
+	UINT faceNum = static_cast<UINT>(faces.size());
+
+	UINT header[4] = {};
+	is.read(reinterpret_cast<char*>(header), sizeof(header));
+
+	if (!is.good()) { return false; }
+	if (header[0] != kBVHFileMagic || header[1] != kBVHFileVersion) { return false; }
+	if (header[2] != faceNum || header[3] == 0 || header[3] > faceNum * 2) { return false; }
+
+	m_nodes.resize(header[3]);
+	m_faceIndices.resize(header[2]);
+
+	is.read(reinterpret_cast<char*>(m_nodes.data()), sizeof(Node) * m_nodes.size());
+	is.read(reinterpret_cast<char*>(m_faceIndices.data()), sizeof(UINT) * m_faceIndices.size());
+
+	// 壊れたファイルで範囲外アクセスしないように検証
+	if (!is.good() || !Validate(m_nodes, m_faceIndices, faceNum))
+	{
+		m_nodes.clear();
+		m_faceIndices.clear();
+
+		return false;
+	}
+
+	m_triangles.Build(positions, faces, &m_faceIndices);
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 外部の領域の木を参照する
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// コピーも作り直しもしないので、ファイルを割り当てたメモリを渡せば読込の処理がほぼ掛からない
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdMeshBVH::Attach(std::span<const Node> nodes, std::span<const UINT> faceIndices, const float* pTriangles)
+{
+	m_nodes.clear();
+	m_faceIndices.clear();
+	m_triangles.Clear();
+
+	m_attachedNodes = {};
+	m_attachedFaceIndices = {};
+
+	UINT faceNum = static_cast<UINT>(faceIndices.size());
+
+	if (nodes.empty() || nodes.size() > static_cast<size_t>(faceNum) * 2 || !pTriangles) { return false; }
+
+	if (!Validate(nodes, faceIndices, faceNum)) { return false; }
+
+	m_attachedNodes = nodes;
+	m_attachedFaceIndices = faceIndices;
+	m_triangles.Attach(pTriangles, faceNum);
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 範囲外のIndexを持っていないか検証する
+// 枝の子は必ず自身より後ろにある(Refitや読込で前提にしている)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdMeshBVH::Validate(std::span<const Node> nodes, std::span<const UINT> faceIndices, UINT faceNum)
+{
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		const Node& node = nodes[i];
+
+		bool isValid = node.IsLeaf() ?
+			(node.m_leftOrFirst + node.m_count <= faceIndices.size()) :
+			(node.m_leftOrFirst > i && node.m_leftOrFirst + 1 < nodes.size());
+
+		if (!isValid) { return false; }
+	}
+
+	for (UINT faceIdx : faceIndices)
+	{
+		if (faceIdx >= faceNum) { return false; }
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// レイとの判定
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 近い方の子から辿り、既に見つかったヒットより遠い箱は飛ばす
+// 葉の面はm_trianglesで連続しているので、kLaneNum個ずつまとめて判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdMeshBVH::IntersectRay(const Math::Vector3& rayPos, const Math::Vector3& rayDir, float& maxDist, bool anyHit, UINT* pHitFace) const
+{
+	std::span<const Node> nodes = GetNodes();
+
+	if (nodes.empty()) { return false; }
+
+	Math::Vector3 invDir(1.0f / rayDir.x, 1.0f / rayDir.y, 1.0f / rayDir.z);
+
+	float enterDist = 0.0f;
+
+	if (!IntersectRayAABB(rayPos, invDir, nodes[0], maxDist, enterDist)) { return false; }
+
+	bool isHit = false;
+
+	// 辿る予定のノードと箱に入る距離
+	struct StackEntry
+	{
+		UINT	m_nodeIdx;
+		float	m_enterDist;
+	};
+
+	StackEntry stack[kMaxDepth + 2];
+	int stackTop = 0;
+	stack[stackTop++] = { 0, enterDist };
+
+	while (stackTop > 0)
+	{
+		StackEntry entry = stack[--stackTop];
+
+		// 積んだ後に見つかったヒットより遠くなった箱は飛ばす
+		if (entry.m_enterDist > maxDist) { continue; }
+
+		KD_COLLISION_STAT_ADD(m_bvhNodeVisits, 1);
+
+		const Node& node = nodes[entry.m_nodeIdx];
+
+		if (node.IsLeaf())
+		{
+			for (UINT offset = 0; offset < node.m_count; offset += KdTriangleSoA::kLaneNum)
+			{
+				UINT count = std::min(KdTriangleSoA::kLaneNum, node.m_count - offset);
+
+				KD_COLLISION_STAT_ADD(m_triangleTests, count);
+
+				float hitDist = FLT_MAX;
+
+				int lane = KdRayTrianglesNearest(m_triangles, node.m_leftOrFirst + offset, count, rayPos, rayDir, maxDist, hitDist);
+
+				if (lane < 0) { continue; }
+
+				maxDist = hitDist;
+				isHit = true;
+
+				if (pHitFace) { *pHitFace = GetFaceIndices()[node.m_leftOrFirst + offset + lane]; }
+
+				if (anyHit) { return true; }
+			}
+
+			continue;
+		}
+
+		UINT nearIdx = node.m_leftOrFirst;
+		UINT farIdx = node.m_leftOrFirst + 1;
+
+		float nearDist = 0.0f;
+		float farDist = 0.0f;
+		bool isNearHit = IntersectRayAABB(rayPos, invDir, nodes[nearIdx], maxDist, nearDist);
+		bool isFarHit = IntersectRayAABB(rayPos, invDir, nodes[farIdx], maxDist, farDist);
+
+		if (isNearHit && isFarHit && nearDist > farDist)
+		{
+			std::swap(nearIdx, farIdx);
+			std::swap(nearDist, farDist);
+		}
+		else if (!isNearHit && isFarHit)
+		{
+			std::swap(nearIdx, farIdx);
+			std::swap(nearDist, farDist);
+			std::swap(isNearHit, isFarHit);
+		}
+
+		// 遠い方を先に積んで近い方から処理する
+		if (isFarHit) { stack[stackTop++] = { farIdx, farDist }; }
+		if (isNearHit) { stack[stackTop++] = { nearIdx, nearDist }; }
+	}
+
+	return isHit;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 指定の箱と重なる葉の面を全て列挙する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdMeshBVH::CollectOverlapFaces(const DirectX::BoundingBox& aabb, std::vector<UINT>& result) const
+{
+	std::span<const Node> nodes = GetNodes();
+	std::span<const UINT> faceIndices = GetFaceIndices();
+
+	if (nodes.empty()) { return; }
+
+	Math::Vector3 boxMin = Math::Vector3(aabb.Center) - Math::Vector3(aabb.Extents);
+	Math::Vector3 boxMax = Math::Vector3(aabb.Center) + Math::Vector3(aabb.Extents);
+
+	UINT stack[kMaxDepth + 2];
+	int stackTop = 0;
+	stack[stackTop++] = 0;
+
+	while (stackTop > 0)
+	{
+		const Node& node = nodes[stack[--stackTop]];
+
+		KD_COLLISION_STAT_ADD(m_bvhNodeVisits, 1);
+
+		// 重なっていない箱の中は調べない
+		if (node.m_min.x > boxMax.x || node.m_max.x < boxMin.x ||
+			node.m_min.y > boxMax.y || node.m_max.y < boxMin.y ||
+			node.m_min.z > boxMax.z || node.m_max.z < boxMin.z)
+		{
+			continue;
+		}
+
+		if (node.IsLeaf())
+		{
+			result.insert(result.end(), faceIndices.begin() + node.m_leftOrFirst, faceIndices.begin() + node.m_leftOrFirst + node.m_count);
+
+			continue;
+		}
+
+		stack[stackTop++] = node.m_leftOrFirst + 1;
+		stack[stackTop++] = node.m_leftOrFirst;
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 指定の点から距離radius以内にある面を全て列挙する
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 箱までの距離で枝を絞り込み、葉では面までの距離をまとめて判定する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdMeshBVH::CollectNearFaces(const Math::Vector3& center, float radius, std::vector<UINT>& result) const
+{
+	std::span<const Node> nodes = GetNodes();
+	std::span<const UINT> faceIndices = GetFaceIndices();
+
+	if (nodes.empty()) { return; }
+
+	const float radiusSq = radius * radius;
+	const Math::Vector3 noScale(1.0f);
+
+	UINT stack[kMaxDepth + 2];
+	int stackTop = 0;
+	stack[stackTop++] = 0;
+
+	while (stackTop > 0)
+	{
+		const Node& node = nodes[stack[--stackTop]];
+
+		KD_COLLISION_STAT_ADD(m_bvhNodeVisits, 1);
+
+		// 箱の中で最も近い点までの距離が半径より遠ければ中は調べない
+		Math::Vector3 nearPoint = Math::Vector3::Min(Math::Vector3::Max(center, node.m_min), node.m_max);
+
+		if (Math::Vector3::DistanceSquared(center, nearPoint) > radiusSq) { continue; }
+
+		if (node.IsLeaf())
+		{
+			for (UINT offset = 0; offset < node.m_count; offset += KdTriangleSoA::kLaneNum)
+			{
+				UINT first = node.m_leftOrFirst + offset;
+				UINT count = std::min(KdTriangleSoA::kLaneNum, node.m_count - offset);
+
+				UINT mask = KdSphereTrianglesOverlapMask(m_triangles, first, count, center, noScale, radiusSq);
+
+				for (UINT lane = 0; mask; ++lane, mask >>= 1)
+				{
+					if (mask & 1) { result.push_back(faceIndices[first + lane]); }
+				}
+			}
+
+			continue;
+		}
+
+		stack[stackTop++] = node.m_leftOrFirst + 1;
+		stack[stackTop++] = node.m_leftOrFirst;
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ノードの境界ボックスを中の面から求める
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 浮動小数の誤差で境界上の面を取りこぼさないように僅かに広げておく
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdMeshBVH::UpdateNodeBounds(UINT nodeIdx, const std::vector<FaceInfo>& faceInfos)
+{
+	Node& node = m_nodes[nodeIdx];
+
+	node.m_min = Math::Vector3(FLT_MAX);
+	node.m_max = Math::Vector3(-FLT_MAX);
+
+	for (UINT i = 0; i < node.m_count; ++i)
+	{
+		const FaceInfo& face = faceInfos[m_faceIndices[node.m_leftOrFirst + i]];
+
+		node.m_min = Math::Vector3::Min(node.m_min, face.m_min);
+		node.m_max = Math::Vector3::Max(node.m_max, face.m_max);
+	}
+
+	Math::Vector3 margin = (node.m_max - node.m_min) * 1.0e-4f + Math::Vector3(1.0e-5f);
+
+	node.m_min -= margin;
+	node.m_max += margin;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// ノードをSAHで分割する
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 各軸で重心の範囲をkBinNum個の区間に分け、区間の境目で分けた時のコストを比較する
+// コスト = 左の箱の表面積 × 左の面数 + 右の箱の表面積 × 右の面数
+// 分割しない方が安い場合や深さの上限に達した場合は葉のままにする
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdMeshBVH::Subdivide(UINT nodeIdx, int depth, const std::vector<FaceInfo>& faceInfos)
+{
+	const UINT first = m_nodes[nodeIdx].m_leftOrFirst;
+	const UINT count = m_nodes[nodeIdx].m_count;
+
+	if (count <= kLeafFaceNum || depth >= kMaxDepth) { return; }
+
+	//------------------------------
+	// 重心の範囲
+	//------------------------------
+	Math::Vector3 centroidMin(FLT_MAX);
+	Math::Vector3 centroidMax(-FLT_MAX);
+
+	for (UINT i = 0; i < count; ++i)
+	{
+		const Math::Vector3& centroid = faceInfos[m_faceIndices[first + i]].m_centroid;
+
+		centroidMin = Math::Vector3::Min(centroidMin, centroid);
+		centroidMax = Math::Vector3::Max(centroidMax, centroid);
+	}
+
+	//------------------------------
+	// 最もコストの低い分割位置を探す
+	//------------------------------
+	struct Bin
+	{
+		Math::Vector3	m_min = Math::Vector3(FLT_MAX);
+		Math::Vector3	m_max = Math::Vector3(-FLT_MAX);
+		UINT			m_count = 0;
+	};
+
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestBin = 0;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float axisMin = (&centroidMin.x)[axis];
+		float axisMax = (&centroidMax.x)[axis];
+
+		// 全ての重心が同じ位置ならこの軸では分けられない
+		if (axisMax - axisMin <= FLT_EPSILON) { continue; }
+
+		float scale = kBinNum / (axisMax - axisMin);
+
+		Bin bins[kBinNum];
+
+		for (UINT i = 0; i < count; ++i)
+		{
+			const FaceInfo& face = faceInfos[m_faceIndices[first + i]];
+
+			int binIdx = std::min(kBinNum - 1, static_cast<int>(((&face.m_centroid.x)[axis] - axisMin) * scale));
+
+			bins[binIdx].m_min = Math::Vector3::Min(bins[binIdx].m_min, face.m_min);
+			bins[binIdx].m_max = Math::Vector3::Max(bins[binIdx].m_max, face.m_max);
+			++bins[binIdx].m_count;
+		}
+
+		// 左からと右からの累積で、各境目の左右の表面積と面数を求める
+		float leftArea[kBinNum - 1] = {};
+		float rightArea[kBinNum - 1] = {};
+		UINT leftCount[kBinNum - 1] = {};
+		UINT rightCount[kBinNum - 1] = {};
+
+		Bin leftBox;
+		Bin rightBox;
+
+		for (int i = 0; i < kBinNum - 1; ++i)
+		{
+			if (bins[i].m_count)
+			{
+				leftBox.m_min = Math::Vector3::Min(leftBox.m_min, bins[i].m_min);
+				leftBox.m_max = Math::Vector3::Max(leftBox.m_max, bins[i].m_max);
+				leftBox.m_count += bins[i].m_count;
+			}
+
+			leftCount[i] = leftBox.m_count;
+			leftArea[i] = leftBox.m_count ? CalcSurfaceArea(leftBox.m_min, leftBox.m_max) : 0.0f;
+
+			const Bin& rightBin = bins[kBinNum - 1 - i];
+
+			if (rightBin.m_count)
+			{
+				rightBox.m_min = Math::Vector3::Min(rightBox.m_min, rightBin.m_min);
+				rightBox.m_max = Math::Vector3::Max(rightBox.m_max, rightBin.m_max);
+				rightBox.m_count += rightBin.m_count;
+			}
+
+			rightCount[kBinNum - 2 - i] = rightBox.m_count;
+			rightArea[kBinNum - 2 - i] = rightBox.m_count ? CalcSurfaceArea(rightBox.m_min, rightBox.m_max) : 0.0f;
+		}
+
+		for (int i = 0; i < kBinNum - 1; ++i)
+		{
+			if (!leftCount[i] || !rightCount[i]) { continue; }
+
+			float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = i + 1;	// この区間から右側
+			}
+		}
+	}
+
+	if (bestAxis < 0) { return; }
+
+	// 分割しない場合のコストより高ければ葉のままにする
+	float leafCost = count * CalcSurfaceArea(m_nodes[nodeIdx].m_min, m_nodes[nodeIdx].m_max);
+
+	if (bestCost >= leafCost) { return; }
+
+	//------------------------------
+	// 面の並び替え：分割位置より左の面を前に集める
+	//------------------------------
+	float axisMin = (&centroidMin.x)[bestAxis];
+	float scale = kBinNum / ((&centroidMax.x)[bestAxis] - axisMin);
+
+	int i = static_cast<int>(first);
+	int j = static_cast<int>(first + count) - 1;
+
+	while (i <= j)
+	{
+		const FaceInfo& face = faceInfos[m_faceIndices[i]];
+
+		int binIdx = std::min(kBinNum - 1, static_cast<int>(((&face.m_centroid.x)[bestAxis] - axisMin) * scale));
+
+		if (binIdx < bestBin)
+		{
+			++i;
+		}
+		else
+		{
+			std::swap(m_faceIndices[i], m_faceIndices[j--]);
+		}
+	}
+
+	UINT leftCountNum = static_cast<UINT>(i) - first;
+
+	if (leftCountNum == 0 || leftCountNum == count) { return; }
+
+	//------------------------------
+	// 子ノードの作成
+	//------------------------------
+	UINT leftIdx = static_cast<UINT>(m_nodes.size());
+
+	Node left;
+	left.m_leftOrFirst = first;
+	left.m_count = leftCountNum;
+
+	Node right;
+	right.m_leftOrFirst = static_cast<UINT>(i);
+	right.m_count = count - leftCountNum;
+
+	m_nodes.push_back(left);
+	m_nodes.push_back(right);
+
+	// 枝にする
+	m_nodes[nodeIdx].m_leftOrFirst = leftIdx;
+	m_nodes[nodeIdx].m_count = 0;
+
+	UpdateNodeBounds(leftIdx, faceInfos);
+	UpdateNodeBounds(leftIdx + 1, faceInfos);
+
+	Subdivide(leftIdx, depth + 1, faceInfos);
+	Subdivide(leftIdx + 1, depth + 1, faceInfos);
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// レイと箱の判定(スラブ法)
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdMeshBVH::IntersectRayAABB(const Math::Vector3& rayPos, const Math::Vector3& invDir, const Node& node, float maxDist, float& enterDist)
+{
+	float tx1 = (node.m_min.x - rayPos.x) * invDir.x;
+	float tx2 = (node.m_max.x - rayPos.x) * invDir.x;
+	float tMin = std::min(tx1, tx2);
+	float tMax = std::max(tx1, tx2);
+
+	float ty1 = (node.m_min.y - rayPos.y) * invDir.y;
+	float ty2 = (node.m_max.y - rayPos.y) * invDir.y;
+	tMin = std::max(tMin, std::min(ty1, ty2));
+	tMax = std::min(tMax, std::max(ty1, ty2));
+
+	float tz1 = (node.m_min.z - rayPos.z) * invDir.z;
+	float tz2 = (node.m_max.z - rayPos.z) * invDir.z;
+	tMin = std::max(tMin, std::min(tz1, tz2));
+	tMax = std::min(tMax, std::max(tz1, tz2));
+
+	if (tMax < tMin || tMax < 0.0f || tMin > maxDist) { return false; }
+
+	enterDist = std::max(tMin, 0.0f);
+
+	return true;
+}
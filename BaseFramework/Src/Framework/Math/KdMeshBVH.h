@@ -0,0 +1,98 @@
+﻿#pragma once
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// メッシュの三角形を境界ボックスの階層(BVH)で分割したもの
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 当たり判定で全ての面を調べる代わりに、レイや球と重なる箱の中の面だけを調べるために使用する
+// 分割はSAH(表面積ヒューリスティック)：箱の表面積 × 中の面数 が小さくなる位置で分ける
+// 座標はメッシュのローカル空間：判定側でレイや球をローカル空間に変換してから辿る
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdMeshBVH
+{
+public:
+
+	// 木の1ノード(32byte)
+	struct Node
+	{
+		Math::Vector3	m_min;
+		UINT			m_leftOrFirst = 0;	// 枝：左の子のIndex(右の子は+1)　葉：m_faceIndicesの開始位置
+		Math::Vector3	m_max;
+		UINT			m_count = 0;		// 葉に含まれる面数：0なら枝
+
+		bool IsLeaf() const { return m_count > 0; }
+	};
+
+	// 作成
+	void Build(const std::vector<Math::Vector3>& positions, const std::vector<KdMeshFace>& faces);
+
+	// 頂点が動いた後に箱だけを計算し直す：面の分け方(木の構造)はそのまま
+	// 作り直すより大幅に速いが、作成時の形から大きく変形すると箱の重なりが増えて判定が遅くなる
+	void Refit(const std::vector<Math::Vector3>& positions, const std::vector<KdMeshFace>& faces);
+
+	// キャッシュファイルへの書き出し・読込
+	// 読込時は元のメッシュと面数が一致しなければ失敗とする
+	bool Save(std::ostream& os) const;
+	bool Load(std::istream& is, const std::vector<Math::Vector3>& positions, const std::vector<KdMeshFace>& faces);
+
+	// 外部の領域(ファイルを割り当てたメモリなど)の木をコピーせずにそのまま参照する：領域は呼び出し側で保持すること
+	// ・triangles	… faceIndicesの順に並べた三角形(KdTriangleSoAの格納領域と同じ並び)
+	// 範囲外のIndexを持つなど壊れている場合は失敗
+	bool Attach(std::span<const Node> nodes, std::span<const UINT> faceIndices, const float* pTriangles);
+
+	// レイとの判定：葉の面はSIMDでまとめて判定する
+	// ・rayPos/rayDir	… ローカル空間のレイ(rayDirは正規化済み)
+	// ・maxDist		… この距離より遠い箱・面は対象外：ヒットする度にその距離まで縮める
+	// ・anyHit			… trueなら最初のヒットで終了
+	// ・pHitFace		… 最も近くで当たった面のIndex(不要ならnullptr)
+	// 戻り値：1つでもヒットしたか
+	bool IntersectRay(const Math::Vector3& rayPos, const Math::Vector3& rayDir, float& maxDist, bool anyHit, UINT* pHitFace = nullptr) const;
+
+	// 指定の箱と重なる葉の面を全て列挙する
+	void CollectOverlapFaces(const DirectX::BoundingBox& aabb, std::vector<UINT>& result) const;
+
+	// 指定の点から距離radius以内にある面を全て列挙する：葉の面はSIMDでまとめて判定する
+	void CollectNearFaces(const Math::Vector3& center, float radius, std::vector<UINT>& result) const;
+
+	bool IsEmpty() const { return GetNodes().empty(); }
+
+	// 木のノード・葉から参照する面のIndex・葉の順に並べた三角形：Attach()している場合は外部の領域
+	std::span<const Node> GetNodes() const { return m_attachedNodes.empty() ? std::span<const Node>(m_nodes) : m_attachedNodes; }
+	std::span<const UINT> GetFaceIndices() const { return m_attachedNodes.empty() ? std::span<const UINT>(m_faceIndices) : m_attachedFaceIndices; }
+	const KdTriangleSoA& GetTriangles() const { return m_triangles; }
+
+private:
+
+	// 作成時の面1つ分の情報
+	struct FaceInfo
+	{
+		Math::Vector3	m_min;
+		Math::Vector3	m_max;
+		Math::Vector3	m_centroid;	// 重心：分割位置の判断に使う
+	};
+
+	// 範囲外のIndexを持っていないか検証する
+	static bool Validate(std::span<const Node> nodes, std::span<const UINT> faceIndices, UINT faceNum);
+
+	// ノードの境界ボックスを中の面から求める
+	void UpdateNodeBounds(UINT nodeIdx, const std::vector<FaceInfo>& faceInfos);
+	// ノードをSAHで分割する(再帰)
+	void Subdivide(UINT nodeIdx, int depth, const std::vector<FaceInfo>& faceInfos);
+
+	// レイと箱の判定：maxDist以内で当たっていればtrueと箱に入る距離を返す
+	static bool IntersectRayAABB(const Math::Vector3& rayPos, const Math::Vector3& invDir, const Node& node, float maxDist, float& enterDist);
+
+	// 木の深さの上限：辿る時のスタックの大きさになる
+	static constexpr int kMaxDepth = 48;
+	// この面数以下になったら分割しない：SIMDで一度に判定できる数に合わせる
+	static constexpr UINT kLeafFaceNum = KdTriangleSoA::kLaneNum;
+	// SAHの分割候補を探す区間の数
+	static constexpr int kBinNum = 16;
+
+	std::vector<Node>	m_nodes;
+	std::vector<UINT>	m_faceIndices;	// 葉から参照する面のIndex(並び替え済み)
+	KdTriangleSoA		m_triangles;	// m_faceIndicesと同じ順に並べた三角形：葉の面が連続するのでまとめて読み込める
+
+	// Attach()した外部の領域
+	std::span<const Node>	m_attachedNodes;
+	std::span<const UINT>	m_attachedFaceIndices;
+};
@@ -134,6 +134,12 @@ void KdStandardShader::DrawMesh(const KdMesh* mesh, const Math::Matrix& mWorld,
 {
 	if (mesh == nullptr) { return; }
 
+	// 当たり判定専用のメッシュは描画用のバッファを持たない
+	if (!mesh->HasGPUGeometry()) { return; }
+
+	// メッシュの頂点形式に合わせた入力レイアウトに切り替え
+	KdShaderManager::Instance().SetInputLayout(GetInputLayout(mesh->GetVertexLayout()));
+
 	// メッシュの頂点情報転送
 	mesh->SetToDevice();
 
@@ -158,6 +164,40 @@ void KdStandardShader::DrawMesh(const KdMesh* mesh, const Math::Matrix& mWorld,
 	}
 }
 
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// CPUで変形したスキンメッシュを描画
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 変形した頂点を転送し、頂点バッファだけ差し替えて元のメッシュのインデックス・サブセットで描画する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdStandardShader::DrawSkinnedMesh(const KdMesh* mesh, KdSkinnedMesh& skinned, const Math::Matrix& mWorld,
+	const std::vector<KdMaterial>& materials, const Math::Vector4& colRate, const Math::Vector3& emissive)
+{
+	if (mesh == nullptr || !mesh->HasGPUGeometry()) { return; }
+
+	if (!skinned.Upload()) { return; }
+
+	// 変形した頂点は通常形式
+	KdShaderManager::Instance().SetInputLayout(GetInputLayout(KdMesh::VertexLayout::Standard));
+
+	mesh->SetToDevice(skinned.GetVertexBuffer());
+
+	// 3Dワールド行列転送
+	m_cb1_Mesh.Work().mW = mWorld;
+	m_cb1_Mesh.Write();
+
+	// 全サブセット
+	for (UINT subi = 0; subi < mesh->GetSubsets().size(); subi++)
+	{
+		// 面が１枚も無い場合はスキップ
+		if (mesh->GetSubsets()[subi].FaceCount == 0)continue;
+
+		// マテリアルデータの転送
+		WriteMaterial(materials[mesh->GetSubsets()[subi].MaterialNo], colRate, emissive);
+
+		mesh->DrawSubset(subi);
+	}
+}
+
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // モデルデータを描画（スタティック(アニメーションをしない)なモデル専用
 // ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
@@ -204,25 +244,41 @@ void KdStandardShader::DrawModel(KdModelWork& rModel, const Math::Matrix& mWorld
 	// データがないときはスキップ
 	if (data == nullptr) { return; }
 
+	// KdAnimationBatchで更新済みなら計算済みの行列を読むだけ：登録されていないモデルはここで計算する
 	if (rModel.NeedCalcNodeMatrices())
 	{
 		rModel.CalcNodeMatrices();
 	}
 
+	// スキンメッシュを現在の姿勢に変形：事前に変形済みなら何もしない
+	if (data->IsSkinMesh())
+	{
+		rModel.UpdateSkinning();
+	}
+
 	// オブジェクト単位の情報転送
 	if (m_dirtyCBObj)
 	{
 		m_cb0_Obj.Write();
 	}
 
-	auto& workNodes = rModel.GetNodes();
 	auto& dataNodes = data->GetOriginalNodes();
 
 	// 全描画用メッシュノードを描画
 	for (auto& nodeIdx : data->GetDrawMeshNodeIndices())
 	{
+		// 変形したスキンメッシュ
+		KdSkinnedMesh* pSkinned = rModel.WorkSkinnedMesh(nodeIdx);
+
+		if (pSkinned && !pSkinned->IsEmpty())
+		{
+			DrawSkinnedMesh(dataNodes[nodeIdx].m_spMesh.get(), *pSkinned, mWorld, data->GetMaterials(), colRate, emissive);
+
+			continue;
+		}
+
 		// 描画
-		DrawMesh(dataNodes[nodeIdx].m_spMesh.get(), workNodes[nodeIdx].m_worldTransform * mWorld,
+		DrawMesh(dataNodes[nodeIdx].m_spMesh.get(), rModel.GetWorldTransform(nodeIdx) * mWorld,
 			data->GetMaterials(), colRate, emissive);
 	}
 
@@ -233,6 +289,87 @@ void KdStandardShader::DrawModel(KdModelWork& rModel, const Math::Matrix& mWorld
 	}
 }
 
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 静的バッチを描画（結合済みの背景
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 頂点は結合時にワールド座標へ変換済みなので行列は単位行列
+// カリングありの場合は視錐台に入っている範囲だけを描画し、隣接する範囲は1回の描画命令にまとめる
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdStandardShader::DrawStaticBatch(const KdStaticBatch& rBatch, const DirectX::BoundingFrustum* pFrustum,
+	const Math::Color& colRate, const Math::Vector3& emissive)
+{
+	const KdMesh* pMesh = rBatch.GetMesh().get();
+
+	if (!pMesh) { return; }
+
+	// 全体が視錐台の外なら何もしない
+	if (pFrustum && !pFrustum->Intersects(rBatch.GetBoundingBox())) { return; }
+
+	// オブジェクト単位の情報転送
+	if (m_dirtyCBObj)
+	{
+		m_cb0_Obj.Write();
+	}
+
+	// カリングなしならサブセット(マテリアル)毎に描画するだけ
+	if (!pFrustum)
+	{
+		DrawMesh(pMesh, Math::Matrix::Identity, rBatch.GetMaterials(), colRate, emissive);
+	}
+	else
+	{
+		KdShaderManager::Instance().SetInputLayout(GetInputLayout(pMesh->GetVertexLayout()));
+
+		pMesh->SetToDevice();
+
+		m_cb1_Mesh.Work().mW = Math::Matrix::Identity;
+		m_cb1_Mesh.Write();
+
+		const std::vector<KdStaticBatch::Range>& ranges = rBatch.GetRanges();
+
+		// まとめて描画する面の範囲
+		UINT drawStart = 0;
+		UINT drawCount = 0;
+
+		// マテリアルを転送済みのサブセット
+		int writtenSubset = -1;
+
+		for (size_t i = 0; i < ranges.size(); ++i)
+		{
+			const KdStaticBatch::Range& range = ranges[i];
+
+			if (!pFrustum->Intersects(range.m_aabb)) { continue; }
+
+			// 直前の範囲と連続していれば繋げる
+			if (drawCount && writtenSubset == static_cast<int>(range.m_subsetNo) && drawStart + drawCount == range.m_faceStart)
+			{
+				drawCount += range.m_faceCount;
+				continue;
+			}
+
+			pMesh->DrawFaces(drawStart, drawCount);
+
+			if (writtenSubset != static_cast<int>(range.m_subsetNo))
+			{
+				WriteMaterial(rBatch.GetMaterials()[range.m_subsetNo], colRate, emissive);
+
+				writtenSubset = range.m_subsetNo;
+			}
+
+			drawStart = range.m_faceStart;
+			drawCount = range.m_faceCount;
+		}
+
+		pMesh->DrawFaces(drawStart, drawCount);
+	}
+
+	// 定数に変更があった場合は自動的に初期状態に戻す
+	if (m_dirtyCBObj)
+	{
+		ResetCBObject();
+	}
+}
+
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // ポリゴンを描画（モデル以外のプログラム上で生成された頂点の集合体
 // ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
@@ -281,6 +418,9 @@ void KdStandardShader::DrawPolygon(const KdPolygon& rPolygon, const Math::Matrix
 		KdShaderManager::Instance().ChangeSamplerState(KdSamplerState::Anisotropic_Clamp);
 	}
 
+	// ポリゴンの頂点は通常形式：直前に圧縮形式のメッシュを描画していても戻す
+	KdShaderManager::Instance().SetInputLayout(m_inputLayout);
+
 	// 描画パイプラインのチェック
 	ID3D11VertexShader* pNowVS = nullptr;
 	KdDirect3D::Instance().WorkDevContext()->VSGetShader(&pNowVS, nullptr, nullptr);
@@ -347,6 +487,9 @@ void KdStandardShader::DrawVertices(const std::vector<KdPolygon::Vertex>& vertic
 		KdShaderManager::Instance().ChangeSamplerState(KdSamplerState::Anisotropic_Clamp);
 	}
 
+	// 頂点は通常形式：直前に圧縮形式のメッシュを描画していても戻す
+	KdShaderManager::Instance().SetInputLayout(m_inputLayout);
+
 	// 描画パイプラインのチェック
 	ID3D11VertexShader* pNowVS = nullptr;
 	KdDirect3D::Instance().WorkDevContext()->VSGetShader(&pNowVS, nullptr, nullptr);
@@ -412,6 +555,41 @@ bool KdStandardShader::Init()
 			Release();
 			return false;
 		}
+
+		// 圧縮形式の頂点：スロット0に座標、スロット1にそれ以外の属性(KdMeshCompactVertex)
+		// 量子化した値はSNORM・FLOATとして読み込まれるのでシェーダー側はfloatのまま受け取れる
+		std::vector<D3D11_INPUT_ELEMENT_DESC> compactLayout = {
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,		0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,			1,  0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "COLOR",    0, DXGI_FORMAT_R8G8B8A8_UNORM,		1,  4, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "NORMAL",   0, DXGI_FORMAT_R8G8B8A8_SNORM,		1,  8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "TANGENT",  0, DXGI_FORMAT_R8G8B8A8_SNORM,		1, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		};
+
+		if (FAILED(KdDirect3D::Instance().WorkDev()->CreateInputLayout(
+			&compactLayout[0], compactLayout.size(), &compiledBuffer[0], sizeof(compiledBuffer), &m_inputLayoutCompact))
+			) {
+			assert(0 && "CreateInputLayout失敗");
+			Release();
+			return false;
+		}
+
+		// 圧縮形式の頂点(UVはfloat)：スロット1はKdMeshCompactWideUVVertex
+		std::vector<D3D11_INPUT_ELEMENT_DESC> compactWideUVLayout = {
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,		0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,			1,  0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "COLOR",    0, DXGI_FORMAT_R8G8B8A8_UNORM,		1,  8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "NORMAL",   0, DXGI_FORMAT_R8G8B8A8_SNORM,		1, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "TANGENT",  0, DXGI_FORMAT_R8G8B8A8_SNORM,		1, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		};
+
+		if (FAILED(KdDirect3D::Instance().WorkDev()->CreateInputLayout(
+			&compactWideUVLayout[0], compactWideUVLayout.size(), &compiledBuffer[0], sizeof(compiledBuffer), &m_inputLayoutCompactWideUV))
+			) {
+			assert(0 && "CreateInputLayout失敗");
+			Release();
+			return false;
+		}
 	}
 
 	{
@@ -503,6 +681,8 @@ void KdStandardShader::Release()
 	KdSafeRelease(m_VS_UnLit);
 
 	KdSafeRelease(m_inputLayout);
+	KdSafeRelease(m_inputLayoutCompact);
+	KdSafeRelease(m_inputLayoutCompactWideUV);
 	
 	KdSafeRelease(m_PS_Lit);
 	KdSafeRelease(m_PS_GenDepthFromLight);
@@ -566,6 +746,22 @@ void KdStandardShader::ConvertNormalsFor2D(std::vector<KdPolygon::Vertex>& targe
 	}
 }
 
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// メッシュの頂点形式に対応する入力レイアウトを取得
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+ID3D11InputLayout* KdStandardShader::GetInputLayout(KdMesh::VertexLayout layout) const
+{
+	switch (layout)
+	{
+	case KdMesh::VertexLayout::Compact:
+		return m_inputLayoutCompact;
+	case KdMesh::VertexLayout::CompactWideUV:
+		return m_inputLayoutCompactWideUV;
+	default:
+		return m_inputLayout;
+	}
+}
+
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 // オブジェクト定数バッファを初期状態に戻す
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
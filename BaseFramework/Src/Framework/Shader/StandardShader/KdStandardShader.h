@@ -158,6 +158,10 @@ public:
 	void DrawModel(KdModelWork& rModel, const Math::Matrix& mWorld = Math::Matrix::Identity,
 		const Math::Color& colRate = kWhiteColor, const Math::Vector3& emissive = Math::Vector3::Zero);
 
+	// 静的バッチ描画：pFrustumを渡すと元のノード単位で視錐台カリングを行う
+	void DrawStaticBatch(const KdStaticBatch& rBatch, const DirectX::BoundingFrustum* pFrustum = nullptr,
+		const Math::Color& colRate = kWhiteColor, const Math::Vector3& emissive = Math::Vector3::Zero);
+
 	// 任意の頂点群からなるポリゴン描画
 	void DrawPolygon(const KdPolygon& poly, const Math::Matrix& mWorld = Math::Matrix::Identity,
 		const Math::Color& colRate = kWhiteColor, const Math::Vector3& emissive = Math::Vector3::Zero);
@@ -184,6 +188,10 @@ public:
 
 private:
 
+	// CPUで変形したスキンメッシュの描画：頂点はモデルの原点の空間にあるのでmWorldはモデルの行列
+	void DrawSkinnedMesh(const KdMesh* mesh, KdSkinnedMesh& skinned, const Math::Matrix& mWorld,
+		const std::vector<KdMaterial>& materials, const Math::Vector4& colRate, const Math::Vector3& emissive);
+
 	// マテリアルのセット
 	void WriteMaterial(const KdMaterial& material, const Math::Vector4& colRate, const Math::Vector3& emiRate);
 
@@ -193,6 +201,9 @@ private:
 	// 定数バッファを初期状態に戻す
 	void ResetCBObject();
 
+	// メッシュの頂点形式に対応する入力レイアウトを取得
+	ID3D11InputLayout* GetInputLayout(KdMesh::VertexLayout layout) const;
+
 	// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
 	// Lit：陰影をつけるオブジェクトの描画用（不透明な物体やキャラクタの板ポリなど
 	// 平行光・点光源などの影響を受け角度によって色を変化させるオブジェクトを描画するシェーダー
@@ -210,7 +221,9 @@ private:
 	ID3D11VertexShader* m_VS_GenDepthFromLight = nullptr;	// 光からの深度
 
 	// 頂点入力レイアウト
-	ID3D11InputLayout* m_inputLayout = nullptr;
+	ID3D11InputLayout* m_inputLayout = nullptr;					// 通常形式(KdMeshVertex・KdPolygon::Vertex)
+	ID3D11InputLayout* m_inputLayoutCompact = nullptr;			// 圧縮形式(座標 + KdMeshCompactVertex)
+	ID3D11InputLayout* m_inputLayoutCompactWideUV = nullptr;	// 圧縮形式(座標 + KdMeshCompactWideUVVertex)
 	
 	// ピクセルシェーダー
 	ID3D11PixelShader* m_PS_Lit = nullptr;					// 陰影あり
@@ -0,0 +1,295 @@
+﻿#include "KdAssetPrefetcher.h"
+
+// 先読みスレッドからのアクセスは記録・統計の対象外にするための識別フラグ
+static thread_local bool s_isPrefetchThread = false;
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 初期化
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// KdAssetsの各保管庫にアクセス通知を設定し、GetData()の呼び出しを監視する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAssetPrefetcher::Init(Mode mode, std::string_view manifestDir)
+{
+	m_mode = mode;
+	m_manifestDir = manifestDir.data();
+
+	if (m_mode == Mode::Disable) { return; }
+
+	KdAssets::Instance().m_textures.SetAccessCallback([this](std::string_view fileName, bool isLoaded)
+		{
+			OnAccess(AssetType::Texture, fileName, isLoaded);
+		});
+
+	KdAssets::Instance().m_modeldatas.SetAccessCallback([this](std::string_view fileName, bool isLoaded)
+		{
+			OnAccess(AssetType::Model, fileName, isLoaded);
+		});
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// シーン開始
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 先読みモードでマニフェストが存在すれば並列読込を開始する
+// マニフェストが無い場合は今回のシーンで記録を行う
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAssetPrefetcher::BeginScene(std::string_view sceneName)
+{
+	if (m_mode == Mode::Disable) { return; }
+
+	// 前のシーンが閉じられていなければ閉じておく
+	if (!m_sceneName.empty()) { EndScene(); }
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_sceneName = sceneName.data();
+	m_stats = Stats();
+
+	m_records.clear();
+	m_touchedFiles.clear();
+	m_prefetchList.clear();
+	m_issuedFiles.clear();
+
+	m_nextPrefetchIdx = 0;
+	m_finishedCount = 0;
+	m_prefetchedCount = 0;
+
+	m_isRecording = (m_mode == Mode::Record);
+
+	if (m_mode != Mode::Prefetch) { return; }
+
+	if (!LoadManifest(m_sceneName, m_prefetchList))
+	{
+		// マニフェストが無ければ次回のために記録する
+		m_isRecording = true;
+
+		return;
+	}
+
+	m_stats.m_requested = m_prefetchList.size();
+
+	// 先読みスレッドの起動：メインスレッドの分を1つ空けておく
+	// hardware_concurrency()は取得できないと0を返すので、引く前に確認する
+	UINT threadNum = std::thread::hardware_concurrency();
+	UINT workerNum = threadNum > 1 ? threadNum - 1 : 1;
+	workerNum = std::min<UINT>(workerNum, m_prefetchList.size());
+
+	for (UINT i = 0; i < workerNum; ++i)
+	{
+		m_workers.push_back(std::async(std::launch::async, [this]() { PrefetchProc(); }));
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// シーン終了
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 先読みスレッドの終了を待ち、統計を確定させて記録したマニフェストを書き出す
+// 統計情報の文字列はGetReport()で取得できる：SetReportOutput(true)ならデバッグ出力もする
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAssetPrefetcher::EndScene()
+{
+	if (m_mode == Mode::Disable || m_sceneName.empty()) { return; }
+
+	WaitPrefetch();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// 一度も使われなかった先読みアセットの集計
+	for (const std::string& fileName : m_issuedFiles)
+	{
+		if (m_touchedFiles.find(fileName) == m_touchedFiles.end())
+		{
+			++m_stats.m_unused;
+		}
+	}
+
+	m_stats.m_prefetched = m_prefetchedCount;
+
+	if (m_isRecording && m_records.size())
+	{
+		SaveManifest(m_sceneName, m_records);
+	}
+
+	m_report = KdFormat("[KdAssetPrefetcher] %s : requested=%u prefetched=%u hit=%u miss=%u unused=%u\n",
+		m_sceneName.c_str(), m_stats.m_requested, m_stats.m_prefetched, m_stats.m_hits, m_stats.m_misses, m_stats.m_unused);
+
+	if (m_isReportOutput) { OutputDebugStringA(m_report.c_str()); }
+
+	m_isRecording = false;
+	m_sceneName.clear();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 先読みの完了を待機する
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAssetPrefetcher::WaitPrefetch()
+{
+	for (auto& worker : m_workers)
+	{
+		if (worker.valid()) { worker.wait(); }
+	}
+
+	m_workers.clear();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 解放
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAssetPrefetcher::Release()
+{
+	// 実行中の先読みスレッドを待たずに解放すると読込先が消えてしまう
+	m_nextPrefetchIdx = m_prefetchList.size();
+
+	WaitPrefetch();
+
+	m_records.clear();
+	m_touchedFiles.clear();
+	m_prefetchList.clear();
+	m_issuedFiles.clear();
+
+	m_sceneName.clear();
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// KdAssetsからのアクセス通知
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// シーン中の初回アクセスのみ記録・統計の対象とする
+// isLoaded：この呼び出しで同期読込が発生したかどうか
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAssetPrefetcher::OnAccess(AssetType type, std::string_view fileName, bool isLoaded)
+{
+	// 先読みスレッド内の入れ子の読込(モデルのテクスチャなど)は対象外
+	if (s_isPrefetchThread) { return; }
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_sceneName.empty()) { return; }
+
+	// 2回目以降のアクセスは無視
+	if (!m_touchedFiles.insert(fileName.data()).second) { return; }
+
+	if (m_isRecording)
+	{
+		m_records.push_back({ type, fileName.data() });
+	}
+
+	if (m_mode != Mode::Prefetch) { return; }
+
+	// このシーンで先読み済み(または先読み中の完了を待った)ならヒット
+	// 前のシーンから読み込まれたままのアセットは先読みの効果ではないので数えない
+	if (!isLoaded && m_issuedFiles.find(fileName.data()) != m_issuedFiles.end())
+	{
+		++m_stats.m_hits;
+	}
+	// 同期読込が発生した：先読みが間に合わなかった or マニフェストに無かった
+	else if (isLoaded)
+	{
+		++m_stats.m_misses;
+	}
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// マニフェストの読込：1行に「種類,ファイルパス」
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+bool KdAssetPrefetcher::LoadManifest(std::string_view sceneName, std::vector<Entry>& result) const
+{
+	std::string path = GetManifestPath(sceneName);
+
+	if (!KdFileExistence(path)) { return false; }
+
+	KdCSVData manifest(path);
+
+	for (size_t i = 0; i < manifest.GetLineSize(); ++i)
+	{
+		const std::vector<std::string>& line = manifest.GetLine(i);
+
+		if (line.size() < 2) { continue; }
+
+		Entry entry;
+		entry.m_type = (line[0] == "Model") ? AssetType::Model : AssetType::Texture;
+		entry.m_fileName = line[1];
+
+		result.push_back(entry);
+	}
+
+	return true;
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// マニフェストの書き出し
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAssetPrefetcher::SaveManifest(std::string_view sceneName, const std::vector<Entry>& entries) const
+{
+	std::filesystem::create_directories(m_manifestDir);
+
+	std::ofstream ofs(GetManifestPath(sceneName));
+
+	if (!ofs)
+	{
+		assert(0 && "KdAssetPrefetcher::SaveManifest マニフェストファイルが作成できません");
+
+		return;
+	}
+
+	for (const Entry& entry : entries)
+	{
+		ofs << (entry.m_type == AssetType::Model ? "Model" : "Texture") << "," << entry.m_fileName << "\n";
+	}
+}
+
+std::string KdAssetPrefetcher::GetManifestPath(std::string_view sceneName) const
+{
+	return m_manifestDir + sceneName.data() + ".csv";
+}
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// 先読みスレッドの処理本体
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 各スレッドが先読みリストから1件ずつ取り出して読み込む：記録された順番 = 必要になる順番
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+void KdAssetPrefetcher::PrefetchProc()
+{
+	s_isPrefetchThread = true;
+
+	// 画像の読込(WIC)にCOMが必要
+	HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	while (true)
+	{
+		size_t idx = m_nextPrefetchIdx++;
+
+		if (idx >= m_prefetchList.size()) { break; }
+
+		const Entry& entry = m_prefetchList[idx];
+
+		bool isResident = (entry.m_type == AssetType::Model) ?
+			KdAssets::Instance().m_modeldatas.IsResident(entry.m_fileName) :
+			KdAssets::Instance().m_textures.IsResident(entry.m_fileName);
+
+		if (!isResident && KdFileExistence(entry.m_fileName))
+		{
+			// 読込の前に登録する：読込中に初回アクセスされて完了を待った場合もヒットになる
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+
+				m_issuedFiles.insert(entry.m_fileName);
+			}
+
+			if (entry.m_type == AssetType::Model)
+			{
+				KdAssets::Instance().m_modeldatas.PrefetchData(entry.m_fileName);
+			}
+			else
+			{
+				KdAssets::Instance().m_textures.PrefetchData(entry.m_fileName);
+			}
+
+			++m_prefetchedCount;
+		}
+
+		++m_finishedCount;
+	}
+
+	if (SUCCEEDED(hrCom)) { CoUninitialize(); }
+
+	s_isPrefetchThread = false;
+}
@@ -0,0 +1,127 @@
+﻿#pragma once
+
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+// シーン単位でアセットの先読みを行うクラス
+// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+// 記録：シーン中にKdAssetsから取得されたアセットを順番通りにマニフェスト(CSV)へ書き出す
+// 先読み：マニフェストを元にシーン開始時に複数スレッドで並列にアセットを読み込んでおく
+// 運用にはシーンの切り替わりでBeginScene()・EndScene()を呼ぶ必要がある
+// 複数存在する事を許さないのでシングルトンパターンを使用
+// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
+class KdAssetPrefetcher
+{
+public:
+
+	// 動作モード
+	enum class Mode
+	{
+		Disable,	// 何もしない
+		Record,		// アクセスされたアセットを記録してマニフェストを作成する
+		Prefetch,	// マニフェストを元に先読みする：マニフェストが無いシーンは記録を行う
+	};
+
+	// アセットの種類
+	enum class AssetType
+	{
+		Texture,
+		Model,
+	};
+
+	// 先読みの統計情報
+	struct Stats
+	{
+		UINT	m_requested = 0;	// マニフェストに記載されていたアセット数
+		UINT	m_prefetched = 0;	// 先読みで実際に読み込んだアセット数
+		UINT	m_hits = 0;			// 初回アクセス時にこのシーンの先読みで読み込まれていた数
+		UINT	m_misses = 0;		// 初回アクセス時に同期読込が発生した数
+		UINT	m_unused = 0;		// 先読みしたがシーン中に一度も使われなかった数
+	};
+
+	// 初期化：KdAssetsの各保管庫へアクセス監視を設定する
+	void Init(Mode mode, std::string_view manifestDir = "Asset/Data/AssetManifest/");
+
+	// シーン開始：先読みモードならマニフェストを読み込んで並列読込を開始する
+	void BeginScene(std::string_view sceneName);
+	// シーン終了：記録したマニフェストの書き出しと統計情報の確定
+	void EndScene();
+
+	// 先読みが全て完了しているか
+	bool IsPrefetchFinished() const { return m_finishedCount >= m_prefetchList.size(); }
+	// 先読みの完了を待機する
+	void WaitPrefetch();
+
+	Mode GetMode() const { return m_mode; }
+
+	// 現在(または直前)のシーンの統計情報
+	const Stats& GetStats() const { return m_stats; }
+	// 直前に終了したシーンの統計情報の文字列
+	const std::string& GetReport() const { return m_report; }
+
+	// シーン終了時に統計情報の文字列をデバッグ出力するか(既定は出力しない)
+	void SetReportOutput(bool enable) { m_isReportOutput = enable; }
+
+	// 解放
+	void Release();
+
+	static KdAssetPrefetcher& Instance()
+	{
+		static KdAssetPrefetcher instance;
+		return instance;
+	}
+
+private:
+
+	// マニフェストの1行分
+	struct Entry
+	{
+		AssetType	m_type = AssetType::Texture;
+		std::string	m_fileName;
+	};
+
+	// KdAssetsからのアクセス通知
+	void OnAccess(AssetType type, std::string_view fileName, bool isLoaded);
+
+	// マニフェストの入出力
+	bool LoadManifest(std::string_view sceneName, std::vector<Entry>& result) const;
+	void SaveManifest(std::string_view sceneName, const std::vector<Entry>& entries) const;
+	std::string GetManifestPath(std::string_view sceneName) const;
+
+	// 先読みスレッドの処理本体
+	void PrefetchProc();
+
+	Mode			m_mode = Mode::Disable;
+
+	std::string		m_manifestDir;
+	std::string		m_sceneName;
+
+	// 記録中かどうか
+	bool			m_isRecording = false;
+
+	// 記録したアセットリスト(初回アクセス順)
+	std::vector<Entry>				m_records;
+	// シーン中に一度でもアクセスされたアセット
+	std::unordered_set<std::string>	m_touchedFiles;
+
+	// 先読み対象リスト
+	std::vector<Entry>				m_prefetchList;
+	// このシーンの先読みで実際に読込を発行したアセット：前のシーンから残っていたものは含まない
+	std::unordered_set<std::string>	m_issuedFiles;
+	// 次に先読みするリストのIndex
+	std::atomic<size_t>				m_nextPrefetchIdx = 0;
+	// 先読みが完了した数
+	std::atomic<size_t>				m_finishedCount = 0;
+	// 先読みで実際に読込が発生した数
+	std::atomic<UINT>				m_prefetchedCount = 0;
+
+	// 先読みスレッド
+	std::vector<std::future<void>>	m_workers;
+
+	Stats			m_stats;
+	std::string		m_report;
+	bool			m_isReportOutput = false;
+
+	std::mutex		m_mutex;
+
+	KdAssetPrefetcher() {}
+	~KdAssetPrefetcher() { Release(); }
+};
@@ -28,6 +28,8 @@ public:
 			return nullptr;
 		}
 
+		std::lock_guard<std::mutex> lock(m_mutex);
+
 		m_spDatas[fileName.data()] = newData;
 
 		return newData;
@@ -36,26 +38,43 @@ public:
 	// データの取得：リスト内に存在しない場合は新しくロードする
 	std::shared_ptr<DataType> GetData(std::string_view fileName)
 	{
-		// リストの中に欲しいデータがあるか検索
-		auto findData = m_spDatas.find(fileName.data());
+		bool isLoaded = false;
 
-		// データがあった場合
-		if (findData != m_spDatas.end())
-		{
-			// そのままデータを共有
-			return (*findData).second;
-		}
-		// データが無かった場合
-		else
+		std::shared_ptr<DataType> spData = FindOrLoadData(fileName, isLoaded);
+
+		// 読込監視用の通知：どのアセットがいつ必要になったかを記録する
+		if (m_onAccess)
 		{
-			// 新たにデータをロードする
-			return LoadData(fileName);
+			m_onAccess(fileName, isLoaded);
 		}
+
+		return spData;
+	}
+
+	// 先読み用の取得：アクセス通知を行わずにリスト内へ読み込んでおく
+	std::shared_ptr<DataType> PrefetchData(std::string_view fileName)
+	{
+		bool isLoaded = false;
+
+		return FindOrLoadData(fileName, isLoaded);
+	}
+
+	// 既にリスト内に存在しているか
+	bool IsResident(std::string_view fileName)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		return m_spDatas.find(fileName.data()) != m_spDatas.end();
 	}
 
+	// アクセス通知の設定：引数はファイル名と、この呼び出しで読込が発生したかどうか
+	void SetAccessCallback(const std::function<void(std::string_view, bool)>& onAccess) { m_onAccess = onAccess; }
+
 	// 保持しているデータの破棄
 	void ClearData(bool force)
 	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
 		if (force)
 		{
 			// 強制的にすべてのデータを消去
@@ -79,7 +98,68 @@ public:
 	}
 
 private:
+
+	// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+	// リスト内の検索と読込
+	// ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== ===== =====
+	// 別スレッドから同時に呼ばれても同じファイルを二重に読み込まないよう
+	// 読込中のファイル名を登録しておき、後から来た呼び出しは読込完了を待つ
+	std::shared_ptr<DataType> FindOrLoadData(std::string_view fileName, bool& isLoaded)
+	{
+		std::string key = fileName.data();
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			// 他のスレッドが読込中なら終わるまで待機
+			m_loadedCondition.wait(lock, [&]() { return m_loadingFiles.find(key) == m_loadingFiles.end(); });
+
+			// リストの中に欲しいデータがあるか検索
+			auto findData = m_spDatas.find(key);
+
+			// データがあった場合はそのままデータを共有
+			if (findData != m_spDatas.end()) { return findData->second; }
+
+			// 読込中として登録
+			m_loadingFiles.insert(key);
+		}
+
+		// 読込自体はロックの外で行う：テクスチャなどの入れ子の読込や他ファイルの並列読込を妨げない
+		std::shared_ptr<DataType> newData = std::make_shared<DataType>();
+
+		if (!newData->Load(fileName))
+		{
+			assert(0 && "KdDataStorage::GetData ファイルが存在しません。ファイルパスを確認してください");
+
+			newData = nullptr;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if (newData) { m_spDatas[key] = newData; }
+
+			m_loadingFiles.erase(key);
+		}
+
+		m_loadedCondition.notify_all();
+
+		isLoaded = true;
+
+		return newData;
+	}
+
 	std::unordered_map<std::string, std::shared_ptr<DataType>> m_spDatas;
+
+	// 読込中のファイル名リスト
+	std::unordered_set<std::string>	m_loadingFiles;
+
+	// スレッド間の排他制御
+	std::mutex							m_mutex;
+	std::condition_variable				m_loadedCondition;
+
+	// アクセス通知
+	std::function<void(std::string_view, bool)>	m_onAccess;
 };
 
 // ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// ///// /////
@@ -109,9 +109,9 @@ inline std::string KdGetNameFromPath(const std::string& path, bool onlyFileName
 template <typename ... Args>
 std::string KdFormat(std::string_view fmt, Args ... args)
 {
-	size_t len = std::snprintf(nullptr, 0, fmt, args ...);
+	size_t len = std::snprintf(nullptr, 0, fmt.data(), args ...);
 	std::vector<char> buf(len + 1);
-	std::snprintf(&buf[0], len + 1, fmt, args ...);
+	std::snprintf(&buf[0], len + 1, fmt.data(), args ...);
 	return std::string(&buf[0], &buf[0] + len);
 }
 
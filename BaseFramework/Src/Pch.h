@@ -31,6 +31,7 @@
 #include <unordered_set>
 #include <string>
 #include <array>
+#include <span>
 #include <vector>
 #include <stack>
 #include <list>
@@ -47,6 +48,7 @@
 #include <atomic>
 #include <mutex>
 #include <future>
+#include <condition_variable>
 #include <fileSystem>
 
 //===============================================